@@ -0,0 +1,852 @@
+/*
+ * Fleet load generator: N simulated filterchlorine units against a broker.
+ *
+ * Each simulated unit runs the firmware's MQTT behaviour - client id and
+ * last will, "online" on connect, identity/ota/schema reports, cmd and
+ * fleet cmd subscriptions, retry every RETRY_INTERVAL plus up to
+ * RETRY_JITTER, telemetry in its identity slot - and encodes its sensors
+ * message with the firmware's own encoder (lib/telemetry) onto the
+ * firmware's topic table (lib/identity/topics). Units are spread over a
+ * pool of worker threads.
+ *
+ * A separate monitor connection subscribes to filterchlorine/+/sensors/#
+ * and filterchlorine/+/status, so every number below is end to end through
+ * the broker:
+ *
+ *   - publish and delivery rate (messages and bytes per second)
+ *   - latency percentiles, publish -> delivery to the monitor
+ *   - messages lost (gaps in each unit's sequence numbers)
+ *   - connects, failed attempts, last wills seen, reconnect times
+ *
+ * Scenarios:
+ *   --storm-at S --outage S   broker unreachable for every unit at once, as
+ *                             when the broker restarts; --no-jitter retries
+ *                             in lockstep instead of the firmware's spread
+ *   --storm-every S           repeat the storm
+ *   --ota-at S                "UPDATE" on filterchlorine/all/cmd: every unit
+ *                             reports updating, downloads for --ota-seconds,
+ *                             reboots (the broker sends its will) and comes
+ *                             back reporting ready
+ *   --drop P --stall P --corrupt P
+ *                             per-publish fault probabilities: close the
+ *                             socket without a goodbye, stop servicing the
+ *                             connection until the broker's keepalive timeout
+ *                             drops it, or send a truncated payload
+ *
+ * Build:  make -C dev/fleetsim   (needs ArduinoJson's headers, see Makefile)
+ * Usage:  dev/fleetsim/fleetsim --devices 500 --threads 8 --interval 1000 \
+ *             --encoding cbor --duration 120 --storm-at 60 --outage 10
+ */
+
+#include <getopt.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mqtt_wire.h"
+#include "../../lib/mqtt/mqtt_config.h"
+#include "../../lib/telemetry/telemetry.h"
+#include "../../lib/telemetry/telemetry_keys.h"
+#include "../../lib/identity/topics.h"
+
+#define SEQ_RING 1024               // publishes per unit the monitor can still match to a send time
+#define CONNECT_TIMEOUT 5000        // ms
+#define STALL_MS (MQTT_KEEPALIVE * 2000)    // past the broker's 1.5 x keepalive
+#define REBOOT_MS 3000              // OTA restart until the unit reconnects
+#define WORKER_IDLE_MS 20           // longest a worker sleeps between passes
+
+
+struct Options {
+    const char * host = "localhost";
+    uint16_t port = 1883;
+    const char * user = "";
+    const char * password = "";
+    const char * prefix = "sim";
+    int devices = 100;
+    int threads = 4;
+    uint32_t interval_ms = 5000;
+    TelemetryEncoding encoding = TELEMETRY_JSON;
+    int duration_s = 60;
+    int report_s = 5;
+    int storm_at_s = 0;
+    int storm_every_s = 0;
+    int outage_s = 5;
+    bool jitter = true;
+    int ota_at_s = 0;
+    int ota_seconds = 20;
+    double drop = 0;
+    double stall = 0;
+    double corrupt = 0;
+    uint32_t seed = 1;
+};
+
+static Options options;
+static std::atomic<bool> running(true);
+static std::atomic<uint64_t> outage_until_ms(0);
+static std::atomic<uint32_t> storm_count(0);
+
+
+// Everything the report reads; the latency samples are shared with the monitor
+struct Stats {
+    std::atomic<uint64_t> published{0}, published_bytes{0}, publish_failed{0};
+    std::atomic<uint64_t> received{0}, received_bytes{0}, lost{0}, undecodable{0};
+    std::atomic<uint64_t> connects{0}, connect_failed{0}, connections_lost{0}, wills{0};
+    std::atomic<uint64_t> drops{0}, stalls{0}, corrupted{0}, commands{0}, reboots{0};
+    std::atomic<int> online{0};
+
+    std::mutex lock;
+    std::vector<uint32_t> latency_us;       // since the last report
+    std::vector<uint32_t> reconnect_ms;     // for the whole run
+};
+
+static Stats stats;
+
+
+struct SentStamp {
+    std::atomic<uint32_t> seq{UINT32_MAX};
+    std::atomic<uint64_t> us{0};
+};
+
+
+/*
+ * One simulated unit. Owned by a single worker; the monitor only reads the
+ * send stamps.
+ */
+struct SimDevice {
+
+    enum State : uint8_t { OFFLINE, ONLINE, STALLED, REBOOTING };
+
+    int index;
+    char id[32];
+    char client_id[48];
+    uint32_t hash;
+    Topics topics;
+    MqttWire wire;
+    std::mt19937 rng;
+
+    State state = OFFLINE;
+    bool first_connect = true;
+    uint32_t storms_seen = 0;
+    uint64_t boot_ms = 0;
+    uint64_t retry_at = 0;
+    uint64_t down_since = 0;
+    uint64_t next_publish = 0;
+    uint64_t resume_at = 0;         // end of a stall or reboot
+    uint64_t ota_done_at = 0;       // download finishes, then reboot
+
+    uint32_t seq = 0;
+    SentStamp sent[SEQ_RING];
+
+    // Simulated cell
+    float current_mA = 1000;
+    float busvoltage = 12.0;
+    bool forward = true;
+    uint32_t reverse_count = 0;
+    uint64_t next_reverse = 0;
+
+    void begin(int i, uint64_t now);
+    void step(uint64_t now);
+    uint64_t wake_at() const;
+
+    private:
+
+        void _connect(uint64_t now);
+        void _online(uint64_t now);
+        void _lost(uint64_t now);
+        void _publish_sensors(uint64_t now);
+        void _on_message(const char * topic, size_t topic_len, const uint8_t * payload, size_t len, uint64_t now);
+        uint32_t _jitter(uint32_t max_ms) { return max_ms ? rng() % max_ms : 0; }
+        bool _chance(double p) { return p > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < p; }
+};
+
+
+static uint64_t epoch_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+
+void SimDevice::begin(int i, uint64_t now) {
+    index = i;
+    snprintf(id, sizeof(id), "%s-%04d", options.prefix, i);
+    snprintf(client_id, sizeof(client_id), "filterchlorine-%s", id);
+    topics.begin(id);
+
+    // Same FNV-1a spread as Identity::begin, over the id instead of the MAC
+    hash = 2166136261u;
+    for (const char * c = id; *c; c++) hash = (hash ^ (uint8_t) *c) * 16777619u;
+    rng.seed(hash ^ options.seed);
+
+    boot_ms = now;
+    next_reverse = now + 60000 + _jitter(60000);
+    current_mA = 900 + _jitter(200);
+}
+
+
+// Next time step() has something to do without the socket becoming readable
+uint64_t SimDevice::wake_at() const {
+    switch (state) {
+        case OFFLINE: return first_connect ? 0 : retry_at;
+        case ONLINE: return ota_done_at && ota_done_at < next_publish ? ota_done_at : next_publish;
+        default: return resume_at;
+    }
+}
+
+
+void SimDevice::step(uint64_t now) {
+
+    // A storm takes every unit down at once
+    uint32_t storms = storm_count.load();
+    if (storms != storms_seen) {
+        storms_seen = storms;
+        if (state == ONLINE || state == STALLED) {
+            wire.drop();
+            _lost(now);
+        }
+    }
+
+    switch (state) {
+        case REBOOTING:
+            if (now < resume_at) return;
+            state = OFFLINE;
+            first_connect = true;
+            boot_ms = now;
+            stats.reboots++;
+            // fall through
+        case OFFLINE:
+            if (first_connect || now >= retry_at) _connect(now);
+            return;
+        case STALLED:
+            if (now < resume_at) return;
+            state = ONLINE;
+            // fall through
+        case ONLINE:
+            _online(now);
+            return;
+    }
+}
+
+
+void SimDevice::_connect(uint64_t now) {
+    first_connect = false;
+    retry_at = now + RETRY_INTERVAL + (options.jitter ? _jitter(RETRY_JITTER) : 0);
+
+    if (now < outage_until_ms.load()) {
+        stats.connect_failed++;
+        return;
+    }
+
+    MqttWire::Will will = {topics.get(TOPIC_STATUS), "offline", 1, true};
+    if (!wire.connect(options.host, options.port, client_id, options.user, options.password,
+                      &will, MQTT_KEEPALIVE, CONNECT_TIMEOUT)) {
+        stats.connect_failed++;
+        return;
+    }
+
+    stats.connects++;
+    stats.online++;
+    state = ONLINE;
+    if (down_since) {
+        std::lock_guard<std::mutex> guard(stats.lock);
+        stats.reconnect_ms.push_back(now - down_since);
+        down_since = 0;
+    }
+
+    wire.subscribe(topics.get(TOPIC_COMMAND));
+    wire.subscribe(topics.get(TOPIC_FLEET_COMMAND));
+    wire.publish(topics.get(TOPIC_STATUS), "online", true);
+
+    // Device::report_online
+    char payload[160];
+    snprintf(payload, sizeof(payload), "{\"id\":\"%s\",\"named\":true,\"mac\":\"sim%09x\",\"client\":\"%s\"}",
+             id, hash & 0xFFFFFFF, client_id);
+    wire.publish(topics.get(TOPIC_IDENTITY), payload, true);
+    wire.publish(topics.get(TOPIC_OTA_STATE), "ready");
+    std::string schema = "[";
+    for (size_t i = 0; i < TELEMETRY_KEY_COUNT; i++) {
+        if (i) schema += ",";
+        schema += "\"";
+        schema += TELEMETRY_KEYS[i];
+        schema += "\"";
+    }
+    schema += "]";
+    wire.publish(topics.get(TOPIC_SCHEMA), schema.c_str(), true);
+
+    // Telemetry in this unit's slot of the interval, as Device::setup arranges
+    uint32_t slot = hash % options.interval_ms;
+    next_publish = now + (slot + options.interval_ms - now % options.interval_ms) % options.interval_ms;
+}
+
+
+void SimDevice::_lost(uint64_t now) {
+    if (state == ONLINE || state == STALLED) stats.online--;
+    state = OFFLINE;
+    if (!down_since) down_since = now;
+    retry_at = now + RETRY_INTERVAL + (options.jitter ? _jitter(RETRY_JITTER) : 0);
+}
+
+
+void SimDevice::_online(uint64_t now) {
+
+    auto handler = [this, now](const char * topic, size_t topic_len, const uint8_t * payload, size_t len) {
+        _on_message(topic, topic_len, payload, len, now);
+    };
+    if (!wire.poll(now, handler)) {
+        stats.connections_lost++;
+        _lost(now);
+        return;
+    }
+
+    // OTA finished downloading: restart without a goodbye, like the ESP does
+    if (ota_done_at && now >= ota_done_at) {
+        ota_done_at = 0;
+        wire.drop();
+        stats.online--;
+        state = REBOOTING;
+        resume_at = now + REBOOT_MS;
+        return;
+    }
+
+    if (now < next_publish) return;
+    next_publish += options.interval_ms;
+    if (next_publish <= now) next_publish = now + options.interval_ms;  // fell behind, don't burst
+
+    if (_chance(options.drop)) {
+        stats.drops++;
+        wire.drop();
+        _lost(now);
+        return;
+    }
+    if (_chance(options.stall)) {
+        stats.stalls++;
+        state = STALLED;
+        resume_at = now + STALL_MS;
+        return;
+    }
+    _publish_sensors(now);
+}
+
+
+// Device::BuildTelemetry with a drifting simulated cell, plus a sequence
+// number the monitor matches to the send time
+void SimDevice::_publish_sensors(uint64_t now) {
+
+    if (now >= next_reverse) {
+        forward = !forward;
+        reverse_count++;
+        next_reverse = now + 60000 + _jitter(60000);
+    }
+    current_mA += std::normal_distribution<float>(0, 5)(rng);
+    current_mA = std::min(1400.0f, std::max(600.0f, current_mA));
+    busvoltage = 12.0 + std::normal_distribution<float>(0, 0.02)(rng);
+    float shunt = current_mA * 0.1;         // mV across 0.1 ohm
+    float load = busvoltage + shunt / 1000;
+
+    JsonDocument doc;
+    char address[16];
+    snprintf(address, sizeof(address), "10.%u.%u.%u", 1 + index / 65536, (index / 256) % 256, index % 256);
+    doc["resistance"] = busvoltage * 1000 / current_mA;
+    doc["current"] = current_mA;
+    doc["rssi"] = -50 - (int) (hash % 30);
+    doc["direction"] = forward ? "forward" : "reverse";
+    doc["ip"] = address;
+    doc["uptime"] = (uint32_t) ((now - boot_ms) / 1000);
+    doc["ts"] = epoch_ms();
+    doc["down"] = "online";
+    doc["busvoltage"] = busvoltage;
+    doc["shuntvoltage"] = shunt;
+    doc["loadvoltage"] = load;
+    doc["power_mW"] = load * current_mA;
+    doc["reversecount"] = reverse_count;
+    doc["temperature"] = 24.0 + (hash % 40) / 10.0;
+    doc["pressure"] = 1013.0;
+    doc["seq"] = seq;
+
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX];
+    size_t len = Telemetry::encode(doc, options.encoding, payload, sizeof(payload));
+    if (!len) {
+        stats.publish_failed++;
+        return;
+    }
+    // A corrupted message doesn't use up a sequence number, so the monitor
+    // counts it as undecodable rather than lost
+    if (_chance(options.corrupt)) {
+        stats.corrupted++;
+        len = 1 + rng() % (len - 1);        // cut mid-field
+    } else {
+        SentStamp & stamp = sent[seq % SEQ_RING];
+        stamp.us.store(wire_now_us());
+        stamp.seq.store(seq, std::memory_order_release);
+        seq++;
+    }
+
+    if (!wire.publish(topics.get(TOPIC_SENSORS, options.encoding), payload, len)) {
+        stats.publish_failed++;
+        stats.connections_lost++;
+        _lost(now);
+        return;
+    }
+    stats.published++;
+    stats.published_bytes += len;
+}
+
+
+// Device::message_handler
+void SimDevice::_on_message(const char *, size_t, const uint8_t * payload, size_t len, uint64_t now) {
+    stats.commands++;
+    std::string command((const char *) payload, len);
+    if (command == "OTA_UPDATE" || command == "UPDATE") {
+        if (ota_done_at) return;
+        wire.publish(topics.get(TOPIC_OTA_STATE), "updating");
+        ota_done_at = now + options.ota_seconds * 1000ULL + _jitter(2000);
+    }
+}
+
+
+static std::vector<SimDevice *> fleet;
+
+
+static void worker(int first) {
+    std::vector<SimDevice *> mine;
+    for (size_t i = first; i < fleet.size(); i += options.threads) mine.push_back(fleet[i]);
+    std::vector<struct pollfd> fds;
+
+    while (running) {
+        uint64_t now = wire_now_ms();
+        uint64_t wake = now + WORKER_IDLE_MS;
+        fds.clear();
+        for (SimDevice * device : mine) {
+            device->step(now);
+            wake = std::min(wake, std::max(now, device->wake_at()));
+            if (device->state == SimDevice::ONLINE) fds.push_back({device->wire.fd(), POLLIN, 0});
+        }
+        uint64_t after = wire_now_ms();
+        int timeout = wake > after ? (int) std::min<uint64_t>(wake - after, WORKER_IDLE_MS) : 0;
+        ::poll(fds.data(), fds.size(), timeout);
+    }
+
+    for (SimDevice * device : mine) device->wire.disconnect();
+}
+
+
+/*
+ * Decoding just enough of each encoding to find one unsigned field in the
+ * top-level map; the monitor needs nothing else from the payload.
+ */
+
+struct Reader {
+    const uint8_t * p;
+    const uint8_t * end;
+    bool ok = true;
+
+    uint64_t be(int bytes) {
+        if (end - p < bytes) { ok = false; return 0; }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value = (value << 8) | *p++;
+        return value;
+    }
+    void skip(uint64_t bytes) {
+        if ((uint64_t) (end - p) < bytes) { ok = false; p = end; }
+        else p += bytes;
+    }
+};
+
+static bool cbor_head(Reader & r, uint8_t & major, uint64_t & arg) {
+    if (r.p >= r.end) return false;
+    uint8_t initial = *r.p++;
+    major = initial >> 5;
+    uint8_t info = initial & 0x1F;
+    if (info < 24) arg = info;
+    else if (info <= 27) arg = r.be(1 << (info - 24));
+    else return false;      // indefinite lengths aren't written by CborWriter
+    return r.ok;
+}
+
+static bool cbor_skip(Reader & r, int depth = 0) {
+    uint8_t major;
+    uint64_t arg;
+    if (depth > 8 || !cbor_head(r, major, arg)) return false;
+    switch (major) {
+        case 2: case 3: r.skip(arg); break;
+        case 4: for (uint64_t i = 0; i < arg && r.ok; i++) cbor_skip(r, depth + 1); break;
+        case 5: for (uint64_t i = 0; i < 2 * arg && r.ok; i++) cbor_skip(r, depth + 1); break;
+        default: break;     // integers, simple values and floats are all in the head
+    }
+    return r.ok;
+}
+
+static bool cbor_find_uint(const uint8_t * data, size_t len, const char * key, uint64_t & value) {
+    Reader r = {data, data + len};
+    uint8_t major;
+    uint64_t pairs;
+    if (!cbor_head(r, major, pairs) || major != 5) return false;
+    size_t key_len = strlen(key);
+    for (uint64_t i = 0; i < pairs; i++) {
+        uint64_t arg;
+        const uint8_t * start = r.p;
+        if (!cbor_head(r, major, arg)) return false;
+        bool match = major == 3 && arg == key_len && (size_t) (r.end - r.p) >= key_len && memcmp(r.p, key, key_len) == 0;
+        if (major == 3 || major == 2) r.skip(arg);
+        else if (major != 0) { r.p = start; if (!cbor_skip(r)) return false; }
+        if (match) {
+            if (!cbor_head(r, major, value) || major != 0) return false;
+            return true;
+        }
+        if (!cbor_skip(r)) return false;
+    }
+    return false;
+}
+
+
+static bool msgpack_length(Reader & r, uint8_t type, uint64_t & len, int & kind) {
+    // kind: 0 scalar of len bytes, 1 string/bin of len bytes, 2 array of len, 3 map of len
+    if (type <= 0x7F || type >= 0xE0) { kind = 0; len = 0; }
+    else if (type <= 0x8F) { kind = 3; len = type & 0x0F; }
+    else if (type <= 0x9F) { kind = 2; len = type & 0x0F; }
+    else if (type <= 0xBF) { kind = 1; len = type & 0x1F; }
+    else switch (type) {
+        case 0xC0: case 0xC2: case 0xC3: kind = 0; len = 0; break;
+        case 0xC4: case 0xD9: kind = 1; len = r.be(1); break;
+        case 0xC5: case 0xDA: kind = 1; len = r.be(2); break;
+        case 0xC6: case 0xDB: kind = 1; len = r.be(4); break;
+        case 0xCA: kind = 0; len = 4; break;
+        case 0xCB: kind = 0; len = 8; break;
+        case 0xCC: case 0xD0: kind = 0; len = 1; break;
+        case 0xCD: case 0xD1: kind = 0; len = 2; break;
+        case 0xCE: case 0xD2: kind = 0; len = 4; break;
+        case 0xCF: case 0xD3: kind = 0; len = 8; break;
+        case 0xDC: kind = 2; len = r.be(2); break;
+        case 0xDD: kind = 2; len = r.be(4); break;
+        case 0xDE: kind = 3; len = r.be(2); break;
+        case 0xDF: kind = 3; len = r.be(4); break;
+        default: return false;
+    }
+    return r.ok;
+}
+
+static bool msgpack_skip(Reader & r, int depth = 0) {
+    if (depth > 8 || r.p >= r.end) return false;
+    uint8_t type = *r.p++;
+    uint64_t len;
+    int kind;
+    if (!msgpack_length(r, type, len, kind)) return false;
+    if (kind <= 1) r.skip(len);
+    else for (uint64_t i = 0; i < len * (kind == 3 ? 2 : 1) && r.ok; i++) msgpack_skip(r, depth + 1);
+    return r.ok;
+}
+
+static bool msgpack_find_uint(const uint8_t * data, size_t len, const char * key, uint64_t & value) {
+    Reader r = {data, data + len};
+    uint64_t pairs;
+    int kind;
+    if (r.p >= r.end || !msgpack_length(r, *r.p++, pairs, kind) || kind != 3) return false;
+    size_t key_len = strlen(key);
+    for (uint64_t i = 0; i < pairs; i++) {
+        const uint8_t * start = r.p;
+        uint64_t len;
+        if (r.p >= r.end || !msgpack_length(r, *r.p++, len, kind)) return false;
+        bool match = kind == 1 && len == key_len && (size_t) (r.end - r.p) >= key_len && memcmp(r.p, key, key_len) == 0;
+        r.p = start;
+        if (!msgpack_skip(r)) return false;
+        if (match) {
+            if (r.p >= r.end) return false;
+            uint8_t type = *r.p++;
+            if (type <= 0x7F) value = type;
+            else if (type >= 0xCC && type <= 0xCF) value = r.be(1 << (type - 0xCC));
+            else return false;
+            return r.ok;
+        }
+        if (!msgpack_skip(r)) return false;
+    }
+    return false;
+}
+
+
+static bool json_find_uint(const uint8_t * data, size_t len, const char * key, uint64_t & value) {
+    std::string text((const char *) data, len);
+    if (text.empty() || text.back() != '}') return false;     // truncated
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t at = text.find(pattern);
+    if (at == std::string::npos) return false;
+    char * end;
+    value = strtoull(text.c_str() + at + pattern.size(), &end, 10);
+    return end != text.c_str() + at + pattern.size();
+}
+
+
+// filterchlorine/<prefix>-NNNN/... -> NNNN, or -1 for someone else's unit
+static int device_index(const char * topic, size_t topic_len) {
+    std::string path(topic, topic_len);
+    std::string head = std::string(TOPIC_ROOT "/") + options.prefix + "-";
+    if (path.compare(0, head.size(), head) != 0) return -1;
+    int index = atoi(path.c_str() + head.size());
+    return index >= 0 && index < (int) fleet.size() ? index : -1;
+}
+
+
+static void monitor(MqttWire * wire) {
+    std::vector<uint32_t> last_seq(fleet.size(), UINT32_MAX);
+
+    auto handler = [&](const char * topic, size_t topic_len, const uint8_t * payload, size_t len) {
+        uint64_t now_us = wire_now_us();
+        int index = device_index(topic, topic_len);
+        if (index < 0) return;
+
+        std::string path(topic, topic_len);
+        if (path.size() >= 7 && path.compare(path.size() - 7, 7, "/status") == 0) {
+            if (len == 7 && memcmp(payload, "offline", 7) == 0) stats.wills++;
+            return;
+        }
+
+        stats.received++;
+        stats.received_bytes += len;
+        uint64_t seq;
+        bool decoded;
+        switch (options.encoding) {
+            case TELEMETRY_CBOR: decoded = cbor_find_uint(payload, len, "seq", seq); break;
+            case TELEMETRY_MSGPACK: decoded = msgpack_find_uint(payload, len, "seq", seq); break;
+            default: decoded = json_find_uint(payload, len, "seq", seq); break;
+        }
+        if (!decoded) {
+            stats.undecodable++;
+            return;
+        }
+
+        // QoS 0 keeps order per publisher, so a jump is a loss
+        uint32_t & last = last_seq[index];
+        if (last != UINT32_MAX && seq > last + 1) stats.lost += seq - last - 1;
+        if (last == UINT32_MAX || seq > last) last = seq;
+
+        SentStamp & stamp = fleet[index]->sent[seq % SEQ_RING];
+        if (stamp.seq.load(std::memory_order_acquire) != seq) return;
+        uint64_t sent_us = stamp.us.load();
+        std::lock_guard<std::mutex> guard(stats.lock);
+        stats.latency_us.push_back(now_us > sent_us ? now_us - sent_us : 0);
+    };
+
+    while (running) {
+        struct pollfd pfd = {wire->fd(), POLLIN, 0};
+        ::poll(&pfd, 1, 100);
+        if (!wire->poll(wire_now_ms(), handler)) {
+            fprintf(stderr, "fleetsim: monitor connection lost\n");
+            running = false;
+        }
+    }
+}
+
+
+static uint32_t percentile(std::vector<uint32_t> & sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t at = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[at];
+}
+
+
+struct Totals {
+    uint64_t published, published_bytes, received, received_bytes;
+};
+
+static void report(int elapsed_s, double span_s, Totals & last) {
+    std::vector<uint32_t> latency;
+    {
+        std::lock_guard<std::mutex> guard(stats.lock);
+        latency.swap(stats.latency_us);
+    }
+    std::sort(latency.begin(), latency.end());
+
+    Totals now = {stats.published, stats.published_bytes, stats.received, stats.received_bytes};
+    printf("%5ds  online %5d  pub %7.0f/s %8.1f kB/s  recv %7.0f/s %8.1f kB/s  "
+           "lat ms p50 %6.2f p90 %6.2f p99 %6.2f max %7.2f  lost %llu\n",
+           elapsed_s, stats.online.load(),
+           (now.published - last.published) / span_s, (now.published_bytes - last.published_bytes) / span_s / 1000,
+           (now.received - last.received) / span_s, (now.received_bytes - last.received_bytes) / span_s / 1000,
+           percentile(latency, 0.50) / 1000.0, percentile(latency, 0.90) / 1000.0,
+           percentile(latency, 0.99) / 1000.0, (latency.empty() ? 0 : latency.back()) / 1000.0,
+           (unsigned long long) stats.lost.load());
+    fflush(stdout);
+    last = now;
+}
+
+
+static void summary(double seconds) {
+    std::vector<uint32_t> reconnect;
+    {
+        std::lock_guard<std::mutex> guard(stats.lock);
+        reconnect = stats.reconnect_ms;
+    }
+    std::sort(reconnect.begin(), reconnect.end());
+
+    printf("\n%d units, %d threads, %s, %u ms interval, %.0f s\n",
+           options.devices, options.threads, Telemetry::name(options.encoding), options.interval_ms, seconds);
+    printf("  published   %llu (%llu bytes, %llu failed)\n", (unsigned long long) stats.published.load(),
+           (unsigned long long) stats.published_bytes.load(), (unsigned long long) stats.publish_failed.load());
+    printf("  delivered   %llu (%.0f msg/s, %.1f kB/s), %llu lost, %llu undecodable\n",
+           (unsigned long long) stats.received.load(), stats.received / seconds, stats.received_bytes / seconds / 1000,
+           (unsigned long long) stats.lost.load(), (unsigned long long) stats.undecodable.load());
+    printf("  connects    %llu ok, %llu failed attempts, %llu lost, %llu last wills seen\n",
+           (unsigned long long) stats.connects.load(), (unsigned long long) stats.connect_failed.load(),
+           (unsigned long long) stats.connections_lost.load(), (unsigned long long) stats.wills.load());
+    printf("  faults      %llu dropped, %llu stalled, %llu corrupted; %llu commands, %llu OTA reboots\n",
+           (unsigned long long) stats.drops.load(), (unsigned long long) stats.stalls.load(),
+           (unsigned long long) stats.corrupted.load(), (unsigned long long) stats.commands.load(),
+           (unsigned long long) stats.reboots.load());
+    if (!reconnect.empty()) {
+        printf("  reconnect   %zu, ms p50 %u p90 %u p99 %u max %u\n", reconnect.size(),
+               percentile(reconnect, 0.50), percentile(reconnect, 0.90), percentile(reconnect, 0.99), reconnect.back());
+    }
+}
+
+
+static void usage() {
+    fprintf(stderr,
+        "usage: fleetsim [options]\n"
+        "  --host H --port P --user U --password W    broker (localhost:1883)\n"
+        "  --devices N --threads T --prefix NAME      units sim-0000.. on T workers (100, 4)\n"
+        "  --interval MS --encoding json|cbor|msgpack sensors period and encoding (5000, json)\n"
+        "  --duration S --report S                    run time and report period (60, 5)\n"
+        "  --storm-at S --storm-every S --outage S    broker outage for all units (off, off, 5)\n"
+        "  --no-jitter                                retry in lockstep, not the firmware's spread\n"
+        "  --ota-at S --ota-seconds S                 fleet-wide UPDATE and download time (off, 20)\n"
+        "  --drop P --stall P --corrupt P             fault probability per publish (0)\n"
+        "  --seed N\n");
+    exit(2);
+}
+
+
+static void parse(int argc, char ** argv) {
+    static const struct option longopts[] = {
+        {"host", 1, 0, 'h'}, {"port", 1, 0, 'p'}, {"user", 1, 0, 'u'}, {"password", 1, 0, 'w'},
+        {"devices", 1, 0, 'n'}, {"threads", 1, 0, 't'}, {"prefix", 1, 0, 'x'},
+        {"interval", 1, 0, 'i'}, {"encoding", 1, 0, 'e'}, {"duration", 1, 0, 'd'}, {"report", 1, 0, 'r'},
+        {"storm-at", 1, 0, 's'}, {"storm-every", 1, 0, 'S'}, {"outage", 1, 0, 'o'}, {"no-jitter", 0, 0, 'J'},
+        {"ota-at", 1, 0, 'a'}, {"ota-seconds", 1, 0, 'A'},
+        {"drop", 1, 0, 'D'}, {"stall", 1, 0, 'T'}, {"corrupt", 1, 0, 'C'}, {"seed", 1, 0, 'z'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", longopts, nullptr)) != -1) {
+        switch (opt) {
+            case 'h': options.host = optarg; break;
+            case 'p': options.port = atoi(optarg); break;
+            case 'u': options.user = optarg; break;
+            case 'w': options.password = optarg; break;
+            case 'n': options.devices = atoi(optarg); break;
+            case 't': options.threads = atoi(optarg); break;
+            case 'x': options.prefix = optarg; break;
+            case 'i': options.interval_ms = atoi(optarg); break;
+            case 'e': if (!Telemetry::parse(optarg, options.encoding)) usage(); break;
+            case 'd': options.duration_s = atoi(optarg); break;
+            case 'r': options.report_s = atoi(optarg); break;
+            case 's': options.storm_at_s = atoi(optarg); break;
+            case 'S': options.storm_every_s = atoi(optarg); break;
+            case 'o': options.outage_s = atoi(optarg); break;
+            case 'J': options.jitter = false; break;
+            case 'a': options.ota_at_s = atoi(optarg); break;
+            case 'A': options.ota_seconds = atoi(optarg); break;
+            case 'D': options.drop = atof(optarg); break;
+            case 'T': options.stall = atof(optarg); break;
+            case 'C': options.corrupt = atof(optarg); break;
+            case 'z': options.seed = atoi(optarg); break;
+            default: usage();
+        }
+    }
+    if (optind < argc || options.devices < 1 || options.devices > 9999 || options.threads < 1 ||
+        options.interval_ms < 10 || options.report_s < 1) usage();
+    if (options.threads > options.devices) options.threads = options.devices;
+}
+
+
+static void stop(int) {
+    running = false;
+}
+
+
+int main(int argc, char ** argv) {
+    parse(argc, argv);
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    // The monitor subscribes before any unit connects, so nothing goes uncounted
+    MqttWire monitor_wire, control;
+    char client_id[48];
+    snprintf(client_id, sizeof(client_id), "fleetsim-monitor-%d", (int) getpid());
+    if (!monitor_wire.connect(options.host, options.port, client_id, options.user, options.password,
+                              nullptr, MQTT_KEEPALIVE, CONNECT_TIMEOUT)) {
+        fprintf(stderr, "fleetsim: can't connect to %s:%u (%d)\n", options.host, options.port, monitor_wire.last_error());
+        return 1;
+    }
+    monitor_wire.subscribe(TOPIC_ROOT "/+/sensors/#");     // the plain topic and every encoding
+    monitor_wire.subscribe(TOPIC_ROOT "/+/status");
+
+    uint64_t start = wire_now_ms();
+    fleet.reserve(options.devices);
+    for (int i = 0; i < options.devices; i++) {
+        fleet.push_back(new SimDevice());
+        fleet.back()->begin(i, start);
+    }
+
+    printf("fleetsim: %d units on %d threads -> %s:%u, %s every %u ms\n", options.devices, options.threads,
+           options.host, options.port, Telemetry::name(options.encoding), options.interval_ms);
+
+    std::thread monitor_thread(monitor, &monitor_wire);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; t++) workers.emplace_back(worker, t);
+
+    Totals last = {};
+    uint64_t last_report = start;
+    int next_storm = options.storm_at_s;
+    bool ota_sent = false;
+
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        uint64_t now = wire_now_ms();
+        int elapsed = (now - start) / 1000;
+
+        if (next_storm && elapsed >= next_storm) {
+            printf("%5ds  storm: broker unreachable for %d s, %s\n", elapsed, options.outage_s,
+                   options.jitter ? "firmware retry jitter" : "no jitter");
+            outage_until_ms = now + options.outage_s * 1000ULL;
+            storm_count++;
+            next_storm = options.storm_every_s ? next_storm + options.storm_every_s : 0;
+        }
+
+        if (options.ota_at_s && !ota_sent && elapsed >= options.ota_at_s) {
+            ota_sent = true;
+            snprintf(client_id, sizeof(client_id), "fleetsim-control-%d", (int) getpid());
+            Topics fleet_topics;
+            fleet_topics.begin("control");
+            if (control.connect(options.host, options.port, client_id, options.user, options.password,
+                                nullptr, MQTT_KEEPALIVE, CONNECT_TIMEOUT)) {
+                control.publish(fleet_topics.get(TOPIC_FLEET_COMMAND), "UPDATE");
+                control.disconnect();
+                printf("%5ds  ota: UPDATE sent to %s\n", elapsed, fleet_topics.get(TOPIC_FLEET_COMMAND));
+            } else {
+                printf("%5ds  ota: control connection failed (%d)\n", elapsed, control.last_error());
+            }
+        }
+
+        if (now - last_report >= options.report_s * 1000ULL) {
+            report(elapsed, (now - last_report) / 1000.0, last);
+            last_report = now;
+        }
+        if (options.duration_s && elapsed >= options.duration_s) running = false;
+    }
+
+    for (std::thread & t : workers) t.join();
+    monitor_thread.join();
+    monitor_wire.disconnect();
+    summary((wire_now_ms() - start) / 1000.0);
+
+    for (SimDevice * device : fleet) delete device;
+    return 0;
+}
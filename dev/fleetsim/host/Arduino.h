@@ -0,0 +1,21 @@
+#pragma once
+
+// Just enough of Arduino.h to build lib/telemetry's encoder and
+// lib/identity's topic table on a host
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <cmath>
+
+using std::isnan;
+
+// Boot-time chatter from the shared code; the simulator prints its own report
+struct HostSerial {
+    int printf(const char *, ...) { return 0; }
+};
+
+inline HostSerial Serial;
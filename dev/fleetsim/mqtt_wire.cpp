@@ -0,0 +1,311 @@
+#include "mqtt_wire.h"
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WIRE_SEND_TIMEOUT 5000      // ms a full socket buffer may hold up a write
+
+// MQTT 3.1.1 control packet types, high nibble of the first byte
+#define MQTT_CONNECT     1
+#define MQTT_CONNACK     2
+#define MQTT_PUBLISH     3
+#define MQTT_PUBACK      4
+#define MQTT_SUBSCRIBE   8
+#define MQTT_PINGREQ    12
+#define MQTT_DISCONNECT 14
+
+
+uint64_t wire_now_us() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t wire_now_ms() {
+    return wire_now_us() / 1000;
+}
+
+
+bool MqttWire::connect(const char * host, uint16_t port, const char * client_id,
+                       const char * user, const char * password, const Will * will,
+                       uint16_t keepalive_s, int timeout_ms) {
+    drop();
+    _error = 0;
+    _in.clear();
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo * addresses = nullptr;
+    if (getaddrinfo(host, service, &hints, &addresses) != 0 || !addresses) {
+        _error = -EHOSTUNREACH;
+        return false;
+    }
+
+    _fd = socket(addresses->ai_family, SOCK_STREAM, 0);
+    if (_fd < 0) {
+        _error = -errno;
+        freeaddrinfo(addresses);
+        return false;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int result = ::connect(_fd, addresses->ai_addr, addresses->ai_addrlen);
+    freeaddrinfo(addresses);
+    if (result < 0 && errno != EINPROGRESS) {
+        _error = -errno;
+        drop();
+        return false;
+    }
+    if (result < 0) {
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (!_wait(POLLOUT, timeout_ms)) {
+            _error = -1;
+            drop();
+            return false;
+        }
+        getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+        if (err) {
+            _error = -err;
+            drop();
+            return false;
+        }
+    }
+
+    size_t remaining = 10 + 2 + strlen(client_id);
+    uint8_t flags = 0x02;   // clean session
+    if (will) {
+        remaining += 2 + strlen(will->topic) + 2 + strlen(will->payload);
+        flags |= 0x04 | (will->qos << 3) | (will->retain ? 0x20 : 0);
+    }
+    if (user && *user) {
+        remaining += 2 + strlen(user);
+        flags |= 0x80;
+        if (password && *password) {
+            remaining += 2 + strlen(password);
+            flags |= 0x40;
+        }
+    }
+
+    _begin(MQTT_CONNECT << 4, remaining);
+    _put_str("MQTT");
+    _out.push_back(4);      // protocol level 3.1.1
+    _out.push_back(flags);
+    _put_u16(keepalive_s);
+    _put_str(client_id);
+    if (will) {
+        _put_str(will->topic);
+        _put_str(will->payload);
+    }
+    if (flags & 0x80) _put_str(user);
+    if (flags & 0x40) _put_str(password);
+    if (!_send()) return false;
+
+    // CONNACK: 0x20 0x02 <session present> <return code>
+    uint64_t deadline = wire_now_ms() + timeout_ms;
+    while (_in.size() < 4) {
+        int left = (int) (deadline - wire_now_ms());
+        if (left <= 0 || !_wait(POLLIN, left)) {
+            _error = -1;
+            drop();
+            return false;
+        }
+        uint8_t buf[64];
+        ssize_t got = recv(_fd, buf, sizeof(buf), 0);
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) {
+            _error = got == 0 ? -ECONNRESET : -errno;
+            drop();
+            return false;
+        }
+        if (got > 0) _in.insert(_in.end(), buf, buf + got);
+    }
+    if (_in[0] != (MQTT_CONNACK << 4) || _in[3] != 0) {
+        _error = _in[0] == (MQTT_CONNACK << 4) ? _in[3] : -EPROTO;
+        drop();
+        return false;
+    }
+    _in.erase(_in.begin(), _in.begin() + 4);
+    _keepalive_s = keepalive_s;
+    return true;
+}
+
+
+bool MqttWire::publish(const char * topic, const uint8_t * payload, size_t len, bool retain) {
+    if (_fd < 0) return false;
+    size_t topic_len = strlen(topic);
+    _begin((MQTT_PUBLISH << 4) | (retain ? 1 : 0), 2 + topic_len + len);
+    _put_str(topic, topic_len);
+    _out.insert(_out.end(), payload, payload + len);
+    return _send();
+}
+
+bool MqttWire::publish(const char * topic, const char * payload, bool retain) {
+    return publish(topic, (const uint8_t *) payload, strlen(payload), retain);
+}
+
+
+bool MqttWire::subscribe(const char * filter) {
+    if (_fd < 0) return false;
+    size_t filter_len = strlen(filter);
+    _begin((MQTT_SUBSCRIBE << 4) | 0x02, 2 + 2 + filter_len + 1);
+    if (++_packet_id == 0) _packet_id = 1;
+    _put_u16(_packet_id);
+    _put_str(filter, filter_len);
+    _out.push_back(0);      // QoS 0
+    return _send();
+}
+
+
+bool MqttWire::poll(uint64_t now_ms, const Handler & handler) {
+    if (_fd < 0) return false;
+
+    uint8_t buf[4096];
+    for (;;) {
+        ssize_t got = recv(_fd, buf, sizeof(buf), 0);
+        if (got > 0) {
+            _in.insert(_in.end(), buf, buf + got);
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (got < 0 && errno == EINTR) continue;
+        drop();
+        return false;
+    }
+    if (!_dispatch(handler)) return false;
+
+    if (_keepalive_s && now_ms - _last_out_ms >= _keepalive_s * 1000ULL) {
+        _begin(MQTT_PINGREQ << 4, 0);
+        if (!_send()) return false;
+    }
+    return true;
+}
+
+
+void MqttWire::disconnect() {
+    if (_fd < 0) return;
+    _begin(MQTT_DISCONNECT << 4, 0);
+    _send();
+    drop();
+}
+
+
+void MqttWire::drop() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+}
+
+
+// Complete packets only; a partial one waits in _in for the rest
+bool MqttWire::_dispatch(const Handler & handler) {
+    size_t pos = 0;
+    while (_in.size() - pos >= 2) {
+        size_t remaining = 0;
+        size_t header = 1;
+        int shift = 0;
+        bool complete = false;
+        while (pos + header < _in.size() && header <= 4) {
+            uint8_t byte = _in[pos + header++];
+            remaining |= (size_t) (byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            if (header > 4) {
+                drop();     // malformed length
+                return false;
+            }
+            break;
+        }
+        if (_in.size() - pos < header + remaining) break;
+
+        const uint8_t * packet = _in.data() + pos;
+        const uint8_t * body = packet + header;
+        if ((packet[0] >> 4) == MQTT_PUBLISH && remaining >= 2) {
+            uint8_t qos = (packet[0] >> 1) & 0x03;
+            size_t topic_len = (body[0] << 8) | body[1];
+            size_t offset = 2 + topic_len + (qos ? 2 : 0);
+            if (offset <= remaining) {
+                if (qos == 1) {
+                    uint16_t id = (body[2 + topic_len] << 8) | body[3 + topic_len];
+                    _begin(MQTT_PUBACK << 4, 2);
+                    _put_u16(id);
+                    _send();
+                }
+                if (handler) handler((const char *) body + 2, topic_len, body + offset, remaining - offset);
+            }
+        }
+        pos += header + remaining;
+    }
+    _in.erase(_in.begin(), _in.begin() + pos);
+    return _fd >= 0;
+}
+
+
+void MqttWire::_begin(uint8_t type, size_t remaining) {
+    _out.clear();
+    _out.push_back(type);
+    do {
+        uint8_t byte = remaining & 0x7F;
+        remaining >>= 7;
+        if (remaining) byte |= 0x80;
+        _out.push_back(byte);
+    } while (remaining);
+}
+
+void MqttWire::_put_u16(uint16_t value) {
+    _out.push_back(value >> 8);
+    _out.push_back(value & 0xFF);
+}
+
+void MqttWire::_put_str(const char * str, size_t len) {
+    _put_u16(len);
+    _out.insert(_out.end(), str, str + len);
+}
+
+void MqttWire::_put_str(const char * str) {
+    _put_str(str, strlen(str));
+}
+
+
+bool MqttWire::_send() {
+    size_t sent = 0;
+    while (sent < _out.size()) {
+        ssize_t n = send(_fd, _out.data() + sent, _out.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && _wait(POLLOUT, WIRE_SEND_TIMEOUT)) continue;
+        _error = n < 0 ? -errno : -ECONNRESET;
+        drop();
+        return false;
+    }
+    _last_out_ms = wire_now_ms();
+    return true;
+}
+
+
+bool MqttWire::_wait(short events, int timeout_ms) {
+    struct pollfd pfd = {_fd, events, 0};
+    int result;
+    do {
+        result = ::poll(&pfd, 1, timeout_ms);
+    } while (result < 0 && errno == EINTR);
+    return result > 0 && (pfd.revents & (events | POLLERR | POLLHUP));
+}
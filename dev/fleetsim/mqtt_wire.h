@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+/**
+ * Minimal MQTT 3.1.1 client over a non-blocking POSIX socket - the part of
+ * PubSubClient the firmware uses: CONNECT with a last will, QoS 0 publish,
+ * subscribe and keepalive pings. No threads of its own; poll() is called
+ * from whichever worker owns the connection.
+ */
+class MqttWire {
+
+    public:
+
+        struct Will {
+            const char * topic;
+            const char * payload;
+            uint8_t qos;
+            bool retain;
+        };
+
+        // topic is not NUL-terminated
+        using Handler = std::function<void(const char * topic, size_t topic_len,
+                                           const uint8_t * payload, size_t len)>;
+
+        ~MqttWire() { drop(); }
+
+        // Blocks up to timeout_ms for the TCP connect and the CONNACK
+        bool connect(const char * host, uint16_t port, const char * client_id,
+                     const char * user, const char * password, const Will * will,
+                     uint16_t keepalive_s, int timeout_ms);
+
+        bool publish(const char * topic, const uint8_t * payload, size_t len, bool retain = false);
+        bool publish(const char * topic, const char * payload, bool retain = false);
+        bool subscribe(const char * filter);
+
+        // Reads whatever has arrived and pings when the keepalive is due;
+        // false once the connection is gone
+        bool poll(uint64_t now_ms, const Handler & handler);
+
+        void disconnect();      // clean, the broker discards the will
+        void drop();            // close without a goodbye, the broker sends the will
+
+        bool connected() const { return _fd >= 0; }
+        int fd() const { return _fd; }
+        int last_error() const { return _error; }   // CONNACK code, or -errno / -1 timeout
+
+    private:
+
+        int _fd = -1;
+        int _error = 0;
+        uint16_t _keepalive_s = 0;
+        uint16_t _packet_id = 0;
+        uint64_t _last_out_ms = 0;
+        std::vector<uint8_t> _out;
+        std::vector<uint8_t> _in;
+
+        void _begin(uint8_t type, size_t remaining);
+        void _put_u16(uint16_t);
+        void _put_str(const char * str, size_t len);
+        void _put_str(const char * str);
+        bool _send();
+        bool _wait(short events, int timeout_ms);
+        bool _dispatch(const Handler & handler);
+
+};
+
+uint64_t wire_now_ms();
+uint64_t wire_now_us();
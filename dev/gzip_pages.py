@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+Regenerates the gzipped page headers from the pages in this directory:
+lib/provisioner/html.h (captive portal) and lib/webapi/dashboard.h.
+
+Pages are stored gzipped in flash and served as-is with
+Content-Encoding: gzip, so the browser does the decompression. Each page
+gets an ETag derived from its contents so repeat loads can be answered
+with a 304.
+
+Usage:  python3 dev/gzip_pages.py
+"""
+
+import gzip
+import hashlib
+import os
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+LIB = os.path.join(HERE, "..", "lib")
+
+TARGETS = {
+    os.path.join(LIB, "provisioner", "html.h"): [
+        ("CONFIG_PAGE", "config.html"),
+        ("SAVED_PAGE", "saved.html"),
+        ("INSTRUCTIONS_PAGE", "instructions.html"),
+    ],
+    os.path.join(LIB, "webapi", "dashboard.h"): [
+        ("DASHBOARD_PAGE", "dashboard.html"),
+    ],
+}
+
+
+def emit(name, path):
+    with open(os.path.join(HERE, path), "rb") as f:
+        raw = f.read()
+    packed = gzip.compress(raw, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(raw).hexdigest()[:16]
+    lines = []
+    for i in range(0, len(packed), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in packed[i:i + 16]) + ",")
+    body = "\n".join(lines)
+    return (
+        f"// {path}: {len(raw)} bytes, {len(packed)} gzipped\n"
+        f"const uint8_t {name}[] PROGMEM = {{\n{body}\n}};\n"
+        f"const size_t {name}_LEN = sizeof({name});\n"
+        f"const char {name}_ETAG[] = \"\\\"{etag}\\\"\";\n"
+    )
+
+
+def main():
+    for target, pages in TARGETS.items():
+        out = [
+            "#pragma once\n",
+            "// Generated by dev/gzip_pages.py from dev/*.html - edit those and rerun\n",
+            "#include <Arduino.h>\n",
+        ]
+        for name, path in pages:
+            out.append(emit(name, path))
+        os.makedirs(os.path.dirname(target), exist_ok=True)
+        with open(target, "w") as f:
+            f.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
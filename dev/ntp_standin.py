@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Minimal SNTP server for exercising the timebase against a known clock.
+
+Answers every client request with this host's time, optionally shifted by
+a fixed offset and skewed by a drift rate, so a device pointed at it (set
+NTP_SERVER in credentials.h to this host's address) can be checked for:
+
+  - the first sync placing telemetry on the right timeline (--offset)
+  - drift tracking converging on the skew (--drift-ppm; the device's "time"
+    command should show about the same figure after a few sync intervals,
+    plus whatever its own crystal is off by)
+  - behaviour when the server stops answering (--drop)
+
+The device polls port 123, so this usually needs root or a port redirect.
+
+Usage:  sudo python3 dev/ntp_standin.py [--offset S] [--drift-ppm P] [--drop N]
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+NTP_EPOCH = 2208988800  # 1900-01-01 to 1970-01-01
+
+
+def to_ntp(t):
+    seconds = int(t)
+    fraction = int((t - seconds) * (1 << 32)) & 0xFFFFFFFF
+    return struct.pack("!II", seconds + NTP_EPOCH, fraction)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--port", type=int, default=123)
+    parser.add_argument("--offset", type=float, default=0.0, help="seconds added to this host's time")
+    parser.add_argument("--drift-ppm", type=float, default=0.0, help="served clock runs fast by this much")
+    parser.add_argument("--drop", type=int, default=0, help="ignore every Nth request")
+    args = parser.parse_args()
+
+    start = time.time()
+
+    def served_time():
+        now = time.time()
+        return now + args.offset + (now - start) * args.drift_ppm / 1e6
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", args.port))
+    print(f"SNTP stand-in on :{args.port}, offset {args.offset:+.3f} s, drift {args.drift_ppm:+.1f} ppm")
+
+    count = 0
+    while True:
+        request, client = sock.recvfrom(512)
+        received = served_time()
+        if len(request) < 48:
+            continue
+        count += 1
+        if args.drop and count % args.drop == 0:
+            print(f"{client[0]}: dropped request #{count}")
+            continue
+
+        # LI 0, VN 4, mode 4 (server); stratum 1 so clients accept it
+        header = struct.pack("!BBbbII4s", (0 << 6) | (4 << 3) | 4, 1, 6, -20, 0, 0, b"LOCL")
+        originate = request[40:48]      # client's transmit timestamp, echoed
+        transmit = served_time()
+        reply = header + to_ntp(transmit) + originate + to_ntp(received) + to_ntp(transmit)
+        sock.sendto(reply, client)
+        print(f"{client[0]}: #{count} served {time.strftime('%H:%M:%S', time.gmtime(transmit))}"
+              f" ({transmit - time.time():+.3f} s vs host)")
+
+
+if __name__ == "__main__":
+    main()
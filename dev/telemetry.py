@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+"""
+Decoder for the device's MQTT telemetry in any of its encodings.
+
+JSON goes to the plain topic; binary messages carry the encoding as a topic
+suffix:
+
+  filterchlorine/<id>/sensors            JSON
+  filterchlorine/<id>/sensors/cbor       CBOR, integer keys
+  filterchlorine/<id>/sensors/msgpack    MessagePack, text keys
+
+CBOR keys are numbers into the table in lib/telemetry/telemetry_keys.h. Each
+unit publishes its table, retained, as a JSON array on
+filterchlorine/<id>/schema/keys; pass that (or the header) to decode(). The
+/api/history?format=cbor|msgpack bodies decode the same way.
+
+As a library:
+
+  import telemetry
+  keys = telemetry.load_keys()                  # or json.loads(schema payload)
+  doc = telemetry.decode(topic, payload, keys)  # -> (base topic, dict)
+
+From the command line, reading mosquitto_sub output (topic + hex payload):
+
+  mosquitto_sub -h broker -t 'filterchlorine/#' -v -F '%t %x' | python3 dev/telemetry.py
+  python3 dev/telemetry.py --encoding cbor history.cbor
+
+No dependencies beyond the standard library.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+KEYS_HEADER = os.path.join(os.path.dirname(__file__), "..", "lib", "telemetry", "telemetry_keys.h")
+SCHEMA_SUFFIX = "/schema/keys"
+SUFFIXES = {"/cbor": "cbor", "/msgpack": "msgpack"}
+
+
+def load_keys(path=KEYS_HEADER):
+    """Key names in number order, read from the device's header."""
+    with open(path) as f:
+        source = f.read()
+    table = source[source.index("TELEMETRY_KEYS[]"):]
+    table = table[table.index("{") + 1:table.index("};")]
+    table = re.sub(r"//[^\n]*", "", table)
+    return re.findall(r'"([^"]*)"', table)
+
+
+class _Reader:
+
+    def __init__(self, data):
+        self.data = bytes(data)
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError("truncated payload")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def byte(self):
+        return self.take(1)[0]
+
+    def uint(self, n):
+        return int.from_bytes(self.take(n), "big")
+
+
+def _half(bits):
+    sign = -1.0 if bits & 0x8000 else 1.0
+    exponent = (bits >> 10) & 0x1F
+    mantissa = bits & 0x3FF
+    if exponent == 0:
+        return sign * mantissa * 2 ** -24
+    if exponent == 31:
+        return sign * float("inf") if mantissa == 0 else float("nan")
+    return sign * (1 + mantissa / 1024) * 2 ** (exponent - 15)
+
+
+def _cbor_item(r, keys):
+    initial = r.byte()
+    major, info = initial >> 5, initial & 0x1F
+
+    if major == 7:
+        if info == 20:
+            return False
+        if info == 21:
+            return True
+        if info in (22, 23):
+            return None
+        if info == 25:
+            return _half(r.uint(2))
+        if info == 26:
+            return struct.unpack(">f", r.take(4))[0]
+        if info == 27:
+            return struct.unpack(">d", r.take(8))[0]
+        if info == 31:
+            return _BREAK
+        raise ValueError(f"unsupported simple value {info}")
+
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        arg = r.uint(1 << (info - 24))
+    elif info == 31 and major in (2, 3, 4, 5):
+        arg = None                      # indefinite length
+    else:
+        raise ValueError(f"bad additional info {info}")
+
+    if major == 0:
+        return arg
+    if major == 1:
+        return -1 - arg
+    if major in (2, 3):
+        if arg is None:
+            parts = []
+            while (part := _cbor_item(r, keys)) is not _BREAK:
+                parts.append(part)
+            return (b"" if major == 2 else "").join(parts)
+        raw = r.take(arg)
+        return raw if major == 2 else raw.decode("utf-8")
+    if major == 4:
+        items = []
+        while arg is None or len(items) < arg:
+            item = _cbor_item(r, keys)
+            if item is _BREAK:
+                break
+            items.append(item)
+        return items
+    if major == 5:
+        result = {}
+        while arg is None or len(result) < arg:
+            key = _cbor_item(r, keys)
+            if key is _BREAK:
+                break
+            result[_name(key, keys)] = _cbor_item(r, keys)
+        return result
+    if major == 6:
+        return _cbor_item(r, keys)      # tags carry nothing the device uses
+    raise ValueError(f"bad major type {major}")
+
+
+_BREAK = object()
+
+
+def _name(key, keys):
+    if isinstance(key, int) and keys and 0 <= key < len(keys):
+        return keys[key]
+    return key
+
+
+def decode_cbor(data, keys=None):
+    r = _Reader(data)
+    value = _cbor_item(r, keys)
+    if r.pos != len(r.data):
+        raise ValueError(f"{len(r.data) - r.pos} trailing bytes")
+    return value
+
+
+def _msgpack_item(r, keys):
+    b = r.byte()
+    if b <= 0x7F:
+        return b
+    if b >= 0xE0:
+        return b - 0x100
+    if 0x80 <= b <= 0x8F:
+        return _msgpack_map(r, keys, b & 0x0F)
+    if 0x90 <= b <= 0x9F:
+        return [_msgpack_item(r, keys) for _ in range(b & 0x0F)]
+    if 0xA0 <= b <= 0xBF:
+        return r.take(b & 0x1F).decode("utf-8")
+    if b == 0xC0:
+        return None
+    if b == 0xC2:
+        return False
+    if b == 0xC3:
+        return True
+    if b in (0xC4, 0xC5, 0xC6):
+        return r.take(r.uint(1 << (b - 0xC4)))
+    if b == 0xCA:
+        return struct.unpack(">f", r.take(4))[0]
+    if b == 0xCB:
+        return struct.unpack(">d", r.take(8))[0]
+    if 0xCC <= b <= 0xCF:
+        return r.uint(1 << (b - 0xCC))
+    if 0xD0 <= b <= 0xD3:
+        n = 1 << (b - 0xD0)
+        return int.from_bytes(r.take(n), "big", signed=True)
+    if 0xD9 <= b <= 0xDB:
+        return r.take(r.uint(1 << (b - 0xD9))).decode("utf-8")
+    if b in (0xDC, 0xDD):
+        return [_msgpack_item(r, keys) for _ in range(r.uint(2 if b == 0xDC else 4))]
+    if b in (0xDE, 0xDF):
+        return _msgpack_map(r, keys, r.uint(2 if b == 0xDE else 4))
+    raise ValueError(f"unsupported MessagePack type 0x{b:02X}")
+
+
+def _msgpack_map(r, keys, pairs):
+    result = {}
+    for _ in range(pairs):
+        key = _msgpack_item(r, keys)
+        result[_name(key, keys)] = _msgpack_item(r, keys)
+    return result
+
+
+def decode_msgpack(data, keys=None):
+    r = _Reader(data)
+    value = _msgpack_item(r, keys)
+    if r.pos != len(r.data):
+        raise ValueError(f"{len(r.data) - r.pos} trailing bytes")
+    return value
+
+
+def decode_payload(payload, encoding, keys=None):
+    if encoding == "cbor":
+        return decode_cbor(payload, keys)
+    if encoding == "msgpack":
+        return decode_msgpack(payload, keys)
+    if not payload:
+        return None
+    try:
+        return json.loads(payload)
+    except ValueError:
+        return bytes(payload).decode("utf-8", "replace")
+
+
+def decode(topic, payload, keys=None):
+    """(topic without the encoding suffix, decoded value)"""
+    for suffix, encoding in SUFFIXES.items():
+        if topic.endswith(suffix):
+            return topic[:-len(suffix)], decode_payload(payload, encoding, keys)
+    return topic, decode_payload(payload, "json", keys)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("file", nargs="?", help="decode one payload from a file instead of reading stdin")
+    parser.add_argument("--encoding", choices=["json", "cbor", "msgpack"], default="cbor")
+    parser.add_argument("--keys", default=KEYS_HEADER, help="telemetry_keys.h, or a saved schema (JSON array)")
+    args = parser.parse_args()
+
+    if args.keys.endswith(".json"):
+        with open(args.keys) as f:
+            keys = json.load(f)
+    else:
+        keys = load_keys(args.keys)
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            print(json.dumps(decode_payload(f.read(), args.encoding, keys), indent=2))
+        return
+
+    # "<topic> <hex>" lines, as from mosquitto_sub -v -F '%t %x'. Units can
+    # run different firmware, so each one's own schema wins once it is seen
+    unit_keys = {}
+    for line in sys.stdin:
+        topic, _, hexdata = line.strip().partition(" ")
+        if not topic:
+            continue
+        payload = bytes.fromhex(hexdata)
+        unit = "/".join(topic.split("/")[:2])
+        if topic.endswith(SCHEMA_SUFFIX):
+            unit_keys[unit] = json.loads(payload)
+            print(f"{topic}: {len(unit_keys[unit])} keys")
+            continue
+        try:
+            base, value = decode(topic, payload, unit_keys.get(unit, keys))
+            print(f"{base} ({len(payload)} bytes): {json.dumps(value)}", flush=True)
+        except ValueError as e:
+            print(f"{topic}: undecodable ({e})", flush=True)
+
+
+if __name__ == "__main__":
+    main()
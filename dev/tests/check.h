@@ -0,0 +1,73 @@
+#pragma once
+
+// Minimal checks for the host tests: each failure prints where and what,
+// the test keeps going, and check_summary() is the exit code
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+inline int check_failures = 0;
+inline int check_count = 0;
+
+inline bool check_report(bool ok, const char * file, int line, const char * what) {
+    check_count++;
+    if (!ok) {
+        check_failures++;
+        fprintf(stderr, "%s:%d: FAILED %s\n", file, line, what);
+    }
+    return ok;
+}
+
+#define CHECK(cond) check_report((cond), __FILE__, __LINE__, #cond)
+
+// Each side is evaluated once, so a failing check on a call with side
+// effects prints what the call returned rather than calling it again
+#define CHECK_NEAR(a, b, tol) [&]() { \
+        double _a = (a), _b = (b); \
+        return check_report(fabs(_a - _b) <= (tol), __FILE__, __LINE__, #a " ~ " #b " within " #tol) || \
+               (fprintf(stderr, "    %g vs %g\n", _a, _b), false); \
+    }()
+
+// (b) stays in the comparison so a literal keeps its constant-ness for
+// -Wsign-compare; it's the expected value and free of side effects
+#define CHECK_EQ(a, b) [&]() { \
+        auto && _a = (a); \
+        return check_report(_a == (b), __FILE__, __LINE__, #a " == " #b) || \
+               (fprintf(stderr, "    %lld vs %lld\n", (long long) _a, (long long) (b)), false); \
+    }()
+
+#define CHECK_STR(a, b) [&]() { \
+        const char * _a = (a); \
+        const char * _b = (b); \
+        return check_report(strcmp(_a, _b) == 0, __FILE__, __LINE__, #a " == " #b) || \
+               (fprintf(stderr, "    \"%s\" vs \"%s\"\n", _a, _b), false); \
+    }()
+
+inline int check_summary(const char * name) {
+    printf("%s: %d checks, %d failed\n", name, check_count, check_failures);
+    return check_failures ? 1 : 0;
+}
+
+// --bench on the command line; costs are only meaningful in an optimised
+// build without the sanitizers (make bench)
+inline bool bench_requested(int argc, char ** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) return true;
+    }
+    return false;
+}
+
+// ns per call of fn, best of a few runs of `rounds` calls
+template <class Fn>
+double bench_ns(long rounds, Fn fn) {
+    double best = 1e300;
+    for (int run = 0; run < 5; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < rounds; i++) fn();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ns / rounds < best) best = ns / rounds;
+    }
+    return best;
+}
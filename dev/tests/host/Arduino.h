@@ -0,0 +1,114 @@
+#pragma once
+
+// Just enough of Arduino.h and FreeRTOS to build the firmware modules under
+// test on a host. millis() is a clock the tests set; critical sections are
+// no-ops, as the tests are single-threaded
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+using std::isnan;
+using std::isfinite;
+using std::isinf;
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+template <class T, class L, class H>
+inline T constrain(T x, L lo, H hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+inline unsigned long host_millis = 0;
+inline unsigned long millis() { return host_millis; }
+inline unsigned long micros() { return host_millis * 1000; }
+inline void delay(unsigned long ms) { host_millis += ms; }
+
+// FreeRTOS / IDF types that appear in the headers
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(lock) ((void) (lock))
+#define portEXIT_CRITICAL(lock) ((void) (lock))
+typedef void * TaskHandle_t;
+typedef void * QueueHandle_t;
+
+
+class String {
+
+    public:
+
+        String(const char * s = "") : _s(s ? s : "") {}
+        String(const std::string & s) : _s(s) {}
+        String(char c) : _s(1, c) {}
+        String(int n) : _s(std::to_string(n)) {}
+
+        const char * c_str() const { return _s.c_str(); }
+        unsigned int length() const { return _s.size(); }
+        long toInt() const { return atol(_s.c_str()); }
+
+        String & operator+=(const String & o) { _s += o._s; return *this; }
+        String & operator+=(const char * o) { _s += o; return *this; }
+        String & operator+=(char c) { _s += c; return *this; }
+        String & operator+=(int n) { _s += std::to_string(n); return *this; }
+
+        friend String operator+(const String & a, const String & b) { return String(a._s + b._s); }
+        friend String operator+(const String & a, const char * b) { return String(a._s + b); }
+        bool operator==(const String & o) const { return _s == o._s; }
+        bool operator==(const char * o) const { return _s == o; }
+        bool operator!=(const char * o) const { return _s != o; }
+
+    private:
+
+        std::string _s;
+
+};
+
+
+// Output sink; write() is all a subclass has to provide
+class Print {
+
+    public:
+
+        virtual ~Print() {}
+        virtual size_t write(uint8_t) = 0;
+        virtual size_t write(const uint8_t * buf, size_t len) {
+            for (size_t i = 0; i < len; i++) write(buf[i]);
+            return len;
+        }
+
+        size_t print(const char * s) { return write((const uint8_t *) s, strlen(s)); }
+        size_t print(const String & s) { return print(s.c_str()); }
+        size_t println(const char * s = "") { return print(s) + print("\r\n"); }
+
+        size_t printf(const char * format, ...) __attribute__((format(printf, 2, 3))) {
+            char buf[512];
+            va_list args;
+            va_start(args, format);
+            int n = vsnprintf(buf, sizeof(buf), format, args);
+            va_end(args);
+            if (n < 0) return 0;
+            return write((const uint8_t *) buf, (size_t) n < sizeof(buf) ? n : sizeof(buf) - 1);
+        }
+
+};
+
+
+// Boot and debug chatter from the modules goes nowhere
+struct HostSerial {
+    template <class... Args> size_t print(Args &&...) { return 0; }
+    template <class... Args> size_t println(Args &&...) { return 0; }
+    size_t printf(const char *, ...) { return 0; }
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,35 @@
+#pragma once
+
+// Captive DNS stand-in: records that it was started and serviced. The last
+// one constructed is host_dns
+
+#include <WiFi.h>
+
+class DNSServer;
+inline DNSServer * host_dns = nullptr;
+
+enum class DNSReplyCode { NoError = 0, ServerFailure = 2, NonExistentDomain = 3 };
+
+class DNSServer {
+
+    public:
+
+        DNSServer() { host_dns = this; }
+
+        void setErrorReplyCode(DNSReplyCode code) { reply_code = code; }
+        bool start(uint16_t port, const char * domain, const IPAddress &) {
+            this->port = port;
+            this->domain = domain;
+            running = true;
+            return true;
+        }
+        void stop() { running = false; }
+        void processNextRequest() { passes++; }
+
+        DNSReplyCode reply_code = DNSReplyCode::ServerFailure;
+        uint16_t port = 0;
+        std::string domain;
+        bool running = false;
+        int passes = 0;
+
+};
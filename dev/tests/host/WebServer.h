@@ -0,0 +1,131 @@
+#pragma once
+
+// WebServer with the routing of the arduino-esp32 one (exact URI match,
+// method filter, not-found fallback) and no sockets. A test queues a
+// request on the server listening on a port; the module's own loop() then
+// serves it through handleClient(), and the response is kept for checking
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_DELETE };
+
+struct HostRequest {
+    HTTPMethod method = HTTP_GET;
+    std::string uri;
+    std::map<std::string, std::string> args;
+    std::map<std::string, std::string> headers;
+};
+
+struct HostResponse {
+    int code = 0;                               // 0 = nothing sent
+    std::string type;
+    std::string body;
+    std::map<std::string, std::string> headers;
+};
+
+class WebServer {
+
+    public:
+
+        typedef std::function<void()> THandlerFunction;
+
+        explicit WebServer(int port) : _port(port) { _servers().push_back(this); }
+        ~WebServer() {
+            auto & all = _servers();
+            all.erase(std::remove(all.begin(), all.end(), this), all.end());
+        }
+
+        void on(const char * uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+        void on(const char * uri, HTTPMethod method, THandlerFunction handler) {
+            _routes.push_back({uri, method, handler});
+        }
+        void onNotFound(THandlerFunction handler) { _not_found = handler; }
+        void collectHeaders(const char * headers[], size_t count) {
+            _collect.assign(headers, headers + count);
+        }
+
+        void begin() { listening = true; }
+        void stop() { listening = false; }
+
+        // One queued request per call, as the real one serves one client
+        void handleClient() {
+            if (!listening || _queue.empty()) return;
+            _request = _queue.front();
+            _queue.erase(_queue.begin());
+            _pending = HostResponse();
+            for (const Route & r : _routes) {
+                if (r.uri == _request.uri && (r.method == HTTP_ANY || r.method == _request.method)) {
+                    r.handler();
+                    _finish();
+                    return;
+                }
+            }
+            if (_not_found) _not_found();
+            _finish();
+        }
+
+        String uri() { return String(_request.uri); }
+        bool hasArg(const char * name) { return _request.args.count(name) > 0; }
+        String arg(const char * name) { return hasArg(name) ? String(_request.args[name]) : String(); }
+        // Only the headers asked for with collectHeaders() are seen, as on the device
+        String header(const char * name) {
+            if (std::find_if(_collect.begin(), _collect.end(),
+                             [name](const std::string & h) { return strcasecmp(h.c_str(), name) == 0; }) == _collect.end()) {
+                return String();
+            }
+            auto it = _request.headers.find(name);
+            return it == _request.headers.end() ? String() : String(it->second);
+        }
+
+        void sendHeader(const String & name, const String & value) {
+            _pending.headers[name.c_str()] = value.c_str();
+        }
+        void send(int code, const char * type = "", const String & content = String()) {
+            _pending.code = code;
+            _pending.type = type;
+            _pending.body = content.c_str();
+        }
+        void send_P(int code, const char * type, const char * content, size_t length) {
+            _pending.code = code;
+            _pending.type = type;
+            _pending.body.assign(content, length);
+        }
+
+        // Test side
+        bool listening = false;
+        std::vector<HostResponse> responses;
+        void queue(const HostRequest & request) { _queue.push_back(request); }
+        static WebServer * on_port(int port) {
+            for (WebServer * s : _servers()) {
+                if (s->_port == port) return s;
+            }
+            return nullptr;
+        }
+
+    private:
+
+        struct Route {
+            std::string uri;
+            HTTPMethod method;
+            THandlerFunction handler;
+        };
+
+        int _port;
+        std::vector<Route> _routes;
+        THandlerFunction _not_found;
+        std::vector<std::string> _collect;
+        std::vector<HostRequest> _queue;
+        HostRequest _request;
+        HostResponse _pending;
+
+        void _finish() { responses.push_back(_pending); }
+
+        static std::vector<WebServer *> & _servers() {
+            static std::vector<WebServer *> all;
+            return all;
+        }
+
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+// The parts of the WiFi class the provisioner uses. Scans complete when the
+// test says so, with the results it sets
+
+#include <Arduino.h>
+#include <vector>
+
+enum wifi_mode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class IPAddress {
+
+    public:
+
+        IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _octets{a, b, c, d} {}
+
+        String toString() const {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _octets[0], _octets[1], _octets[2], _octets[3]);
+            return String(buf);
+        }
+
+    private:
+
+        uint8_t _octets[4];
+
+};
+
+struct HostNetwork {
+    const char * ssid;
+    int rssi;
+};
+
+class HostWiFi {
+
+    public:
+
+        // Test side
+        std::vector<HostNetwork> networks;
+        bool scan_done = false;
+        int scans_started = 0;
+        wifi_mode_t current_mode = WIFI_STA;
+        bool ap_up = false;
+
+        bool mode(wifi_mode_t m) { current_mode = m; return true; }
+        bool softAP(const char *) { ap_up = true; return true; }
+        bool softAPdisconnect(bool) { ap_up = false; return true; }
+        IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+
+        int16_t scanNetworks(bool) {
+            scans_started++;
+            return WIFI_SCAN_RUNNING;
+        }
+        int16_t scanComplete() {
+            if (!scan_done) return WIFI_SCAN_RUNNING;
+            _results = networks;
+            scan_done = false;
+            return _results.size();
+        }
+        String SSID(uint8_t i) { return i < _results.size() ? String(_results[i].ssid) : String(); }
+        int32_t RSSI(uint8_t i) { return i < _results.size() ? _results[i].rssi : 0; }
+        void scanDelete() { _results.clear(); }
+
+    private:
+
+        std::vector<HostNetwork> _results;
+
+};
+
+inline HostWiFi WiFi;
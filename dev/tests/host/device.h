@@ -0,0 +1,32 @@
+#pragma once
+
+// The sample ring of lib/device, which the history store reads; the test
+// appends the INA219 samples it wants recorded
+
+#include <Arduino.h>
+#include <vector>
+
+struct PowerSample {
+    uint64_t us;
+    float current_mA;
+    float busvoltage;
+    float power_mW;
+};
+
+class Device {
+
+    public:
+
+        uint32_t SampleSeq() { return samples.size(); }
+        bool GetSample(uint32_t seq, PowerSample & sample) {
+            if (seq >= samples.size()) return false;
+            sample = samples[seq];
+            return true;
+        }
+
+        // Test side
+        std::vector<PowerSample> samples;
+
+};
+
+extern Device device;
@@ -0,0 +1,24 @@
+#pragma once
+
+// No partitions on the host: the tests hand the store a SeriesFlash of their own
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+
+enum esp_partition_type_t { ESP_PARTITION_TYPE_APP, ESP_PARTITION_TYPE_DATA };
+enum esp_partition_subtype_t { ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82 };
+
+struct esp_partition_t {
+    size_t size;
+};
+
+inline const esp_partition_t * esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char *) {
+    return nullptr;
+}
+inline esp_err_t esp_partition_read(const esp_partition_t *, size_t, void *, size_t) { return ESP_FAIL; }
+inline esp_err_t esp_partition_write(const esp_partition_t *, size_t, const void *, size_t) { return ESP_FAIL; }
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t, size_t) { return ESP_FAIL; }
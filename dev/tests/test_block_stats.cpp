@@ -0,0 +1,217 @@
+/*
+ * ACS712 block kernel (lib/current_adc/block_stats.h) against a plain
+ * double-precision reference on synthetic captures: DC, PWM square waves,
+ * sine ripple with noise, small ripple on a large offset (where the
+ * integer sum-of-squares has to survive the cancellation), odd lengths
+ * for the unrolled loop's tail, and full-scale input. --bench prints the
+ * cost of one capture block.
+ */
+
+#include "check.h"
+#include "block_stats.h"
+#include <vector>
+
+#define BLOCK 1000                  // ACS712_BLOCK_SAMPLES
+#define FULL_SCALE 4095
+
+static void reference(const std::vector<uint16_t> & x, double offset, BlockStats & out) {
+    double sum = 0, sum_sq = 0, peak = 0;
+    uint16_t lo = 0xFFFF, hi = 0;
+    for (uint16_t v : x) sum += v;
+    double mean = sum / x.size();
+    for (uint16_t v : x) {
+        sum_sq += (v - mean) * (v - mean);
+        peak = std::max(peak, fabs(v - offset));
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+    double ripple = sqrt(sum_sq / x.size());
+    out.mean = mean - offset;
+    out.ripple_rms = ripple;
+    out.rms = sqrt(ripple * ripple + (mean - offset) * (mean - offset));
+    out.peak = peak;
+    out.min = lo;
+    out.max = hi;
+    out.n = x.size();
+}
+
+// Relative to the signal, with a floor of a hundredth of a count
+static bool matches(const std::vector<uint16_t> & x, float offset) {
+    BlockStats got, want;
+    block_stats(x.data(), x.size(), offset, got);
+    reference(x, offset, want);
+    bool ok = true;
+    ok &= CHECK_EQ(got.n, want.n);
+    ok &= CHECK_EQ(got.min, want.min);
+    ok &= CHECK_EQ(got.max, want.max);
+    ok &= CHECK_NEAR(got.mean, want.mean, 0.01 + 1e-5 * fabs(want.mean));
+    ok &= CHECK_NEAR(got.ripple_rms, want.ripple_rms, 0.01 + 1e-4 * want.ripple_rms);
+    ok &= CHECK_NEAR(got.rms, want.rms, 0.01 + 1e-5 * want.rms);
+    ok &= CHECK_NEAR(got.peak, want.peak, 1e-3);
+    return ok;
+}
+
+static uint32_t lcg = 12345;
+static int noise(int amplitude) {
+    lcg = lcg * 1664525 + 1013904223;
+    return (int) (lcg >> 8) % (2 * amplitude + 1) - amplitude;
+}
+
+static uint16_t clamp12(double v) {
+    return (uint16_t) std::max(0.0, std::min((double) FULL_SCALE, round(v)));
+}
+
+// 5 kHz PWM at 20 kS/s is four samples a period; duty in quarters
+static std::vector<uint16_t> pwm(size_t n, int period, int on, uint16_t low, uint16_t high, int jitter) {
+    std::vector<uint16_t> x(n);
+    for (size_t i = 0; i < n; i++) x[i] = clamp12(((int) (i % period) < on ? high : low) + noise(jitter));
+    return x;
+}
+
+
+static void test_empty() {
+    BlockStats s;
+    s.mean = s.rms = 1;
+    block_stats(nullptr, 0, 2000, s);
+    CHECK_EQ(s.n, 0);
+    CHECK_EQ(s.mean, 0);
+    CHECK_EQ(s.rms, 0);
+    CHECK_EQ(s.ripple_rms, 0);
+    CHECK_EQ(s.peak, 0);
+}
+
+
+static void test_dc() {
+    std::vector<uint16_t> x(BLOCK, 2400);
+    BlockStats s;
+    block_stats(x.data(), x.size(), 2000.0f, s);
+    CHECK_NEAR(s.mean, 400, 1e-4);
+    CHECK_NEAR(s.rms, 400, 1e-4);
+    CHECK_EQ(s.ripple_rms, 0);
+    CHECK_NEAR(s.peak, 400, 1e-4);
+    CHECK_EQ(s.min, 2400);
+    CHECK_EQ(s.max, 2400);
+
+    // Below the offset: reverse current
+    std::fill(x.begin(), x.end(), 1700);
+    block_stats(x.data(), x.size(), 2000.0f, s);
+    CHECK_NEAR(s.mean, -300, 1e-4);
+    CHECK_NEAR(s.rms, 300, 1e-4);
+    CHECK_NEAR(s.peak, 300, 1e-4);
+}
+
+
+static void test_pwm() {
+    // 2 of 4 samples high (50 %): ripple is half the step
+    std::vector<uint16_t> x = pwm(BLOCK, 4, 2, 2000, 3000, 0);
+    BlockStats s;
+    block_stats(x.data(), x.size(), 2000.0f, s);
+    CHECK_NEAR(s.mean, 500, 1e-3);
+    CHECK_NEAR(s.ripple_rms, 500, 1e-2);
+    CHECK_NEAR(s.rms, sqrt(500.0 * 500 + 500.0 * 500), 1e-2);
+    CHECK_NEAR(s.peak, 1000, 1e-3);
+
+    // Duty d: ripple is step * sqrt(d (1 - d))
+    x = pwm(BLOCK * 2, 20, 3, 1900, 3100, 0);
+    block_stats(x.data(), x.size(), 1900.0f, s);
+    CHECK_NEAR(s.mean, 1200 * 0.15, 1e-2);
+    CHECK_NEAR(s.ripple_rms, 1200 * sqrt(0.15 * 0.85), 1e-2);
+
+    for (int on = 0; on <= 4; on++) matches(pwm(BLOCK, 4, on, 2050, 2900, 3), 2048.0f);
+    matches(pwm(BLOCK, 7, 5, 1000, 3500, 20), 2048.5f);
+}
+
+
+static void test_sine_noise() {
+    std::vector<uint16_t> x(BLOCK);
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] = clamp12(2300 + 150 * sin(2 * M_PI * i / 40.0) + noise(12));
+    }
+    matches(x, 2047.3f);
+}
+
+
+// Small ripple riding on a large level: mean_sq and mean^2 are both ~1.6e7
+// and differ by about one count^2
+static void test_cancellation() {
+    std::vector<uint16_t> x(BLOCK);
+    for (size_t i = 0; i < x.size(); i++) x[i] = (i & 1) ? 4000 : 4002;
+    BlockStats s;
+    block_stats(x.data(), x.size(), 2048.0f, s);
+    CHECK_NEAR(s.ripple_rms, 1.0, 1e-3);
+    CHECK_NEAR(s.mean, 4001 - 2048, 1e-3);
+
+    for (size_t i = 0; i < x.size(); i++) x[i] = clamp12(4090 + noise(1));
+    matches(x, 2048.0f);
+}
+
+
+// Every length around the unroll width, with the extremes in the tail
+static void test_lengths() {
+    for (size_t n = 1; n <= 13; n++) {
+        std::vector<uint16_t> x(n, 2000);
+        x[n - 1] = 2500;
+        if (n > 1) x[n - 2] = 1500;
+        if (!matches(x, 2000.0f)) fprintf(stderr, "    at n = %zu\n", n);
+    }
+    std::vector<uint16_t> x = pwm(BLOCK + 3, 4, 1, 100, 4000, 50);
+    x.back() = FULL_SCALE;
+    x[BLOCK + 1] = 0;
+    matches(x, 2048.0f);
+}
+
+
+// The integer accumulators at full scale: the sum stays in 32 bits up to
+// ~1M samples, far beyond a block
+static void test_full_scale() {
+    std::vector<uint16_t> x(1 << 20, FULL_SCALE);
+    BlockStats s;
+    block_stats(x.data(), x.size(), 0.0f, s);
+    CHECK_NEAR(s.mean, FULL_SCALE, 1e-3);
+    CHECK_NEAR(s.rms, FULL_SCALE, 1e-3);
+    CHECK_NEAR(s.ripple_rms, 0, 1e-3);
+
+    std::vector<uint16_t> y = pwm(BLOCK, 2, 1, 0, FULL_SCALE, 0);
+    matches(y, 0.0f);
+    matches(y, FULL_SCALE);
+}
+
+
+// Per-sample float loop, the obvious alternative, for comparison
+static void float_stats(const uint16_t * x, size_t n, float offset, BlockStats & out) {
+    float sum = 0, sum_sq = 0, peak = 0;
+    for (size_t i = 0; i < n; i++) {
+        float v = x[i] - offset;
+        sum += v;
+        sum_sq += v * v;
+        peak = std::max(peak, fabsf(v));
+    }
+    out.mean = sum / n;
+    out.rms = sqrtf(sum_sq / n);
+    out.ripple_rms = sqrtf(std::max(0.0f, sum_sq / n - out.mean * out.mean));
+    out.peak = peak;
+}
+
+static void bench() {
+    std::vector<uint16_t> x(BLOCK);
+    for (size_t i = 0; i < x.size(); i++) x[i] = clamp12(2300 + 150 * sin(2 * M_PI * i / 4.0) + noise(12));
+    BlockStats s;
+    volatile float sink = 0;
+    double integer = bench_ns(20000, [&]() { block_stats(x.data(), x.size(), 2048.0f, s); sink = sink + s.rms; });
+    double flt = bench_ns(20000, [&]() { float_stats(x.data(), x.size(), 2048.0f, s); sink = sink + s.rms; });
+    printf("block_stats: %.0f ns per %d-sample block (%.2f ns/sample); float loop %.0f ns\n",
+           integer, BLOCK, integer / BLOCK, flt);
+}
+
+
+int main(int argc, char ** argv) {
+    test_empty();
+    test_dc();
+    test_pwm();
+    test_sine_noise();
+    test_cancellation();
+    test_lengths();
+    test_full_scale();
+    if (bench_requested(argc, argv)) bench();
+    return check_summary("block_stats");
+}
@@ -0,0 +1,255 @@
+/*
+ * Charge-based polarity reversal (lib/device/charge_balance.h), driven the
+ * way Device drives it: one INA219 reading at a time, with the current
+ * wandering, noisy and signed by polarity, the interval jittering and the
+ * odd reading missing. Reverse / forward charge has to converge on the
+ * ratio, the residual stays within one reading, a reboot from the RTC or
+ * the NVS copy carries on, a ratio of 0 never reverses, and a stopped
+ * output with no readings counts no charge.
+ */
+
+#include "check.h"
+#include "charge_balance.h"
+#include <random>
+#include <string.h>
+
+// Device's configuration (device.h)
+#define CYCLE_C 600.0f              // REVERSE_CYCLE_C
+#define RATIO 0.1f
+#define INTERVAL_S 0.1              // POWER_SAMPLE_INTERVAL
+#define FALLBACK_MA 1000.0f         // REVERSE_FALLBACK_MA
+#define STALE_S 2.0f                // CHARGE_STALE_MS
+
+static std::mt19937 rng(4711);
+
+static double uniform(double lo, double hi) {
+    return std::uniform_real_distribution<double>(lo, hi)(rng);
+}
+
+// The cell as the INA219 sees it: 1 A give or take half, drifting over
+// hours, read noise on top, negative while reversed
+struct Cell {
+    double t = 0;
+    double max_q = 0;               // largest charge in one reading, C
+    int missing = 0;
+
+    bool step(ChargeBalance & balance) {
+        double dt = INTERVAL_S * uniform(0.9, 1.1);
+        t += dt;
+        double mA = 1000 * (1 + 0.5 * sin(2 * M_PI * t / 7200)) + uniform(-80, 80);
+        if (balance.reverse()) mA = -mA;
+        max_q = std::max(max_q, fabs(mA) * dt / 1000);
+        if (uniform(0, 1) < 0.01) {
+            missing++;
+            return balance.step(NAN, (float) dt);
+        }
+        return balance.step((float) mA, (float) dt);
+    }
+};
+
+// What every state has to satisfy: the balance is exactly what reverse
+// charge has paid against the forward charge's debt
+static bool consistent(const ChargeBalance & balance) {
+    const ChargeState & s = balance.state();
+    double debt = s.reverse_C - balance.ratio() * s.forward_C;
+    return CHECK_NEAR(s.balance_C, debt, 1e-3 + 1e-6 * s.forward_C);
+}
+
+
+static void test_convergence() {
+    ChargeBalance balance(CYCLE_C, RATIO);
+    Cell cell;
+    CHECK(!balance.reverse());
+    CHECK_EQ(balance.achieved_ratio(), 0);
+
+    // Phase lengths per cycle: forward ~cycle_C, reverse ~ratio x that
+    int flips = 0;
+    double phase_start_forward = 0, phase_start_reverse = 0;
+    double worst_forward = 0, worst_reverse = 0, worst_balance = 0;
+    while (balance.state().reversals < 200 || balance.reverse()) {
+        bool was_reverse = balance.reverse();
+        if (!cell.step(balance)) continue;
+        flips++;
+        const ChargeState & s = balance.state();
+        if (!was_reverse) {
+            worst_forward = std::max(worst_forward, fabs(s.forward_C - phase_start_forward - CYCLE_C));
+            phase_start_reverse = s.reverse_C;
+        } else {
+            worst_reverse = std::max(worst_reverse, fabs(s.reverse_C - phase_start_reverse - RATIO * CYCLE_C));
+            phase_start_forward = s.forward_C;
+            // Paid up to within one reading at the end of every reverse phase
+            worst_balance = std::max(worst_balance, fabs((double) s.balance_C));
+        }
+    }
+    CHECK_EQ(flips, 400);
+    CHECK(cell.missing > 0);
+    CHECK(worst_forward <= cell.max_q);
+    CHECK(worst_reverse <= 2 * cell.max_q);
+    CHECK(worst_balance <= cell.max_q);
+    consistent(balance);
+
+    // 200 cycles at 1 A is a few days; with the last reverse phase paid
+    // the lifetime ratio is within one reading of exact
+    double forward = balance.state().forward_C;
+    CHECK_NEAR(forward, 200 * CYCLE_C, 200 * cell.max_q);
+    CHECK_NEAR(balance.achieved_ratio(), RATIO, 2 * cell.max_q / forward + 1e-6);
+}
+
+
+// Readings that can't count never move anything
+static void test_invalid_readings() {
+    ChargeBalance balance(CYCLE_C, RATIO);
+    ChargeState before = balance.state();
+    CHECK(!balance.step(NAN, 0.1f));
+    CHECK(!balance.step(1000, 0));
+    CHECK(!balance.step(1000, -0.1f));
+    CHECK(!balance.step(1000, NAN));
+    CHECK(memcmp(&before, &balance.state(), sizeof(before)) == 0);
+
+    // Sign doesn't matter, only the charge through the cell
+    CHECK(!balance.step(-1000, 1));
+    CHECK(!balance.step(1000, 1));
+    CHECK_NEAR(balance.state().forward_C, 2, 1e-6);
+    CHECK_NEAR(balance.balance_C(), -2 * RATIO, 1e-6);
+}
+
+
+// A reboot restores from RTC memory when it survived, else from the NVS
+// copy written at the last flip; either way the schedule carries on
+static void test_reboot() {
+    ChargeBalance reference(CYCLE_C, RATIO);
+    Cell cell;
+    while (reference.state().reversals < 5) cell.step(reference);
+    while (!reference.step(700, 0.1f)) {}          // into the next forward phase
+    ChargeState nvs = reference.state();            // SaveCharge() at the flip
+    for (int i = 0; i < 3000; i++) cell.step(reference);
+    ChargeState rtc = reference.state();            // rtc_charge after every reading
+
+    // Warm reboot: a fresh object from RTC memory is indistinguishable
+    ChargeBalance warm(CYCLE_C, RATIO);
+    CHECK(warm.restore(rtc));
+    CHECK(memcmp(&warm.state(), &rtc, sizeof(rtc)) == 0);
+    bool same = true;
+    for (int i = 0; i < 100000; i++) {
+        float mA = (float) (reference.reverse() ? -1100 : 1100), dt = 0.1f;
+        same &= reference.step(mA, dt) == warm.step(mA, dt);
+    }
+    same &= memcmp(&warm.state(), &reference.state(), sizeof(rtc)) == 0;
+    CHECK(same);
+
+    // Cold boot: back to the last flip, same polarity, owing the same
+    ChargeBalance cold(CYCLE_C, RATIO);
+    CHECK(cold.restore(nvs));
+    CHECK_EQ(cold.reverse(), nvs.reverse);
+    CHECK_EQ(cold.state().reversals, nvs.reversals);
+    CHECK_EQ(cold.balance_C(), nvs.balance_C);
+    while (cold.state().reversals < 100 || cold.reverse()) cell.step(cold);
+    consistent(cold);
+    CHECK_NEAR(cold.achieved_ratio(), RATIO, 2 * cell.max_q / cold.state().forward_C + 1e-6);
+}
+
+
+// Anything that isn't a state of ours is refused and changes nothing
+static void test_restore_rejects() {
+    ChargeBalance balance(CYCLE_C, RATIO);
+    Cell cell;
+    for (int i = 0; i < 1000; i++) cell.step(balance);
+    ChargeState good = balance.state();
+    ChargeState before = good;
+
+    ChargeState zeroed = {};                        // RTC memory after power-on
+    CHECK(!balance.restore(zeroed));
+    ChargeState bad = good;
+    bad.magic ^= 1;
+    CHECK(!balance.restore(bad));
+    bad = good;
+    bad.balance_C = NAN;
+    CHECK(!balance.restore(bad));
+    bad = good;
+    bad.phase_C = INFINITY;
+    CHECK(!balance.restore(bad));
+    bad = good;
+    bad.forward_C = NAN;
+    CHECK(!balance.restore(bad));
+    bad = good;
+    bad.reverse_C = -INFINITY;
+    CHECK(!balance.restore(bad));
+    CHECK(memcmp(&before, &balance.state(), sizeof(before)) == 0);
+
+    // A stray polarity byte reads as reverse and is stored as 1
+    ChargeState odd = good;
+    odd.reverse = 0x5A;
+    CHECK(balance.restore(odd));
+    CHECK_EQ(balance.state().reverse, 1);
+}
+
+
+static void test_ratio_zero() {
+    ChargeBalance balance(CYCLE_C, 0);
+    Cell cell;
+    bool flipped = false;
+    while (cell.t < 7 * 24 * 3600) flipped |= cell.step(balance);    // a week at ~1 A
+    CHECK(!flipped);
+    CHECK(!balance.reverse());
+    CHECK_EQ(balance.state().reversals, 0);
+    CHECK_EQ(balance.balance_C(), 0);
+    CHECK_EQ(balance.state().reverse_C, 0);
+    CHECK(balance.state().forward_C > 100 * CYCLE_C);
+    CHECK_EQ(balance.achieved_ratio(), 0);
+
+    // Nothing is owed for the time at 0, so turning the ratio up starts a
+    // new cycle rather than a week-long reverse phase
+    balance.set_ratio(RATIO);
+    CHECK(balance.step(1000, 0.1f));
+    CHECK(balance.reverse());
+    CHECK_NEAR(balance.balance_C(), -RATIO * 0.1f, 1e-6);
+    CHECK(balance.step(-1000, 0.1f));
+    CHECK(!balance.reverse());
+}
+
+
+// With the INA219 gone Device counts charge on time, a stale interval at
+// a go, at the current charge_fallback_mA() gives it
+static int stale_for(ChargeBalance & balance, float seconds, bool running, bool tripped) {
+    int flips = 0;
+    for (float t = 0; t < seconds; t += STALE_S) {
+        flips += balance.step(charge_fallback_mA(running, tripped, FALLBACK_MA), STALE_S);
+    }
+    return flips;
+}
+
+static void test_stale_fallback() {
+    // Driving: 1 A assumed, so the forward phase still ends after cycle_C
+    ChargeBalance balance(CYCLE_C, RATIO);
+    CHECK_EQ(stale_for(balance, CYCLE_C - 2 * STALE_S, true, false), 0);
+    CHECK_EQ(stale_for(balance, 2 * STALE_S, true, false), 1);
+    CHECK(balance.reverse());
+
+    // Stopped from telnet or RPC, or tripped: a day of stale readings adds
+    // no phantom charge and brings no reversal
+    ChargeState before = balance.state();
+    CHECK_EQ(stale_for(balance, 24 * 3600, false, false), 0);
+    CHECK_EQ(stale_for(balance, 24 * 3600, true, true), 0);
+    CHECK_EQ(stale_for(balance, 24 * 3600, false, true), 0);
+    CHECK(balance.reverse());
+    CHECK_EQ(balance.state().reverse_C, before.reverse_C);
+    CHECK_EQ(balance.state().forward_C, before.forward_C);
+    CHECK_EQ(balance.balance_C(), before.balance_C);
+    CHECK_EQ(balance.state().reversals, before.reversals);
+
+    // Started again, the reverse phase picks up where it stopped
+    CHECK_EQ(stale_for(balance, RATIO * CYCLE_C + STALE_S, true, false), 1);
+    CHECK(!balance.reverse());
+    consistent(balance);
+}
+
+
+int main() {
+    test_convergence();
+    test_invalid_readings();
+    test_reboot();
+    test_restore_rejects();
+    test_ratio_zero();
+    test_stale_fallback();
+    return check_summary("charge_balance");
+}
@@ -0,0 +1,192 @@
+/*
+ * Overcurrent retry schedule (lib/protection/fault_latch.h): a trip holds
+ * the output off until the retry, each trip in a streak doubles the wait
+ * up to the cap, running stable_ms after a retry ends the streak, a streak
+ * past the retry limit locks out until clear(), and nothing re-arms early.
+ */
+
+#include "check.h"
+#include "fault_latch.h"
+
+// Protection's configuration (protection.h)
+#define RETRY_MS 5000               // PROTECTION_RETRY_MS
+#define RETRY_MAX_MS 300000         // PROTECTION_RETRY_MAX_MS
+#define RETRIES 5                   // PROTECTION_RETRIES
+#define STABLE_MS 60000             // PROTECTION_STABLE_MS
+
+#define MS 1000LL
+#define T0 (3600 * 1000 * MS)       // an hour after boot
+
+// Trips at `now`, then polls every millisecond until the retry; returns
+// the wait in ms, or -1 when the latch never re-armed within `limit_ms`
+static int64_t trip_and_wait(FaultLatch & latch, int64_t & now, int64_t limit_ms = 3600 * 1000) {
+    if (!latch.trip(now)) return -1;
+    int64_t start = now;
+    for (int64_t end = now + limit_ms * MS; now <= end; now += MS) {
+        if (latch.poll(now)) return (now - start) / MS;
+    }
+    return -1;
+}
+
+
+static void test_trip() {
+    FaultLatch latch(RETRY_MS, RETRY_MAX_MS, RETRIES, STABLE_MS);
+    CHECK_EQ(latch.state(), FAULT_ARMED);
+    CHECK_EQ(latch.retry_at(), 0);
+    CHECK(!latch.poll(T0));
+
+    CHECK(latch.trip(T0));
+    CHECK_EQ(latch.state(), FAULT_TRIPPED);
+    CHECK_EQ(latch.streak(), 1);
+    CHECK_EQ(latch.tripped_at(), T0);
+    CHECK_EQ(latch.retry_at(), T0 + RETRY_MS * MS);
+
+    // Further trips while held off don't latch or move the retry
+    CHECK(!latch.trip(T0 + 100 * MS));
+    CHECK_EQ(latch.streak(), 1);
+    CHECK_EQ(latch.tripped_at(), T0);
+    CHECK_EQ(latch.retry_at(), T0 + RETRY_MS * MS);
+
+    // Not a microsecond early, then once
+    CHECK(!latch.poll(T0 + RETRY_MS * MS - 1));
+    CHECK_EQ(latch.state(), FAULT_TRIPPED);
+    CHECK(latch.poll(T0 + RETRY_MS * MS));
+    CHECK_EQ(latch.state(), FAULT_ARMED);
+    CHECK_EQ(latch.retry_at(), 0);
+    CHECK(!latch.poll(T0 + RETRY_MS * MS + 1));
+}
+
+
+// A fault that's still there at every retry: 5, 10, 20, 40, 80 s, then lockout
+static void test_backoff() {
+    FaultLatch latch(RETRY_MS, RETRY_MAX_MS, RETRIES, STABLE_MS);
+    int64_t now = T0;
+    int64_t wait = RETRY_MS;
+    for (int i = 1; i <= RETRIES; i++) {
+        CHECK_EQ(trip_and_wait(latch, now), wait);
+        CHECK_EQ(latch.streak(), i);
+        wait *= 2;
+    }
+
+    CHECK(latch.trip(now));
+    CHECK_EQ(latch.state(), FAULT_LOCKOUT);
+    CHECK_EQ(latch.streak(), RETRIES + 1);
+    CHECK_EQ(latch.retry_at(), 0);
+}
+
+
+// The doubling stops at retry_max_ms, and a long streak doesn't overflow
+// the shift
+static void test_cap() {
+    FaultLatch latch(RETRY_MS, RETRY_MAX_MS, 12, STABLE_MS);
+    int64_t now = T0;
+    const int64_t expected[] = {5000, 10000, 20000, 40000, 80000, 160000, 300000, 300000, 300000, 300000};
+    for (int64_t wait : expected) {
+        if (!CHECK_EQ(trip_and_wait(latch, now), wait)) fprintf(stderr, "    at streak %d\n", latch.streak());
+    }
+
+    FaultLatch uncapped(1, UINT32_MAX, 40, STABLE_MS);
+    now = T0;
+    for (int i = 1; i <= 40; i++) {
+        CHECK(uncapped.trip(now));
+        int64_t wait = (uncapped.retry_at() - now) / MS;
+        CHECK_EQ(wait, 1LL << (i - 1 < 16 ? i - 1 : 16));
+        now = uncapped.retry_at();
+        CHECK(uncapped.poll(now));
+    }
+    CHECK(uncapped.trip(now));
+    CHECK_EQ(uncapped.state(), FAULT_LOCKOUT);
+}
+
+
+// Running stable_ms after a retry ends the streak; a trip a millisecond
+// sooner counts as the same fault
+static void test_stable() {
+    FaultLatch latch(RETRY_MS, RETRY_MAX_MS, RETRIES, STABLE_MS);
+    int64_t now = T0;
+    CHECK_EQ(trip_and_wait(latch, now), RETRY_MS);
+    CHECK_EQ(trip_and_wait(latch, now), 2 * RETRY_MS);
+
+    int64_t armed = now;                // trip_and_wait() stops on the tick that re-armed
+    now = armed + (STABLE_MS - 1) * MS;
+    CHECK_EQ(trip_and_wait(latch, now), 4 * RETRY_MS);
+    CHECK_EQ(latch.streak(), 3);
+
+    armed = now;
+    now = armed + STABLE_MS * MS;
+    CHECK_EQ(trip_and_wait(latch, now), RETRY_MS);
+    CHECK_EQ(latch.streak(), 1);
+
+    // poll() while armed ends the streak too, so streak() reads right
+    // without waiting for the next trip
+    armed = now;
+    CHECK(!latch.poll(armed + (STABLE_MS - 1) * MS));
+    CHECK_EQ(latch.streak(), 1);
+    CHECK(!latch.poll(armed + STABLE_MS * MS));
+    CHECK_EQ(latch.streak(), 0);
+    CHECK_EQ(latch.state(), FAULT_ARMED);
+
+    // An intermittent fault that clears for a while between bursts never
+    // builds up to lockout
+    now = armed + 2 * STABLE_MS * MS;
+    for (int burst = 0; burst < 20; burst++) {
+        CHECK_EQ(trip_and_wait(latch, now), RETRY_MS);
+        CHECK_EQ(trip_and_wait(latch, now), 2 * RETRY_MS);
+        now += STABLE_MS * MS;
+    }
+    CHECK_EQ(latch.state(), FAULT_ARMED);
+}
+
+
+static void test_lockout() {
+    FaultLatch latch(RETRY_MS, RETRY_MAX_MS, RETRIES, STABLE_MS);
+    int64_t now = T0;
+    for (int i = 0; i < RETRIES; i++) trip_and_wait(latch, now);
+    CHECK(latch.trip(now));
+    CHECK_EQ(latch.state(), FAULT_LOCKOUT);
+
+    // Held off indefinitely: no retry, further trips ignored
+    CHECK_EQ(trip_and_wait(latch, now), -1);
+    bool held = true;
+    for (int64_t t = now; t < now + 24 * 3600 * 1000 * MS; t += 60 * 1000 * MS) held &= !latch.poll(t);
+    CHECK(held);
+    CHECK_EQ(latch.state(), FAULT_LOCKOUT);
+
+    // clear() re-arms with a fresh streak
+    now += 24 * 3600 * 1000 * MS;
+    latch.clear(now);
+    CHECK_EQ(latch.state(), FAULT_ARMED);
+    CHECK_EQ(latch.streak(), 0);
+    CHECK_EQ(trip_and_wait(latch, now), RETRY_MS);
+    CHECK_EQ(latch.streak(), 1);
+
+    // clear() also cuts a retry wait short
+    CHECK(latch.trip(now));
+    CHECK_EQ(latch.state(), FAULT_TRIPPED);
+    latch.clear(now + MS);
+    CHECK_EQ(latch.state(), FAULT_ARMED);
+    CHECK_EQ(latch.retry_at(), 0);
+    CHECK(!latch.poll(now + 2 * MS));
+}
+
+
+// Straight after boot the clock is near zero; the first trip still starts
+// a streak of one
+static void test_boot() {
+    FaultLatch latch(RETRY_MS, RETRY_MAX_MS, RETRIES, STABLE_MS);
+    int64_t now = 10 * MS;
+    CHECK_EQ(trip_and_wait(latch, now), RETRY_MS);
+    CHECK_EQ(latch.streak(), 1);
+    CHECK_EQ(trip_and_wait(latch, now), 2 * RETRY_MS);
+}
+
+
+int main() {
+    test_trip();
+    test_backoff();
+    test_cap();
+    test_stable();
+    test_lockout();
+    test_boot();
+    return check_summary("fault_latch");
+}
@@ -0,0 +1,307 @@
+/*
+ * Reading filters (lib/filters/filters.h): the low-passes' gain against
+ * their transfer functions, measured by running sines through them; the
+ * median's spike rejection and step delay; the range gate; the Kalman
+ * gain settling where the Riccati equation says; and the chain stopping
+ * at NAN without disturbing later stages. --bench prints the per-sample
+ * cost of the three chains Device runs.
+ */
+
+#include "check.h"
+#include "filters.h"
+#include <random>
+#include <vector>
+
+// Device's channel configuration (device.h)
+#define FS 10.0f                    // 1000 / POWER_SAMPLE_INTERVAL
+#define CURRENT_FC 2.0f             // FILTER_CURRENT_FC
+#define RESISTANCE_FC 0.5f          // FILTER_RESISTANCE_FC
+
+static std::mt19937 rng(12345);
+
+static double gaussian(double sigma) {
+    return std::normal_distribution<double>(0, sigma)(rng);
+}
+
+static double db(double gain) {
+    return 20 * log10(gain);
+}
+
+// Steady-state gain at f, by correlating the output with the input sine
+// after the start-up has died away
+template <class Filter>
+static double measured_gain(Filter filter, float fs, float f) {
+    const double w = 2 * M_PI * f / fs;
+    const int settle = (int) (50 * fs / f) + 1000;
+    const int n = (int) (200 * fs / f) + 10000;
+    double s = 0, c = 0;
+    filter.step(0);
+    for (int i = 0; i < settle + n; i++) {
+        double y = filter.step((float) sin(w * i));
+        if (i < settle) continue;
+        s += y * sin(w * i);
+        c += y * cos(w * i);
+    }
+    return 2 * sqrt(s * s + c * c) / n;
+}
+
+// y += a (x - y): H = a / (1 - (1 - a) z^-1)
+static double ema_gain(float fs, float fc, float f) {
+    double a = 1 - exp(-2 * M_PI * fc / fs);
+    double w = 2 * M_PI * f / fs;
+    return a / sqrt(1 - 2 * (1 - a) * cos(w) + (1 - a) * (1 - a));
+}
+
+// Bilinear Butterworth: |H|^2 = 1 / (1 + (tan(w / 2) / tan(wc / 2))^4)
+static double butterworth_gain(float fs, float fc, float f) {
+    double r = tan(M_PI * f / fs) / tan(M_PI * fc / fs);
+    return 1 / sqrt(1 + r * r * r * r);
+}
+
+
+static void test_ema_response() {
+    // Device's current channel: fc is a fifth of fs, so the -3 dB point
+    // drifts from fc; the gain follows the transfer function regardless
+    for (float f : {0.05f, 0.5f, 1.0f, 2.0f, 3.0f, 4.5f}) {
+        CHECK_NEAR(measured_gain(EmaFilter::cutoff(FS, CURRENT_FC), FS, f), ema_gain(FS, CURRENT_FC, f), 2e-3);
+    }
+    CHECK_NEAR(db(measured_gain(EmaFilter::cutoff(FS, CURRENT_FC), FS, 0.05f)), 0, 0.05);
+    double last = 1;
+    for (float f : {0.5f, 1.0f, 2.0f, 3.0f, 4.5f}) {
+        double gain = measured_gain(EmaFilter::cutoff(FS, CURRENT_FC), FS, f);
+        CHECK(gain < last);
+        last = gain;
+    }
+
+    // fc well below fs: -3 dB at fc, -20 dB a decade on
+    CHECK_NEAR(db(measured_gain(EmaFilter::cutoff(1000, 10), 1000, 1)), 0, 0.05);
+    CHECK_NEAR(db(measured_gain(EmaFilter::cutoff(1000, 10), 1000, 10)), -3.01, 0.15);
+    CHECK_NEAR(db(measured_gain(EmaFilter::cutoff(1000, 10), 1000, 100)), -20, 0.5);
+}
+
+
+static void test_biquad_response() {
+    for (float f : {0.01f, 0.1f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f}) {
+        CHECK_NEAR(measured_gain(Biquad::lowpass(FS, RESISTANCE_FC), FS, f),
+                   butterworth_gain(FS, RESISTANCE_FC, f), 2e-3);
+    }
+    CHECK_NEAR(db(measured_gain(Biquad::lowpass(FS, RESISTANCE_FC), FS, 0.01f)), 0, 0.02);
+    CHECK_NEAR(db(measured_gain(Biquad::lowpass(FS, RESISTANCE_FC), FS, RESISTANCE_FC)), -3.01, 0.05);
+
+    // -40 dB a decade well below Nyquist, a little more from the warping
+    CHECK_NEAR(db(measured_gain(Biquad::lowpass(1000, 10), 1000, 10)), -3.01, 0.05);
+    CHECK_NEAR(db(measured_gain(Biquad::lowpass(1000, 10), 1000, 100)), -40, 1);
+}
+
+
+// Both low-passes start settled at the first value: no ramp up from zero
+static void test_primed() {
+    EmaFilter ema = EmaFilter::cutoff(FS, CURRENT_FC);
+    Biquad biquad = Biquad::lowpass(FS, RESISTANCE_FC);
+    bool ema_flat = true, biquad_flat = true;
+    for (int i = 0; i < 100; i++) {
+        ema_flat &= ema.step(1500.0f) == 1500.0f;
+        biquad_flat &= fabsf(biquad.step(1500.0f) - 1500.0f) < 1e-3f;
+    }
+    CHECK(ema_flat);
+    CHECK(biquad_flat);
+
+    // reset() primes again at the next value
+    ema.reset();
+    biquad.reset();
+    CHECK_EQ(ema.step(-40.0f), -40.0f);
+    CHECK_NEAR(biquad.step(-40.0f), -40.0f, 1e-3);
+
+    // And a step settles to the new level at unity DC gain
+    float y = 0;
+    for (int i = 0; i < 200; i++) y = biquad.step(250.0f);
+    CHECK_NEAR(y, 250.0f, 1e-2);
+}
+
+
+static void test_median() {
+    MedianFilter<5> median;
+
+    // Filling up: odd counts take the middle, even counts average the two
+    CHECK_EQ(median.step(10), 10);
+    CHECK_EQ(median.step(20), 15);
+    CHECK_EQ(median.step(0), 10);
+    CHECK_EQ(median.step(30), 15);
+
+    // Single and double spikes, either sign, never reach the output once
+    // the window is full
+    MedianFilter<5> spikes;
+    for (int i = 0; i < 5; i++) spikes.step(100.0f);
+    float worst = 0;
+    for (int i = 0; i < 1000; i++) {
+        float x = 100.0f;
+        if (i % 17 == 0) x = 3200.0f;
+        if (i % 23 == 0 || i % 23 == 1) x = -3200.0f;
+        worst = std::max(worst, fabsf(spikes.step(x) - 100.0f));
+    }
+    CHECK_EQ(worst, 0);
+
+    // A step passes after (N + 1) / 2 samples, without overshoot
+    MedianFilter<5> step;
+    for (int i = 0; i < 5; i++) step.step(0);
+    CHECK_EQ(step.step(50), 0);
+    CHECK_EQ(step.step(50), 0);
+    CHECK_EQ(step.step(50), 50);
+    CHECK_EQ(step.step(50), 50);
+
+    MedianFilter<3> three;
+    for (int i = 0; i < 3; i++) three.step(1);
+    CHECK_EQ(three.step(9), 1);
+    CHECK_EQ(three.step(9), 9);
+
+    // reset() forgets the window
+    step.reset();
+    CHECK_EQ(step.step(-7), -7);
+}
+
+
+static void test_range_gate() {
+    RangeGate gate(0, 32);
+    CHECK_EQ(gate.step(0), 0);
+    CHECK_EQ(gate.step(32), 32);
+    CHECK_EQ(gate.step(12.5f), 12.5f);
+    CHECK_EQ(gate.rejected(), 0);
+
+    CHECK(isnan(gate.step(-0.01f)));
+    CHECK(isnan(gate.step(32.01f)));
+    CHECK(isnan(gate.step(NAN)));
+    CHECK(isnan(gate.step(INFINITY)));
+    CHECK(isnan(gate.step(-INFINITY)));
+    CHECK_EQ(gate.rejected(), 5);
+
+    // reset() is per-stream state only; the count is a lifetime total
+    gate.reset();
+    CHECK_EQ(gate.rejected(), 5);
+}
+
+
+static void test_kalman() {
+    const float q = 1e-6f, r = 1e-4f;
+
+    // Gain and variance settle at the Riccati fixed point
+    ScalarKalman kalman(q, r);
+    kalman.step(12.0f);
+    CHECK_NEAR(kalman.variance(), r, 1e-12);
+    for (int i = 0; i < 1000; i++) kalman.step(12.0f);
+    double prior = (q + sqrt((double) q * q + 4.0 * q * r)) / 2;
+    CHECK_NEAR(kalman.variance(), prior - q, 1e-9);
+
+    // On a constant level with read noise r the estimate's error is what
+    // the filter thinks it is, far below the raw noise
+    ScalarKalman noisy(q, r);
+    double sum_sq = 0;
+    int n = 0;
+    for (int i = 0; i < 20000; i++) {
+        float x = noisy.step((float) (12.0 + gaussian(sqrt(r))));
+        if (i < 2000) continue;
+        sum_sq += (x - 12.0) * (x - 12.0);
+        n++;
+    }
+    double rms = sqrt(sum_sq / n);
+    CHECK(rms < 0.3 * sqrt(r));
+    CHECK_NEAR(rms, sqrt(noisy.variance()), 0.5 * sqrt(noisy.variance()));
+
+    // A supply step is followed within a few time constants (1 / gain)
+    double gain = prior / (prior + r);
+    float y = 0;
+    for (int i = 0; i < (int) (5 / gain); i++) y = noisy.step(11.0f);
+    CHECK_NEAR(y, 11.0f, 0.01);
+
+    // reset() takes the next read as is
+    noisy.reset();
+    CHECK_EQ(noisy.step(5.0f), 5.0f);
+}
+
+
+static void test_chain() {
+    typedef FilterChain<RangeGate, MedianFilter<3>, EmaFilter> Chain;
+    Chain chain(RangeGate(-3200, 3200), {}, EmaFilter(0.5f));
+    Chain twin(RangeGate(-3200, 3200), {}, EmaFilter(0.5f));
+
+    // Rejected reads come out NAN and leave the later stages as they were:
+    // the chain that saw them matches one that never did
+    const float reads[] = {100, 120, 110, NAN, 130, 5000, -9999, 90, INFINITY, 100, 105};
+    bool same = true;
+    int nans = 0;
+    for (float x : reads) {
+        float y = chain.step(x);
+        if (isnan(y)) {
+            nans++;
+            continue;
+        }
+        same &= y == twin.step(x);
+    }
+    CHECK(same);
+    CHECK_EQ(nans, 4);
+    CHECK_EQ(chain.first().rejected(), 4);
+    CHECK_EQ(twin.first().rejected(), 0);
+
+    // reset() reaches every stage
+    chain.reset();
+    CHECK_EQ(chain.step(-50), -50);
+
+    // The empty chain passes through
+    FilterChain<> empty;
+    CHECK_EQ(empty.step(3.5f), 3.5f);
+}
+
+
+// Device's resistance chain fed through guarded_ratio: cell-off samples
+// stop at the gate instead of dragging the biquad towards zero or infinity
+static void test_guarded_ratio() {
+    CHECK_NEAR(guarded_ratio(12000, 400, 20), 30, 1e-6);
+    CHECK_NEAR(guarded_ratio(12000, -400, 20), -30, 1e-6);
+    CHECK(isnan(guarded_ratio(12000, 19.9f, 20)));
+    CHECK(isnan(guarded_ratio(12000, -19.9f, 20)));
+    CHECK(isnan(guarded_ratio(12000, 0, 20)));
+    CHECK(isnan(guarded_ratio(NAN, 400, 20)));
+    CHECK(isnan(guarded_ratio(12000, NAN, 20)));
+    CHECK(isnan(guarded_ratio(INFINITY, 400, 20)));
+    CHECK_NEAR(guarded_ratio(12000, 20, 20), 600, 1e-6);
+
+    FilterChain<RangeGate, Biquad> resistance(RangeGate(0, 1e6), Biquad::lowpass(FS, RESISTANCE_FC));
+    float y = 0;
+    for (int i = 0; i < 200; i++) {
+        float i_mA = (i / 20) % 2 ? 0.5f : 400.0f;          // cell switching off and on
+        float r = resistance.step(guarded_ratio(12000, i_mA, 20));
+        if (!isnan(r)) y = r;
+        CHECK(isnan(r) || fabsf(r - 30) < 1e-3f);
+    }
+    CHECK_NEAR(y, 30, 1e-3);
+}
+
+
+static void bench() {
+    FilterChain<RangeGate, MedianFilter<5>, EmaFilter> current(
+        RangeGate(-3200, 3200), {}, EmaFilter::cutoff(FS, CURRENT_FC));
+    FilterChain<RangeGate, MedianFilter<3>, ScalarKalman> bus(RangeGate(0, 32), {}, ScalarKalman(1e-6f, 1e-4f));
+    FilterChain<RangeGate, Biquad> resistance(RangeGate(0, 1e6), Biquad::lowpass(FS, RESISTANCE_FC));
+
+    std::vector<float> x(1024);
+    for (float & v : x) v = (float) (400 + gaussian(20));
+    volatile float sink = 0;
+    size_t i = 0;
+    double c = bench_ns(1000000, [&]() { sink = current.step(x[i++ & 1023]); });
+    double b = bench_ns(1000000, [&]() { sink = bus.step(x[i++ & 1023] / 32); });
+    double r = bench_ns(1000000, [&]() { sink = resistance.step(x[i++ & 1023]); });
+    printf("filters: current %.1f ns, bus %.1f ns, resistance %.1f ns per sample\n", c, b, r);
+}
+
+
+int main(int argc, char ** argv) {
+    test_ema_response();
+    test_biquad_response();
+    test_primed();
+    test_median();
+    test_range_gate();
+    test_kalman();
+    test_chain();
+    test_guarded_ratio();
+    if (bench_requested(argc, argv)) bench();
+    return check_summary("filters");
+}
@@ -0,0 +1,436 @@
+/*
+ * INA219 driver (lib/sensors/ina219_sensor.cpp) against a register-level
+ * emulator of the chip. The test supplies I2cBus's register accessors,
+ * Storage and Timebase, and steps the driver through probe -> ready ->
+ * fetch the way the bus task does. The emulator does what the datasheet
+ * says: the calibration register's bit 0 is read-only, the shunt and bus
+ * registers are quantised and clipped to the PGA range, current and power
+ * come from the calibration register, reading power clears CNVR, and a
+ * brown-out resets everything.
+ */
+
+#include "check.h"
+#include "ina219_sensor.h"
+#include "i2c_bus.h"
+#include "storage.h"
+#include "timebase.h"
+#include <map>
+#include <vector>
+
+#define SHUNT 0.00551
+#define CAL_SAMPLES INA219_CAL_SAMPLES
+#define CHECK_EVERY 50
+
+// ---- the chip ----------------------------------------------------------------
+
+class Ina219Emulator {
+
+    public:
+
+        // What the chip is wired to
+        double current_A = 0;
+        double bus_V = 12.0;
+        double shunt_ohms = SHUNT;      // the real part, not what the driver is told
+        double shunt_offset_mV = 0;     // input offset / thermal EMF
+        bool present = true;
+
+        Ina219Emulator() { brown_out(); }
+
+        void brown_out() {
+            _regs.assign(6, 0);
+            _regs[INA219_REG_CONFIG] = 0x399F;
+        }
+
+        // One finished conversion with the current inputs
+        void convert() {
+            uint16_t config = _regs[INA219_REG_CONFIG];
+            int32_t range = 4000 << ((config >> 11) & 0x3);     // 40 mV << PGA, in 10 uV
+            int32_t shunt = lround((current_A * shunt_ohms * 1000 + shunt_offset_mV) * 100);
+            bool clipped = shunt > range || shunt < -range;
+            shunt = std::max(-range, std::min(range, shunt));
+            int32_t bus = lround(bus_V / 0.004);
+            bus = std::max(0, std::min(bus, (config & 0x2000) ? 8000 : 4000));
+
+            int64_t current = (int64_t) shunt * _regs[INA219_REG_CALIBRATION] / 4096;
+            int64_t power = llabs(current) * bus / 5000;
+            bool overflow = clipped || current > 32767 || current < -32768 || power > 0xFFFF;
+
+            _regs[INA219_REG_SHUNT] = (uint16_t) (int16_t) shunt;
+            _regs[INA219_REG_CURRENT] = (uint16_t) (int16_t) std::max<int64_t>(-32768, std::min<int64_t>(32767, current));
+            _regs[INA219_REG_POWER] = (uint16_t) std::min<int64_t>(power, 0xFFFF);
+            _regs[INA219_REG_BUS] = bus << 3 | 0x02 | (overflow ? 0x01 : 0);
+        }
+
+        bool read(uint8_t reg, uint16_t & value) {
+            reads++;
+            if (!present || reg > INA219_REG_CALIBRATION) return false;
+            value = _regs[reg];
+            if (reg == INA219_REG_POWER) _regs[INA219_REG_BUS] &= ~0x02;     // CNVR
+            return true;
+        }
+
+        bool write(uint8_t reg, uint16_t value) {
+            writes++;
+            if (!present) return false;
+            if (reg == INA219_REG_CONFIG) {
+                if (value & 0x8000) brown_out();
+                else _regs[reg] = value;
+                // A new configuration restarts the conversion
+                _regs[INA219_REG_BUS] &= ~0x02;
+            } else if (reg == INA219_REG_CALIBRATION) {
+                _regs[reg] = value & 0xFFFE;
+            } else {
+                return false;           // the result registers are read-only
+            }
+            return true;
+        }
+
+        uint16_t reg(uint8_t r) { return _regs[r]; }
+
+        int reads = 0;
+        int writes = 0;
+        int bursts = 0;
+
+    private:
+
+        std::vector<uint16_t> _regs;
+
+};
+
+static Ina219Emulator chip;
+
+
+// ---- what the driver links against -----------------------------------------
+
+I2cBus::I2cBus() {}
+
+bool I2cBus::read_reg16(uint8_t address, uint8_t reg, uint16_t & value) {
+    return address == INA219_ADDRESS && chip.read(reg, value);
+}
+
+bool I2cBus::write_reg16(uint8_t address, uint8_t reg, uint16_t value) {
+    return address == INA219_ADDRESS && chip.write(reg, value);
+}
+
+bool I2cBus::read_reg16_burst(uint8_t address, const uint8_t * regs, uint16_t * values, size_t count) {
+    chip.bursts++;
+    for (size_t i = 0; i < count; i++) {
+        if (!read_reg16(address, regs[i], values[i])) return false;
+    }
+    return true;
+}
+
+static std::map<std::string, std::vector<uint8_t>> nvs;
+
+Storage::Storage() {}
+Storage storage;
+
+bool Storage::load_blob(const char * ns, const char * key, void * data, size_t length) {
+    auto it = nvs.find(std::string(ns) + "/" + key);
+    if (it == nvs.end() || it->second.size() != length) return false;
+    memcpy(data, it->second.data(), length);
+    return true;
+}
+
+void Storage::store_blob(const char * ns, const char * key, const void * data, size_t length) {
+    nvs[std::string(ns) + "/" + key].assign((const uint8_t *) data, (const uint8_t *) data + length);
+}
+
+void Storage::clear_blob(const char * ns, const char * key) {
+    nvs.erase(std::string(ns) + "/" + key);
+}
+
+Timebase::Timebase() {}
+Timebase timebase;
+uint64_t Timebase::now_us() { return host_millis * 1000; }
+
+
+// ---- driving the driver ------------------------------------------------------
+
+// The bus task's view of the sensor
+class Driver : public Ina219Sensor {
+
+    public:
+
+        Driver() : Ina219Sensor(INA219_ADDRESS, INA219_INTERVAL) {}
+
+        using Ina219Sensor::probe;
+        using Ina219Sensor::ready;
+        using Ina219Sensor::fetch;
+
+};
+
+static I2cBus bus;
+
+// One conversion and the bus task's poll + fetch; false if it didn't produce a reading
+static bool sample(Driver & d, PowerReading & r) {
+    host_millis += d.interval_ms;
+    chip.convert();
+    if (d.ready(bus) != 1) return false;
+    if (!d.fetch(bus)) return false;
+    return d.latest(r);
+}
+
+static PowerReading sample_at(Driver & d, double amps, double volts = 12.0) {
+    chip.current_A = amps;
+    chip.bus_V = volts;
+    PowerReading r = {};
+    // A pending reconfiguration costs one poll
+    if (!sample(d, r)) CHECK(sample(d, r));
+    return r;
+}
+
+// One shunt LSB (10 uV) in current, plus one current LSB
+static double tolerance_mA(Driver & d) {
+    return 0.01 / d.shunt_ohms() + d.current_lsb_mA();
+}
+
+
+static void test_registers() {
+    Driver d;
+    // 10 A through 5.51 mOhm is 55.1 mV: the 80 mV range (PGA /2)
+    float shunt = SHUNT, max_A = 10;
+    uint16_t expected = (uint16_t) (0.04096 / ((max_A / 32768) * shunt)) & 0xFFFE;
+    CHECK_EQ(d.calibration_register(), expected);
+    CHECK_EQ(d.config_register(), 0x2000 | 1 << 11 | 0xC << 7 | 0xC << 3 | 0x7);   // 32 V, /2, 16 averages, continuous
+    CHECK_NEAR(d.current_lsb_mA(), 40.96 / (expected * SHUNT), 1e-6);
+    CHECK_NEAR(d.current_lsb_mA(), 10000.0 / 32768, 1e-3);
+    CHECK_EQ(d.averaging(), 16);
+    CHECK_EQ(d.interval_ms, INA219_INTERVAL);
+
+    CHECK(d.probe(bus));
+    CHECK_EQ(chip.reg(INA219_REG_CONFIG), d.config_register());
+    CHECK_EQ(chip.reg(INA219_REG_CALIBRATION), d.calibration_register());
+
+    // 128 averages take 136 ms for shunt + bus: the interval follows
+    d.configure(SHUNT, 10, 128);
+    chip.convert();
+    CHECK_EQ(d.ready(bus), 0);              // rewrites the config, restarting the conversion
+    CHECK_EQ(d.averaging(), 128);
+    CHECK_EQ((d.config_register() >> 3) & 0xF, 0xF);
+    CHECK_EQ((d.config_register() >> 7) & 0xF, 0xF);
+    CHECK_EQ(d.interval_ms, 139);
+    CHECK_EQ(chip.reg(INA219_REG_CONFIG), d.config_register());
+
+    // Not a power of two: the next lower one; 1 is the plain 12-bit mode
+    d.configure(SHUNT, 10, 100);
+    d.ready(bus);
+    CHECK_EQ(d.averaging(), 64);
+    d.configure(SHUNT, 10, 1);
+    d.ready(bus);
+    CHECK_EQ((d.config_register() >> 3) & 0xF, 0x3);
+    CHECK_EQ(d.interval_ms, INA219_INTERVAL);
+
+    // PGA per full-scale: 2 A -> 11 mV (40 mV); 30 A -> 165 mV (320 mV)
+    d.configure(SHUNT, 2, 16);
+    d.ready(bus);
+    CHECK_EQ((d.config_register() >> 11) & 0x3, 0);
+    d.configure(SHUNT, 30, 16);
+    d.ready(bus);
+    CHECK_EQ((d.config_register() >> 11) & 0x3, 3);
+
+    // A tiny shunt would need Cal past 16 bits: clamped, and the LSB follows
+    d.configure(0.0001, 1, 16);
+    d.ready(bus);
+    CHECK_EQ(d.calibration_register(), 0xFFFE);
+    CHECK_NEAR(d.current_lsb_mA(), 40.96 / (0xFFFE * 0.0001), 1e-3);
+}
+
+
+static void test_readings() {
+    chip = Ina219Emulator();
+    Driver d;
+    CHECK(d.probe(bus));
+    double tol = tolerance_mA(d);
+
+    // Ready only once a conversion has finished, and again only after the next
+    PowerReading r;
+    CHECK_EQ(d.ready(bus), 0);
+    CHECK(!d.latest(r));
+
+    const double currents[] = {0, 0.0123, 0.5, 2.75, 8.2, 9.99, -0.75, -4.1};
+    for (double amps : currents) {
+        r = sample_at(d, amps, 12.34);
+        CHECK_NEAR(r.current_mA, amps * 1000, tol);
+        CHECK_NEAR(r.shunt_mV, amps * SHUNT * 1000, 0.005);
+        CHECK_NEAR(r.bus_V, 12.34, 0.002);
+        CHECK_NEAR(r.power_mW, fabs(amps) * 1000 * 12.34, tol * 12.34 + 0.002 * fabs(amps) * 1000);
+        CHECK(!r.overflow);
+        CHECK_EQ(d.ready(bus), 0);          // reading power cleared CNVR
+    }
+
+    // The chip's own current register agrees with what the driver reports
+    r = sample_at(d, 3.3);
+    CHECK_NEAR((int16_t) chip.reg(INA219_REG_CURRENT) * d.current_lsb_mA(), r.current_mA, 1e-3);
+
+    // One CNVR poll and one burst per sample
+    int reads = chip.reads, bursts = chip.bursts;
+    uint32_t seq = r.seq;
+    r = sample_at(d, 1.0);
+    CHECK_EQ(chip.bursts - bursts, 1);
+    CHECK_EQ(chip.reads - reads, 4);
+    CHECK_EQ(r.seq, seq + 1);
+    CHECK_EQ(r.us, host_millis * 1000);
+
+    // Past the PGA range: clipped shunt, flagged
+    r = sample_at(d, 16.0);
+    CHECK(r.overflow);
+    r = sample_at(d, 1.0);
+    CHECK(!r.overflow);
+}
+
+
+static void test_bus_errors() {
+    chip = Ina219Emulator();
+    Driver d;
+    chip.present = false;
+    CHECK(!d.probe(bus));
+    chip.present = true;
+    CHECK(d.probe(bus));
+
+    chip.convert();
+    chip.present = false;
+    CHECK_EQ(d.ready(bus), -1);
+    chip.present = true;
+    CHECK_EQ(d.ready(bus), 1);
+    chip.present = false;
+    CHECK(!d.fetch(bus));
+    chip.present = true;
+
+    // A failed config write is retried on the next poll
+    d.configure(SHUNT, 10, 32);
+    chip.present = false;
+    CHECK_EQ(d.ready(bus), -1);
+    chip.present = true;
+    CHECK_EQ(d.ready(bus), 0);
+    CHECK_EQ(chip.reg(INA219_REG_CONFIG), d.config_register());
+}
+
+
+// Power glitch: the chip comes back with the reset config and Cal = 0, so
+// current and power read 0 until the driver's periodic check rewrites it
+static void test_brown_out() {
+    chip = Ina219Emulator();
+    Driver d;
+    CHECK(d.probe(bus));
+    PowerReading r = sample_at(d, 2.0);
+    CHECK_NEAR(r.current_mA, 2000, tolerance_mA(d));
+
+    chip.brown_out();
+    int zero = 0, restored_after = -1;
+    for (int i = 0; i < CHECK_EVERY + 1; i++) {
+        r = sample_at(d, 2.0);
+        if (fabs(r.current_mA) < 1) zero++;
+        else if (restored_after < 0) restored_after = i;
+    }
+    CHECK(zero > 0);
+    CHECK(restored_after > 0 && restored_after <= CHECK_EVERY);
+    CHECK_EQ(chip.reg(INA219_REG_CALIBRATION), d.calibration_register());
+    CHECK_EQ(chip.reg(INA219_REG_CONFIG), d.config_register());
+    CHECK_NEAR(r.current_mA, 2000, tolerance_mA(d));
+}
+
+
+static void capture(Driver & d, double amps, float reference_mA) {
+    CHECK(d.capture_point(reference_mA));
+    for (int i = 0; i < CAL_SAMPLES; i++) sample_at(d, amps);
+}
+
+
+// The real shunt is 4 % over nominal and there's a 60 uV input offset (~11 mA)
+static void test_field_calibration() {
+    chip = Ina219Emulator();
+    chip.shunt_ohms = SHUNT * 1.04;
+    chip.shunt_offset_mV = 0.06;
+    nvs.clear();
+
+    Driver d;
+    CHECK(d.probe(bus));
+    PowerReading r = sample_at(d, 5.0);
+    CHECK(fabs(r.current_mA - 5000) > 150);     // visibly off before calibration
+
+    uint16_t base = d.calibration_register();
+    capture(d, 0.5, 500);
+    CHECK_EQ(d.calibration_state(), Ina219Sensor::CAL_IDLE);
+    CHECK_EQ(d.calibration_points(), 1);
+    d.clear_calibration();
+    CHECK_EQ(d.calibration_points(), 0);
+
+    capture(d, 0.5, 500);
+    capture(d, 6.0, 6000);
+    CHECK_EQ(d.calibration_state(), Ina219Sensor::CAL_DONE);
+    CHECK_NEAR(d.gain(), 1 / 1.04, 1e-3);
+    CHECK_NEAR(d.offset_mA(), -0.06 / SHUNT / 1.04, 1.5);
+
+    // The gain goes into the chip's calibration register, the offset is added after
+    sample_at(d, 1.0);
+    CHECK_NEAR(d.calibration_register(), base / 1.04, base * 1e-3);
+    CHECK_EQ(chip.reg(INA219_REG_CALIBRATION), d.calibration_register());
+    double tol = tolerance_mA(d) + 1.0;
+    for (double amps : {0.1, 0.5, 2.0, 6.0, 9.0, -1.5}) {
+        r = sample_at(d, amps);
+        CHECK_NEAR(r.current_mA, amps * 1000, tol + 0.0005 * fabs(amps) * 1000);
+    }
+
+    // Persisted from the main task, and picked up by a fresh driver
+    CHECK(nvs.empty());
+    CHECK(d.persist());
+    CHECK(!d.persist());
+    CHECK_EQ(nvs.size(), 1);
+
+    Driver fresh;
+    fresh.load_calibration();
+    CHECK(fresh.probe(bus));
+    CHECK_EQ(fresh.calibration_register(), d.calibration_register());
+    r = sample_at(fresh, 4.0);
+    CHECK_NEAR(r.current_mA, 4000, tol + 2);
+
+    // Clearing forgets it, here and in NVS
+    fresh.clear_calibration();
+    CHECK(nvs.empty());
+    CHECK_EQ(fresh.gain(), 1.0);
+    sample_at(fresh, 1.0);
+    CHECK_EQ(fresh.calibration_register(), base);
+}
+
+
+static void test_calibration_rejected() {
+    chip = Ina219Emulator();
+    nvs.clear();
+    Driver d;
+    CHECK(d.probe(bus));
+
+    // Points too close together
+    capture(d, 1.0, 1000);
+    capture(d, 1.02, 1020);
+    CHECK_EQ(d.calibration_state(), Ina219Sensor::CAL_FAILED);
+    CHECK_EQ(d.gain(), 1.0);
+
+    // A reference that implies a gain beyond 2x
+    capture(d, 1.0, 1000);
+    capture(d, 2.0, 4000);
+    CHECK_EQ(d.calibration_state(), Ina219Sensor::CAL_FAILED);
+    CHECK_EQ(d.gain(), 1.0);
+    CHECK(!d.persist());
+
+    // A stored record that's out of range isn't applied
+    Ina219Calibration bad = {INA219_CAL_MAGIC, 3.0, 0};
+    storage.store_blob("ina219", "cal", &bad, sizeof(bad));
+    d.load_calibration();
+    CHECK_EQ(d.gain(), 1.0);
+    bad = {0x12345678, 1.1, 0};
+    storage.store_blob("ina219", "cal", &bad, sizeof(bad));
+    d.load_calibration();
+    CHECK_EQ(d.gain(), 1.0);
+}
+
+
+int main() {
+    test_registers();
+    test_readings();
+    test_bus_errors();
+    test_brown_out();
+    test_field_calibration();
+    test_calibration_rejected();
+    return check_summary("ina219");
+}
@@ -0,0 +1,331 @@
+/*
+ * /metrics rendering (lib/metrics/metrics.cpp) against the OpenMetrics text
+ * format: a small checker parses the whole page - family metadata, sample
+ * names and suffixes per type, label syntax and escaping, values, histogram
+ * buckets, the closing # EOF - and the exact lines are checked for the
+ * cases that have gone wrong before (non-finite values, label quoting).
+ * The firmware's own metric names are read from metrics_registry.cpp and
+ * held to the naming rules: unique, unit spelled out, no _total.
+ */
+
+#include "check.h"
+#include "metrics.h"
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+struct StringPrint : Print {
+    std::string text;
+    size_t write(uint8_t c) override { text += (char) c; return 1; }
+};
+
+
+// ---- the metrics under test --------------------------------------------------
+
+static float gauge_value = 12.5f;
+static uint64_t counter_value = 42;
+
+static Gauge plain("test_current_milliamperes", "A plain gauge", []() { return gauge_value; });
+static Gauge not_a_number("test_resistance_ohms", "NaN with the cell off", []() { return (float) NAN; });
+static Gauge positive_inf("test_ratio_up", "Divides by zero upwards", []() { return (float) INFINITY; });
+static Gauge negative_inf("test_ratio_down", "Divides by zero downwards", []() { return (float) -INFINITY; });
+static Counter counter("test_reversals", "A counter", []() { return counter_value; });
+static LabeledCounter labeled("test_events", "One label, one skipped index", "event",
+    [](int index, const char *& label, uint64_t & value) {
+        static const char * names[] = {"connected", nullptr, "back\\slash \"quoted\"\nnewline"};
+        if (index >= 3) return false;
+        label = names[index];
+        value = 10 + index;
+        return true;
+    });
+static LabeledGauge labeled_gauge("test_stack_headroom_bytes", "Gauge family", "task",
+    [](int index, const char *& label, float & value) {
+        static const char * names[] = {"loopTask", "IDLE0"};
+        static const float values[] = {1234.0f, NAN};
+        if (index >= 2) return false;
+        label = names[index];
+        value = values[index];
+        return true;
+    });
+static const uint32_t bounds[] = {100, 1000, 10000};
+static uint32_t buckets[4];
+static Histogram histogram("test_latency_seconds", "Histogram", bounds, 3, buckets);
+
+
+// ---- OpenMetrics text checker ------------------------------------------------
+
+struct Family {
+    std::string type;
+    bool help = false;
+    int samples = 0;
+    // histogram
+    std::vector<double> le;
+    std::vector<double> cumulative;
+    double count = -1;
+    bool sum = false;
+};
+
+static bool is_name(const std::string & s) {
+    if (s.empty() || !(isalpha((unsigned char) s[0]) || s[0] == '_' || s[0] == ':')) return false;
+    for (char c : s) {
+        if (!(isalnum((unsigned char) c) || c == '_' || c == ':')) return false;
+    }
+    return true;
+}
+
+static bool parse_value(const std::string & s, double & v) {
+    if (s == "NaN") { v = NAN; return true; }
+    if (s == "+Inf") { v = INFINITY; return true; }
+    if (s == "-Inf") { v = -INFINITY; return true; }
+    if (s.empty()) return false;
+    char * end;
+    v = strtod(s.c_str(), &end);
+    // strtod also takes "inf" and "nan", which OpenMetrics doesn't
+    return *end == '\0' && isfinite(v);
+}
+
+// Parses {a="x",b="y"}; values are unescaped into labels
+static bool parse_labels(const std::string & line, size_t & at, std::map<std::string, std::string> & labels) {
+    at++;
+    while (at < line.size() && line[at] != '}') {
+        size_t eq = line.find('=', at);
+        if (eq == std::string::npos) return false;
+        std::string name = line.substr(at, eq - at);
+        if (!is_name(name) || labels.count(name) || eq + 1 >= line.size() || line[eq + 1] != '"') return false;
+        std::string value;
+        size_t i = eq + 2;
+        for (; i < line.size() && line[i] != '"'; i++) {
+            if (line[i] == '\\') {
+                if (++i >= line.size()) return false;
+                if (line[i] == 'n') value += '\n';
+                else if (line[i] == '\\' || line[i] == '"') value += line[i];
+                else return false;
+            } else {
+                value += line[i];
+            }
+        }
+        if (i >= line.size()) return false;
+        labels[name] = value;
+        at = i + 1;
+        if (at < line.size() && line[at] == ',') at++;
+    }
+    if (at >= line.size()) return false;
+    at++;
+    return true;
+}
+
+// Empty when the page is valid, else the first offending line and why
+static std::string validate(const std::string & page, std::map<std::string, Family> & families) {
+    if (page.empty() || page.back() != '\n') return "page doesn't end in a newline";
+
+    std::vector<std::string> lines;
+    for (size_t at = 0, nl; at < page.size(); at = nl + 1) {
+        nl = page.find('\n', at);
+        lines.push_back(page.substr(at, nl - at));
+    }
+    if (lines.back() != "# EOF") return "last line isn't # EOF";
+
+    std::string current;
+    std::set<std::string> finished;
+    for (size_t n = 0; n + 1 < lines.size(); n++) {
+        const std::string & line = lines[n];
+        if (line.empty()) return "empty line";
+
+        if (line[0] == '#') {
+            char kind[8], name[128];
+            int used = 0;
+            if (sscanf(line.c_str(), "# %7s %127s %n", kind, name, &used) < 2) return line + ": bad comment";
+            std::string rest = line.substr(used);
+            if (!is_name(name)) return line + ": bad family name";
+            if (name != current) {
+                if (finished.count(name)) return line + ": family split";
+                if (!current.empty()) finished.insert(current);
+                current = name;
+            }
+            Family & f = families[name];
+            if (f.samples) return line + ": metadata after samples";
+            if (strcmp(kind, "TYPE") == 0) {
+                static const std::set<std::string> types = {"counter", "gauge", "histogram", "gaugehistogram",
+                                                             "stateset", "info", "summary", "unknown"};
+                if (!f.type.empty() || !types.count(rest)) return line + ": bad or repeated TYPE";
+                f.type = rest;
+            } else if (strcmp(kind, "HELP") == 0) {
+                if (f.help) return line + ": repeated HELP";
+                f.help = true;
+            } else if (strcmp(kind, "EOF") != 0) {
+                return line + ": unknown comment";
+            }
+            continue;
+        }
+
+        size_t at = 0;
+        while (at < line.size() && line[at] != '{' && line[at] != ' ') at++;
+        std::string name = line.substr(0, at);
+        std::map<std::string, std::string> labels;
+        if (at < line.size() && line[at] == '{' && !parse_labels(line, at, labels)) return line + ": bad labels";
+        if (at >= line.size() || line[at] != ' ') return line + ": no value";
+        double value;
+        if (!parse_value(line.substr(at + 1), value)) return line + ": bad value";
+
+        // The sample belongs to the family being described, under an allowed suffix
+        if (current.empty() || name.compare(0, current.size(), current) != 0) return line + ": outside its family";
+        Family & f = families[current];
+        std::string suffix = name.substr(current.size());
+        f.samples++;
+        if (f.type == "gauge") {
+            if (!suffix.empty()) return line + ": gauge with a suffix";
+        } else if (f.type == "counter") {
+            if (suffix != "_total" || !(value >= 0) || value != floor(value)) return line + ": bad counter sample";
+        } else if (f.type == "histogram") {
+            if (suffix == "_bucket") {
+                double le;
+                if (!labels.count("le") || !parse_value(labels["le"], le) || isnan(le)) return line + ": bucket without le";
+                if (!f.le.empty() && le <= f.le.back()) return line + ": buckets not ascending";
+                if (!f.cumulative.empty() && value < f.cumulative.back()) return line + ": buckets not cumulative";
+                f.le.push_back(le);
+                f.cumulative.push_back(value);
+            } else if (suffix == "_count") {
+                f.count = value;
+            } else if (suffix == "_sum") {
+                f.sum = true;
+            } else {
+                return line + ": bad histogram suffix";
+            }
+        } else {
+            return line + ": sample for an untyped family";
+        }
+    }
+
+    for (auto & entry : families) {
+        const Family & f = entry.second;
+        if (f.type.empty() || !f.help) return entry.first + ": missing TYPE or HELP";
+        if (f.type == "histogram") {
+            if (f.le.empty() || !isinf(f.le.back())) return entry.first + ": no +Inf bucket";
+            if (f.count != f.cumulative.back()) return entry.first + ": _count isn't the +Inf bucket";
+            if (!f.sum) return entry.first + ": no _sum";
+        }
+    }
+    return "";
+}
+
+static bool has_line(const std::string & page, const std::string & line) {
+    return page.find("\n" + line + "\n") != std::string::npos || page.compare(0, line.size() + 1, line + "\n") == 0;
+}
+
+
+// ---- tests ------------------------------------------------------------------
+
+static void test_checker() {
+    // The checker itself rejects what it should
+    std::map<std::string, Family> f;
+    CHECK(validate("# TYPE a gauge\n# HELP a x\na 1\n# EOF\n", f).empty());
+    f.clear();
+    CHECK(!validate("# TYPE a gauge\n# HELP a x\na inf\n# EOF\n", f).empty());
+    f.clear();
+    CHECK(!validate("# TYPE a gauge\n# HELP a x\na{l=\"x\"y\"} 1\n# EOF\n", f).empty());
+    f.clear();
+    CHECK(!validate("# TYPE a counter\n# HELP a x\na 1\n# EOF\n", f).empty());
+    f.clear();
+    CHECK(!validate("# TYPE a gauge\n# HELP a x\na 1\n", f).empty());
+}
+
+
+static void test_page() {
+    histogram.observe(50);
+    histogram.observe(100);            // on a bound: le is inclusive
+    histogram.observe(5000);
+    histogram.observe(20000000);       // above every bound
+
+    StringPrint out;
+    Metric::render_all(out);
+    const std::string & page = out.text;
+
+    std::map<std::string, Family> families;
+    std::string error = validate(page, families);
+    if (!CHECK(error.empty())) fprintf(stderr, "    %s\n\n%s", error.c_str(), page.c_str());
+    CHECK_EQ(families.size(), 8);
+
+    // Declaration order, TYPE before HELP, counters typed without _total
+    CHECK(page.rfind("# TYPE test_current_milliamperes gauge\n"
+                     "# HELP test_current_milliamperes A plain gauge\n", 0) == 0);
+    CHECK(has_line(page, "# TYPE test_reversals counter"));
+    CHECK(page.find("test_current_milliamperes") < page.find("test_latency_seconds"));
+
+    CHECK(has_line(page, "test_current_milliamperes 12.5"));
+    CHECK(has_line(page, "test_resistance_ohms NaN"));
+    CHECK(has_line(page, "test_ratio_up +Inf"));
+    CHECK(has_line(page, "test_ratio_down -Inf"));
+    CHECK(has_line(page, "test_reversals_total 42"));
+
+    CHECK(has_line(page, "test_events_total{event=\"connected\"} 10"));
+    CHECK(page.find("test_events_total{event=\"connected\"} 11") == std::string::npos);
+    CHECK(has_line(page, "test_events_total{event=\"back\\\\slash \\\"quoted\\\"\\nnewline\"} 12"));
+    CHECK(has_line(page, "test_stack_headroom_bytes{task=\"loopTask\"} 1234"));
+    CHECK(has_line(page, "test_stack_headroom_bytes{task=\"IDLE0\"} NaN"));
+
+    CHECK(has_line(page, "test_latency_seconds_bucket{le=\"0.0001\"} 2"));
+    CHECK(has_line(page, "test_latency_seconds_bucket{le=\"0.001\"} 2"));
+    CHECK(has_line(page, "test_latency_seconds_bucket{le=\"0.01\"} 3"));
+    CHECK(has_line(page, "test_latency_seconds_bucket{le=\"+Inf\"} 4"));
+    CHECK(has_line(page, "test_latency_seconds_count 4"));
+    CHECK(has_line(page, "test_latency_seconds_sum 20.005150"));
+}
+
+
+// Readers change between renders; every page stands on its own
+static void test_rerender() {
+    gauge_value = -0.25f;
+    counter_value = 18446744073709551615ULL;
+    StringPrint out;
+    Metric::render_all(out);
+    std::map<std::string, Family> families;
+    std::string error = validate(out.text, families);
+    if (!CHECK(error.empty())) fprintf(stderr, "    %s\n", error.c_str());
+    CHECK(has_line(out.text, "test_current_milliamperes -0.25"));
+    CHECK(has_line(out.text, "test_reversals_total 18446744073709551615"));
+}
+
+
+// Every metric name in the registry. Units are words, as in _seconds and
+// _milliamperes; the registry's scaled units (_millivolts, _microseconds)
+// are spelled out too, never abbreviated
+static void test_registry_names() {
+    std::ifstream file(METRICS_REGISTRY);
+    if (!CHECK(file.good())) return;
+    std::stringstream text;
+    text << file.rdbuf();
+    const std::string source = text.str();
+
+    static const char *const abbreviated[] = {"_ms", "_us", "_ns", "_sec", "_secs", "_milliamps", "_amps", "_ma",
+                                              "_mv", "_mw", "_mah", "_kb", "_mb", "_hz", "_khz", "_mhz", "_pct"};
+    std::set<std::string> names;
+    for (size_t at = 0; (at = source.find("\"filterchlorine_", at)) != std::string::npos; ) {
+        size_t end = source.find('"', at + 1);
+        std::string name = source.substr(at + 1, end - at - 1);
+        at = end + 1;
+
+        bool ok = CHECK(is_name(name));
+        ok &= CHECK(names.insert(name).second);
+        ok &= CHECK(name.size() < 6 || name.compare(name.size() - 6, 6, "_total") != 0);
+        for (const char * unit : abbreviated) {
+            size_t n = strlen(unit);
+            ok &= CHECK(name.size() <= n || name.compare(name.size() - n, n, unit) != 0);
+        }
+        if (!ok) fprintf(stderr, "    %s\n", name.c_str());
+    }
+    CHECK(names.size() > 50);
+    CHECK(names.count("filterchlorine_wifi_outage_max_seconds"));
+    CHECK(names.count("filterchlorine_wifi_outage_p95_seconds"));
+    CHECK(names.count("filterchlorine_power_estimated_milliamperes"));
+}
+
+
+int main() {
+    test_checker();
+    test_page();
+    test_rerender();
+    test_registry_names();
+    return check_summary("openmetrics");
+}
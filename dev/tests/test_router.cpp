@@ -0,0 +1,213 @@
+/*
+ * Captive portal request router (lib/provisioner), through its own
+ * begin()/loop()/end() against host stand-ins for WebServer, DNSServer and
+ * WiFi: every route, the ETag revalidation, the OS probes, credential
+ * validation, the cached background scan, and one request per loop() pass.
+ */
+
+#include "check.h"
+#include "provisioner.h"
+#include "html.h"
+
+static WebServer * server;
+
+static HostResponse get(const char * uri, std::map<std::string, std::string> args = {},
+                        std::map<std::string, std::string> headers = {}) {
+    HostRequest request;
+    request.uri = uri;
+    request.args = args;
+    request.headers = headers;
+    size_t before = server->responses.size();
+    server->queue(request);
+    provisioner.loop();
+    if (!CHECK_EQ(server->responses.size(), before + 1)) return HostResponse();
+    return server->responses.back();
+}
+
+static bool body_is(const HostResponse & r, const uint8_t * page, size_t len) {
+    return r.body.size() == len && memcmp(r.body.data(), page, len) == 0;
+}
+
+
+static void test_begin() {
+    provisioner.begin();
+    CHECK(provisioner.is_active());
+    CHECK(!provisioner.is_complete());
+    CHECK(WiFi.current_mode == WIFI_AP_STA);      // the station link stays up
+    CHECK(WiFi.ap_up);
+    CHECK(server->listening);
+    CHECK(host_dns->running);
+    CHECK_EQ(host_dns->port, 53);
+    CHECK(host_dns->domain == "*");
+    CHECK(host_dns->reply_code == DNSReplyCode::NoError);
+}
+
+
+static void test_pages() {
+    HostResponse r = get("/");
+    CHECK_EQ(r.code, 200);
+    CHECK(r.type == "text/html");
+    CHECK(r.headers["Content-Encoding"] == "gzip");
+    CHECK(r.headers["Cache-Control"] == "no-cache");
+    CHECK(r.headers["ETag"] == CONFIG_PAGE_ETAG);
+    CHECK(body_is(r, CONFIG_PAGE, CONFIG_PAGE_LEN));
+    CHECK(r.body.size() > 2 && (uint8_t) r.body[0] == 0x1f && (uint8_t) r.body[1] == 0x8b);
+
+    // A reload with the ETag is answered without the body
+    r = get("/", {}, {{"If-None-Match", CONFIG_PAGE_ETAG}});
+    CHECK_EQ(r.code, 304);
+    CHECK(r.body.empty());
+
+    r = get("/", {}, {{"If-None-Match", "\"stale\""}});
+    CHECK_EQ(r.code, 200);
+    CHECK(body_is(r, CONFIG_PAGE, CONFIG_PAGE_LEN));
+
+    // Every page has its own tag
+    CHECK(strcmp(CONFIG_PAGE_ETAG, SAVED_PAGE_ETAG) != 0);
+    CHECK(strcmp(CONFIG_PAGE_ETAG, INSTRUCTIONS_PAGE_ETAG) != 0);
+}
+
+
+static void test_probes() {
+    const char * probes[] = {"/generate_204", "/gen_204", "/hotspot-detect.html", "/connecttest.txt", "/ncsi.txt"};
+    for (const char * probe : probes) {
+        HostResponse r = get(probe);
+        CHECK_EQ(r.code, 302);
+        CHECK(r.headers["Location"] == "http://192.168.4.1/");
+        CHECK(r.headers["Cache-Control"] == "no-store");
+    }
+}
+
+
+static void test_other_routes() {
+    CHECK_EQ(get("/favicon.ico").code, 200);
+    CHECK_EQ(get("/nothing/here").code, 204);
+    CHECK_EQ(get("/generate_204/extra").code, 204);    // exact match only
+}
+
+
+static void test_save() {
+    HostResponse r = get("/save", {{"ssid", "abc"}, {"pass", "longenough"}});
+    CHECK_EQ(r.code, 200);
+    CHECK(body_is(r, INSTRUCTIONS_PAGE, INSTRUCTIONS_PAGE_LEN));
+    CHECK(!provisioner.is_complete());
+
+    r = get("/save", {{"ssid", "plant-ap"}, {"pass", "x"}});
+    CHECK(body_is(r, INSTRUCTIONS_PAGE, INSTRUCTIONS_PAGE_LEN));
+    CHECK(!provisioner.is_complete());
+
+    r = get("/save");
+    CHECK(body_is(r, INSTRUCTIONS_PAGE, INSTRUCTIONS_PAGE_LEN));
+    CHECK(!provisioner.is_complete());
+
+    // Longer than an SSID can be: cut to 32 characters
+    std::string ssid(40, 's');
+    r = get("/save", {{"ssid", ssid}, {"pass", "secret-pass"}});
+    CHECK_EQ(r.code, 200);
+    CHECK(r.headers["ETag"] == SAVED_PAGE_ETAG);
+    CHECK(body_is(r, SAVED_PAGE, SAVED_PAGE_LEN));
+    CHECK(provisioner.is_complete());
+
+    char got_ssid[33], got_pass[65];
+    provisioner.get_creds(got_ssid, got_pass);
+    CHECK_EQ(strlen(got_ssid), 32);
+    CHECK_STR(got_pass, "secret-pass");
+}
+
+
+static void test_scan() {
+    // Nothing cached yet; serving /scan never starts a scan itself
+    int started = WiFi.scans_started;
+    HostResponse r = get("/scan");
+    CHECK_EQ(r.code, 200);
+    CHECK(r.type == "application/json");
+    CHECK(r.headers["Cache-Control"] == "no-store");
+    CHECK(r.body == "[]");
+    CHECK_EQ(WiFi.scans_started, started);
+
+    WiFi.networks = {{"plant", -50}, {"", -40}, {"plant", -70}, {"quote\"back\\slash", -80}, {"office", -65}};
+    WiFi.scan_done = true;
+    provisioner.loop();         // collects the finished scan
+    r = get("/scan");
+    CHECK(r.body == "[{\"ssid\":\"plant\",\"rssi\":-50},{\"ssid\":\"quote\\\"back\\\\slash\",\"rssi\":-80},"
+                    "{\"ssid\":\"office\",\"rssi\":-65}]");
+
+    // Only SCAN_CACHE_SIZE networks are kept
+    static char names[SCAN_CACHE_SIZE + 4][16];
+    WiFi.networks.clear();
+    for (int i = 0; i < SCAN_CACHE_SIZE + 4; i++) {
+        snprintf(names[i], sizeof(names[i]), "net%d", i);
+        WiFi.networks.push_back({names[i], -60});
+    }
+    host_millis += SCAN_REFRESH_INTERVAL + 1;
+    provisioner.loop();         // starts the refresh
+    CHECK_EQ(WiFi.scans_started, started + 1);
+    WiFi.scan_done = true;
+    provisioner.loop();
+    r = get("/scan");
+    int entries = 0;
+    for (size_t at = 0; (at = r.body.find("\"ssid\"", at)) != std::string::npos; at++) entries++;
+    CHECK_EQ(entries, SCAN_CACHE_SIZE);
+
+    // No new scan until the refresh interval has passed again
+    provisioner.loop();
+    CHECK_EQ(WiFi.scans_started, started + 1);
+}
+
+
+// One request per pass, and DNS serviced every pass, so neither waits
+static void test_one_per_pass() {
+    HostRequest request;
+    request.uri = "/favicon.ico";
+    server->queue(request);
+    server->queue(request);
+    size_t before = server->responses.size();
+    int dns = host_dns->passes;
+    provisioner.loop();
+    CHECK_EQ(server->responses.size(), before + 1);
+    provisioner.loop();
+    CHECK_EQ(server->responses.size(), before + 2);
+    CHECK_EQ(host_dns->passes, dns + 2);
+}
+
+
+static void test_end() {
+    provisioner.end();
+    CHECK(!provisioner.is_active());
+    CHECK(!server->listening);
+    CHECK(!host_dns->running);
+    CHECK(!WiFi.ap_up);
+    CHECK(WiFi.current_mode == WIFI_STA);
+
+    // Nothing is served once it has ended
+    HostRequest request;
+    request.uri = "/";
+    server->queue(request);
+    size_t before = server->responses.size();
+    provisioner.loop();
+    CHECK_EQ(server->responses.size(), before);
+
+    // A second run reuses the routes and serves again
+    provisioner.begin();
+    provisioner.loop();
+    CHECK_EQ(server->responses.size(), before + 1);
+    CHECK_EQ(server->responses.back().code, 200);
+    provisioner.end();
+}
+
+
+int main() {
+    host_millis = 1000;         // as after boot; the scan timer treats 0 as never
+    server = WebServer::on_port(80);
+    if (!CHECK(server != nullptr) || !CHECK(host_dns != nullptr)) return check_summary("router");
+
+    test_begin();
+    test_pages();
+    test_probes();
+    test_other_routes();
+    test_save();
+    test_scan();
+    test_one_per_pass();
+    test_end();
+    return check_summary("router");
+}
@@ -0,0 +1,492 @@
+/*
+ * History store (lib/series) on a simulated flash part. The RAM image
+ * behaves like NOR: erase sets a sector to 0xFF and a write can only clear
+ * bits; a write that would set one, or that crosses a sector boundary, is
+ * counted as a violation and fails. The store is fed INA219 samples through
+ * the device ring and run a second at a time against a settable clock.
+ */
+
+#include "check.h"
+#include "series.h"
+#include "timebase.h"
+#include "device.h"
+#include <vector>
+
+#define EPOCH 1760000000u               // clock at the first simulated second, on an hour
+#define PARTITION (32 * SERIES_SECTOR)  // the 128 KB min_spiffs data partition
+#define PARTITION_MIN (8 * SERIES_SECTOR)  // two sectors raw, four minute, two hour: wraps sooner
+
+// ---- flash -------------------------------------------------------------------
+
+class RamFlash : public SeriesFlash {
+
+    public:
+
+        explicit RamFlash(size_t bytes) : image(bytes, 0xFF), erases(bytes / SERIES_SECTOR, 0) {}
+
+        size_t size() override { return image.size(); }
+
+        bool read(size_t offset, void * data, size_t len) override {
+            if (offset + len > image.size()) return false;
+            memcpy(data, &image[offset], len);
+            return true;
+        }
+
+        bool write(size_t offset, const void * data, size_t len) override {
+            if (!len) return true;
+            if (offset + len > image.size() || offset / SERIES_SECTOR != (offset + len - 1) / SERIES_SECTOR) {
+                violations++;
+                return false;
+            }
+            const uint8_t * bytes = (const uint8_t *) data;
+            for (size_t i = 0; i < len; i++) {
+                if (bytes[i] & ~image[offset + i]) {
+                    violations++;
+                    return false;
+                }
+            }
+            for (size_t i = 0; i < len; i++) image[offset + i] &= bytes[i];
+            return true;
+        }
+
+        bool erase(size_t offset) override {
+            if (offset % SERIES_SECTOR || offset >= image.size()) {
+                violations++;
+                return false;
+            }
+            memset(&image[offset], 0xFF, SERIES_SECTOR);
+            erases[offset / SERIES_SECTOR]++;
+            return true;
+        }
+
+        std::vector<uint8_t> image;
+        std::vector<int> erases;
+        int violations = 0;
+
+};
+
+
+// ---- what the store links against -------------------------------------------
+
+Device device;
+
+Timebase::Timebase() {}
+Timebase timebase;
+void Timebase::begin(const char *) { _sync_count = 1; }
+uint64_t Timebase::now_us() { return (uint64_t) host_millis * 1000; }
+uint64_t Timebase::to_epoch_ms(uint64_t monotonic_us) { return (uint64_t) EPOCH * 1000 + monotonic_us / 1000; }
+
+static uint32_t now_s() { return timebase.epoch_ms() / 1000; }
+
+
+// ---- driving it ------------------------------------------------------------------
+
+typedef float (*Signal)(uint32_t t, int sample, int field);
+
+static float steady(uint32_t t, int sample, int field) {
+    return field == 0 ? 1000 + 40 * sinf(t / 30.0f) + (sample & 1) : 12.0f + 0.01f * (t % 7);
+}
+
+static uint32_t lcg = 1;
+static float noisy(uint32_t, int, int field) {
+    lcg = lcg * 1664525 + 1013904223;
+    float r = (lcg >> 8) / 16777216.0f;
+    return field == 0 ? -8000 + 16000 * r : 11 + 2 * r;
+}
+
+// Per second: ten INA219 samples, then the store's loop(); returns the raw
+// points that second should produce (the per-second means)
+struct Expected {
+    uint32_t t;
+    float v[SERIES_FIELDS];
+};
+
+static std::vector<Expected> run(SeriesStore & store, uint32_t seconds, Signal signal) {
+    std::vector<Expected> points;
+    for (uint32_t i = 0; i < seconds; i++) {
+        host_millis += 1000;
+        uint32_t t = now_s();
+        Expected e = {t, {0, 0}};
+        for (int s = 0; s < 10; s++) {
+            PowerSample sample = {timebase.now_us(), signal(t, s, 0), signal(t, s, 1), 0};
+            device.samples.push_back(sample);
+            e.v[0] += sample.current_mA / 10;
+            e.v[1] += sample.busvoltage / 10;
+        }
+        store.loop();
+        points.push_back(e);
+    }
+    return points;
+}
+
+static std::vector<SeriesPoint> query(SeriesStore & store, SeriesTier tier, uint32_t from = 0, uint32_t to = UINT32_MAX) {
+    std::vector<SeriesPoint> out;
+    SeriesCursor cursor(store, tier, from, to);
+    SeriesPoint p;
+    while (cursor.next(p)) out.push_back(p);
+    return out;
+}
+
+// The raw points from the first one stored on match what was fed in, to the quantum
+static bool raw_matches(const std::vector<SeriesPoint> & got, const std::vector<Expected> & want) {
+    if (got.empty()) return CHECK(!got.empty());
+    size_t at = 0;
+    while (at < want.size() && want[at].t < got[0].t) at++;
+    if (!CHECK_EQ(got.size(), want.size() - at)) return false;
+    for (size_t i = 0; i < got.size(); i++) {
+        const Expected & e = want[at + i];
+        if (!CHECK_EQ(got[i].t, e.t) || !CHECK_NEAR(got[i].v[0], e.v[0], 1.0 / 32 + 1e-3 * fabs(e.v[0])) ||
+            !CHECK_NEAR(got[i].v[1], e.v[1], 1.0 / 2048 + 1e-5)) {
+            fprintf(stderr, "    raw point %zu of %zu\n", i, got.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rollup periods fed, less the one still open
+static size_t closed(const std::vector<Expected> & fed, uint32_t period) {
+    return fed.back().t / period - fed.front().t / period;
+}
+
+static void start(SeriesStore & store, RamFlash & flash) {
+    device.samples.clear();
+    CHECK(store.begin(&flash));
+}
+
+
+static void test_round_trip() {
+    RamFlash flash(PARTITION);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+
+    // Nothing is recorded before the clock is set
+    run(*store, 5, steady);
+    SeriesTierStats stats;
+    CHECK(store->tier_stats(SERIES_RAW, stats));
+    CHECK_EQ(stats.newest, 0);
+    delete store;
+
+    timebase.begin(nullptr);
+    store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> history = run(*store, 900, steady);
+    CHECK(raw_matches(query(*store, SERIES_RAW), history));
+    CHECK(store->tier_stats(SERIES_RAW, stats));
+    CHECK_EQ(stats.oldest, history.front().t);
+    CHECK_EQ(stats.newest, history.back().t);
+
+    // A sub-range, and the open frame still in RAM is part of every query
+    std::vector<SeriesPoint> part = query(*store, SERIES_RAW, history[100].t, history[199].t);
+    CHECK_EQ(part.size(), 100);
+    CHECK(!part.empty() && part.front().t == history[100].t && part.back().t == history[199].t);
+    CHECK_EQ(query(*store, SERIES_RAW, history.back().t).size(), 1);
+
+    // Raw frames go out at least once a minute
+    CHECK(store->flash_writes() >= 900 / SERIES_FLUSH_RAW * 2);
+    CHECK_EQ(flash.violations, 0);
+    delete store;
+}
+
+
+// Closed minutes are the min / mean / max of their raw points
+static void test_rollups() {
+    RamFlash flash(PARTITION);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> fed = run(*store, 3 * 3600 + 120, steady);
+    std::vector<SeriesPoint> raw = query(*store, SERIES_RAW);
+    std::vector<SeriesPoint> minutes = query(*store, SERIES_MINUTE);
+    std::vector<SeriesPoint> hours = query(*store, SERIES_HOUR);
+
+    CHECK_EQ(minutes.size(), closed(fed, 60));      // every minute but the open one
+    CHECK_EQ(hours.size(), closed(fed, 3600));
+    for (const SeriesPoint & m : minutes) {
+        CHECK_EQ(m.t % 60, 0);
+        CHECK_EQ(m.count, 6);
+        float lo[2] = {1e9, 1e9}, hi[2] = {-1e9, -1e9};
+        double sum[2] = {};
+        int n = 0;
+        for (const SeriesPoint & r : raw) {
+            if (r.t < m.t || r.t >= m.t + 60) continue;
+            for (int f = 0; f < 2; f++) {
+                lo[f] = std::min(lo[f], r.v[f]);
+                hi[f] = std::max(hi[f], r.v[f]);
+                sum[f] += r.v[f];
+            }
+            n++;
+        }
+        if (!n) continue;       // raw tier may have wrapped past it
+        for (int f = 0; f < 2; f++) {
+            bool ok = CHECK_EQ(m.v[f * 3], lo[f]) && CHECK_NEAR(m.v[f * 3 + 1], sum[f] / n, f ? 1.0 / 2048 : 1.0 / 32) &&
+                      CHECK_EQ(m.v[f * 3 + 2], hi[f]);
+            if (!ok) {
+                fprintf(stderr, "    minute %u field %d\n", m.t, f);
+                break;
+            }
+        }
+    }
+    // Hours: extremes from their minutes, the mean over every raw point
+    for (const SeriesPoint & h : hours) {
+        CHECK_EQ(h.t % 3600, 0);
+        float lo = 1e9, hi = -1e9;
+        double sum = 0;
+        int n = 0;
+        for (const SeriesPoint & m : minutes) {
+            if (m.t < h.t || m.t >= h.t + 3600) continue;
+            lo = std::min(lo, m.v[0]);
+            hi = std::max(hi, m.v[2]);
+        }
+        for (const SeriesPoint & r : raw) {
+            if (r.t < h.t || r.t >= h.t + 3600) continue;
+            sum += r.v[0];
+            n++;
+        }
+        CHECK(n > 0);
+        CHECK_EQ(h.v[0], lo);
+        CHECK_EQ(h.v[2], hi);
+        CHECK_NEAR(h.v[1], sum / n, 1.0 / 16);
+    }
+    CHECK_EQ(store->finest_tier(fed.front().t + 60), SERIES_RAW);
+    CHECK_EQ(flash.violations, 0);
+    delete store;
+}
+
+
+// A fresh store on the same image picks up where the last one stopped
+static void test_reboot() {
+    RamFlash flash(PARTITION);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> fed = run(*store, 1000, steady);
+
+    // Planned restart: flush() first, nothing is lost
+    store->flush();
+    delete store;
+    store = new SeriesStore;
+    start(*store, flash);
+    CHECK(raw_matches(query(*store, SERIES_RAW), fed));
+
+    std::vector<Expected> more = run(*store, 500, steady);
+    fed.insert(fed.end(), more.begin(), more.end());
+    CHECK(raw_matches(query(*store, SERIES_RAW), fed));
+
+    // The minute open at the restart was rebuilt from raw and closes whole
+    std::vector<SeriesPoint> minutes = query(*store, SERIES_MINUTE);
+    CHECK_EQ(minutes.size(), closed(fed, 60));
+
+    // Unplanned reset: at most the raw flush interval is gone, and appending
+    // carries on in the same chain
+    delete store;
+    store = new SeriesStore;
+    start(*store, flash);
+    std::vector<SeriesPoint> raw = query(*store, SERIES_RAW);
+    CHECK(!raw.empty() && raw.back().t >= fed.back().t - SERIES_FLUSH_RAW);
+    uint32_t lost_after = raw.back().t;
+    std::vector<Expected> after = run(*store, 200, steady);
+    raw = query(*store, SERIES_RAW);
+    std::vector<Expected> want;
+    for (const Expected & e : fed) if (e.t <= lost_after) want.push_back(e);
+    want.insert(want.end(), after.begin(), after.end());
+    CHECK(raw_matches(raw, want));
+    CHECK_EQ(flash.violations, 0);
+    delete store;
+}
+
+
+// Round the ring several times: each sector erased once per trip, the
+// oldest data goes, what's left is contiguous
+static void test_wrap() {
+    RamFlash flash(PARTITION_MIN);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    SeriesTierStats stats;
+    store->tier_stats(SERIES_RAW, stats);
+    int sectors = stats.sectors;
+
+    std::vector<Expected> fed = run(*store, 6 * 3600, steady);
+    store->tier_stats(SERIES_RAW, stats);
+    CHECK_EQ(stats.blocks, sectors);
+    CHECK(stats.oldest > fed.front().t);
+    std::vector<SeriesPoint> raw = query(*store, SERIES_RAW);
+    CHECK(raw_matches(raw, fed));
+    CHECK(!raw.empty() && raw.front().t == stats.oldest && raw.back().t == fed.back().t);
+
+    int lo = 1 << 30, hi = 0;
+    for (int s = 0; s < sectors; s++) {
+        lo = std::min(lo, flash.erases[s]);
+        hi = std::max(hi, flash.erases[s]);
+    }
+    CHECK(lo >= 2);
+    CHECK(hi - lo <= 1);
+    CHECK_EQ(flash.violations, 0);
+
+    // Older than the raw tier holds: answered from minutes
+    CHECK_EQ(store->finest_tier(fed.front().t), SERIES_MINUTE);
+    delete store;
+}
+
+
+// Random full-range values: every point near the worst-case size, so
+// frames fill mid-sector and sectors fill mid-frame in every combination.
+// Nothing may be written across a sector end.
+static void test_worst_case() {
+    RamFlash flash(PARTITION_MIN);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> fed = run(*store, 20 * 3600, noisy);
+
+    CHECK_EQ(flash.violations, 0);
+    CHECK(raw_matches(query(*store, SERIES_RAW), fed));
+    std::vector<SeriesPoint> minutes = query(*store, SERIES_MINUTE);
+    SeriesTierStats stats;
+    store->tier_stats(SERIES_MINUTE, stats);
+    CHECK(stats.oldest > fed.front().t);            // the minute ring has wrapped too
+    for (size_t i = 1; i < minutes.size(); i++) {
+        if (!CHECK_EQ(minutes[i].t, minutes[i - 1].t + 60)) break;
+    }
+    CHECK(!minutes.empty() && minutes.back().t == fed.back().t - fed.back().t % 60 - 60);
+
+    // And it all comes back after a reboot
+    store->flush();
+    delete store;
+    store = new SeriesStore;
+    start(*store, flash);
+    CHECK_EQ(query(*store, SERIES_MINUTE).size(), minutes.size());
+    CHECK(raw_matches(query(*store, SERIES_RAW), fed));
+    delete store;
+}
+
+
+// As close to the encoder's worst case as the store can be driven. Values
+// too large for the quantum to round keep every mantissa bit, and each XOR
+// with the previous value falls outside the last window (sign bit and no
+// trailing zeros, alternating with a low exponent bit and no trailing one),
+// so every value opens a new, nearly full window. The clock moves 61 s a
+// step, so each step closes a minute and a frame fills before the rollup
+// flush interval sends it - at every offset into the sector, the last
+// frames included.
+static uint32_t worst_bits[SERIES_FIELDS] = {0x53A00000, 0x53A00000};     // 2^40 region
+
+static float worst_value(int field, int step) {
+    lcg = lcg * 1664525 + 1013904223;
+    uint32_t middle = (lcg >> 4) & 0x007FFFF8;
+    uint32_t x = step & 1 ? 0x20000001 | middle : 0x80000000 | middle | 1u << (1 + (lcg >> 30) % 2);
+    // Now and then unchanged, so point sizes vary and frames end at every offset
+    if ((lcg >> 27) % 8 == 0) x = 0;
+    worst_bits[field] ^= x;
+    float v;
+    memcpy(&v, &worst_bits[field], sizeof(v));
+    return v;
+}
+
+static void test_worst_points() {
+    RamFlash flash(PARTITION_MIN);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> fed;
+    for (int i = 0; i < 40000; i++) {
+        host_millis += 61 * 1000;
+        uint32_t t = now_s();
+        Expected e = {t, {worst_value(0, i), worst_value(1, i)}};
+        device.samples.push_back({timebase.now_us(), e.v[0], e.v[1], 0});
+        store->loop();
+        fed.push_back(e);
+    }
+    CHECK_EQ(flash.violations, 0);
+
+    // Each minute held a single point, so min, mean and max are that point
+    std::vector<SeriesPoint> minutes = query(*store, SERIES_MINUTE);
+    CHECK(minutes.size() > 100);
+    size_t at = 0;
+    for (const SeriesPoint & m : minutes) {
+        while (at < fed.size() && fed[at].t - fed[at].t % 60 < m.t) at++;
+        if (!CHECK(at < fed.size() && fed[at].t - fed[at].t % 60 == m.t)) break;
+        bool ok = true;
+        for (int f = 0; f < SERIES_FIELDS && ok; f++) {
+            ok = CHECK_EQ(m.v[f * 3], fed[at].v[f]) && CHECK_EQ(m.v[f * 3 + 1], fed[at].v[f]) &&
+                 CHECK_EQ(m.v[f * 3 + 2], fed[at].v[f]);
+        }
+        if (!ok) {
+            fprintf(stderr, "    minute %u\n", m.t);
+            break;
+        }
+    }
+    delete store;
+}
+
+
+// A frame whose CRC fails ends its block; other blocks still read, and the
+// store appends in a new block rather than after the damage
+static void test_corruption() {
+    RamFlash flash(PARTITION);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> fed = run(*store, 600, steady);
+    store->flush();
+    delete store;
+
+    // Clear a bit inside the third frame of raw sector 0
+    size_t at = 16;             // BlockHeader
+    for (int frame = 0; frame < 2; frame++) {
+        uint16_t bits = flash.image[at] | flash.image[at + 1] << 8;
+        at += 4 + (bits + 7) / 8;
+    }
+    uint16_t bits = flash.image[at] | flash.image[at + 1] << 8;
+    CHECK(bits != 0xFFFF);
+    size_t hit = at + 4 + bits / 16;
+    while (!flash.image[hit]) hit++;
+    flash.image[hit] &= flash.image[hit] - 1;
+
+    store = new SeriesStore;
+    start(*store, flash);
+    std::vector<SeriesPoint> raw = query(*store, SERIES_RAW);
+    CHECK(!raw.empty() && raw.size() < fed.size());
+    CHECK(!raw.empty() && raw.front().t == fed.front().t);
+    for (size_t i = 0; i < raw.size(); i++) {
+        if (!CHECK_EQ(raw[i].t, fed[i].t)) break;
+    }
+
+    std::vector<Expected> more = run(*store, 300, steady);
+    raw = query(*store, SERIES_RAW, more.front().t);
+    CHECK(raw_matches(raw, more));
+    CHECK_EQ(flash.violations, 0);
+    delete store;
+}
+
+
+// The clock stepped back by SNTP starts a new block; nothing is overwritten
+static void test_clock_step() {
+    RamFlash flash(PARTITION);
+    SeriesStore * store = new SeriesStore;
+    start(*store, flash);
+    std::vector<Expected> fed = run(*store, 300, steady);
+    host_millis -= 120 * 1000;
+    std::vector<Expected> again = run(*store, 300, steady);
+    std::vector<SeriesPoint> raw = query(*store, SERIES_RAW);
+    CHECK_EQ(raw.size(), fed.size() + again.size());
+    CHECK_EQ(flash.violations, 0);
+    delete store;
+}
+
+
+static void test_small_partition() {
+    RamFlash tiny(4 * SERIES_SECTOR);
+    SeriesStore store;
+    CHECK(!store.begin(&tiny));
+    CHECK(!store.is_ready());
+}
+
+
+int main() {
+    test_small_partition();
+    test_round_trip();
+    test_rollups();
+    test_reboot();
+    test_wrap();
+    test_worst_case();
+    test_worst_points();
+    test_corruption();
+    test_clock_step();
+    return check_summary("series");
+}
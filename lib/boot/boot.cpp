@@ -0,0 +1,50 @@
+#include "boot.h"
+#include "timebase.h"
+#include "telemetry.h"
+#include "topics.h"
+#include <esp_timer.h>
+#include <esp_system.h>
+
+BootTimeline::BootTimeline() {}
+
+BootTimeline boot_timeline;
+
+
+// Phase names must be string literals - only the pointer is kept
+void BootTimeline::mark(const char * name) {
+    if (_count >= BOOT_MAX_PHASES) return;
+    _phases[_count].name = name;
+    _phases[_count].us = esp_timer_get_time();
+    _count++;
+}
+
+
+uint32_t BootTimeline::elapsed_ms(const char * name) {
+    for (int i = 0; i < _count; i++) {
+        if (strcmp(_phases[i].name, name) == 0) return (uint32_t)(_phases[i].us / 1000);
+    }
+    return 0;
+}
+
+
+void BootTimeline::print() {
+    Serial.println("\tBoot timeline (ms from reset):");
+    for (int i = 0; i < _count; i++) {
+        Serial.printf("\t  %-12s %8.1f\n", _phases[i].name, _phases[i].us / 1000.0);
+    }
+}
+
+
+// Published once, the first time the broker is reachable
+void BootTimeline::publish() {
+    if (_published) return;
+
+    JsonDocument doc;
+    doc["reset_reason"] = (int) esp_reset_reason();
+    if (timebase.is_synced()) doc["boot_ts"] = timebase.to_epoch_ms(0);
+    for (int i = 0; i < _count; i++) {
+        doc[_phases[i].name] = (unsigned long)(_phases[i].us / 1000);
+    }
+    telemetry.publish(TOPIC_DIAG_BOOT, doc);
+    _published = true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define BOOT_MAX_PHASES 12
+
+// Records when each boot phase completed, in microseconds since reset, so the
+// time from power-on to a running cell (and to a usable network) is visible
+class BootTimeline {
+
+    public:
+
+        BootTimeline();
+
+        void mark(const char *);
+        void print();
+        void publish();
+
+        bool is_published() { return _published; }
+        uint32_t elapsed_ms(const char *);
+
+    private:
+
+        struct Phase {
+            const char * name;
+            int64_t us;
+        };
+
+        Phase _phases[BOOT_MAX_PHASES];
+        int _count = 0;
+        bool _published = false;
+
+};
+
+extern BootTimeline boot_timeline;
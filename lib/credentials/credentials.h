@@ -4,6 +4,23 @@
 #define WIFI_SSID "BurradooAP"
 #define WIFI_PASS "2rachelle"
 
+// Uncomment to let the link monitor roam to a second AP/extender
+//#define WIFI_ALT_SSID "BurradooAP-Ext"
+//#define WIFI_ALT_PASS WIFI_PASS
+
+// Uncomment to skip DHCP entirely
+//#define WIFI_STATIC_IP IPAddress(192, 168, 1, 131)
+//#define WIFI_GATEWAY IPAddress(192, 168, 1, 1)
+//#define WIFI_SUBNET IPAddress(255, 255, 255, 0)
+//#define WIFI_DNS IPAddress(192, 168, 1, 1)
+
+// Uncomment to sync time from a local NTP server (default: pool.ntp.org)
+//#define NTP_SERVER "192.168.1.1"
+
+// Uncomment to publish under filterchlorine/<name>/ instead of the MAC
+// (the telnet "name" command overrides this)
+//#define DEVICE_NAME "pool"
+
 #define MQTT_HOST "192.168.1.204"
 #define MQTT_PORT 1883
 const char *mqtt_broker = "192.168.1.204";
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Block-processing kernels for the ACS712 capture. Kept free of Arduino and
+// IDF headers so they can be exercised off-target.
+//
+// Everything is accumulated in integers: the samples are 12-bit, so sum and
+// sum-of-squares of a few thousand of them fit easily in 32/64 bits, and the
+// S3 does a 32-bit MAC per cycle without touching the FPU until the end.
+
+struct BlockStats {
+    float mean;       // counts, offset corrected
+    float rms;        // counts, offset corrected (DC + AC)
+    float ripple_rms; // counts, AC part only (standard deviation)
+    float peak;       // counts, largest |x - offset|
+    uint16_t min;     // raw counts
+    uint16_t max;     // raw counts
+    uint32_t n;
+};
+
+// x: raw ADC counts, offset: zero-current level in counts
+inline void block_stats(const uint16_t * x, size_t n, float offset, BlockStats & out) {
+
+    out.n = n;
+    if (n == 0) {
+        out.mean = out.rms = out.ripple_rms = out.peak = 0;
+        out.min = out.max = 0;
+        return;
+    }
+
+    uint32_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint16_t lo = 0xFFFF, hi = 0;
+
+    // Unrolled by four - lets the compiler keep the accumulators in
+    // registers and overlap the loads with the multiplies
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t a = x[i], b = x[i + 1], c = x[i + 2], d = x[i + 3];
+        sum += a + b + c + d;
+        sum_sq += a * a + b * b + c * c + d * d;
+        uint16_t l1 = a < b ? a : b, l2 = c < d ? c : d;
+        uint16_t h1 = a < b ? b : a, h2 = c < d ? d : c;
+        if (l1 < lo) lo = l1;
+        if (l2 < lo) lo = l2;
+        if (h1 > hi) hi = h1;
+        if (h2 > hi) hi = h2;
+    }
+    for (; i < n; i++) {
+        uint32_t a = x[i];
+        sum += a;
+        sum_sq += a * a;
+        if (a < lo) lo = a;
+        if (a > hi) hi = a;
+    }
+
+    // Once per block, in double: mean_sq and mean^2 are both ~1e7 and their
+    // difference can be a handful of counts^2
+    double mean_raw = (double) sum / n;
+    float variance = (float) ((double) sum_sq / n - mean_raw * mean_raw);
+    if (variance < 0) variance = 0;
+
+    out.mean = (float) mean_raw - offset;
+    out.ripple_rms = __builtin_sqrtf(variance);
+    out.rms = __builtin_sqrtf(variance + out.mean * out.mean);
+    float up = hi - offset, down = offset - lo;
+    out.peak = up > down ? up : down;
+    out.min = lo;
+    out.max = hi;
+}
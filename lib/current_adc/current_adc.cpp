@@ -0,0 +1,203 @@
+#include "current_adc.h"
+#include "power.h"
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+#include <esp_timer.h>
+
+#define FRAME_BYTES (SOC_ADC_DIGI_RESULT_BYTES * 256)
+
+CurrentAdc::CurrentAdc() {}
+
+CurrentAdc current_adc;
+
+static esp_adc_cal_characteristics_t adc_chars;
+
+// The DMA sample clock divides APB. The driver holds its own lock as well;
+// this one shows up in "pm" and the power estimate
+static PmLock adc_lock(ESP_PM_APB_FREQ_MAX, "adc");
+
+
+bool CurrentAdc::begin() {
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = FRAME_BYTES * 4;
+    init.conv_num_each_intr = FRAME_BYTES;
+    init.adc1_chan_mask = BIT(ADC1_CHANNEL_3);
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) {
+        Serial.println("\tACS712: ADC DMA init failed");
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = ADC1_CHANNEL_3;
+    pattern.unit = 0;   // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = false;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = ACS712_SAMPLE_RATE;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&config) != ESP_OK) {
+        Serial.println("\tACS712: ADC DMA configure failed");
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    // Count -> mV slope from the factory eFuse calibration, taken around mid-scale
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adc_chars);
+    float mV_per_count = (esp_adc_cal_raw_to_voltage(3000, &adc_chars) -
+                          esp_adc_cal_raw_to_voltage(1000, &adc_chars)) / 2000.0;
+    _mA_per_count = mV_per_count * ACS712_DIVIDER / ACS712_MV_PER_A * 1000.0;
+
+    // Nominal zero until zero() is run: Vcc/2 behind the divider
+    _offset = 2500.0 / ACS712_DIVIDER / mV_per_count;
+
+    adc_lock.acquire();
+    adc_digi_start();
+    _running = true;
+    xTaskCreatePinnedToCore(_task, "acs712", 4096, this, 2, nullptr, 1);
+    Serial.printf("\tACS712: sampling GPIO%d at %d Hz\n", ACS712_PIN, ACS712_SAMPLE_RATE);
+    return true;
+}
+
+
+void CurrentAdc::_task(void * arg) {
+    static_cast<CurrentAdc *>(arg)->_run();
+}
+
+
+// Reader: fill the buffer that isn't published, process it, flip
+void CurrentAdc::_run() {
+
+    uint8_t frame[FRAME_BYTES];
+    uint8_t fill = _ready ^ 1;
+    size_t count = 0;
+    uint16_t over = 0;
+
+    while (true) {
+        uint32_t got = 0;
+        esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &got, 100);
+        if (err == ESP_ERR_INVALID_STATE) {
+            _overruns++;    // driver ring filled before we read it - data was lost
+        } else if (err != ESP_OK) {
+            continue;
+        }
+        // The last sample of the frame was converted about now
+        int64_t frame_end = esp_timer_get_time();
+        uint32_t frame_samples = got / SOC_ADC_DIGI_RESULT_BYTES;
+
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            adc_digi_output_data_t * d = (adc_digi_output_data_t *) &frame[i];
+            if (d->type2.channel != ADC1_CHANNEL_3) continue;
+            uint16_t x = d->type2.data;
+            _samples[fill][count++] = x;
+
+            // Overcurrent: checked per sample, not per block, so a trip doesn't wait 50 ms.
+            // One call per excursion - over stops at the limit until a sample is back in range
+            if (_limit_counts && fabsf(x - _offset) > _limit_counts) {
+                if (over < _limit_samples && ++over == _limit_samples) {
+                    uint32_t behind = frame_samples - 1 - i / SOC_ADC_DIGI_RESULT_BYTES;
+                    _limit(frame_end - (int64_t) behind * 1000000 / ACS712_SAMPLE_RATE);
+                }
+            } else {
+                over = 0;
+            }
+
+            if (count == ACS712_BLOCK_SAMPLES) {
+                _process(fill);
+                portENTER_CRITICAL(&_lock);
+                _ready = fill;
+                _flips++;
+                portEXIT_CRITICAL(&_lock);
+                fill ^= 1;
+                count = 0;
+            }
+        }
+    }
+}
+
+
+void CurrentAdc::_process(uint8_t buffer) {
+
+    int64_t start = esp_timer_get_time();
+
+    BlockStats stats;
+    block_stats(_samples[buffer], ACS712_BLOCK_SAMPLES, _offset, stats);
+
+    if (_zero_request) {
+        _offset += stats.mean;
+        _zero_request = false;
+        return;
+    }
+
+    CurrentBlock block;
+    block.mean_mA = stats.mean * _mA_per_count;
+    block.rms_mA = stats.rms * _mA_per_count;
+    block.ripple_mA = stats.ripple_rms * _mA_per_count;
+    block.peak_mA = stats.peak * _mA_per_count;
+    block.ripple_pp_mA = (stats.max - stats.min) * _mA_per_count;
+    block.process_us = (uint32_t) (esp_timer_get_time() - start);
+
+    portENTER_CRITICAL(&_lock);
+    block.seq = _result.seq + 1;
+    _result = block;
+    portEXIT_CRITICAL(&_lock);
+}
+
+
+// The next block becomes the zero reference
+void CurrentAdc::zero() {
+    _zero_request = true;
+}
+
+
+bool CurrentAdc::latest(CurrentBlock & out) {
+    if (!_running) return false;
+    portENTER_CRITICAL(&_lock);
+    out = _result;
+    portEXIT_CRITICAL(&_lock);
+    return out.seq != 0;
+}
+
+
+// Copy of the last complete block of raw counts. The reader only refills
+// the published buffer after a flip, so a copy with no flip across it is
+// whole; one that raced a flip is taken again from the new buffer
+size_t CurrentAdc::waveform(uint16_t * out, size_t max) {
+    size_t n = min(max, (size_t) ACS712_BLOCK_SAMPLES);
+    while (true) {
+        portENTER_CRITICAL(&_lock);
+        uint32_t flips = _flips;
+        uint8_t ready = _ready;
+        portEXIT_CRITICAL(&_lock);
+
+        memcpy(out, _samples[ready], n * sizeof(uint16_t));
+
+        portENTER_CRITICAL(&_lock);
+        bool whole = _flips == flips;
+        portEXIT_CRITICAL(&_lock);
+        if (whole) return n;
+    }
+}
+
+
+// Set once the offset is known; until then the nominal zero would trip early or late
+void CurrentAdc::watch_limit(float mA, uint16_t samples, void (*limit)(int64_t sample_us)) {
+    _limit = limit;
+    _limit_samples = samples ? samples : 1;
+    _limit_counts = _mA_per_count > 0 ? mA / _mA_per_count : 0;
+}
+
+
+// Independent check on the INA219: both sensors see the same cell current
+bool CurrentAdc::agrees_with(float ina_mA) {
+    CurrentBlock block;
+    if (!latest(block)) return true;
+    float diff = fabsf(fabsf(block.mean_mA) - fabsf(ina_mA));
+    return diff <= ACS712_AGREE_FLOOR_MA || diff <= fabsf(ina_mA) * ACS712_AGREE_PERCENT / 100.0;
+}
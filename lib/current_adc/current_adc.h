@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include "block_stats.h"
+
+#define ACS712_PIN 4                  // GPIO4 = ADC1 channel 3 on the S3
+#define ACS712_SAMPLE_RATE 20000      // Hz, continuous DMA conversion
+#define ACS712_BLOCK_SAMPLES 1000     // 50 ms blocks - a whole number of 5 kHz PWM periods
+#define ACS712_MV_PER_A 185.0         // 5 A part; 100 for 20 A, 66 for 30 A
+#define ACS712_DIVIDER 1.0            // output divider ratio in front of the ADC pin
+#define ACS712_AGREE_PERCENT 15.0     // cross-check tolerance against the INA219...
+#define ACS712_AGREE_FLOOR_MA 50.0    // ...or this absolute difference at low current
+
+// Result of one processed block, in engineering units
+struct CurrentBlock {
+    float mean_mA;        // offset corrected
+    float rms_mA;
+    float ripple_mA;      // AC rms
+    float peak_mA;
+    float ripple_pp_mA;
+    uint32_t process_us;  // cost of block_stats() + conversion for this block
+    uint32_t seq;
+};
+
+/**
+ * ACS712 captured with the ADC in continuous DMA mode.
+ *
+ * A reader task pulls conversion frames from the driver into one of two
+ * sample buffers, processes the block, then flips buffers - the main loop
+ * only ever sees finished results and the last complete waveform. A copy
+ * of the waveform that a flip overtakes is retried, so it's never a mix of
+ * two blocks.
+ */
+class CurrentAdc {
+
+    public:
+
+        CurrentAdc();
+
+        bool begin();
+        void zero();                        // learn the offset - call with the cell off
+        bool latest(CurrentBlock &);
+        size_t waveform(uint16_t *, size_t);
+        bool agrees_with(float ina_mA);
+
+        // Calls limit(sample time) from the reader task for every sample
+        // once `samples` in a row have been beyond +-mA
+        void watch_limit(float mA, uint16_t samples, void (*limit)(int64_t sample_us));
+
+        bool is_running() { return _running; }
+        uint32_t overruns() { return _overruns; }
+
+    private:
+
+        uint16_t _samples[2][ACS712_BLOCK_SAMPLES];
+        volatile uint8_t _ready = 1;        // buffer holding the last finished block
+        volatile uint32_t _flips = 0;       // buffer flips, under _lock with _ready
+        CurrentBlock _result = {};
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+        float _offset = 0;                  // counts at zero current
+        volatile bool _zero_request = false;
+        float _mA_per_count = 0;
+        volatile bool _running = false;
+        volatile uint32_t _overruns = 0;
+
+        float _limit_counts = 0;            // 0 = not watching
+        uint16_t _limit_samples = 0;
+        void (*_limit)(int64_t) = nullptr;
+
+        static void _task(void *);
+        void _run();
+        void _process(uint8_t);
+
+};
+
+extern CurrentAdc current_adc;
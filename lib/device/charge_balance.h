@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Polarity reversal scheduled on charge rather than time. Plain state and
+// readings passed in, kept free of Arduino and IDF headers so the schedule
+// can be checked off-target; Device feeds it every INA219 reading.
+
+#define CHARGE_STATE_MAGIC 0xC4A26E01
+
+// What survives a reboot (RTC memory and NVS, see Device)
+struct ChargeState {
+    uint32_t magic;
+    uint8_t reverse;        // polarity the cell is in
+    uint32_t reversals;
+    float balance_C;        // reverse charge delivered minus owed; the carried-over residual
+    float phase_C;          // charge through the cell in the current polarity so far
+    double forward_C;       // lifetime totals
+    double reverse_C;
+};
+
+// Current to count on time while there are no usable readings: the assumed
+// figure while the output is driving, nothing once it's stopped or tripped
+inline float charge_fallback_mA(bool running, bool tripped, float assumed_mA) {
+    return running && !tripped ? assumed_mA : 0.0f;
+}
+
+/**
+ * Each forward phase runs until cycle_C has passed. Every forward coulomb
+ * owes ratio coulombs of reverse, and the reverse phase runs until the debt
+ * is paid. Whatever a phase over- or undershoots by (one reading's worth)
+ * stays in the balance and is settled by the next cycle, so over many
+ * cycles reverse / forward charge converges on the ratio however the
+ * current drifts. A ratio of 0 never reverses.
+ */
+class ChargeBalance {
+
+    public:
+
+        ChargeBalance(float cycle_C, float ratio) : _cycle_C(cycle_C), _ratio(ratio) {
+            _state.magic = CHARGE_STATE_MAGIC;
+        }
+
+        // True when the polarity should flip now
+        bool step(float current_mA, float seconds) {
+            if (!(seconds > 0) || isnan(current_mA)) return false;
+            float q = fabsf(current_mA) * seconds / 1000.0f;
+            _state.phase_C += q;
+            if (_state.reverse) {
+                _state.reverse_C += q;
+                _state.balance_C += q;
+                if (_state.balance_C < 0) return false;
+                _state.reverse = 0;
+            } else {
+                _state.forward_C += q;
+                _state.balance_C -= _ratio * q;
+                if (_state.phase_C < _cycle_C || _ratio <= 0) return false;
+                _state.reverse = 1;
+                _state.reversals++;
+            }
+            _state.phase_C = 0;
+            return true;
+        }
+
+        // False (and nothing changed) for a state that isn't one of ours
+        bool restore(const ChargeState & state) {
+            if (state.magic != CHARGE_STATE_MAGIC || !isfinite(state.balance_C) || !isfinite(state.phase_C) ||
+                !isfinite(state.forward_C) || !isfinite(state.reverse_C)) {
+                return false;
+            }
+            _state = state;
+            _state.reverse = state.reverse ? 1 : 0;
+            return true;
+        }
+
+        void set_ratio(float ratio) { _ratio = ratio; }
+        float ratio() const { return _ratio; }
+        float cycle_C() const { return _cycle_C; }
+
+        const ChargeState & state() const { return _state; }
+        bool reverse() const { return _state.reverse; }
+        float balance_C() const { return _state.balance_C; }
+        // Lifetime reverse / forward charge, 0 before any forward charge
+        float achieved_ratio() const {
+            return _state.forward_C > 0 ? (float) (_state.reverse_C / _state.forward_C) : 0.0f;
+        }
+
+    private:
+
+        float _cycle_C;
+        float _ratio;
+        ChargeState _state = {};
+
+};
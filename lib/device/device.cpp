@@ -1,66 +1,74 @@
 #include "mqtt.h"
-#include <Wire.h>
 #include <WiFi.h>
-#include <Adafruit_INA219.h>
 #include <Adafruit_NeoPixel.h>
 #include <ArduinoJson.h>
 #include "device.h"
 
 #include "../telnet/telnet.h"
-#include "ACS712.h"
+#include "current_adc.h"
+#include "protection.h"
+#include "i2c_bus.h"
+#include "ina219_sensor.h"
+#include "bme280_sensor.h"
 #define On_Board_LED_PIN 38
 #define RGB_LED_PIN 48
 #define NUM_PIXELS 1
 #define SampleTime 5000
 #include "motor.h"
+#include "boot.h"
+#include "timebase.h"
+#include "telemetry.h"
+#include "identity.h"
+#include "topics.h"
+#include "rpc.h"
+#include "storage.h"
+#include "sweep.h"
+#include <esp_timer.h>
 
 Device::Device() : motor(nullptr), pixel(nullptr) {}
 
 Device device;
-#define CurrentCalibrationFactor 18.150 // Adjust this factor based on calibration results
-const int sensorIn = 4; // pin where the OUT pin from sensor is connected on ESP32-S3 (ADC1)
 
 // Define static member variables
 bool Device::payloadReady = false;
 char Device::globalBuf[256] = {0};
 
+// Survives soft resets and watchdog reboots; after a power loss the NVS
+// copy (at most CHARGE_SAVE_INTERVAL old) is used instead
+RTC_DATA_ATTR ChargeState rtc_charge;
+
 void Device::setup()
 {
-    static const char *subscription_list[] = {
-        "beacon"};
-    mqtt.set_subscriptions(subscription_list, 1);
-    mqtt.set_callback(message_handler);
-    _SampleTime = 60*1000; // 1 minute default sample time
-    _LastSampleTime = millis();
-    
-    // Initialize NeoPixel RGB LED
-    pixel = new Adafruit_NeoPixel(NUM_PIXELS, RGB_LED_PIN, NEO_GRB + NEO_KHZ800);
-    if (pixel) {
-        pixel->begin();
-        pixel->setBrightness(20); // Low brightness to avoid blinding
-        pixel->setPixelColor(0, pixel->Color(0, 255, 0)); // Start green
-        pixel->show();
-        telnet.println("NeoPixel initialized (GPIO 48)");
+    // Control plane first - the cell must run whatever the network is doing
+    // All I2C traffic runs on the bus task (SDA = GPIO 9, SCL = GPIO 8)
+    ina219_sensor.load_calibration();
+    telemetry.load();
+    i2c_bus.add_sensor(&ina219_sensor);
+    i2c_bus.add_sensor(&bme280_sensor);
+    if (!i2c_bus.begin())
+    {
+        telnet.println("Failed to start I2C bus task");
     }
-    
-    // Publish initial status
-    mqtt.publish("filterchlorine/status", "online");
-    mqtt.publish("filterchlorine/ota/state", "ready");
-    
-    // Initialize I2C with custom pins: SDA = GPIO 8, SCL = GPIO 9
-    Wire.begin(9, 8);
-    
-    if (!this->ina219.begin())
+
+    if (!ina219_sensor.is_present())
     {
         telnet.println("Failed to find INA219 chip mark as down");
         _Down = true;
     }
     else
     {
-        // Configure INA219 for 0-16V, 0-400mA range (higher precision for low current)
-       //this->ina219.setCalibration_32V_2A();
-        telnet.println("INA219 initialized and calibrated (16V/400mA)");
+        char line[96];
+        snprintf(line, sizeof(line), "INA219 initialized: shunt %.5f ohm, LSB %.3f mA, cal 0x%04X, %u-sample averaging",
+                 ina219_sensor.shunt_ohms(), ina219_sensor.current_lsb_mA(),
+                 ina219_sensor.calibration_register(), ina219_sensor.averaging());
+        telnet.println(line);
+    }
+    if (bme280_sensor.is_present())
+    {
+        telnet.println("BME280 found");
     }
+    boot_timeline.mark("ina219");
+
     // Initialize motor: PWM pin 26, DIR pin 25, channel 0, 5kHz, 8-bit
     motor = new MD135(35, 36, 0, 5000, 8);
     if (!motor) {
@@ -68,11 +76,67 @@ void Device::setup()
         Serial.println("CRITICAL: Failed to allocate motor object!");
     } else {
         motor->begin();
-        motor->forward(255); // Start in forward - will auto-reverse after 10 minutes
-        telnet.println("Motor initialized successfully (forward mode)");
+
+        // ACS712 on GPIO 4 (see ACS712_PIN) - zeroed while the cell is still off
+        if (current_adc.begin()) {
+            current_adc.zero();
+            delay(2 * ACS712_BLOCK_SAMPLES * 1000 / ACS712_SAMPLE_RATE + 10);
+        }
+        protection.begin(motor);    // after the zero, so the ACS712 limit is taken from it
+        sweep.begin(motor);
+
+        // Pick up the polarity and charge residual from before the reboot
+        ChargeState saved;
+        if (_balance.restore(rtc_charge) ||
+            (storage.load_blob("charge", "state", &saved, sizeof(saved)) && _balance.restore(saved)))
+        {
+            char line[96];
+            snprintf(line, sizeof(line), "Charge balance restored: %s, residual %.1f C, %lu reversals",
+                     _balance.reverse() ? "reverse" : "forward", _balance.balance_C(),
+                     (unsigned long) _balance.state().reversals);
+            telnet.println(line);
+        }
+        rtc_charge = _balance.state();
+        ResumeDrive();
+        telnet.println(_balance.reverse() ? "Motor initialized successfully (reverse mode)"
+                                          : "Motor initialized successfully (forward mode)");
     }
+    boot_timeline.mark("motor");
     
-    _last_power_update = millis();  // Initialize power measurement timer
+    _last_power_us = timebase.now_us();  // Initialize power measurement timer
+    _charge_us = _last_power_us;
+
+    // This unit's command and RPC topics and the fleet-wide command one
+    static const char *subscription_list[3];
+    subscription_list[0] = topics.get(TOPIC_COMMAND);
+    subscription_list[1] = topics.get(TOPIC_RPC_REQUEST);
+    subscription_list[2] = topics.get(TOPIC_FLEET_COMMAND);
+    mqtt.set_subscriptions(subscription_list, 3);
+    mqtt.set_callback(message_handler);
+    _SampleTime = 60*1000; // 1 minute default sample time
+    _LastMillis = millis() + identity.slot(_SampleTime); // this unit's publish slot within the minute
+    _LastSampleTime = millis();
+    
+    // Initialize NeoPixel RGB LED
+    pixel = new Adafruit_NeoPixel(NUM_PIXELS, RGB_LED_PIN, NEO_GRB + NEO_KHZ800);
+    if (pixel) {
+        pixel->begin();
+        pixel->setBrightness(20); // Low brightness to avoid blinding
+        pixel->setPixelColor(0, pixel->Color(0, 255, 0)); // Start green
+        pixel->show();
+        telnet.println("NeoPixel initialized (GPIO 48)");
+    }
+}
+
+// Called once the broker is first reachable
+void Device::report_online()
+{
+    char payload[160];
+    snprintf(payload, sizeof(payload), "{\"id\":\"%s\",\"named\":%s,\"mac\":\"%s\",\"client\":\"%s\"}",
+             identity.id(), identity.is_named() ? "true" : "false", identity.mac(), identity.client_id());
+    mqtt.publish(topics.get(TOPIC_IDENTITY), (const uint8_t *) payload, strlen(payload), true);
+    mqtt.publish(topics.get(TOPIC_OTA_STATE), "ready");
+    telemetry.publish_schema();
 }
 
 void Device::loop()
@@ -86,7 +150,34 @@ void Device::loop()
         return;
     }
     
-    // Generate sensor data
+    // The bus task keeps probing, so a late or reseated INA219 comes back
+    _Down = !ina219_sensor.is_present();
+
+    // A finished field calibration is saved from here - NVS stays off the bus task
+    if (ina219_sensor.persist()) {
+        char line[64];
+        snprintf(line, sizeof(line), "INA219 calibrated: gain %.4f, offset %.1f mA (saved)",
+                 ina219_sensor.gain(), ina219_sensor.offset_mA());
+        telnet.println(line);
+    }
+
+    // High-rate power sampling feeds the live views and the mAh integration
+    if (!_Down) {
+        update_power();
+    }
+
+    // No usable reading for a while - the INA219 is gone, or still listed
+    // but not answering - so count charge on time at an assumed current
+    // while the output is driving, and the electrodes still get reversed.
+    // Picks up from the last reading that counted, and a reading that comes
+    // back only counts from here on
+    uint64_t now_us = timebase.now_us();
+    if (now_us - _charge_us > (uint64_t) CHARGE_STALE_MS * 1000) {
+        float assumed_mA = charge_fallback_mA(motor->isRunning(), motor->isTripped(), REVERSE_FALLBACK_MA);
+        _step_charge(assumed_mA, (now_us - _charge_us) / 1000000.0);
+        _charge_us = now_us;
+    }
+
     // Generate sensor data
     if(millis() < _LastMillis) {
     
@@ -96,48 +187,26 @@ void Device::loop()
     _LastMillis = millis() + _SampleTime;
     _LastSampleTime = millis(); // Record when sample was taken
     _MinuteCount++;
-    
-    // Motor control: Run forward for 10 minutes, then reverse for 1 minute, repeat
-    // _ReverseRatio = 0.1 means reverse 1 out of every 10 minutes
-    if(motor->isForward()) {
-        // Currently running forward - check if it's time to reverse
-        if((float) _MinuteCount * _ReverseRatio >= 1.00) {
-            motor->reverse(255);
-            _ReverseCount++;
-            _MinuteCount = 0;
-        }
-    } else {
-        // Currently running reverse - check if it's time to go back to forward
-        if(_MinuteCount >= 1) {
-            motor->forward(255);
-            _MinuteCount = 0;
-        }
-    }
 
-    int rssi = WiFi.RSSI(); // Get WiFi signal strength
+    // Mid-phase progress, so a power loss costs at most this much of it
+    if (millis() - _charge_saved > CHARGE_SAVE_INTERVAL) {
+        SaveCharge();
+    }
 
     update_power(); // Read power data from INA219
 
-    // Build JSON payload using ArduinoJson
-    JsonDocument doc;
-    doc["resistance"] = _resistance;
-    doc["current"] = _current_mA;
-    doc["rssi"] = rssi;
-    doc["direction"] = motor->isForward() ? "forward" : "reverse";
-    doc["ip"] = WiFi.localIP().toString();
-    doc["uptime"] = millis() / 1000;
-    doc["down"] = IsDown() ? "offline" : "online";
-    doc["busvoltage"] = _busvoltage;
-    doc["shuntvoltage"] = _shuntvoltage;
-    doc["loadvoltage"] = _loadvoltage;
-    doc["power_mW"] = _power_mW;
-    doc["reversecount"] = _ReverseCount;
-
-    char jsonBuffer[256];
-    serializeJson(doc, jsonBuffer);
+    Environment env;
+    if (bme280_sensor.latest(env))
+    {
+        _temperature = env.temperature_C;
+        _humidity = env.humidity_pct;
+        _pressure = env.pressure_hPa;
+    }
 
-    // Publish JSON to single topic
-    mqtt.publish("filterchlorine/sensors", jsonBuffer);
+    // Publish the sensors message in the configured encoding
+    JsonDocument doc;
+    BuildTelemetry(doc);
+    telemetry.publish(TOPIC_SENSORS, doc);
 
     // Removed blocking delay(2000) - was killing WiFi performance
     if (payloadReady)
@@ -175,20 +244,35 @@ void Device::message_handler(char *topic, char *payload)
     telnet.print(" / payload: ");
     telnet.println(payload);
 
+    // Calls are queued and answered from the main loop
+    if (strcmp(topic, topics.get(TOPIC_RPC_REQUEST)) == 0)
+    {
+        rpc.receive(payload);
+        return;
+    }
+
     // Handle OTA update trigger
     if (strcmp(payload, "OTA_UPDATE") == 0 || strcmp(payload, "UPDATE") == 0)
     {
         telnet.println("\tOTA Update triggered via MQTT");
-        mqtt.publish("filterchlorine/ota/state", "updating");
+        mqtt.publish(topics.get(TOPIC_OTA_STATE), "updating");
         telnet.println("\tWaiting for OTA upload...");
         telnet.println("\tDevice is ready for OTA updates");
-        mqtt.publish("filterchlorine/ota/state", "ready");
+        mqtt.publish(topics.get(TOPIC_OTA_STATE), "ready");
         return;
     }
 
     strcpy(globalBuf, payload);
     payloadReady = true;
 }
+// False once the sample has been overwritten (or not taken yet)
+bool Device::GetSample(uint32_t seq, PowerSample &sample)
+{
+    if (seq >= _sample_seq || _sample_seq - seq > POWER_RING_SIZE) return false;
+    sample = _samples[seq % POWER_RING_SIZE];
+    return true;
+}
+
 bool Device::IsDown()
 {
     return _Down;
@@ -202,15 +286,33 @@ void Device::update_power()
         return;
     }
     
-    // Calculate time since last measurement
-    unsigned long currentMillis = millis();
-    float elapsed_seconds = (currentMillis - _last_power_update) / 1000.0;
-    _last_power_update = currentMillis;
-    
-    // Read voltage and current from INA219
-    _shuntvoltage = this->ina219.getShuntVoltage_mV();
-    _busvoltage = this->ina219.getBusVoltage_V();
-    _current_mA = this->ina219.getCurrent_mA() * CurrentCalibrationFactor; // Apply calibration factor if needed
+    // Consume the bus task's latest reading, once
+    PowerReading reading;
+    if (!ina219_sensor.latest(reading) || reading.seq == _reading_seq)
+    {
+        return;
+    }
+    _reading_seq = reading.seq;
+
+    // Before any filtering - a real overcurrent must not wait for the median.
+    // An overflowed reading is beyond the INA219's range, so it trips too
+    protection.check(reading.overflow ? INFINITY : reading.current_mA, reading.us);
+
+    // Spikes and out-of-range reads are dropped here; the last good value stands
+    float current = _current_filter.step(reading.overflow ? NAN : reading.current_mA); // already scaled by the shunt and field calibration
+    float bus = _bus_filter.step(reading.bus_V);
+    if (isnan(current) || isnan(bus))
+    {
+        return;
+    }
+
+    // Integrate over the time between the chip readings, not our calls
+    float elapsed_seconds = (reading.us - _last_power_us) / 1000000.0;
+    _last_power_us = reading.us;
+
+    _shuntvoltage = reading.shunt_mV;
+    _busvoltage = bus;
+    _current_mA = current;
 
     // Compute load voltage and power
     _loadvoltage = _busvoltage + (_shuntvoltage / 1000);
@@ -221,12 +323,26 @@ void Device::update_power()
     _total_mA += _current_mA * elapsed_seconds;
     _total_sec += elapsed_seconds;
     _total_mAH = _total_mA / 3600.0;
+    if (reading.us > _charge_us) {
+        _step_charge(_current_mA, (reading.us - _charge_us) / 1000000.0);
+        _charge_us = reading.us;
+    }
 
-    _resistance = (_busvoltage * 1000) / _current_mA; // Ohm's law: R = V/I, convert V to mV for mA
+    // Ohm's law: R = V/I, convert V to mV for mA; undefined with the cell off
+    float resistance = guarded_ratio(_busvoltage * 1000, _current_mA, RESISTANCE_MIN_MA);
+    if (isnan(resistance)) _resistance_filter.reset();
+    _resistance = isnan(resistance) ? NAN : _resistance_filter.step(resistance);
+
+    PowerSample &sample = _samples[_sample_seq % POWER_RING_SIZE];
+    sample.us = reading.us;
+    sample.current_mA = _current_mA;
+    sample.busvoltage = _busvoltage;
+    sample.power_mW = _power_mW;
+    _sample_seq++;
 
     // Only print to telnet occasionally to avoid spam
     static unsigned long last_print = 0;
-    if (currentMillis - last_print > 10000) {  // Print every 10 seconds max
+    if (millis() - last_print > 10000) {  // Print every 10 seconds max
         telnet.print("Bus: ");
         telnet.print(_busvoltage);
         telnet.print("V Shunt: ");
@@ -240,6 +356,98 @@ void Device::update_power()
         telnet.print(" mW, mAH: ");
         telnet.print(_total_mAH);
         telnet.println(" mAH");
-        last_print = currentMillis;
+        last_print = millis();
+    }
+}
+
+
+// Polarity reversal on charge, not time - see ChargeBalance
+void Device::_step_charge(float current_mA, float seconds)
+{
+    // A characterization sweep drives both polarities itself
+    if (sweep.running()) return;
+
+    bool flip = _balance.step(current_mA, seconds);
+    rtc_charge = _balance.state();
+    if (!flip) return;
+
+    _MinuteCount = 0;
+    if (_balance.reverse()) _ReverseCount++;
+    ResumeDrive();
+    SaveCharge();
+}
+
+
+// Full duty unless a target current and a sweep table say otherwise
+void Device::ResumeDrive()
+{
+    if (!motor) return;
+    int speed = sweep.feedforward(_balance.reverse());
+    if (speed < 0) speed = 255;
+    if (_balance.reverse()) motor->reverse(speed);
+    else motor->forward(speed);
+}
+
+
+void Device::SaveCharge()
+{
+    ChargeState state = _balance.state();
+    storage.store_blob("charge", "state", &state, sizeof(state));
+    _charge_saved = millis();
+}
+
+
+// A noisy cell current with a spike every tenth reading, through copies so
+// the live channels are untouched
+float Device::FilterCost_us(int rounds)
+{
+    CurrentFilter current = _current_filter;
+    BusFilter bus = _bus_filter;
+    ResistanceFilter resistance = _resistance_filter;
+    volatile float sink = 0;    // keeps the loop from being optimised out
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++)
+    {
+        float i_mA = current.step(i % 10 ? 500.0f + (i % 7) : 5000.0f);
+        float v = bus.step(12.0f + (i % 5) * 0.004f);
+        sink = resistance.step(guarded_ratio(v * 1000, i_mA, RESISTANCE_MIN_MA));
+    }
+    return (esp_timer_get_time() - start) / (float) rounds;
+}
+
+
+// The filterchlorine/<id>/sensors message, also used by the "bench" command
+void Device::BuildTelemetry(JsonDocument &doc)
+{
+    doc["resistance"] = _resistance;
+    doc["current"] = _current_mA;
+    doc["rssi"] = WiFi.RSSI();
+    doc["direction"] = motor && motor->isForward() ? "forward" : "reverse";
+    IPAddress ip = WiFi.localIP();
+    char address[16];
+    snprintf(address, sizeof(address), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    doc["ip"] = address;
+    doc["uptime"] = timebase.uptime();
+    if (timebase.is_synced()) doc["ts"] = timebase.to_epoch_ms(_last_power_us);
+    doc["down"] = IsDown() ? "offline" : "online";
+    doc["busvoltage"] = _busvoltage;
+    doc["shuntvoltage"] = _shuntvoltage;
+    doc["loadvoltage"] = _loadvoltage;
+    doc["power_mW"] = _power_mW;
+    doc["reversecount"] = _ReverseCount;
+    doc["charge_ratio"] = _balance.achieved_ratio();     // lifetime reverse / forward coulombs
+    doc["charge_residual"] = _balance.balance_C();      // C of reverse still owed (< 0) or overpaid
+    if (!isnan(_temperature)) {
+        doc["temperature"] = _temperature;
+        doc["pressure"] = _pressure;
+        if (!isnan(_humidity)) doc["humidity"] = _humidity;
+    }
+
+    // Independent ACS712 reading and PWM ripple, cross-checked against the INA219
+    CurrentBlock acs;
+    if (current_adc.latest(acs)) {
+        doc["acs_current"] = acs.mean_mA;
+        doc["acs_ripple"] = acs.ripple_mA;
+        doc["acs_agree"] = current_adc.agrees_with(_current_mA);
     }
 }
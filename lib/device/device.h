@@ -1,8 +1,38 @@
 #pragma once
-#include <Adafruit_INA219.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "filters.h"
+#include "charge_balance.h"
+#include "ina219_sensor.h"
+
+#define POWER_SAMPLE_INTERVAL 100 // ms between INA219 reads for live views
+#define POWER_RING_SIZE 256       // ~25 s of high-rate samples
+#define FILTER_CURRENT_FC 2.0     // Hz, current low-pass after the spike median
+#define FILTER_BUS_Q 1e-6         // V^2 per sample, how far the supply wanders
+#define FILTER_BUS_R 1e-4         // V^2, bus read noise (4 mV LSB plus ripple)
+#define FILTER_RESISTANCE_FC 0.5  // Hz, resistance low-pass
+#define RESISTANCE_MIN_MA 20.0    // below this the cell counts as off and resistance is NAN
+#define REVERSE_CYCLE_C 600.0     // forward charge between reversals, 10 min at 1 A
+#define REVERSE_FALLBACK_MA 1000.0 // assumed cell current while there are no usable INA219 readings
+#define CHARGE_STALE_MS 2000     // no usable INA219 reading this long and charge is counted on time
+#define CHARGE_SAVE_INTERVAL 600000 // ms between NVS saves of the charge balance mid-phase
+
+// One high-rate INA219 reading
+struct PowerSample {
+    uint64_t us;            // monotonic (timebase) - see Timebase::to_epoch_ms()
+    float current_mA;
+    float busvoltage;
+    float power_mW;
+};
+
+#include "motor.h"
+
+// Per-channel conditioning (see filters.h), applied to every INA219 reading
+typedef FilterChain<RangeGate, MedianFilter<5>, EmaFilter> CurrentFilter;
+typedef FilterChain<RangeGate, MedianFilter<3>, ScalarKalman> BusFilter;
+typedef FilterChain<RangeGate, Biquad> ResistanceFilter;
 
 // Forward declaration
-class MD135;
 class Adafruit_NeoPixel;
 
 class Device {
@@ -13,21 +43,43 @@ class Device {
 
         void setup();
         void loop();
+        void report_online();
         static void message_handler(char *, char *);
         static bool payloadReady;
         static char globalBuf[256];
         void CalculateData();
+        void BuildTelemetry(JsonDocument &);
 
         void update_power();
         void updateLED();
+        void SaveCharge();      // before a deliberate restart
+        void ResumeDrive();     // polarity from the charge balance, speed from the sweep feedforward
         bool IsDown();
         unsigned long _SampleTime = 0;
         unsigned long _LastMillis = 0;
         unsigned long _LastSampleTime = 0;
         float GetAmps() { return _current_mA; };
         int GetMinuteCount() { return _MinuteCount; };
-        MD135* motor; // Motor as pointer - initialized in setup()
-        Adafruit_INA219 ina219; // INA219 sensor - public for diagnostics
+        float GetBusVoltage() { return _busvoltage; };
+        float GetShuntVoltage() { return _shuntvoltage; };
+        float GetLoadVoltage() { return _loadvoltage; };
+        float GetPower() { return _power_mW; };
+        float GetResistance() { return _resistance; };    // NAN while the cell is off
+        float GetTotalmAH() { return _total_mAH; };
+        unsigned int GetReverseCount() { return _ReverseCount; };
+        float GetReverseRatio() { return _balance.ratio(); };     // target reverse / forward charge
+        void SetReverseRatio(float ratio) { _balance.set_ratio(ratio); };
+        const ChargeBalance & GetChargeBalance() { return _balance; };
+        float GetTemperature() { return _temperature; };
+        float GetHumidity() { return _humidity; };
+        float GetPressure() { return _pressure; };
+
+        // high-rate sample ring, indexed by a free-running sequence number
+        uint32_t SampleSeq() { return _sample_seq; };
+        bool GetSample(uint32_t seq, PowerSample &sample);
+        uint32_t RejectedReadings() { return _current_filter.first().rejected() + _bus_filter.first().rejected(); };
+        float FilterCost_us(int rounds);  // per reading, all three channels, on copies of the live filters
+        Motor* motor; // Motor as pointer - initialized in setup()
         Adafruit_NeoPixel* pixel; // NeoPixel RGB LED
     private:
         float _resistance = 0.0;
@@ -43,9 +95,24 @@ class Device {
         float _total_mAH = 0.0;
         bool _direction = true; // true for forward, false for reverse
         unsigned int _MinuteCount = 0;
-        float _ReverseRatio = 0.1;
         unsigned int _ReverseCount = 0;
-        unsigned long _last_power_update = 0;  // Track time between measurements
+        ChargeBalance _balance = ChargeBalance(REVERSE_CYCLE_C, 0.1);
+        unsigned long _charge_saved = 0;
+        uint64_t _last_power_us = 0;           // Track time between measurements
+        uint64_t _charge_us = 0;               // charge counted up to here, by reading or by fallback
+        uint32_t _reading_seq = 0;             // last INA219 reading consumed
+        float _temperature = NAN;              // BME280, NAN when not fitted
+        float _humidity = NAN;
+        float _pressure = NAN;
+        CurrentFilter _current_filter = CurrentFilter(
+            RangeGate(-INA219_MAX_CURRENT * 1000, INA219_MAX_CURRENT * 1000), {},
+            EmaFilter::cutoff(1000.0f / POWER_SAMPLE_INTERVAL, FILTER_CURRENT_FC));
+        BusFilter _bus_filter = BusFilter(RangeGate(0, 32), {}, ScalarKalman(FILTER_BUS_Q, FILTER_BUS_R));
+        ResistanceFilter _resistance_filter = ResistanceFilter(
+            RangeGate(0, 1e6), Biquad::lowpass(1000.0f / POWER_SAMPLE_INTERVAL, FILTER_RESISTANCE_FC));
+        void _step_charge(float current_mA, float seconds);
+        PowerSample _samples[POWER_RING_SIZE];
+        volatile uint32_t _sample_seq = 0;
 };
 
 
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// Signal conditioning for the sensor channels. Each stage is a small value
+// type with step() and reset(); FilterChain strings stages together at
+// compile time, so a channel is one object with no virtual calls and no
+// heap. Kept free of Arduino and IDF headers so the stages can be checked
+// off-target.
+//
+// NAN means "no valid value": a gate or a derived quantity returns it, and
+// the chain stops there without touching the later stages' state, so one
+// rejected read neither reaches the output nor disturbs the filters.
+
+
+// Drops non-finite reads and anything outside [lo, hi]
+class RangeGate {
+
+    public:
+
+        RangeGate(float lo, float hi) : _lo(lo), _hi(hi) {}
+
+        float step(float x) {
+            if (isfinite(x) && x >= _lo && x <= _hi) return x;
+            _rejected++;
+            return NAN;
+        }
+        void reset() {}
+        uint32_t rejected() const { return _rejected; }
+
+    private:
+
+        float _lo;
+        float _hi;
+        uint32_t _rejected = 0;
+
+};
+
+
+// Median of the last N values: a single spike never reaches the output, and
+// a step passes through after (N + 1) / 2 samples undistorted
+template <uint8_t N>
+class MedianFilter {
+
+    static_assert(N >= 3 && N % 2 == 1 && N <= 15, "median window must be odd, 3..15");
+
+    public:
+
+        float step(float x) {
+            _window[_next] = x;
+            _next = (_next + 1) % N;
+            if (_count < N) _count++;
+
+            // Insertion sort of a copy; N is tiny
+            float sorted[N];
+            for (uint8_t i = 0; i < _count; i++) {
+                float v = _window[i];
+                uint8_t j = i;
+                for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+                sorted[j] = v;
+            }
+            return _count % 2 ? sorted[_count / 2] : (sorted[_count / 2 - 1] + sorted[_count / 2]) / 2;
+        }
+        void reset() { _count = _next = 0; }
+
+    private:
+
+        float _window[N];
+        uint8_t _count = 0;
+        uint8_t _next = 0;
+
+};
+
+
+// First-order low-pass, y += alpha * (x - y); starts at the first value.
+// alpha = 1 - exp(-2 pi fc / fs) puts the -3 dB point near fc
+class EmaFilter {
+
+    public:
+
+        explicit EmaFilter(float alpha) : _alpha(alpha) {}
+
+        static EmaFilter cutoff(float fs_hz, float fc_hz) {
+            return EmaFilter(1.0f - expf(-2.0f * (float) M_PI * fc_hz / fs_hz));
+        }
+
+        float step(float x) {
+            _y = _primed ? _y + _alpha * (x - _y) : x;
+            _primed = true;
+            return _y;
+        }
+        void reset() { _primed = false; }
+
+    private:
+
+        float _alpha;
+        float _y = 0;
+        bool _primed = false;
+
+};
+
+
+// Second-order section, transposed direct form II. lowpass() is the
+// RBJ cookbook design; q = 0.7071 is Butterworth, flat to fc then -12 dB
+// an octave. The state starts settled at the first value, so there is no
+// start-up transient from zero
+class Biquad {
+
+    public:
+
+        Biquad(float b0, float b1, float b2, float a1, float a2)
+            : _b0(b0), _b1(b1), _b2(b2), _a1(a1), _a2(a2) {}
+
+        static Biquad lowpass(float fs_hz, float fc_hz, float q = 0.7071f) {
+            float w = 2.0f * (float) M_PI * fc_hz / fs_hz;
+            float alpha = sinf(w) / (2.0f * q);
+            float c = cosf(w);
+            float a0 = 1.0f + alpha;
+            return Biquad((1.0f - c) / 2 / a0, (1.0f - c) / a0, (1.0f - c) / 2 / a0,
+                          -2.0f * c / a0, (1.0f - alpha) / a0);
+        }
+
+        float step(float x) {
+            if (!_primed) {
+                // Steady state for a constant x at unity DC gain
+                _z1 = (1.0f - _b0) * x;
+                _z2 = (_b2 - _a2) * x;
+                _primed = true;
+            }
+            float y = _b0 * x + _z1;
+            _z1 = _b1 * x - _a1 * y + _z2;
+            _z2 = _b2 * x - _a2 * y;
+            return y;
+        }
+        void reset() { _primed = false; }
+
+    private:
+
+        float _b0, _b1, _b2, _a1, _a2;
+        float _z1 = 0;
+        float _z2 = 0;
+        bool _primed = false;
+
+};
+
+
+// Kalman filter for a slowly wandering scalar (random walk): q is the
+// process variance per step, r the measurement variance. The gain settles
+// to a constant, so in steady state this is an EMA whose alpha follows
+// from the noise figures rather than a guess
+class ScalarKalman {
+
+    public:
+
+        ScalarKalman(float q, float r) : _q(q), _r(r) {}
+
+        float step(float z) {
+            if (!_primed) {
+                _x = z;
+                _p = _r;
+                _primed = true;
+                return _x;
+            }
+            _p += _q;
+            float k = _p / (_p + _r);
+            _x += k * (z - _x);
+            _p *= 1.0f - k;
+            return _x;
+        }
+        void reset() { _primed = false; }
+        float variance() const { return _p; }
+
+    private:
+
+        float _q;
+        float _r;
+        float _x = 0;
+        float _p = 0;
+        bool _primed = false;
+
+};
+
+
+// Stages applied left to right, e.g.
+//   FilterChain<RangeGate, MedianFilter<5>, EmaFilter> current{RangeGate(-3200, 3200), {}, EmaFilter(0.3f)};
+template <class... Stages>
+class FilterChain;
+
+template <>
+class FilterChain<> {
+
+    public:
+
+        float step(float x) { return x; }
+        void reset() {}
+
+};
+
+template <class Stage, class... Rest>
+class FilterChain<Stage, Rest...> {
+
+    public:
+
+        FilterChain(const Stage & stage, const Rest &... rest) : _stage(stage), _rest(rest...) {}
+
+        float step(float x) {
+            float y = _stage.step(x);
+            return isnan(y) ? y : _rest.step(y);
+        }
+        void reset() {
+            _stage.reset();
+            _rest.reset();
+        }
+        Stage & first() { return _stage; }
+
+    private:
+
+        Stage _stage;
+        FilterChain<Rest...> _rest;
+
+};
+
+
+// num / den for a derived quantity, NAN when den is too small to mean
+// anything (cell off, sensor at its noise floor) or either side is invalid
+inline float guarded_ratio(float num, float den, float min_den) {
+    if (!isfinite(num) || !isfinite(den) || fabsf(den) < min_den) return NAN;
+    return num / den;
+}
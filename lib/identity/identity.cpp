@@ -0,0 +1,69 @@
+#include "identity.h"
+#include "storage.h"
+#include <esp_system.h>
+
+Identity identity;
+
+
+void Identity::begin(const char * default_name) {
+
+    uint8_t mac[6];
+    esp_efuse_mac_get_default(mac);
+    snprintf(_mac, sizeof(_mac), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(_client_id, sizeof(_client_id), "%s%s", CLIENT_ID_PREFIX, _mac);
+
+    // FNV-1a over the MAC - spreads neighbouring serial numbers across the period
+    _hash = 2166136261u;
+    for (int i = 0; i < 6; i++) _hash = (_hash ^ mac[i]) * 16777619u;
+
+    char stored[DEVICE_NAME_MAX + 1];
+    if (storage.load_blob("identity", "name", stored, sizeof(stored))) {
+        stored[DEVICE_NAME_MAX] = '\0';
+        _named = _sanitize(stored, _id);
+    }
+    if (!_named && default_name) _named = _sanitize(default_name, _id);
+    if (!_named) strlcpy(_id, _mac, sizeof(_id));
+
+    Serial.printf("\tIdentity: %s (client %s)\n", _id, _client_id);
+}
+
+
+bool Identity::set_name(const char * name) {
+    char clean[DEVICE_NAME_MAX + 1] = {};
+    if (!_sanitize(name, clean)) return false;
+    storage.store_blob("identity", "name", clean, sizeof(clean));
+    return true;
+}
+
+
+void Identity::clear_name() {
+    storage.clear_blob("identity", "name");
+}
+
+
+uint32_t Identity::slot(uint32_t period_ms) {
+    return period_ms ? _hash % period_ms : 0;
+}
+
+
+unsigned long Identity::slot_start(unsigned long now, uint32_t period_ms) {
+    return period_ms ? now - (now + period_ms - slot(period_ms)) % period_ms : now;
+}
+
+
+uint32_t Identity::jitter(uint32_t max_ms) {
+    return max_ms ? esp_random() % max_ms : 0;
+}
+
+
+// Lowercase, [a-z0-9_-] only; false if nothing usable is left
+bool Identity::_sanitize(const char * in, char * out) {
+    size_t len = 0;
+    for (; *in && len < DEVICE_NAME_MAX; in++) {
+        char c = tolower((unsigned char) *in);
+        if (isalnum((unsigned char) c) || c == '-' || c == '_') out[len++] = c;
+        else if (c == ' ' || c == '.') out[len++] = '-';
+    }
+    out[len] = '\0';
+    return len > 0 && strcmp(out, "all") != 0;     // "all" is the fleet-wide prefix
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define DEVICE_NAME_MAX 24          // configured names are cut to this
+#define CLIENT_ID_PREFIX "filterchlorine-"
+
+/**
+ * Who this unit is on a shared broker.
+ *
+ * The MQTT client ID is always derived from the factory MAC, so two units
+ * can never take each other's session. The topic id is the configured
+ * name when there is one (NVS, set with the telnet "name" command, or
+ * DEVICE_NAME at build time) and the MAC otherwise - e.g. "pool" or
+ * "a0b1c2d3e4f5". Names are lowercased and limited to [a-z0-9_-] so they
+ * are always a single, wildcard-safe topic level.
+ *
+ * slot() gives each unit a fixed phase within a period, so periodic
+ * publishes from a fleet that rebooted together (power cut) don't land on
+ * the broker at the same instant. A timer reset to slot_start() instead of
+ * now stays in its slot however late the loop gets to it.
+ */
+class Identity {
+
+    public:
+
+        void begin(const char * default_name);     // main task, before topics.begin()
+
+        const char * id() { return _id; }
+        const char * client_id() { return _client_id; }
+        const char * mac() { return _mac; }
+        bool is_named() { return _named; }
+
+        // Takes effect at the next boot, when the topics are rebuilt
+        bool set_name(const char *);
+        void clear_name();
+
+        uint32_t slot(uint32_t period_ms);          // 0 .. period - 1, stable per unit
+        unsigned long slot_start(unsigned long now, uint32_t period_ms);   // latest slot boundary <= now
+        uint32_t jitter(uint32_t max_ms);           // 0 .. max - 1, random each call
+
+    private:
+
+        char _id[DEVICE_NAME_MAX + 1];
+        char _client_id[sizeof(CLIENT_ID_PREFIX) + 12];
+        char _mac[13];
+        bool _named = false;
+        uint32_t _hash = 0;
+
+        static bool _sanitize(const char * in, char * out);
+
+};
+
+extern Identity identity;
@@ -0,0 +1,45 @@
+#include "topics.h"
+
+// Paths under the unit's prefix, in Topic order
+static const char *const TOPIC_PATHS[TOPIC_COUNT] = {
+    "status", "identity", "ota/state", "ota/progress", "cmd", "rpc/req", "rpc/resp", "schema/keys",
+    "sensors", "diag/link", "diag/connect", "diag/boot", "diag/memory", "diag/memory/alarm",
+    "diag/memory/allocs",
+    "cmd",
+};
+
+Topics topics;
+
+
+void Topics::begin(const char * id) {
+    _used = 0;
+    _arena[sizeof(_arena) - 1] = '\0';
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+        const char * prefix = t == TOPIC_FLEET_COMMAND ? "all" : id;
+        _offsets[t][TELEMETRY_JSON] = _add(prefix, TOPIC_PATHS[t], "");
+        for (int e = TELEMETRY_JSON + 1; e < TELEMETRY_ENCODING_COUNT; e++) {
+            bool encoded = t >= TOPIC_SENSORS && t <= TOPIC_DIAG_MEMORY_ALLOCS;
+            _offsets[t][e] = encoded ? _add(prefix, TOPIC_PATHS[t], Telemetry::suffix((TelemetryEncoding) e))
+                                     : _offsets[t][TELEMETRY_JSON];
+        }
+    }
+    Serial.printf("\tTopics: %s/%s/..., %u bytes\n", TOPIC_ROOT, id, (unsigned) _used);
+}
+
+
+// Offset of the new string. The arena's last byte stays '\0', and a topic
+// that doesn't fit points there
+uint16_t Topics::_add(const char * id, const char * path, const char * suffix) {
+    size_t room = sizeof(_arena) - 1 - _used;
+    int len = snprintf(_arena + _used, room, "%s/%s/%s%s", TOPIC_ROOT, id, path, suffix);
+    if (len < 0 || (size_t) len >= room) return sizeof(_arena) - 1;
+    uint16_t offset = _used;
+    _used += len + 1;
+    return offset;
+}
+
+
+const char * Topics::get(Topic topic, TelemetryEncoding encoding) {
+    if (topic >= TOPIC_COUNT || encoding >= TELEMETRY_ENCODING_COUNT) return "";
+    return _arena + _offsets[topic][encoding];
+}
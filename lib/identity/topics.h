@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+#define TOPIC_ROOT "filterchlorine"
+#define TOPIC_ARENA_SIZE 1792       // every topic and encoding variant, built once; ~1620 at a 24-char id
+
+enum Topic : uint8_t {
+    // filterchlorine/<id>/...
+    TOPIC_STATUS,               // online/offline, retained, offline is the last will
+    TOPIC_IDENTITY,             // retained id, name, MAC and client id
+    TOPIC_OTA_STATE,
+    TOPIC_OTA_PROGRESS,         // JSON state and byte counts while an update runs
+    TOPIC_COMMAND,              // subscribed
+    TOPIC_RPC_REQUEST,          // subscribed, see rpc.h
+    TOPIC_RPC_RESPONSE,
+    TOPIC_SCHEMA,               // retained CBOR key table
+    TOPIC_SENSORS,              // telemetry topics from here on get /cbor and /msgpack variants
+    TOPIC_DIAG_LINK,
+    TOPIC_DIAG_CONNECT,
+    TOPIC_DIAG_BOOT,
+    TOPIC_DIAG_MEMORY,
+    TOPIC_DIAG_MEMORY_ALARM,
+    TOPIC_DIAG_MEMORY_ALLOCS,   // memdebug build only
+    // filterchlorine/all/...
+    TOPIC_FLEET_COMMAND,        // subscribed, every unit acts on it
+    TOPIC_COUNT
+};
+
+/**
+ * All MQTT topic strings, formatted once at boot into a fixed arena so a
+ * publish never builds a topic. Units publish under filterchlorine/<id>/,
+ * so filterchlorine/+/sensors covers a whole fleet.
+ */
+class Topics {
+
+    public:
+
+        void begin(const char * id);
+
+        const char * get(Topic topic) { return get(topic, TELEMETRY_JSON); }
+        const char * get(Topic, TelemetryEncoding);
+        size_t arena_used() { return _used; }
+
+    private:
+
+        char _arena[TOPIC_ARENA_SIZE];
+        uint16_t _offsets[TOPIC_COUNT][TELEMETRY_ENCODING_COUNT];
+        size_t _used = 0;
+
+        uint16_t _add(const char * id, const char * path, const char * suffix);
+
+};
+
+extern Topics topics;
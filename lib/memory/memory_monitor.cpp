@@ -0,0 +1,272 @@
+#include "memory_monitor.h"
+#include "telemetry.h"
+#include "topics.h"
+#include "identity.h"
+#include "timebase.h"
+#include "../telnet/telnet.h"
+#include <esp_heap_caps.h>
+
+#define MEMORY_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+
+static const char *const SUBSYSTEM_NAMES[MEM_SUBSYSTEM_COUNT] = {
+    "other", "main", "ota", "network", "mqtt", "telnet", "webapi", "device", "sensors", "timer"
+};
+
+// Written from the malloc wrappers on every task, so only touched atomically
+static MemoryCounts alloc_counts[MEM_SUBSYSTEM_COUNT];
+
+MemoryMonitor memory_monitor;
+
+
+void MemoryMonitor::begin() {
+    _main_task = xTaskGetCurrentTaskHandle();
+    heap_caps_register_failed_alloc_callback(_failed_alloc);
+
+    // Tasks that live for the whole run; the ones not started yet are
+    // picked up by a later sample
+    _add_task("loopTask", MEM_MAIN);
+    _add_task("i2c_bus", MEM_SENSORS);
+    _add_task("acs712", MEM_SENSORS);
+    _add_task("ota", MEM_OTA);
+    _add_task("esp_timer", MEM_TIMER);
+    _add_task("tiT", MEM_NETWORK);
+    _add_task("wifi", MEM_NETWORK);
+    _add_task("sys_evt", MEM_NETWORK);
+    _add_task("arduino_events", MEM_NETWORK);
+
+    _sample();
+#ifdef MEMORY_MALLOC_HOOKS
+    Serial.printf("\tMemory: %u bytes free, allocation hooks on\n", _free);
+#else
+    Serial.printf("\tMemory: %u bytes free\n", _free);
+#endif
+}
+
+
+void MemoryMonitor::_add_task(const char * name, MemorySubsystem subsystem) {
+    if (_task_count >= MEMORY_MAX_TASKS) return;
+    _tasks[_task_count++] = {name, subsystem, nullptr, 0};
+}
+
+
+void MemoryMonitor::loop() {
+    unsigned long now = millis();
+    if (now - _sample_timer >= MEMORY_SAMPLE_INTERVAL) {
+        _sample_timer = now;
+        _sample();
+        _check_alarms();
+    }
+    if (now - _publish_timer >= MEMORY_PUBLISH_INTERVAL) {
+        _publish_timer = identity.slot_start(now, MEMORY_PUBLISH_INTERVAL);
+        publish();
+    }
+}
+
+
+void MemoryMonitor::_sample() {
+    _free = heap_caps_get_free_size(MEMORY_CAPS);
+    _min_free = heap_caps_get_minimum_free_size(MEMORY_CAPS);
+    _largest = heap_caps_get_largest_free_block(MEMORY_CAPS);
+    _fragmentation = _free ? 100 - (uint64_t) _largest * 100 / _free : 0;
+
+    // High-water marks are in bytes on the ESP32 (StackType_t is a byte)
+    for (int i = 0; i < _task_count; i++) {
+        TaskHandle_t handle = __atomic_load_n(&_tasks[i].handle, __ATOMIC_ACQUIRE);
+        if (!handle) {
+            handle = xTaskGetHandle(_tasks[i].name);
+            if (handle) __atomic_store_n(&_tasks[i].handle, handle, __ATOMIC_RELEASE);
+        }
+        if (handle) _tasks[i].headroom = uxTaskGetStackHighWaterMark(handle);
+    }
+}
+
+
+void MemoryMonitor::_check_alarms() {
+
+    _update(MEM_ALARM_HEAP_LOW, _free < MEMORY_FREE_ALARM, _free >= MEMORY_FREE_ALARM * 5 / 4, _free);
+    _update(MEM_ALARM_FRAGMENTED, _fragmentation > MEMORY_FRAG_ALARM,
+            _fragmentation <= MEMORY_FRAG_ALARM - 10, _fragmentation);
+
+    // A high-water mark never recovers, so this one stays raised
+    int lowest = -1;
+    for (int i = 0; i < _task_count; i++) {
+        if (!_tasks[i].handle) continue;
+        if (lowest < 0 || _tasks[i].headroom < _tasks[lowest].headroom) lowest = i;
+    }
+    if (lowest >= 0) {
+        _update(MEM_ALARM_STACK_LOW, _tasks[lowest].headroom < MEMORY_STACK_ALARM, false,
+                _tasks[lowest].headroom, _tasks[lowest].name);
+    }
+
+    // Raised for the sample period that saw new failures
+    uint32_t failures = _failures;
+    _update(MEM_ALARM_ALLOC_FAILED, failures != _failures_seen, failures == _failures_seen, _failed_size);
+    _failures_seen = failures;
+}
+
+
+void MemoryMonitor::_update(MemoryAlarm alarm, bool raise, bool clear, uint32_t value, const char * task) {
+
+    bool active = _alarms & alarm;
+    if (active ? !clear : !raise) return;
+    active = !active;
+    if (active) _alarms |= alarm;
+    else _alarms &= ~alarm;
+
+    char line[96];
+    snprintf(line, sizeof(line), "\tMemory alarm %s %s: %lu%s%s", alarm_name(alarm),
+             active ? "raised" : "cleared", (unsigned long) value, task ? " in " : "", task ? task : "");
+    telnet.println(line);
+
+    JsonDocument doc;
+    doc["alarm"] = alarm_name(alarm);
+    doc["active"] = active;
+    doc["value"] = value;
+    if (task) doc["task"] = task;
+    doc["ts"] = timebase.epoch_ms();
+    telemetry.publish(TOPIC_DIAG_MEMORY_ALARM, doc);
+}
+
+
+void MemoryMonitor::publish() {
+
+    JsonDocument doc;
+    doc["heap_free"] = _free;
+    doc["heap_min"] = _min_free;
+    doc["heap_block"] = _largest;
+    doc["heap_frag"] = _fragmentation;
+    doc["alloc_fail"] = (uint32_t) _failures;
+    JsonArray alarms = doc["alarms"].to<JsonArray>();
+    for (uint8_t bit = 1; bit && bit <= MEM_ALARM_ALLOC_FAILED; bit <<= 1) {
+        if (_alarms & bit) alarms.add(alarm_name((MemoryAlarm) bit));
+    }
+
+    JsonObject stacks = doc["stacks"].to<JsonObject>();
+    for (int i = 0; i < _task_count; i++) {
+        if (_tasks[i].handle) stacks[_tasks[i].name] = _tasks[i].headroom;
+    }
+    uint64_t ts = timebase.epoch_ms();
+    doc["ts"] = ts;
+    telemetry.publish(TOPIC_DIAG_MEMORY, doc);
+
+    // [allocations, frees, bytes allocated] per subsystem that allocated at
+    // all, on their own topic: ten subsystems at full 32-bit counts are
+    // ~470 bytes of JSON, which with the figures above went over
+    // TELEMETRY_PAYLOAD_MAX. Nothing to send without the hooks
+    JsonDocument hooks;
+    JsonObject allocs = hooks["allocs"].to<JsonObject>();
+    MemoryCounts c;
+    for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        if (!counts((MemorySubsystem) i, c) || !c.allocs) continue;
+        JsonArray entry = allocs[SUBSYSTEM_NAMES[i]].to<JsonArray>();
+        entry.add(c.allocs);
+        entry.add(c.frees);
+        entry.add(c.bytes);
+    }
+    if (allocs.size() == 0) return;
+    hooks["ts"] = ts;
+    telemetry.publish(TOPIC_DIAG_MEMORY_ALLOCS, hooks);
+}
+
+
+const char * MemoryMonitor::subsystem_name(MemorySubsystem subsystem) {
+    return subsystem < MEM_SUBSYSTEM_COUNT ? SUBSYSTEM_NAMES[subsystem] : "?";
+}
+
+
+const char * MemoryMonitor::alarm_name(MemoryAlarm alarm) {
+    switch (alarm) {
+        case MEM_ALARM_HEAP_LOW: return "heap_low";
+        case MEM_ALARM_FRAGMENTED: return "fragmented";
+        case MEM_ALARM_STACK_LOW: return "stack_low";
+        case MEM_ALARM_ALLOC_FAILED: return "alloc_failed";
+    }
+    return "?";
+}
+
+
+bool MemoryMonitor::counts(MemorySubsystem subsystem, MemoryCounts & out) {
+    if (subsystem >= MEM_SUBSYSTEM_COUNT) return false;
+    out.allocs = __atomic_load_n(&alloc_counts[subsystem].allocs, __ATOMIC_RELAXED);
+    out.frees = __atomic_load_n(&alloc_counts[subsystem].frees, __ATOMIC_RELAXED);
+    out.bytes = __atomic_load_n(&alloc_counts[subsystem].bytes, __ATOMIC_RELAXED);
+    return true;
+}
+
+
+bool MemoryMonitor::task_stack(int index, MemoryTaskStack & out) {
+    if (index < 0 || index >= _task_count || !_tasks[index].handle) return false;
+    out.name = _tasks[index].name;
+    out.headroom = _tasks[index].headroom;
+    return true;
+}
+
+
+// _scope is only read here on the main task, the one task that writes it.
+// Before the scheduler runs (and before begin()) everything is "other"
+MemorySubsystem IRAM_ATTR MemoryMonitor::current_subsystem() {
+    if (!_main_task || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) return MEM_OTHER;
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task == _main_task) return _scope;
+    for (int i = 0; i < _task_count; i++) {
+        if (__atomic_load_n(&_tasks[i].handle, __ATOMIC_ACQUIRE) == task) return _tasks[i].subsystem;
+    }
+    return MEM_OTHER;
+}
+
+
+// Whichever task's allocation failed - count it and leave the rest to _check_alarms()
+void MemoryMonitor::_failed_alloc(size_t size, uint32_t, const char *) {
+    memory_monitor._failed_size = size;
+    __atomic_fetch_add(&memory_monitor._failures, 1, __ATOMIC_RELAXED);
+}
+
+
+#ifdef MEMORY_MALLOC_HOOKS
+
+// -Wl,--wrap=malloc etc. route every C heap call in the image through here
+extern "C" {
+
+void * __real_malloc(size_t);
+void * __real_calloc(size_t, size_t);
+void * __real_realloc(void *, size_t);
+void __real_free(void *);
+
+static inline void IRAM_ATTR count_alloc(size_t size) {
+    MemoryCounts & c = alloc_counts[memory_monitor.current_subsystem()];
+    __atomic_fetch_add(&c.allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c.bytes, size, __ATOMIC_RELAXED);
+}
+
+static inline void IRAM_ATTR count_free() {
+    __atomic_fetch_add(&alloc_counts[memory_monitor.current_subsystem()].frees, 1, __ATOMIC_RELAXED);
+}
+
+void * IRAM_ATTR __wrap_malloc(size_t size) {
+    void * p = __real_malloc(size);
+    if (p) count_alloc(size);
+    return p;
+}
+
+void * IRAM_ATTR __wrap_calloc(size_t n, size_t size) {
+    void * p = __real_calloc(n, size);
+    if (p) count_alloc(n * size);
+    return p;
+}
+
+// A resize counts as a new allocation of the new size; realloc(p, 0) is a free
+void * IRAM_ATTR __wrap_realloc(void * ptr, size_t size) {
+    void * p = __real_realloc(ptr, size);
+    if (p && size) count_alloc(size);
+    else if (ptr && !size) count_free();
+    return p;
+}
+
+void IRAM_ATTR __wrap_free(void * ptr) {
+    if (ptr) count_free();
+    __real_free(ptr);
+}
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define MEMORY_SAMPLE_INTERVAL 5000     // heap and stack sampling
+#define MEMORY_PUBLISH_INTERVAL 60000   // stats on filterchlorine/<id>/diag/memory
+#define MEMORY_FREE_ALARM 24576         // free heap below this raises heap_low
+#define MEMORY_FRAG_ALARM 60            // % of free heap not in the largest block
+#define MEMORY_STACK_ALARM 512          // bytes of stack never touched, per task
+#define MEMORY_MAX_TASKS 10
+
+// Where an allocation is counted. Other tasks are mapped by name; on the
+// main loop task the subsystem is whatever MemoryScope says is running
+enum MemorySubsystem : uint8_t {
+    MEM_OTHER, MEM_MAIN, MEM_OTA, MEM_NETWORK, MEM_MQTT, MEM_TELNET, MEM_WEBAPI,
+    MEM_DEVICE, MEM_SENSORS, MEM_TIMER,
+    MEM_SUBSYSTEM_COUNT
+};
+
+enum MemoryAlarm : uint8_t {
+    MEM_ALARM_HEAP_LOW = 1,
+    MEM_ALARM_FRAGMENTED = 2,
+    MEM_ALARM_STACK_LOW = 4,
+    MEM_ALARM_ALLOC_FAILED = 8,
+};
+
+struct MemoryCounts {
+    uint32_t allocs;            // malloc/calloc/realloc/new
+    uint32_t frees;
+    uint32_t bytes;             // requested, cumulative
+};
+
+struct MemoryTaskStack {
+    const char * name;
+    uint32_t headroom;          // bytes never used
+};
+
+/**
+ * Heap and stack observability.
+ *
+ * Heap figures (internal 8-bit capable RAM) and per-task stack high-water
+ * marks are sampled from the main loop. Fragmentation is the share of free
+ * heap that isn't in the largest free block - a 40 KB heap whose biggest
+ * block is 4 KB can't hold an 8 KB TLS record.
+ *
+ * In the memdebug build (MEMORY_MALLOC_HOOKS defined and malloc/calloc/
+ * realloc/free wrapped by the linker, see platformio.ini) every allocation
+ * through the C heap -
+ * including operator new, String and ArduinoJson - is counted against the
+ * subsystem that made it. Allocations drivers make with heap_caps_malloc()
+ * directly (the WiFi blobs) bypass the hooks; failures are caught from
+ * every path through the IDF failed-allocation callback. The counts go out
+ * on filterchlorine/<id>/diag/memory/allocs.
+ *
+ * Alarms are raised when a threshold is crossed and cleared with some
+ * hysteresis, each edge logged to telnet and published on
+ * filterchlorine/<id>/diag/memory/alarm.
+ */
+class MemoryMonitor {
+
+    public:
+
+        void begin();           // from setup(), on the main loop task
+        void loop();
+        void publish();
+
+        uint32_t free_heap() { return _free; }
+        uint32_t min_free_heap() { return _min_free; }
+        uint32_t largest_block() { return _largest; }
+        uint8_t fragmentation() { return _fragmentation; }     // %
+        uint32_t alloc_failures() { return _failures; }
+        uint32_t last_failed_size() { return _failed_size; }
+        uint8_t alarms() { return _alarms; }
+
+        static const char * subsystem_name(MemorySubsystem);
+        static const char * alarm_name(MemoryAlarm);
+        bool counts(MemorySubsystem, MemoryCounts &);
+        int task_count() { return _task_count; }
+        bool task_stack(int index, MemoryTaskStack &);
+
+        // Called from the malloc wrappers, on any task
+        MemorySubsystem current_subsystem();
+
+    private:
+
+        friend class MemoryScope;
+
+        struct Task {
+            const char * name;
+            MemorySubsystem subsystem;
+            TaskHandle_t handle;
+            uint32_t headroom;
+        };
+
+        // Names and subsystems are fixed in begin(); a handle is filled in
+        // once by _sample() and read by the wrappers, so only atomically
+        Task _tasks[MEMORY_MAX_TASKS];
+        int _task_count = 0;
+        TaskHandle_t _main_task = nullptr;
+        MemorySubsystem _scope = MEM_MAIN;      // main loop task only
+
+        uint32_t _free = 0;
+        uint32_t _min_free = 0;
+        uint32_t _largest = 0;
+        uint8_t _fragmentation = 0;
+        volatile uint32_t _failures = 0;
+        volatile uint32_t _failed_size = 0;
+        uint32_t _failures_seen = 0;
+        uint8_t _alarms = 0;
+
+        unsigned long _sample_timer = 0;
+        unsigned long _publish_timer = 0;
+
+        void _add_task(const char *, MemorySubsystem);
+        void _sample();
+        void _check_alarms();
+        void _update(MemoryAlarm, bool raise, bool clear, uint32_t value, const char * task = nullptr);
+        static void _failed_alloc(size_t, uint32_t, const char *);
+
+};
+
+extern MemoryMonitor memory_monitor;
+
+
+// Counts main-loop allocations against a subsystem while in scope
+class MemoryScope {
+
+    public:
+
+        MemoryScope(MemorySubsystem subsystem) : _previous(memory_monitor._scope) {
+            memory_monitor._scope = subsystem;
+        }
+        ~MemoryScope() { memory_monitor._scope = _previous; }
+
+    private:
+
+        MemorySubsystem _previous;
+
+};
@@ -0,0 +1,96 @@
+#include "metrics.h"
+
+Metric * Metric::_head = nullptr;
+
+Metric::Metric(const char * name, const char * help, const char * type)
+    : _name(name), _help(help), _type(type), _next(nullptr) {
+    // Append so the page keeps declaration order
+    Metric ** tail = &_head;
+    while (*tail) tail = &(*tail)->_next;
+    *tail = this;
+}
+
+
+void Metric::render_all(Print & out) {
+    for (const Metric * m = _head; m; m = m->_next) {
+        out.printf("# TYPE %s %s\n# HELP %s %s\n", m->_name, m->_type, m->_name, m->_help);
+        m->_render_samples(out);
+    }
+    out.print("# EOF\n");
+}
+
+
+void Metric::_print_value(Print & out, float value) {
+    if (isnan(value)) out.print(" NaN\n");
+    else if (isinf(value)) out.print(value > 0 ? " +Inf\n" : " -Inf\n");
+    else out.printf(" %.6g\n", value);
+}
+
+
+void Metric::_print_label(Print & out, const char * name, const char * value) {
+    out.printf("{%s=\"", name);
+    for (const char * c = value; *c; c++) {
+        if (*c == '\\' || *c == '"') out.write((uint8_t) '\\');
+        if (*c == '\n') out.print("\\n");
+        else out.write((uint8_t) *c);
+    }
+    out.print("\"}");
+}
+
+
+void Gauge::_render_samples(Print & out) const {
+    out.print(_name);
+    _print_value(out, _read());
+}
+
+
+void Counter::_render_samples(Print & out) const {
+    out.printf("%s_total %llu\n", _name, (unsigned long long) _read());
+}
+
+
+void LabeledCounter::_render_samples(Print & out) const {
+    const char * label;
+    uint64_t value;
+    for (int i = 0; _read(i, label, value); i++) {
+        if (!label) continue;
+        out.printf("%s_total", _name);
+        _print_label(out, _label_name, label);
+        out.printf(" %llu\n", (unsigned long long) value);
+    }
+}
+
+
+void LabeledGauge::_render_samples(Print & out) const {
+    const char * label;
+    float value;
+    for (int i = 0; _read(i, label, value); i++) {
+        if (!label) continue;
+        out.print(_name);
+        _print_label(out, _label_name, label);
+        _print_value(out, value);
+    }
+}
+
+
+void Histogram::observe(uint32_t micro) {
+    uint8_t i = 0;
+    while (i < _count && micro > _bounds[i]) i++;
+    _buckets[i]++;
+    _sum += micro;
+    _total++;
+}
+
+
+// Buckets are stored per-bin and made cumulative on the way out
+void Histogram::_render_samples(Print & out) const {
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        cumulative += _buckets[i];
+        out.printf("%s_bucket{le=\"%g\"} %lu\n", _name, _bounds[i] / 1e6, (unsigned long) cumulative);
+    }
+    cumulative += _buckets[_count];
+    out.printf("%s_bucket{le=\"+Inf\"} %lu\n", _name, (unsigned long) cumulative);
+    out.printf("%s_count %lu\n", _name, (unsigned long) _total);
+    out.printf("%s_sum %.6f\n", _name, _sum / 1e6);
+}
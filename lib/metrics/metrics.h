@@ -0,0 +1,153 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Static metric registry rendered in OpenMetrics text format.
+//
+// Every metric is a statically allocated object that links itself into the
+// registry when constructed. Gauges and counters read their value from the
+// owning module on demand, so modules don't depend on this one; histograms
+// are fed by the code being measured. render() streams straight into a Print
+// (the HTTP response), so the page is never built in RAM.
+
+class Metric {
+
+    public:
+
+        Metric(const char * name, const char * help, const char * type);
+        virtual ~Metric() {}
+
+        static void render_all(Print &);
+
+    protected:
+
+        const char * _name;
+        const char * _help;
+        const char * _type;
+
+        virtual void _render_samples(Print &) const = 0;
+
+        // Value in the exposition syntax (NaN, +Inf, -Inf spelled out)
+        static void _print_value(Print &, float);
+        // {name="value"} with the value's \, " and newlines escaped
+        static void _print_label(Print &, const char * name, const char * value);
+
+    private:
+
+        Metric * _next;
+        static Metric * _head;
+
+};
+
+
+class Gauge : public Metric {
+
+    public:
+
+        using Reader = float (*)();
+        Gauge(const char * name, const char * help, Reader read)
+            : Metric(name, help, "gauge"), _read(read) {}
+
+    protected:
+
+        void _render_samples(Print &) const override;
+
+    private:
+
+        Reader _read;
+
+};
+
+
+class Counter : public Metric {
+
+    public:
+
+        using Reader = uint64_t (*)();
+        Counter(const char * name, const char * help, Reader read)
+            : Metric(name, help, "counter"), _read(read) {}
+
+    protected:
+
+        void _render_samples(Print &) const override;
+
+    private:
+
+        Reader _read;
+
+};
+
+
+// Counter family with one label; the reader is called with index 0, 1, 2...
+// until it returns false, and may skip an index by returning a null label
+class LabeledCounter : public Metric {
+
+    public:
+
+        using Reader = bool (*)(int index, const char *& label, uint64_t & value);
+        LabeledCounter(const char * name, const char * help, const char * label_name, Reader read)
+            : Metric(name, help, "counter"), _label_name(label_name), _read(read) {}
+
+    protected:
+
+        void _render_samples(Print &) const override;
+
+    private:
+
+        const char * _label_name;
+        Reader _read;
+
+};
+
+
+// Gauge family with one label, read the same way as LabeledCounter
+class LabeledGauge : public Metric {
+
+    public:
+
+        using Reader = bool (*)(int index, const char *& label, float & value);
+        LabeledGauge(const char * name, const char * help, const char * label_name, Reader read)
+            : Metric(name, help, "gauge"), _label_name(label_name), _read(read) {}
+
+    protected:
+
+        void _render_samples(Print &) const override;
+
+    private:
+
+        const char * _label_name;
+        Reader _read;
+
+};
+
+
+// Fixed-bucket histogram; bounds are in the metric's base unit (seconds for
+// latencies) and must be ascending. Observations are in integer micro-units
+// so the hot path has no float math.
+class Histogram : public Metric {
+
+    public:
+
+        Histogram(const char * name, const char * help, const uint32_t * bounds_micro, uint8_t count,
+                  uint32_t * bucket_storage)
+            : Metric(name, help, "histogram"), _bounds(bounds_micro), _count(count), _buckets(bucket_storage) {}
+
+        void observe(uint32_t micro);
+
+    protected:
+
+        void _render_samples(Print &) const override;
+
+    private:
+
+        const uint32_t * _bounds;
+        uint8_t _count;
+        uint32_t * _buckets;      // _count + 1 entries, the last is +Inf
+        uint64_t _sum = 0;
+        uint32_t _total = 0;
+
+};
+
+
+// Fed from the main loop
+extern Histogram loop_latency;
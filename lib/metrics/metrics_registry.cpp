@@ -0,0 +1,259 @@
+#include "metrics.h"
+#include "device.h"
+#include "motor.h"
+#include "mqtt.h"
+#include "wifi_tools.h"
+#include "wifi_names.h"
+#include "link_monitor.h"
+#include "current_adc.h"
+#include "i2c_bus.h"
+#include "timebase.h"
+#include "memory_monitor.h"
+#include "power.h"
+#include "rpc.h"
+#include "series.h"
+#include "protection.h"
+#include "ota.h"
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+// Everything the device exports. Kept apart from the rendering so that can
+// be built and checked on its own (dev/tests)
+
+// Cell power
+static Gauge current_ma("filterchlorine_current_milliamperes", "Cell current from the INA219",
+    []() { return device.GetAmps(); });
+static Gauge bus_voltage("filterchlorine_bus_voltage_volts", "INA219 bus voltage",
+    []() { return device.GetBusVoltage(); });
+static Gauge shunt_voltage("filterchlorine_shunt_voltage_millivolts", "INA219 shunt voltage",
+    []() { return device.GetShuntVoltage(); });
+static Gauge power_mw("filterchlorine_power_milliwatts", "Cell power",
+    []() { return device.GetPower(); });
+static Gauge resistance("filterchlorine_resistance_ohms", "Cell resistance (filtered V/I), NaN with the cell off",
+    []() { return device.GetResistance(); });
+static Gauge fault_state("filterchlorine_fault_state", "Overcurrent protection (armed 0, tripped 1, lockout 2)",
+    []() { return (float) protection.state(); });
+static LabeledCounter trips("filterchlorine_overcurrent_trips", "Overcurrent trips, per detecting path", "source",
+    [](int index, const char *& label, uint64_t & value) {
+        if (index >= TRIP_SOURCE_COUNT) return false;
+        label = Protection::source_name((TripSource) index);
+        value = protection.trips((TripSource) index);
+        return true;
+    });
+static Gauge trip_latency("filterchlorine_trip_latency_seconds", "Detection to output cut, last trip",
+    []() { return protection.last_latency_us() / 1e6f; });
+static Gauge trip_latency_max("filterchlorine_trip_latency_max_seconds", "Detection to output cut, worst since boot",
+    []() { return protection.max_latency_us() / 1e6f; });
+static Counter rejected("filterchlorine_sensor_rejected_readings", "INA219 readings dropped as out of range",
+    []() { return (uint64_t) device.RejectedReadings(); });
+static Gauge charge("filterchlorine_charge_milliamp_hours", "Charge integrated since boot",
+    []() { return device.GetTotalmAH(); });
+static Gauge direction("filterchlorine_forward", "1 when the cell runs forward, 0 in reverse",
+    []() { return (float) (device.motor && device.motor->isForward()); });
+static Gauge sensor_up("filterchlorine_sensor_up", "1 when the INA219 responds",
+    []() { return (float) !device.IsDown(); });
+static Gauge acs_current("filterchlorine_acs712_current_milliamperes", "Cell current from the ACS712 (block mean)",
+    []() { CurrentBlock b; return current_adc.latest(b) ? b.mean_mA : NAN; });
+static Gauge acs_ripple("filterchlorine_acs712_ripple_milliamperes", "AC rms current ripple from the ACS712",
+    []() { CurrentBlock b; return current_adc.latest(b) ? b.ripple_mA : NAN; });
+static Gauge acs_agree("filterchlorine_acs712_agrees", "1 when the ACS712 and INA219 agree within tolerance",
+    []() { return (float) current_adc.agrees_with(device.GetAmps()); });
+static Gauge acs_cost("filterchlorine_acs712_block_seconds", "Processing time of the last ACS712 block",
+    []() { CurrentBlock b; return current_adc.latest(b) ? b.process_us / 1e6f : NAN; });
+static Counter acs_overruns("filterchlorine_acs712_overruns", "ADC DMA buffer overruns",
+    []() { return (uint64_t) current_adc.overruns(); });
+static Counter reversals("filterchlorine_reversals", "Polarity reversals since boot",
+    []() { return (uint64_t) device.GetReverseCount(); });
+
+// Enclosure climate (BME280, NAN when not fitted)
+static Gauge temperature("filterchlorine_enclosure_temperature_celsius", "Enclosure temperature",
+    []() { return device.GetTemperature(); });
+static Gauge humidity("filterchlorine_enclosure_humidity_percent", "Enclosure relative humidity",
+    []() { return device.GetHumidity(); });
+static Gauge pressure("filterchlorine_enclosure_pressure_hectopascals", "Enclosure air pressure",
+    []() { return device.GetPressure(); });
+
+// I2C bus, per device address
+static bool i2c_label(int index, const char *& label, I2cDeviceStats & stats) {
+    static char address[5];
+    if (!i2c_bus.device_stats(index, stats)) return false;
+    snprintf(address, sizeof(address), "0x%02x", stats.address);
+    label = address;
+    return true;
+}
+static LabeledCounter i2c_transactions("filterchlorine_i2c_transactions", "I2C transactions by device address", "address",
+    [](int index, const char *& label, uint64_t & value) {
+        I2cDeviceStats stats;
+        if (!i2c_label(index, label, stats)) return false;
+        value = stats.transactions;
+        return true;
+    });
+static LabeledCounter i2c_errors("filterchlorine_i2c_errors", "Failed I2C transactions by device address", "address",
+    [](int index, const char *& label, uint64_t & value) {
+        I2cDeviceStats stats;
+        if (!i2c_label(index, label, stats)) return false;
+        value = stats.errors;
+        return true;
+    });
+static LabeledCounter i2c_busy("filterchlorine_i2c_busy_microseconds", "Bus time spent per device address", "address",
+    [](int index, const char *& label, uint64_t & value) {
+        I2cDeviceStats stats;
+        if (!i2c_label(index, label, stats)) return false;
+        value = stats.busy_us;
+        return true;
+    });
+static Counter i2c_recoveries("filterchlorine_i2c_recoveries", "Stuck-bus recoveries",
+    []() { return (uint64_t) i2c_bus.recoveries(); });
+
+// Network
+static Counter mqtt_connects("filterchlorine_mqtt_connects", "Successful MQTT broker connects",
+    []() { return (uint64_t) mqtt.connect_count(); });
+static Counter mqtt_failures("filterchlorine_mqtt_connect_failures", "Failed MQTT broker connects",
+    []() { return (uint64_t) mqtt.connect_failures(); });
+static Counter rpc_calls("filterchlorine_rpc_calls", "MQTT RPC calls received",
+    []() { return (uint64_t) rpc.calls(); });
+static Counter rpc_errors("filterchlorine_rpc_errors", "MQTT RPC calls answered with an error",
+    []() { return (uint64_t) rpc.errors(); });
+static Counter rpc_timeouts("filterchlorine_rpc_timeouts", "MQTT RPC calls that expired before they ran",
+    []() { return (uint64_t) rpc.timeouts(); });
+static Gauge ota_progress("filterchlorine_ota_progress_percent", "Firmware image received, 0 when no update is running",
+    []() { return ota.in_progress() ? (float) ota.percent() : 0.0f; });
+static Counter ota_failures("filterchlorine_ota_failures", "Firmware updates that failed since boot",
+    []() { return (uint64_t) ota.failures(); });
+static Gauge rssi("filterchlorine_wifi_rssi_dbm", "Smoothed WiFi RSSI",
+    []() { return link_monitor.rssi(); });
+static Gauge tx_power("filterchlorine_wifi_tx_power_dbm", "WiFi TX power",
+    []() { return (float) link_monitor.tx_power_dbm(); });
+static LabeledCounter wifi_disconnects("filterchlorine_wifi_disconnects", "WiFi disconnects by reason", "reason",
+    [](int index, const char *& label, uint64_t & value) {
+        static char code[4];
+        if (index > 255) return false;
+        value = wifi_tools.reason_count(index);
+        if (value == 0) {
+            label = nullptr;
+        } else if ((label = wifi_reason_name(index)) == nullptr) {
+            snprintf(code, sizeof(code), "%d", index);
+            label = code;
+        }
+        return true;
+    });
+static LabeledCounter wifi_events("filterchlorine_wifi_events", "WiFi driver events by type", "event",
+    [](int index, const char *& label, uint64_t & value) {
+        if (index >= (int) (sizeof(WIFI_EVENT_NAMES) / sizeof(WIFI_EVENT_NAMES[0]))) return false;
+        label = WIFI_EVENT_NAMES[index].name;
+        value = wifi_tools.event_count(WIFI_EVENT_NAMES[index].code);
+        return true;
+    });
+static Counter wifi_outages("filterchlorine_wifi_outages", "Link drops that ended in a reconnect",
+    []() { WiFiOutageStats o; wifi_tools.outage_stats(o); return (uint64_t) o.count; });
+static Counter wifi_outage_seconds("filterchlorine_wifi_outage_seconds", "Total time from link drop to IP",
+    []() { WiFiOutageStats o; wifi_tools.outage_stats(o); return o.total_ms / 1000; });
+static Gauge wifi_outage_max("filterchlorine_wifi_outage_max_seconds", "Longest time from link drop to IP",
+    []() { WiFiOutageStats o; wifi_tools.outage_stats(o); return o.max_ms / 1000.0f; });
+static Gauge wifi_outage_p95("filterchlorine_wifi_outage_p95_seconds", "p95 time from link drop to IP, recent outages",
+    []() { WiFiOutageStats o; wifi_tools.outage_stats(o); return o.p95_ms / 1000.0f; });
+
+// System
+static Gauge uptime("filterchlorine_uptime_seconds", "Seconds since boot",
+    []() { return (float) timebase.uptime(); });
+static Gauge ntp_synced("filterchlorine_ntp_synced", "1 once SNTP has set the wall clock",
+    []() { return (float) timebase.is_synced(); });
+static Counter ntp_syncs("filterchlorine_ntp_syncs", "SNTP syncs since boot",
+    []() { return (uint64_t) timebase.sync_count(); });
+static Gauge ntp_offset("filterchlorine_ntp_offset_seconds", "Clock correction applied at the last SNTP sync",
+    []() { return timebase.last_offset_us() / 1e6f; });
+static Gauge ntp_drift("filterchlorine_ntp_drift_ppm", "Estimated crystal drift against SNTP",
+    []() { return timebase.drift_ppm(); });
+static Gauge heap_free("filterchlorine_heap_free_bytes", "Free heap",
+    []() { return (float) ESP.getFreeHeap(); });
+static Gauge heap_min("filterchlorine_heap_min_free_bytes", "Lowest free heap since boot",
+    []() { return (float) ESP.getMinFreeHeap(); });
+static Gauge heap_largest("filterchlorine_heap_largest_block_bytes", "Largest allocatable block",
+    []() { return (float) heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); });
+static Gauge heap_fragmentation("filterchlorine_heap_fragmentation_ratio", "Share of free heap outside the largest block",
+    []() { return memory_monitor.fragmentation() / 100.0f; });
+static Counter alloc_failures("filterchlorine_heap_alloc_failures", "Failed heap allocations",
+    []() { return (uint64_t) memory_monitor.alloc_failures(); });
+static Gauge memory_alarms("filterchlorine_memory_alarms", "Active memory alarm bits (heap_low 1, fragmented 2, stack_low 4, alloc_failed 8)",
+    []() { return (float) memory_monitor.alarms(); });
+
+// Allocations by the subsystem that made them (zero without MEMORY_MALLOC_HOOKS)
+static bool memory_label(int index, const char *& label, MemoryCounts & counts) {
+    if (!memory_monitor.counts((MemorySubsystem) index, counts)) return false;
+    label = MemoryMonitor::subsystem_name((MemorySubsystem) index);
+    return true;
+}
+static LabeledCounter heap_allocs("filterchlorine_heap_allocations", "Heap allocations by subsystem", "subsystem",
+    [](int index, const char *& label, uint64_t & value) {
+        MemoryCounts counts;
+        if (!memory_label(index, label, counts)) return false;
+        value = counts.allocs;
+        return true;
+    });
+static LabeledCounter heap_frees("filterchlorine_heap_frees", "Heap frees by subsystem", "subsystem",
+    [](int index, const char *& label, uint64_t & value) {
+        MemoryCounts counts;
+        if (!memory_label(index, label, counts)) return false;
+        value = counts.frees;
+        return true;
+    });
+static LabeledCounter heap_bytes("filterchlorine_heap_allocated_bytes", "Bytes requested from the heap by subsystem", "subsystem",
+    [](int index, const char *& label, uint64_t & value) {
+        MemoryCounts counts;
+        if (!memory_label(index, label, counts)) return false;
+        value = counts.bytes;
+        return true;
+    });
+static LabeledGauge stack_headroom("filterchlorine_stack_headroom_bytes", "Stack never used, per task", "task",
+    [](int index, const char *& label, float & value) {
+        MemoryTaskStack stack;
+        if (index >= memory_monitor.task_count()) return false;
+        if (memory_monitor.task_stack(index, stack)) {
+            label = stack.name;
+            value = stack.headroom;
+        } else {
+            label = nullptr;
+        }
+        return true;
+    });
+
+// Power management
+static Gauge power_mode("filterchlorine_power_mode", "Power mode (performance 0, balanced 1, low 2)",
+    []() { return (float) power.mode(); });
+static Gauge cpu_frequency("filterchlorine_cpu_frequency_hertz", "CPU clock when sampled",
+    []() { return getCpuFrequencyMhz() * 1e6f; });
+static LabeledGauge power_estimate("filterchlorine_power_estimated_milliamperes", "Estimated average supply current, per mode since boot", "mode",
+    [](int index, const char *& label, float & value) {
+        PowerModeStats stats;
+        if (!power.mode_stats((PowerMode) index, stats)) return false;
+        label = stats.us ? Power::name((PowerMode) index) : nullptr;
+        value = stats.average_mA;
+        return true;
+    });
+static LabeledGauge pm_lock_held("filterchlorine_pm_lock_held_seconds", "Time each power-management lock has been held", "lock",
+    [](int index, const char *& label, float & value) {
+        PmLock * lock = power.lock(index);
+        if (!lock) return false;
+        label = lock->name();
+        value = lock->held_us() / 1e6f;
+        return true;
+    });
+
+// History store
+static Counter series_writes("filterchlorine_series_flash_writes", "Flash writes by the history store",
+    []() { return (uint64_t) series.flash_writes(); });
+static Counter series_erases("filterchlorine_series_flash_erases", "Flash sectors erased by the history store",
+    []() { return (uint64_t) series.flash_erases(); });
+static LabeledGauge series_span("filterchlorine_series_span_seconds", "History held, oldest to newest point, per tier", "tier",
+    [](int index, const char *& label, float & value) {
+        SeriesTierStats stats = {};
+        if (index >= SERIES_TIER_COUNT) return false;
+        label = series.tier_stats((SeriesTier) index, stats) ? SeriesStore::tier_name((SeriesTier) index) : nullptr;
+        value = stats.newest > stats.oldest ? stats.newest - stats.oldest : 0;
+        return true;
+    });
+
+static const uint32_t loop_bounds[] = {100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000};
+static uint32_t loop_buckets[sizeof(loop_bounds) / sizeof(loop_bounds[0]) + 1];
+Histogram loop_latency("filterchlorine_loop_latency_seconds", "Time between main loop passes",
+    loop_bounds, sizeof(loop_bounds) / sizeof(loop_bounds[0]), loop_buckets);
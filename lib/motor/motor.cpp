@@ -2,7 +2,7 @@
  * Motor class implementation
  * 
  * This file is now a wrapper - Motor is typedef'd to MD135
- * All implementation is in md135.cpp
+ * All implementation is in the MotorDriver template (motor_driver.h)
  * This file exists for backward compatibility only
  */
 
@@ -0,0 +1,362 @@
+#ifndef MOTOR_DRIVER_H
+#define MOTOR_DRIVER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "pwm_backend.h"
+#include "power.h"
+
+#define MOTOR_SPEED_MAX 255     // speed is always 0-255, whatever the PWM resolution
+
+/**
+ * Single-channel PWM + DIR motor driver, parameterized at compile time.
+ *
+ * Traits describe the board and driver chip:
+ * - forward_level               DIR pin level for forward
+ * - pwm_frequency, pwm_resolution
+ * - coast_ms                    dead time at 0 % before DIR may flip
+ * - dir_setup_ms                DIR settle time before PWM restarts
+ * - start_percent, start_min    kick-off duty from standstill (% of target, floor in speed units)
+ * - start_hold_ms               how long the kick-off duty is held
+ * - ramp_ms                     0 -> full speed ramp time
+ * - ramp_step_ms                step period when the backend ramps in software
+ *
+ * Pwm is one of the backends in pwm_backend.h.
+ *
+ * forward()/reverse()/stop() only record the command and return; the
+ * sequence (stop, coast, flip DIR, kick off, ramp) is run by a one-shot
+ * esp_timer, and with LedcFadePwm the ramp itself runs in the LEDC. Stops
+ * are never delayed - they cut the output at once, even mid-ramp.
+ *
+ * While the output is on, a power-management lock keeps the APB clock at
+ * 80 MHz, so frequency scaling never changes the PWM frequency or stalls a
+ * fade.
+ *
+ * trip() is the overcurrent path: it forces the pin low from any context,
+ * ISR included, and holds it there until clearTrip(), keeping the command
+ * so the output comes back through the normal kick-off and ramp. Holding
+ * relies on off() taking the pin away from the PWM, as LedcFadePwm does.
+ */
+template <class Traits, class Pwm = LedcFadePwm>
+class MotorDriver {
+private:
+    uint8_t pin_pwm;        // PWM pin for speed control
+    uint8_t pin_dir;        // Direction pin
+    uint8_t pwm_channel;    // ESP32 PWM channel
+    uint32_t pwm_frequency; // PWM frequency in Hz
+    uint8_t pwm_resolution; // PWM resolution in bits
+    int current_speed;      // Commanded speed (0-255)
+    bool is_forward;        // Commanded direction
+    volatile bool _tripped = false; // output held off by trip()
+
+    // Output state - only touched from the timer task after begin()
+    enum Phase : uint8_t { SETTLED, COAST, DIR_SETUP, START_HOLD, RAMP };
+    volatile Phase _phase = SETTLED;
+    bool _out_forward = true;   // level on the DIR pin
+    uint32_t _duty = 0;         // duty on the PWM pin (or heading to, while fading)
+    bool _output_on = true;     // pin routed to the PWM (not forced low)
+    int64_t _until = 0;         // current phase ends, us
+    int64_t _zero_at = 0;       // output last reached 0, us
+    int64_t _fade_end = 0;      // hardware fade still running until, us
+
+    esp_timer_handle_t _timer = nullptr;
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    PmLock _pm_lock{ESP_PM_APB_FREQ_MAX, "pwm"};    // LEDC counts APB cycles - held while duty > 0
+
+    uint32_t _max_duty() { return (1u << pwm_resolution) - 1; }
+    uint32_t _to_duty(int speed) { return (uint32_t) speed * _max_duty() / MOTOR_SPEED_MAX; }
+    void _set_dir(bool forward) {
+        digitalWrite(pin_dir, forward == (Traits::forward_level == HIGH) ? HIGH : LOW);
+        _out_forward = forward;
+    }
+    void _cut(int64_t now) {
+        if (_duty) {
+            _zero_at = now;
+            _pm_lock.release();
+        }
+        if (_output_on) Pwm::off(pin_pwm, pwm_channel);
+        _output_on = false;
+        _duty = 0;
+    }
+    void _command(bool forward, int speed);
+    void _kick();
+    void _wait(int64_t until, int64_t now);
+    void _step();
+    static void _on_timer(void * arg) { static_cast<MotorDriver *>(arg)->_step(); }
+
+public:
+    /**
+     * Constructor
+     * @param pwm PWM speed control pin
+     * @param dir Direction control pin
+     * @param channel PWM channel (0-15 on ESP32, 0-7 on ESP32-S3)
+     * @param frequency PWM frequency in Hz (default from Traits)
+     * @param resolution PWM resolution in bits (default from Traits)
+     */
+    MotorDriver(uint8_t pwm, uint8_t dir, uint8_t channel = 0,
+                uint32_t frequency = Traits::pwm_frequency, uint8_t resolution = Traits::pwm_resolution)
+        : pin_pwm(pwm), pin_dir(dir), pwm_channel(channel), pwm_frequency(frequency),
+          pwm_resolution(resolution), current_speed(0), is_forward(true) {}
+
+    /**
+     * Initialize pins, PWM and the sequencing timer
+     */
+    void begin();
+
+    /**
+     * Set motor to move forward at specified speed
+     * @param speed Motor speed (0-255)
+     */
+    void forward(int speed) { _command(true, speed); }
+
+    /**
+     * Set motor to move in reverse at specified speed
+     * @param speed Motor speed (0-255)
+     */
+    void reverse(int speed) { _command(false, speed); }
+
+    /**
+     * Stop the motor (immediately, also mid-ramp)
+     */
+    void stop() { _command(is_forward, 0); }
+
+    /**
+     * Set motor speed without changing direction
+     * @param speed Motor speed (0-255)
+     */
+    void setSpeed(int speed) { _command(is_forward, speed); }
+
+    /**
+     * Get commanded motor speed
+     * @return Current speed value
+     */
+    int getSpeed() { return current_speed; }
+
+    /**
+     * Check if motor is commanded forward
+     * @return true if forward, false if reverse
+     */
+    bool isForward() { return is_forward; }
+
+    /**
+     * Check if motor is currently running
+     * @return true if motor speed > 0
+     */
+    bool isRunning() { return current_speed > 0; }
+
+    /**
+     * Set motor direction without changing speed
+     * @param forward true for forward, false for reverse
+     */
+    void setDirection(bool forward) { _command(forward, current_speed); }
+
+    /**
+     * Change the PWM frequency; the duty ratio is kept. Best done with the
+     * output stopped, a hardware fade in progress is retimed mid-ramp
+     * @param frequency PWM frequency in Hz
+     * @return The frequency now set - the old one if the LEDC can't make it
+     */
+    uint32_t setFrequency(uint32_t frequency);
+
+    /**
+     * Get the PWM frequency
+     * @return PWM frequency in Hz
+     */
+    uint32_t getFrequency() { return pwm_frequency; }
+
+    /**
+     * Get the maximum speed value
+     * @return Maximum speed value (always 255; resolution only makes ramps finer)
+     */
+    int getMaxSpeed() { return MOTOR_SPEED_MAX; }
+
+    /**
+     * Check if the output has reached the commanded state
+     * @return false while stopping, coasting, flipping DIR or ramping
+     */
+    bool isSettled() { return _phase == SETTLED; }
+
+    /**
+     * Cut the output now and hold it off, keeping the command (ISR safe)
+     */
+    void trip();
+
+    /**
+     * Release a trip; the output restarts from standstill
+     */
+    void clearTrip();
+
+    /**
+     * Check if the output is held off by trip()
+     * @return true until clearTrip()
+     */
+    bool isTripped() { return _tripped; }
+};
+
+
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::begin() {
+    // Configure direction pin as output, forward first
+    pinMode(pin_dir, OUTPUT);
+    _set_dir(true);
+
+    // Setup PWM channel for speed control, motor stopped
+    Pwm::begin(pin_pwm, pwm_channel, pwm_frequency, pwm_resolution);
+    _zero_at = esp_timer_get_time();
+
+    esp_timer_create_args_t args = {};
+    args.callback = _on_timer;
+    args.arg = this;
+    args.name = "motor";
+    esp_timer_create(&args, &_timer);
+}
+
+
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::_command(bool forward, int speed) {
+    speed = constrain(speed, 0, MOTOR_SPEED_MAX);
+    portENTER_CRITICAL(&_lock);
+    current_speed = speed;
+    is_forward = forward;
+    portEXIT_CRITICAL(&_lock);
+    _kick();
+}
+
+
+template <class Traits, class Pwm>
+uint32_t MotorDriver<Traits, Pwm>::setFrequency(uint32_t frequency) {
+    if (Pwm::set_frequency(pwm_channel, frequency, pwm_resolution)) pwm_frequency = frequency;
+    return pwm_frequency;
+}
+
+
+// Only the pin here; _step() does the bookkeeping, kicked now from a task or
+// by the next trip() from one after an ISR
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::trip() {
+    portENTER_CRITICAL_SAFE(&_lock);
+    _tripped = true;
+    Pwm::off(pin_pwm, pwm_channel);
+    portEXIT_CRITICAL_SAFE(&_lock);
+    if (!xPortInIsrContext()) _kick();
+}
+
+
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::clearTrip() {
+    portENTER_CRITICAL(&_lock);
+    _tripped = false;
+    portEXIT_CRITICAL(&_lock);
+    _kick();
+}
+
+
+// Run a step as soon as possible; a phase in progress just re-arms for its
+// own end and picks the new command up then
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::_kick() {
+    if (!_timer) return;
+    esp_timer_stop(_timer);
+    esp_timer_start_once(_timer, 1);
+}
+
+
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::_wait(int64_t until, int64_t now) {
+    _until = until;
+    esp_timer_stop(_timer);
+    esp_timer_start_once(_timer, until > now ? until - now : 1);
+}
+
+
+// Timer task. Moves the output one step toward the commanded state.
+template <class Traits, class Pwm>
+void MotorDriver<Traits, Pwm>::_step() {
+
+    portENTER_CRITICAL(&_lock);
+    bool forward = is_forward;
+    int speed = current_speed;
+    bool tripped = _tripped;
+    portEXIT_CRITICAL(&_lock);
+
+    int64_t now = esp_timer_get_time();
+    uint32_t target = _to_duty(speed);
+
+    // Stops (and trips) are never delayed
+    if (speed == 0 || tripped) {
+        _cut(now);
+        _until = 0;
+        _phase = SETTLED;
+        return;
+    }
+
+    // Let the current phase (and any hardware fade) run out
+    int64_t until = _until > _fade_end ? _until : _fade_end;
+    if (now < until) {
+        _wait(until, now);
+        return;
+    }
+
+    // Wrong direction: output to 0, coast, then flip DIR
+    if (forward != _out_forward) {
+        _cut(now);
+        int64_t coast_end = _zero_at + Traits::coast_ms * 1000LL;
+        if (now < coast_end) {
+            _phase = COAST;
+            _wait(coast_end, now);
+            return;
+        }
+        _set_dir(forward);
+        _phase = DIR_SETUP;
+        _wait(now + Traits::dir_setup_ms * 1000LL, now);
+        return;
+    }
+
+    // From standstill: a short low-duty kick-off prevents the inrush surge
+    if (_duty == 0) {
+        int start = speed * Traits::start_percent / 100;
+        if (start < Traits::start_min) start = Traits::start_min;
+        if (start > speed) start = speed;
+        _duty = _to_duty(start);
+        _pm_lock.acquire();
+        Pwm::write(pwm_channel, _duty);
+        if (!_output_on) {
+            // Under the lock, so a trip() racing this step still wins
+            portENTER_CRITICAL(&_lock);
+            if (!_tripped) {
+                Pwm::on(pin_pwm, pwm_channel);
+                _output_on = true;
+            }
+            portEXIT_CRITICAL(&_lock);
+        }
+        _phase = START_HOLD;
+        _wait(now + Traits::start_hold_ms * 1000LL, now);
+        return;
+    }
+
+    // Ramp to the target, time proportional to the distance
+    if (_duty != target) {
+        uint32_t distance = _duty > target ? _duty - target : target - _duty;
+        _phase = RAMP;
+        if (Pwm::hardware_fade) {
+            uint32_t ms = (uint64_t) Traits::ramp_ms * distance / _max_duty();
+            if (ms == 0) ms = 1;
+            Pwm::fade(pwm_channel, target, ms);
+            _duty = target;
+            _fade_end = now + ms * 1000LL;
+            _wait(_fade_end, now);
+        } else {
+            uint32_t step = (uint64_t) _max_duty() * Traits::ramp_step_ms / Traits::ramp_ms;
+            if (step == 0) step = 1;
+            if (distance <= step) _duty = target;
+            else _duty = _duty < target ? _duty + step : _duty - step;
+            Pwm::write(pwm_channel, _duty);
+            _wait(now + Traits::ramp_step_ms * 1000LL, now);
+        }
+        return;
+    }
+
+    _phase = SETTLED;
+}
+
+#endif // MOTOR_DRIVER_H
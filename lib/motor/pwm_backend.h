@@ -0,0 +1,97 @@
+#ifndef PWM_BACKEND_H
+#define PWM_BACKEND_H
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include <soc/soc_caps.h>
+#include <soc/gpio_sig_map.h>
+
+/**
+ * PWM output policies for MotorDriver.
+ *
+ * Every backend provides the same static interface:
+ * - begin(pin, channel, frequency, resolution) - configure and start at 0 %
+ * - set_frequency(channel, frequency, resolution) - retime, false if refused
+ * - write(channel, duty)                       - set duty now
+ * - fade(channel, duty, ms)                    - move to duty over ms
+ * - off(pin, channel) / on(pin, channel)       - force the pin low at once,
+ *                                                even mid-ramp, and release it
+ * - hardware_fade                              - true when fade() runs without
+ *                                                the CPU; otherwise the driver
+ *                                                steps the ramp itself
+ */
+
+// Plain ledcWrite - ramps are stepped in software by the driver
+struct LedcWritePwm {
+
+    static constexpr bool hardware_fade = false;
+
+    static void begin(uint8_t pin, uint8_t channel, uint32_t frequency, uint8_t resolution) {
+        ledcSetup(channel, frequency, resolution);
+        ledcAttachPin(pin, channel);
+        ledcWrite(channel, 0);
+    }
+
+    static bool set_frequency(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+        return ledcChangeFrequency(channel, frequency, resolution) != 0;
+    }
+
+    static void write(uint8_t channel, uint32_t duty) { ledcWrite(channel, duty); }
+    static void fade(uint8_t channel, uint32_t duty, uint32_t) { ledcWrite(channel, duty); }
+    static void off(uint8_t, uint8_t channel) { ledcWrite(channel, 0); }
+    static void on(uint8_t, uint8_t) {}
+
+};
+
+
+// LEDC hardware fade: the peripheral steps the duty itself, so a ramp costs
+// one register write and no CPU time while it runs
+struct LedcFadePwm {
+
+    static constexpr bool hardware_fade = true;
+
+    // Arduino numbers channels 0-15 across both speed groups, 8 per group
+    static ledc_mode_t mode(uint8_t channel) { return (ledc_mode_t) (channel / 8); }
+    static ledc_channel_t unit(uint8_t channel) { return (ledc_channel_t) (channel % 8); }
+
+    static void begin(uint8_t pin, uint8_t channel, uint32_t frequency, uint8_t resolution) {
+        static bool fade_installed = false;
+        ledcSetup(channel, frequency, resolution);
+        ledcAttachPin(pin, channel);
+        ledcWrite(channel, 0);
+        if (!fade_installed) fade_installed = ledc_fade_func_install(0) == ESP_OK;
+    }
+
+    static bool set_frequency(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+        return ledcChangeFrequency(channel, frequency, resolution) != 0;
+    }
+
+    // Duty changes wait for a running fade on IDF 4.4 - the driver never
+    // overlaps them, see MotorDriver::_fade_end
+    static void write(uint8_t channel, uint32_t duty) {
+        ledc_set_duty_and_update(mode(channel), unit(channel), duty, 0);
+    }
+
+    static void fade(uint8_t channel, uint32_t duty, uint32_t ms) {
+        ledc_set_fade_time_and_start(mode(channel), unit(channel), duty, ms, LEDC_FADE_NO_WAIT);
+    }
+
+    // A fade can't be aborted through the driver, so take the pin away from
+    // the LEDC and drive it low; the peripheral finishes its ramp unseen
+    static void off(uint8_t pin, uint8_t) {
+        pinMatrixOutDetach(pin, false, false);
+        digitalWrite(pin, LOW);
+    }
+
+    static void on(uint8_t pin, uint8_t channel) {
+#if SOC_LEDC_SUPPORT_HS_MODE
+        uint32_t signal = channel < 8 ? LEDC_HS_SIG_OUT0_IDX + channel : LEDC_LS_SIG_OUT0_IDX + channel - 8;
+#else
+        uint32_t signal = LEDC_LS_SIG_OUT0_IDX + channel;
+#endif
+        pinMatrixOutAttach(pin, signal, false, false);
+    }
+
+};
+
+#endif // PWM_BACKEND_H
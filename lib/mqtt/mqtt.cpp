@@ -1,7 +1,8 @@
 #include "mqtt.h"
 #include <WiFi.h>
-
-#define DEVICE_ID "FilterChlorine"
+#include "wifi_tools.h"
+#include "identity.h"
+#include "topics.h"
 
 Mqtt::Mqtt() : _stored_handler(nullptr) {} // constructor
 
@@ -10,13 +11,13 @@ Mqtt mqtt; // global mqtt object
 void Mqtt::setup(const char * mqtt_host, const char * user, const char * password,int mqtt_port) {
 
     Serial.print("\tMQTT Client ID: ");
-    Serial.println(DEVICE_ID);
+    Serial.println(identity.client_id());
     
-    _mqtt_client.setBufferSize(2048);
+    _mqtt_client.setBufferSize(MQTT_BUFFER_SIZE);
     _mqtt_client.setClient(_wifi_client);
     _mqtt_client.setServer(mqtt_host, mqtt_port);
-    _mqtt_client.setKeepAlive(30);  // 30 second keepalive
-    _mqtt_client.setSocketTimeout(15);  // 15 second timeout for unreliable links
+    _mqtt_client.setKeepAlive(MQTT_KEEPALIVE);
+    _mqtt_client.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
     strcpy(_user, user);
     strcpy( _password, password);
 }
@@ -32,18 +33,27 @@ void Mqtt::maintain() {
 
     if (!_mqtt_client.connected()) {
         _is_connected = false;
-        bool should_reconnect = _is_first_connect || millis() - _retry_timer > RETRY_INTERVAL;
+        bool should_reconnect = _is_first_connect || millis() - _retry_timer > _retry_delay;
         if (should_reconnect) {
             _retry_timer = millis();
+            _retry_delay = RETRY_INTERVAL + identity.jitter(RETRY_JITTER);
             _is_first_connect = false;
             Serial.print("\tMQTT: Attempting connection to broker... ");
-            if (_mqtt_client.connect(DEVICE_ID, _user, _password) ) {
+            // The broker marks us offline if the session dies without a goodbye
+            if (_mqtt_client.connect(identity.client_id(), _user, _password,
+                                     topics.get(TOPIC_STATUS), 1, true, "offline")) {
                 Serial.println("SUCCESS");
                 _is_connected = true;
+                _connect_count++;
 
                 _subscribe_to_all();
+                _mqtt_client.publish(topics.get(TOPIC_STATUS), "online", true);
+
+                wifi_tools.report_mqtt_connected();
+                _publish_connect_stats();
 
             } else {
+                _connect_failures++;
                 int state = _mqtt_client.state();
                 Serial.print("FAILED - state: ");
                 Serial.print(state);
@@ -2,8 +2,7 @@
 
 #include <WiFiClient.h>
 #include <PubSubClient.h>
-
-#define RETRY_INTERVAL 5000  // 5 seconds between MQTT reconnection attempts
+#include "mqtt_config.h"
 
 using MessageHandler = void (*)(char *, char *);
 
@@ -17,12 +16,16 @@ class Mqtt {
         void setup(const char *, const char *, const char *, int);
         void maintain();
         void report_disconnect();
+        bool is_connected() { return _is_connected; }
+        uint32_t connect_count() { return _connect_count; }
+        uint32_t connect_failures() { return _connect_failures; }
 
         // publish
         void publish(const char *, const char *);
         void publish(const char *, float);
         void publish(const char *, int);
         void publish(const char *);
+        void publish(const char *, const uint8_t *, size_t, bool retained = false);
 
         // subscribe
         void set_subscriptions(const char **, int);
@@ -37,14 +40,17 @@ class Mqtt {
 
         // connect
         unsigned long _retry_timer;
+        unsigned long _retry_delay = RETRY_INTERVAL;
         bool _is_first_connect = true;
         bool _is_connected = false;
-        char _device_id[9];
+        uint32_t _connect_count = 0;
+        uint32_t _connect_failures = 0;
         char _user[15];
         char _password[15];
 
         // publish
         void _publish(const char *, const char *);
+        void _publish_connect_stats();
 
         // subscribe
         const char ** _subscription_list = nullptr;
@@ -0,0 +1,8 @@
+#pragma once
+
+// Connection policy, shared with the host fleet simulator (dev/fleetsim)
+#define RETRY_INTERVAL 5000  // 5 seconds between MQTT reconnection attempts
+#define RETRY_JITTER 5000    // plus up to this much, so a fleet doesn't retry in lockstep
+#define MQTT_BUFFER_SIZE 2048 // RPC_RESPONSE_MAX, telemetry or the key schema, plus topic and header
+#define MQTT_KEEPALIVE 30     // seconds
+#define MQTT_SOCKET_TIMEOUT 15 // seconds, for unreliable links
@@ -12,7 +12,9 @@ void Mqtt::_callback_wrapper(char * topic, byte * payload, unsigned int length)
     telnet.print("\tCallback wrapper triggered! Length: ");
     telnet.print((int)length);
     telnet.println("");
-    char message[length+1];
+    // Runs on the main task only; the client never hands over more than its buffer
+    static char message[MQTT_BUFFER_SIZE + 1];
+    if (length > MQTT_BUFFER_SIZE) length = MQTT_BUFFER_SIZE;
     memcpy(message, payload, length);
     message[length] = 0;
     if (mqtt._stored_handler) {
@@ -1,5 +1,11 @@
 #include "mqtt.h"
 #include "../telnet/telnet.h"
+#include "wifi_tools.h"
+#include "wifi_names.h"
+#include "link_monitor.h"
+#include "timebase.h"
+#include "telemetry.h"
+#include "topics.h"
 
 
 void Mqtt::publish(const char * topic, const char * payload) {
@@ -22,6 +28,20 @@ void Mqtt::publish(const char * topic) {
     _publish(topic, "");
 }
 
+// Binary payloads (CBOR, MessagePack) - echoed to telnet as a byte count
+void Mqtt::publish(const char * topic, const uint8_t * payload, size_t length, bool retained) {
+    if (_is_connected) {
+        telnet.print("\tsending: ");
+        telnet.print(topic);
+        telnet.print(" / ");
+        telnet.print((int) length);
+        telnet.println(" bytes");
+        if (_mqtt_client.publish(topic, payload, length, retained)) {
+            link_monitor.count_tx(strlen(topic) + length);
+        }
+    }
+}
+
 
 void Mqtt::_publish(const char * topic, const char * payload) {
     if (_is_connected) {
@@ -33,6 +53,43 @@ void Mqtt::_publish(const char * topic, const char * payload) {
         Serial.print(topic);
         Serial.print(" / ");
         Serial.println(payload);*/
-        _mqtt_client.publish(topic, payload);
+        if (_mqtt_client.publish(topic, payload)) {
+            link_monitor.count_tx(strlen(topic) + strlen(payload));
+        }
+    }
+}
+
+// Connect timing for the link that just came up, so fast vs scan reconnects can be compared
+void Mqtt::_publish_connect_stats() {
+    JsonDocument doc;
+    doc["wifi_ms"] = wifi_tools.time_to_connect();
+    doc["mqtt_ms"] = wifi_tools.time_to_mqtt();
+    doc["fast"] = wifi_tools.fast_connected();
+    doc["channel"] = WiFi.channel();
+    doc["ts"] = timebase.epoch_ms();
+
+    // What this reconnect ended, and the running picture, to line drops up
+    // against time of day and AP changes
+    WiFiOutage outage;
+    if (wifi_tools.take_outage(outage)) {
+        char bssid[18];
+        snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X", outage.bssid[0], outage.bssid[1],
+                 outage.bssid[2], outage.bssid[3], outage.bssid[4], outage.bssid[5]);
+        const char * reason = wifi_reason_name(outage.reason);
+        doc["outage_ms"] = outage.ms;
+        if (reason) doc["reason"] = reason; else doc["reason"] = outage.reason;
+        doc["prev_bssid"] = bssid;
+    }
+    WiFiOutageStats stats;
+    wifi_tools.outage_stats(stats);
+    doc["outages"] = stats.count;
+    doc["outage_total_s"] = (uint32_t) (stats.total_ms / 1000);
+    doc["outage_max_ms"] = stats.max_ms;
+    doc["outage_p95_ms"] = stats.p95_ms;
+    JsonObject reasons = doc["reasons"].to<JsonObject>();
+    for (const WiFiName & r : WIFI_REASON_NAMES) {
+        uint32_t n = wifi_tools.reason_count(r.code);
+        if (n) reasons[r.name] = n;
     }
+    telemetry.publish(TOPIC_DIAG_CONNECT, doc);
 }
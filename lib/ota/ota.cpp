@@ -0,0 +1,152 @@
+#include "ota.h"
+#include "mqtt.h"
+#include "topics.h"
+#include "power.h"
+#include "link_monitor.h"
+#include "series.h"
+#include "../device/device.h"
+#include "../telnet/telnet.h"
+#include <ArduinoOTA.h>
+#include <ESPmDNS.h>
+
+Ota ota;
+
+// Full clock for the whole transfer
+static PmLock ota_lock(ESP_PM_CPU_FREQ_MAX, "ota");
+
+static const char *const STATE_NAMES[OTA_STATE_COUNT] = {"idle", "receiving", "done", "failed"};
+
+
+void Ota::begin(Motor * motor) {
+    _motor = motor;
+
+    // Start mDNS for hostname resolution
+    if (!MDNS.begin(OTA_HOSTNAME))
+    {
+        telnet.println("\tError setting up mDNS");
+    }
+    else
+    {
+        telnet.println("\tmDNS started: " OTA_HOSTNAME ".local");
+    }
+
+    ArduinoOTA.setHostname(OTA_HOSTNAME);
+    ArduinoOTA.setPassword("admin");
+    ArduinoOTA.setPort(OTA_PORT);
+    ArduinoOTA.setRebootOnSuccess(false);   // loop() reboots, once the output is safe
+
+    // These run on the OTA task - state only, loop() does the rest
+    ArduinoOTA.onStart([]() {
+        ota._received = 0;
+        ota._total = 0;
+        ota._state = OTA_RECEIVING;
+    });
+
+    ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+        ota._received = progress;
+        ota._total = total;
+    });
+
+    ArduinoOTA.onEnd([]() {
+        ota._state = OTA_DONE;
+    });
+
+    ArduinoOTA.onError([](ota_error_t error) {
+        ota._error = error;
+        ota._state = OTA_FAILED;
+    });
+
+    ArduinoOTA.begin();
+    xTaskCreatePinnedToCore(_task, "ota", OTA_TASK_STACK, this, OTA_TASK_PRIORITY, nullptr, OTA_TASK_CORE);
+    telnet.println("\tOTA ready");
+}
+
+
+// A transfer runs to completion inside handle()
+void Ota::_task(void *) {
+    for (;;) {
+        ArduinoOTA.handle();
+        vTaskDelay(pdMS_TO_TICKS(OTA_POLL_MS));
+    }
+}
+
+
+void Ota::loop() {
+    OtaState state = _state;
+    if (state == _reported) {
+        if (state == OTA_RECEIVING && millis() - _progress_timer >= OTA_PROGRESS_INTERVAL) _publish_progress();
+        return;
+    }
+
+    if (_reported == OTA_RECEIVING) {
+        ota_lock.release();
+        link_monitor.hold_max_power(false);
+    }
+    _reported = state;
+
+    switch (state) {
+        case OTA_RECEIVING:
+            ota_lock.acquire();
+            link_monitor.hold_max_power(true);     // boost TX power for a stable transfer
+            mqtt.publish(topics.get(TOPIC_OTA_STATE), "updating");
+            telnet.println("\tOTA: receiving - the cell keeps running");
+            _publish_progress();
+            break;
+
+        case OTA_DONE:
+            _reboot();
+            break;
+
+        case OTA_FAILED: {
+            static const char *const ERRORS[] = {"auth", "begin", "connect", "receive", "end"};
+            char line[64];
+            snprintf(line, sizeof(line), "\tOTA: failed (%s) at %u%%",
+                     _error >= OTA_AUTH_ERROR && _error <= OTA_END_ERROR ? ERRORS[_error] : "unknown", percent());
+            telnet.println(line);
+            _failures++;
+            _publish_progress();
+            mqtt.publish(topics.get(TOPIC_OTA_STATE), "ready");
+            _state = OTA_IDLE;
+            _reported = OTA_IDLE;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+
+void Ota::_publish_progress() {
+    _progress_timer = millis();
+    char payload[112];
+    snprintf(payload, sizeof(payload), "{\"state\":\"%s\",\"percent\":%u,\"bytes\":%lu,\"total\":%lu,\"heap\":%lu}",
+             state_name(_reported), percent(), (unsigned long) _received, (unsigned long) _total,
+             (unsigned long) ESP.getFreeHeap());
+    mqtt.publish(topics.get(TOPIC_OTA_PROGRESS), (const uint8_t *) payload, strlen(payload));
+}
+
+
+// The one pause: the output is brought to a stop so the restart can't cut
+// it mid-ramp or mid-flip, then the state worth keeping is saved
+void Ota::_reboot() {
+    _updates++;
+    _publish_progress();
+    telnet.println("\tOTA: complete - stopping the output and rebooting");
+
+    if (_motor) {
+        _motor->stop();
+        unsigned long start = millis();
+        while (!_motor->isSettled() && millis() - start < OTA_SAFE_STATE_MS) delay(10);
+    }
+    series.flush();
+    device.SaveCharge();
+
+    delay(200);     // let the last messages leave
+    ESP.restart();
+}
+
+
+const char * Ota::state_name(OtaState state) {
+    return state < OTA_STATE_COUNT ? STATE_NAMES[state] : "?";
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include "motor.h"
+
+#define OTA_HOSTNAME "filter-chlorine"
+#define OTA_PORT 3232
+#define OTA_TASK_STACK 6144
+#define OTA_TASK_PRIORITY 0             // below loopTask, so the cell always goes first
+#define OTA_TASK_CORE 0                 // with the WiFi stack, away from the control tasks
+#define OTA_POLL_MS 50                  // between checks for an invitation
+#define OTA_PROGRESS_INTERVAL 2000      // ms between progress messages
+#define OTA_SAFE_STATE_MS 1000          // longest wait for the output to stop before the reboot
+
+enum OtaState : uint8_t {
+    OTA_IDLE,
+    OTA_RECEIVING,      // image streaming into the inactive partition
+    OTA_DONE,           // verified and marked for boot, restart pending
+    OTA_FAILED,         // back to idle once reported
+    OTA_STATE_COUNT
+};
+
+/**
+ * Firmware updates without stopping the cell.
+ *
+ * ArduinoOTA::handle() runs the whole transfer inside the call once an
+ * invitation arrives, so it gets its own low-priority task: the image is
+ * received and written to the inactive partition a chunk at a time while
+ * the main loop carries on sampling, reversing, checking for overcurrent
+ * and publishing. MQTT stays up, and progress goes out on
+ * filterchlorine/<id>/ota/progress.
+ *
+ * Nothing shared is touched from the OTA task - it only records state and
+ * byte counts, and loop() acts on them. A finished image isn't booted by
+ * ArduinoOTA; loop() brings the output to a stop, saves what needs saving
+ * and restarts, which is the only time control pauses.
+ */
+class Ota {
+
+    public:
+
+        void begin(Motor *);    // once the network is up
+        void loop();            // main loop: progress, the final reboot
+
+        OtaState state() { return _state; }
+        bool in_progress() { return _state == OTA_RECEIVING || _state == OTA_DONE; }
+        uint8_t percent() { return _total ? (uint8_t) ((uint64_t) _received * 100 / _total) : 0; }
+        uint32_t updates() { return _updates; }
+        uint32_t failures() { return _failures; }
+        static const char * state_name(OtaState);
+
+    private:
+
+        Motor * _motor = nullptr;
+        volatile OtaState _state = OTA_IDLE;
+        volatile uint32_t _received = 0;
+        volatile uint32_t _total = 0;
+        volatile int _error = 0;
+        OtaState _reported = OTA_IDLE;
+        unsigned long _progress_timer = 0;
+        uint32_t _updates = 0;
+        uint32_t _failures = 0;
+
+        static void _task(void *);
+        void _publish_progress();
+        void _reboot();
+
+};
+
+extern Ota ota;
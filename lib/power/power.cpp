@@ -0,0 +1,304 @@
+#include "power.h"
+#include "storage.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+
+struct PowerProfile {
+    const char * name;
+    uint16_t max_mhz;
+    uint16_t min_mhz;
+    bool light_sleep;
+    wifi_ps_type_t wifi_ps;
+    uint16_t idle_ms;           // longest the main loop blocks per pass, 0 = spin
+};
+
+static const PowerProfile PROFILES[POWER_MODE_COUNT] = {
+    {"performance", 240, 240, false, WIFI_PS_NONE,      0},
+    {"balanced",    240,  80, false, WIFI_PS_MIN_MODEM, 10},
+    {"low",         160,  40, true,  WIFI_PS_MAX_MODEM, 50},
+};
+
+// Typical ESP32-S3 supply current at 3.3 V, mA, from the datasheet's
+// modem-sleep and light-sleep tables. A board with its regulator, LED and
+// sensors draws more, so read the estimate as a comparison between modes
+// unless it has been checked against a meter.
+struct CpuCurrent {
+    uint16_t mhz;
+    float run_mA;           // code running
+    float idle_mA;          // waiting for an interrupt
+};
+static const CpuCurrent CPU_CURRENT[] = {
+    {240, 66.0, 32.0}, {160, 52.0, 27.0}, {80, 37.0, 22.0}, {40, 23.0, 13.0},
+};
+#define LIGHT_SLEEP_MA 0.24f
+
+// Radio average on top of the CPU, by WiFi power-save mode, at DTIM 1-3 with light traffic
+static const float WIFI_MA[] = {68.0, 20.0, 8.0};      // WIFI_PS_NONE, _MIN_MODEM, _MAX_MODEM
+
+static const char *const LOCK_TYPE_NAMES[PM_LOCK_TYPES] = {"cpu", "apb", "awake"};
+
+Power power;
+PmLock * PmLock::_head = nullptr;
+
+
+static float cpu_mA(uint16_t mhz, bool running) {
+    for (const CpuCurrent & c : CPU_CURRENT) {
+        if (mhz >= c.mhz) return running ? c.run_mA : c.idle_mA;
+    }
+    const CpuCurrent & slowest = CPU_CURRENT[sizeof(CPU_CURRENT) / sizeof(CPU_CURRENT[0]) - 1];
+    return running ? slowest.run_mA : slowest.idle_mA;
+}
+
+
+void Power::begin() {
+    uint8_t stored;
+    if (storage.load_blob("power", "mode", &stored, sizeof(stored)) && stored < POWER_MODE_COUNT) {
+        _mode = (PowerMode) stored;
+    }
+
+    // Locks constructed before now get their IDF handles, taken as often as they're held
+    for (PmLock * lock = PmLock::_head; lock; lock = lock->_next) {
+        if (lock->_handle || esp_pm_lock_create(lock->_type, 0, lock->_name, &lock->_handle) != ESP_OK) continue;
+        for (uint16_t i = 0; i < lock->_depth; i++) esp_pm_lock_acquire(lock->_handle);
+    }
+    _begun = true;
+
+    _apply();
+    _sample_us = esp_timer_get_time();
+    char description[96];
+    describe(description, sizeof(description));
+    Serial.printf("\tPower: %s\n", description);
+}
+
+
+void Power::loop() {
+    if (millis() - _sample_timer < POWER_ESTIMATE_INTERVAL) return;
+    _sample_timer = millis();
+    _sample();
+}
+
+
+bool Power::set_mode(const char * requested) {
+    PowerMode mode;
+    if (!parse(requested, mode)) return false;
+    _sample();                  // close out the interval under the old mode
+    _mode = mode;
+    uint8_t stored = mode;
+    storage.store_blob("power", "mode", &stored, sizeof(stored));
+    _apply();
+    return true;
+}
+
+
+const char * Power::name(PowerMode mode) {
+    return mode < POWER_MODE_COUNT ? PROFILES[mode].name : "?";
+}
+
+bool Power::parse(const char * requested, PowerMode & mode) {
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        if (strcasecmp(requested, PROFILES[i].name) == 0) {
+            mode = (PowerMode) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+size_t Power::describe(char * out, size_t size) {
+    const PowerProfile & p = PROFILES[_mode];
+    static const char *const PS_NAMES[] = {"off", "min", "max"};
+    const char * sleep = !p.light_sleep ? "off" : _light_sleep_ok ? "on" : "unavailable";
+    if (_pm_ok) {
+        return snprintf(out, size, "%s, DFS %u/%u MHz, light sleep %s, modem sleep %s",
+                        p.name, p.max_mhz, p.min_mhz, sleep, PS_NAMES[p.wifi_ps]);
+    }
+    return snprintf(out, size, "%s, fixed %u MHz (no PM support), modem sleep %s",
+                    p.name, p.max_mhz, PS_NAMES[p.wifi_ps]);
+}
+
+
+wifi_ps_type_t Power::wifi_ps() {
+    return PROFILES[_mode].wifi_ps;
+}
+
+void Power::apply_wifi() {
+    if (WiFi.getMode() & WIFI_MODE_STA) esp_wifi_set_ps(wifi_ps());
+}
+
+
+// Light sleep needs tickless idle in the IDF build; without it the request
+// is refused as a whole, so ask again for DFS alone
+void Power::_apply() {
+    const PowerProfile & p = PROFILES[_mode];
+#if CONFIG_IDF_TARGET_ESP32S3
+    esp_pm_config_esp32s3_t config = {};
+#else
+    esp_pm_config_esp32_t config = {};
+#endif
+    config.max_freq_mhz = p.max_mhz;
+    config.min_freq_mhz = p.min_mhz;
+    config.light_sleep_enable = p.light_sleep;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK && p.light_sleep) {
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    }
+    _pm_ok = err == ESP_OK;
+    _light_sleep_ok = _pm_ok && config.light_sleep_enable;
+    if (!_pm_ok) setCpuFrequencyMhz(p.max_mhz);
+    apply_wifi();
+}
+
+
+void Power::idle(uint32_t next_due_ms) {
+    uint32_t ms = PROFILES[_mode].idle_ms;
+    if (next_due_ms < ms) ms = next_due_ms;
+    if (!ms) return;
+    int64_t start = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(ms) ? pdMS_TO_TICKS(ms) : 1);
+    _idle_us += esp_timer_get_time() - start;
+}
+
+
+/*
+ * The estimate for the interval just ended. Awake, the CPU runs at the
+ * mode's maximum. Idle, it sits wherever the locks held it: at the maximum
+ * under a CPU lock, at 80 MHz under an APB lock, otherwise at the minimum -
+ * or in light sleep, if enabled and nothing forbids it. The lock shares are
+ * over the whole interval, so other tasks' locks count even while the main
+ * loop itself was busy; close enough to compare modes.
+ */
+void Power::_sample() {
+
+    uint64_t now = esp_timer_get_time();
+    uint64_t span = now - _sample_us;
+    if (!span) return;
+
+    float held[PM_LOCK_TYPES];
+    for (int t = 0; t < PM_LOCK_TYPES; t++) {
+        uint64_t total = _held_us((esp_pm_lock_type_t) t, now);
+        held[t] = min(1.0f, (float) (total - _sample_held[t]) / span);
+        _sample_held[t] = total;
+    }
+    uint64_t idle = _idle_us - _sample_idle;
+    if (idle > span) idle = span;
+    _sample_us = now;
+    _sample_idle = _idle_us;
+
+    const PowerProfile & p = PROFILES[_mode];
+    uint16_t max_mhz = p.max_mhz;
+    uint16_t min_mhz = _pm_ok ? p.min_mhz : p.max_mhz;
+    uint16_t apb_mhz = min_mhz > 80 ? min_mhz : 80;
+
+    float cpu_share = held[ESP_PM_CPU_FREQ_MAX];
+    float apb_share = max(0.0f, held[ESP_PM_APB_FREQ_MAX] - cpu_share);
+    float floor_share = max(0.0f, 1.0f - cpu_share - apb_share);
+    float sleep_share = _light_sleep_ok ? max(0.0f, floor_share - held[ESP_PM_NO_LIGHT_SLEEP]) : 0.0f;
+    float idle_mA = cpu_share * cpu_mA(max_mhz, false) + apb_share * cpu_mA(apb_mhz, false)
+                  + (floor_share - sleep_share) * cpu_mA(min_mhz, false) + sleep_share * LIGHT_SLEEP_MA;
+
+    float idle_fraction = (float) idle / span;
+    _estimate = (1.0f - idle_fraction) * cpu_mA(max_mhz, true) + idle_fraction * idle_mA;
+    if (WiFi.getMode() != WIFI_MODE_NULL) _estimate += WIFI_MA[p.wifi_ps];
+
+    PowerModeStats & stats = _stats[_mode];
+    double charge = (double) stats.average_mA * stats.us + (double) _estimate * span;
+    stats.us += span;
+    stats.awake_us += span - idle;
+    stats.average_mA = charge / stats.us;
+}
+
+
+bool Power::mode_stats(PowerMode mode, PowerModeStats & stats) {
+    if (mode >= POWER_MODE_COUNT) return false;
+    stats = _stats[mode];
+    return true;
+}
+
+
+float Power::estimate_mA() {
+    return _estimate;
+}
+
+
+const char * Power::lock_type_name(esp_pm_lock_type_t type) {
+    return type < PM_LOCK_TYPES ? LOCK_TYPE_NAMES[type] : "?";
+}
+
+
+int Power::lock_count() {
+    int count = 0;
+    for (PmLock * lock = PmLock::_head; lock; lock = lock->_next) count++;
+    return count;
+}
+
+
+PmLock * Power::lock(int index) {
+    PmLock * lock = PmLock::_head;
+    while (lock && index--) lock = lock->_next;
+    return lock;
+}
+
+
+uint64_t Power::_held_us(esp_pm_lock_type_t type, uint64_t now) {
+    portENTER_CRITICAL(&_lock);
+    uint64_t held = _type_held[type] + (_type_depth[type] ? now - _type_since[type] : 0);
+    portEXIT_CRITICAL(&_lock);
+    return held;
+}
+
+
+// Caller holds _lock
+void Power::_changed(esp_pm_lock_type_t type, bool acquired, uint64_t now) {
+    if (acquired) {
+        if (_type_depth[type]++ == 0) _type_since[type] = now;
+    } else if (_type_depth[type] && --_type_depth[type] == 0) {
+        _type_held[type] += now - _type_since[type];
+    }
+}
+
+
+PmLock::PmLock(esp_pm_lock_type_t type, const char * name) : _type(type), _name(name) {
+    // Append so "pm" lists locks in the order they were made
+    PmLock ** tail = &_head;
+    while (*tail) tail = &(*tail)->_next;
+    *tail = this;
+    if (power._begun) esp_pm_lock_create(_type, 0, _name, &_handle);
+}
+
+
+void PmLock::acquire() {
+    uint64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_SAFE(&power._lock);
+    if (_depth++ == 0) {
+        _since = now;
+        _holds++;
+        power._changed(_type, true, now);
+    }
+    portEXIT_CRITICAL_SAFE(&power._lock);
+    if (_handle) esp_pm_lock_acquire(_handle);
+}
+
+
+void PmLock::release() {
+    uint64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_SAFE(&power._lock);
+    bool held = _depth > 0;
+    if (held && --_depth == 0) {
+        _held += now - _since;
+        power._changed(_type, false, now);
+    }
+    portEXIT_CRITICAL_SAFE(&power._lock);
+    if (held && _handle) esp_pm_lock_release(_handle);
+}
+
+
+uint64_t PmLock::held_us() {
+    uint64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&power._lock);
+    uint64_t held = _held + (_depth ? now - _since : 0);
+    portEXIT_CRITICAL(&power._lock);
+    return held;
+}
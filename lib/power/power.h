@@ -0,0 +1,153 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_wifi_types.h>
+
+#ifndef POWER_MODE
+#define POWER_MODE POWER_PERFORMANCE    // until changed with the "pm" command
+#endif
+#define POWER_ESTIMATE_INTERVAL 1000    // ms between current estimate updates
+#define PM_LOCK_TYPES 3                 // ESP_PM_CPU_FREQ_MAX, _APB_FREQ_MAX, _NO_LIGHT_SLEEP
+
+enum PowerMode : uint8_t {
+    POWER_PERFORMANCE,      // 240 MHz fixed, radio always listening, loop spins
+    POWER_BALANCED,         // DFS 240/80 MHz, modem sleep between DTIMs, loop idles
+    POWER_LOW,              // DFS 160/40 MHz, light sleep when allowed, max modem sleep
+    POWER_MODE_COUNT
+};
+
+// Accumulated since boot for one mode, whenever it was the active one
+struct PowerModeStats {
+    uint64_t us;
+    uint64_t awake_us;      // main loop working rather than idling
+    float average_mA;       // estimate, see Power
+};
+
+class PmLock;
+
+/**
+ * Power management: ESP-IDF dynamic frequency scaling, automatic light
+ * sleep and WiFi modem sleep, chosen as one of three modes (a setting kept
+ * in NVS, like the telemetry encoding).
+ *
+ * None of it helps while loop() spins, so outside performance mode the
+ * main loop blocks in idle() between passes; the RTOS then drops the CPU to
+ * the minimum frequency, or into light sleep, until the next pass or
+ * interrupt. Anything that can't tolerate that holds a PmLock - the PWM
+ * output and ADC DMA (APB clock), I2C transactions, OTA. Modem sleep keeps
+ * the association and wakes for every DTIM, so the 30 s MQTT keepalive is
+ * never at risk.
+ *
+ * Average current is an estimate, not a measurement - the INA219 and the
+ * ACS712 sit on the cell, not the board supply. Time awake, time idle and
+ * time under each lock type are weighted with typical ESP32-S3 figures
+ * (power.cpp) and kept per mode, so modes can be compared on the same unit.
+ *
+ * The arduino-esp32 2.x core is built without tickless idle; there
+ * esp_pm_configure() refuses light sleep, and low mode falls back to DFS
+ * and modem sleep, which light_sleep_enabled() reports. Light sleep also
+ * waits for every APB lock, so with the cell running it mostly doesn't
+ * happen - DFS and modem sleep are where the savings come from.
+ */
+class Power {
+
+    public:
+
+        void begin();                       // setup(), main task
+        void loop();
+
+        PowerMode mode() { return _mode; }
+        bool set_mode(const char * name);   // main task, persisted
+        static const char * name(PowerMode);
+        static bool parse(const char * name, PowerMode &);
+        size_t describe(char *, size_t);    // mode, clocks, sleep settings
+
+        wifi_ps_type_t wifi_ps();
+        void apply_wifi();                  // once the STA interface exists
+        bool pm_available() { return _pm_ok; }
+        bool light_sleep_enabled() { return _light_sleep_ok; }
+
+        // End of a main loop pass; blocks up to next_due_ms unless in performance mode
+        void idle(uint32_t next_due_ms);
+
+        bool mode_stats(PowerMode, PowerModeStats &);
+        float estimate_mA();                // current mode, last interval
+
+        int lock_count();
+        PmLock * lock(int index);
+        static const char * lock_type_name(esp_pm_lock_type_t);
+
+    private:
+
+        friend class PmLock;
+
+        PowerMode _mode = POWER_MODE;
+        bool _begun = false;
+        bool _pm_ok = false;
+        bool _light_sleep_ok = false;
+
+        // Per lock type: how many holders, since when, and total held
+        uint16_t _type_depth[PM_LOCK_TYPES] = {};
+        uint64_t _type_since[PM_LOCK_TYPES] = {};
+        uint64_t _type_held[PM_LOCK_TYPES] = {};
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+        uint64_t _idle_us = 0;
+        uint64_t _sample_us = 0;
+        uint64_t _sample_idle = 0;
+        uint64_t _sample_held[PM_LOCK_TYPES] = {};
+        unsigned long _sample_timer = 0;
+        float _estimate = 0;
+        PowerModeStats _stats[POWER_MODE_COUNT] = {};
+
+        void _apply();
+        void _sample();
+        uint64_t _held_us(esp_pm_lock_type_t, uint64_t now);
+        void _changed(esp_pm_lock_type_t, bool acquired, uint64_t now);
+
+};
+
+extern Power power;
+
+
+/**
+ * A named ESP-IDF power-management lock. acquire()/release() nest and may be
+ * called from any task or esp_timer callback; while held the chip doesn't
+ * drop below what the type asks for. Without CONFIG_PM_ENABLE they only
+ * count, so the estimate and "pm" still show who would hold the chip awake.
+ *
+ * Locks are static or long-lived objects; each registers itself so "pm"
+ * can list them.
+ */
+class PmLock {
+
+    public:
+
+        PmLock(esp_pm_lock_type_t type, const char * name);
+
+        void acquire();
+        void release();
+
+        const char * name() { return _name; }
+        esp_pm_lock_type_t type() { return _type; }
+        bool held() { return _depth > 0; }
+        uint32_t holds() { return _holds; }
+        uint64_t held_us();
+
+    private:
+
+        friend class Power;
+
+        esp_pm_lock_type_t _type;
+        const char * _name;
+        esp_pm_lock_handle_t _handle = nullptr;
+        volatile uint16_t _depth = 0;
+        uint32_t _holds = 0;
+        uint64_t _since = 0;
+        uint64_t _held = 0;
+        PmLock * _next = nullptr;
+
+        static PmLock * _head;
+
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+// Trip / retry / lockout logic for the overcurrent path. Plain state and
+// times passed in, kept free of Arduino and IDF headers so the sequence can
+// be checked off-target; Protection serialises the calls.
+
+enum FaultState : uint8_t {
+    FAULT_ARMED,        // output allowed, a trip latches
+    FAULT_TRIPPED,      // output held off until the retry time
+    FAULT_LOCKOUT,      // too many trips in a row - held off until clear()
+    FAULT_STATE_COUNT
+};
+
+/**
+ * Every trip in a streak doubles the wait before the automatic retry
+ * (retry_ms, 2 x retry_ms ... capped at retry_max_ms). The streak ends once
+ * the output has run stable_ms after a retry without tripping; a streak
+ * longer than retries ends in lockout instead of another retry.
+ */
+class FaultLatch {
+
+    public:
+
+        FaultLatch(uint32_t retry_ms, uint32_t retry_max_ms, uint8_t retries, uint32_t stable_ms)
+            : _retry_ms(retry_ms), _retry_max_ms(retry_max_ms), _retries(retries), _stable_ms(stable_ms) {}
+
+        // True when this trip latched; trips while already held off are ignored
+        bool trip(int64_t now_us) {
+            if (_state != FAULT_ARMED) return false;
+            _expire(now_us);
+            _streak++;
+            _tripped_at = now_us;
+            if (_streak > _retries) {
+                _state = FAULT_LOCKOUT;
+                return true;
+            }
+            uint64_t wait_ms = (uint64_t) _retry_ms << (_streak - 1 < 16 ? _streak - 1 : 16);
+            if (wait_ms > _retry_max_ms) wait_ms = _retry_max_ms;
+            _retry_at = now_us + (int64_t) wait_ms * 1000;
+            _state = FAULT_TRIPPED;
+            return true;
+        }
+
+        // True when the retry is due; the latch re-arms and the output may restart
+        bool poll(int64_t now_us) {
+            if (_state == FAULT_ARMED) _expire(now_us);
+            if (_state != FAULT_TRIPPED || now_us < _retry_at) return false;
+            _state = FAULT_ARMED;
+            _armed_at = now_us;
+            return true;
+        }
+
+        // Manual reset, the only way out of lockout
+        void clear(int64_t now_us) {
+            _state = FAULT_ARMED;
+            _streak = 0;
+            _armed_at = now_us;
+        }
+
+        FaultState state() const { return _state; }
+        uint8_t streak() const { return _streak; }
+        int64_t tripped_at() const { return _tripped_at; }
+        int64_t retry_at() const { return _state == FAULT_TRIPPED ? _retry_at : 0; }
+
+    private:
+
+        uint32_t _retry_ms;
+        uint32_t _retry_max_ms;
+        uint8_t _retries;
+        uint32_t _stable_ms;
+
+        FaultState _state = FAULT_ARMED;
+        uint8_t _streak = 0;
+        int64_t _tripped_at = 0;
+        int64_t _retry_at = 0;
+        int64_t _armed_at = 0;
+
+        void _expire(int64_t now_us) {
+            if (_streak && now_us - _armed_at >= (int64_t) _stable_ms * 1000) _streak = 0;
+        }
+
+};
@@ -0,0 +1,107 @@
+#include "protection.h"
+#include "current_adc.h"
+#include "../telnet/telnet.h"
+#include <esp_timer.h>
+
+Protection protection;
+
+static const char *const SOURCE_NAMES[TRIP_SOURCE_COUNT] = {"alert", "acs712", "ina219", "test"};
+static const char *const STATE_NAMES[FAULT_STATE_COUNT] = {"armed", "tripped", "lockout"};
+
+
+void Protection::begin(Motor * motor) {
+    _motor = motor;
+    current_adc.watch_limit(PROTECTION_TRIP_MA, PROTECTION_TRIP_SAMPLES, _on_limit);
+    if (PROTECTION_ALERT_PIN >= 0) {
+        pinMode(PROTECTION_ALERT_PIN, INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(PROTECTION_ALERT_PIN), _on_alert, FALLING);
+    }
+    Serial.printf("\tProtection: trip at %.0f mA, retry after %d s, lockout after %d trips\n",
+                  PROTECTION_TRIP_MA, PROTECTION_RETRY_MS / 1000, PROTECTION_RETRIES);
+}
+
+
+void Protection::_on_alert() {
+    protection.trip(TRIP_ALERT, esp_timer_get_time());
+}
+
+void Protection::_on_limit(int64_t sample_us) {
+    protection.trip(TRIP_ACS712, sample_us);
+}
+
+
+// Latch, then cut. Only the first trip of a fault cuts; the rest are
+// already held off and don't count
+void Protection::trip(TripSource source, int64_t detected_us) {
+    portENTER_CRITICAL_SAFE(&_lock);
+    bool latched = _latch.trip(detected_us);
+    portEXIT_CRITICAL_SAFE(&_lock);
+    if (!latched) return;
+
+    if (_motor) _motor->trip();
+    uint32_t latency = (uint32_t) (esp_timer_get_time() - detected_us);
+    _trips[source]++;
+    _last_source = source;
+    _last_latency = latency;
+    if (latency > _max_latency) _max_latency = latency;
+    _reported = false;
+}
+
+
+void Protection::check(float current_mA, int64_t read_us) {
+    if (fabsf(current_mA) > PROTECTION_TRIP_MA) trip(TRIP_INA219, read_us);
+}
+
+
+void Protection::loop() {
+    if (!_reported) {
+        _reported = true;
+        // After a trip from an ISR this kicks the driver's bookkeeping
+        if (_motor && _motor->isTripped()) _motor->trip();
+        char line[128];
+        int32_t retry = retry_in_ms();
+        snprintf(line, sizeof(line), "\tOvercurrent trip (%s), cut in %lu us, %s", source_name(_last_source),
+                 (unsigned long) _last_latency, state() == FAULT_LOCKOUT ? "locked out - fault clear" : "retrying in ");
+        telnet.print(line);
+        if (retry >= 0) {
+            snprintf(line, sizeof(line), "%ld s", (long) (retry / 1000));
+            telnet.print(line);
+        }
+        telnet.println("");
+    }
+
+    portENTER_CRITICAL(&_lock);
+    bool retry = _latch.poll(esp_timer_get_time());
+    portEXIT_CRITICAL(&_lock);
+    if (retry && _motor) {
+        _motor->clearTrip();
+        telnet.println("\tOvercurrent: retrying output");
+    }
+}
+
+
+void Protection::clear() {
+    portENTER_CRITICAL(&_lock);
+    _latch.clear(esp_timer_get_time());
+    portEXIT_CRITICAL(&_lock);
+    if (_motor && _motor->isTripped()) _motor->clearTrip();
+}
+
+
+int32_t Protection::retry_in_ms() {
+    portENTER_CRITICAL(&_lock);
+    int64_t at = _latch.retry_at();
+    portEXIT_CRITICAL(&_lock);
+    if (!at) return -1;
+    int64_t left = at - esp_timer_get_time();
+    return left > 0 ? (int32_t) (left / 1000) : 0;
+}
+
+
+const char * Protection::source_name(TripSource source) {
+    return source < TRIP_SOURCE_COUNT ? SOURCE_NAMES[source] : "?";
+}
+
+const char * Protection::state_name(FaultState state) {
+    return state < FAULT_STATE_COUNT ? STATE_NAMES[state] : "?";
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Arduino.h>
+#include "fault_latch.h"
+#include "motor.h"
+
+#define PROTECTION_TRIP_MA 2500.0       // |cell current| that trips; the 5 A ACS712 clips near 3.2 A on the ADC
+#define PROTECTION_TRIP_SAMPLES 4       // consecutive ACS712 samples over the limit, 200 us at 20 kHz
+#define PROTECTION_ALERT_PIN -1         // active-low comparator or driver fault output, -1 = not fitted
+#define PROTECTION_RETRY_MS 5000        // first automatic retry, doubling with each trip in a streak
+#define PROTECTION_RETRY_MAX_MS 300000
+#define PROTECTION_RETRIES 5            // trips in a streak before lockout
+#define PROTECTION_STABLE_MS 60000      // running this long after a retry ends the streak
+
+enum TripSource : uint8_t {
+    TRIP_ALERT,         // GPIO interrupt from PROTECTION_ALERT_PIN
+    TRIP_ACS712,        // sample-by-sample check in the ADC reader task
+    TRIP_INA219,        // every reading, the slow backstop
+    TRIP_TEST,          // "fault test"
+    TRIP_SOURCE_COUNT
+};
+
+/**
+ * Overcurrent fast trip for the cell driver.
+ *
+ * The INA219 has no alert pin and the ACS712 no comparator, so detection
+ * runs where the samples already are: every ACS712 sample is checked as the
+ * reader task takes it off the DMA, and every INA219 reading as a backstop.
+ * An external comparator or driver fault line on PROTECTION_ALERT_PIN trips
+ * from its GPIO interrupt. Either way MotorDriver::trip() cuts the pin in
+ * the detecting context, with no hop through the main loop.
+ *
+ * Latency is from the detecting sample (or interrupt) to the cut: for the
+ * ACS712 that includes the DMA frame the sample sat in, for the INA219 the
+ * bus task's read. The retry schedule is in FaultLatch.
+ */
+class Protection {
+
+    public:
+
+        void begin(Motor *);
+        void loop();
+
+        void trip(TripSource, int64_t detected_us);     // any context, ISR included
+        void check(float current_mA, int64_t read_us);  // INA219 backstop
+        void clear();
+
+        FaultState state() { return _latch.state(); }
+        uint8_t streak() { return _latch.streak(); }
+        int32_t retry_in_ms();                          // -1 unless waiting to retry
+        uint32_t trips(TripSource source) { return source < TRIP_SOURCE_COUNT ? _trips[source] : 0; }
+        TripSource last_source() { return _last_source; }
+        uint32_t last_latency_us() { return _last_latency; }
+        uint32_t max_latency_us() { return _max_latency; }
+
+        static const char * source_name(TripSource);
+        static const char * state_name(FaultState);
+
+    private:
+
+        Motor * _motor = nullptr;
+        FaultLatch _latch{PROTECTION_RETRY_MS, PROTECTION_RETRY_MAX_MS, PROTECTION_RETRIES, PROTECTION_STABLE_MS};
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+        volatile bool _reported = true;     // the last trip has been logged
+        volatile uint32_t _trips[TRIP_SOURCE_COUNT] = {};
+        volatile TripSource _last_source = TRIP_TEST;
+        volatile uint32_t _last_latency = 0;
+        volatile uint32_t _max_latency = 0;
+
+        static void _on_alert();
+        static void _on_limit(int64_t sample_us);
+
+};
+
+extern Protection protection;
@@ -1,163 +1,142 @@
 #pragma once
 
-const char CONFIG_PAGE[] PROGMEM = R"(
+// Generated by dev/gzip_pages.py from dev/*.html - edit those and rerun
 
-<!DOCTYPE HTML>
-<html>
-    <head>
-        <meta charset="UTF-8">
-        <meta name="viewport" content="width=device-width, initial-scale=1.0">
-        <style>
-            * {
-                box-sizing: border-box;
-                font-family: arial;
-            }
-            #container {
-                width: 300px;
-                margin: 0 auto;
-                text-align: center;
-            }
-            h1 {
-                font-size: 24px;
-                margin: 8vh auto 4vh;
-            }
-            div {
-                width: 220px;
-                margin: 14px auto 2px;
-                text-align: left;
-            }            
-            input {
-                width: 220px;
-                padding: 5px 10px;
-                border: 1px solid #aaa;
-                border-radius: 4px;
-            }
-            input[type="submit"] {
-                width: 80px;
-                margin-top: 30px;
-                border-radius: 6px;
-                background-color: #ddd;
-                font-size: 16px;
-            }
-        </style>
-    </head>
-    <body>
-        <div id="container">
-            <h1>Device Provisioning</h1>
-            <form action="/save">
-                
-                <div>SSID:</div>
-                <input maxlength="32" type="text" id="ssid" name="ssid" required placeholder="Enter WiFI SSID"><br>
-                
-                <div>PASS:</div>
-                <input maxlength="32" type="text" id="pass" name="pass" required placeholder="Enter WiFI Password"><br>
+#include <Arduino.h>
 
-                <input type="submit" value="Save">
-            </form>
-        </div>
-    </body>
-</html>
+// config.html: 2131 bytes, 760 gzipped
+const uint8_t CONFIG_PAGE[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x56, 0x5d, 0x6f, 0xd3, 0x30,
+    0x14, 0x7d, 0xdf, 0xaf, 0x30, 0xde, 0x43, 0x5b, 0x20, 0x49, 0xdb, 0x8d, 0x69, 0xea, 0x92, 0x4a,
+    0x8c, 0x75, 0x62, 0x12, 0x88, 0x4a, 0x1d, 0x42, 0x08, 0xf1, 0xe0, 0xc6, 0x6e, 0x63, 0x70, 0xec,
+    0x60, 0x3b, 0xd9, 0x0a, 0xea, 0x7f, 0xe7, 0x3a, 0xe9, 0xb6, 0xb4, 0x49, 0x0b, 0x08, 0x3f, 0xdd,
+    0x6b, 0x9f, 0xfa, 0x9e, 0x73, 0x3f, 0x9c, 0x1e, 0x85, 0xcf, 0xae, 0x3e, 0xbc, 0xb9, 0xfd, 0x3c,
+    0x9d, 0xa0, 0xb7, 0xb7, 0xef, 0xdf, 0x8d, 0x8f, 0xc2, 0xc4, 0xa6, 0x62, 0x7c, 0x84, 0x60, 0x85,
+    0x09, 0x23, 0xb4, 0x32, 0x4b, 0x37, 0x65, 0x96, 0xa0, 0x38, 0x21, 0xda, 0x30, 0x1b, 0xe1, 0x8f,
+    0xb7, 0xd7, 0xde, 0x39, 0xde, 0x3d, 0x96, 0x24, 0x65, 0x11, 0x2e, 0x38, 0xbb, 0xcb, 0x94, 0xb6,
+    0x18, 0xc5, 0x4a, 0x5a, 0x26, 0x01, 0x7e, 0xc7, 0xa9, 0x4d, 0x22, 0xca, 0x0a, 0x1e, 0x33, 0xaf,
+    0x74, 0x5e, 0x22, 0x2e, 0xb9, 0xe5, 0x44, 0x78, 0x26, 0x26, 0x82, 0x45, 0x03, 0xbf, 0x5f, 0xbf,
+    0xce, 0xd8, 0x95, 0x60, 0x4f, 0xbe, 0x5b, 0xcf, 0xd1, 0xaf, 0x2d, 0xdf, 0xad, 0xb9, 0xba, 0xf7,
+    0x0c, 0xff, 0xc9, 0xe5, 0x72, 0x04, 0xb6, 0xa6, 0x4c, 0x7b, 0xb0, 0x75, 0xd1, 0xc0, 0x2d, 0x80,
+    0x88, 0xb7, 0x20, 0x29, 0x17, 0xab, 0x11, 0x22, 0x1a, 0xc2, 0x6e, 0x63, 0xd6, 0x5b, 0xde, 0xb1,
+    0xe3, 0x4d, 0xb8, 0x64, 0xba, 0x25, 0x64, 0xc9, 0x7e, 0x84, 0x4e, 0xfa, 0xfd, 0xac, 0x25, 0x50,
+    0x4a, 0xf4, 0x92, 0xcb, 0x11, 0xea, 0x23, 0x92, 0x5b, 0xd5, 0x3c, 0xb7, 0xec, 0xde, 0x7a, 0x44,
+    0xf0, 0x25, 0x60, 0x62, 0x48, 0x0d, 0xd3, 0x87, 0x88, 0x24, 0x83, 0x16, 0x02, 0xa5, 0x16, 0x10,
+    0xcd, 0x46, 0x68, 0x78, 0x7a, 0x88, 0xc3, 0x79, 0x91, 0x94, 0x2c, 0xd0, 0x69, 0x91, 0x1c, 0x8a,
+    0x42, 0x79, 0xb1, 0x5f, 0xe7, 0x70, 0x78, 0x50, 0xe7, 0x00, 0x18, 0x54, 0x41, 0x86, 0x6d, 0xb0,
+    0xba, 0x5c, 0xc1, 0x16, 0x76, 0x87, 0x46, 0xdd, 0xd9, 0x3a, 0xe1, 0x32, 0xcb, 0xed, 0x3f, 0x93,
+    0xca, 0x08, 0xa5, 0x65, 0x2b, 0xbc, 0x02, 0x52, 0x83, 0x56, 0x48, 0xd5, 0x24, 0xc0, 0x1b, 0x10,
+    0x46, 0x09, 0x4e, 0xd1, 0x31, 0x21, 0x64, 0x1f, 0xce, 0xd3, 0x84, 0xf2, 0xdc, 0x8c, 0x50, 0x23,
+    0xcf, 0xeb, 0x26, 0xdd, 0x2f, 0x76, 0x95, 0x41, 0xf7, 0x9b, 0x7c, 0x9e, 0x72, 0x8b, 0xbf, 0xee,
+    0x67, 0x7f, 0x7e, 0x20, 0xa3, 0x9e, 0x55, 0x99, 0x6b, 0xae, 0xfd, 0xdc, 0x1f, 0x39, 0x9d, 0xb5,
+    0x62, 0x48, 0xfc, 0x7d, 0xa9, 0x55, 0x2e, 0xa9, 0x17, 0x2b, 0xa1, 0x40, 0xe9, 0x31, 0xa5, 0xf4,
+    0xe2, 0x50, 0x13, 0x0d, 0xce, 0xf6, 0x8b, 0x0b, 0x83, 0xda, 0x20, 0x86, 0xc1, 0xd3, 0x93, 0x10,
+    0xce, 0x15, 0x5d, 0xd5, 0xe6, 0xd5, 0xf5, 0x10, 0xa7, 0x11, 0x7e, 0x9c, 0x1c, 0xbc, 0x3d, 0xbc,
+    0x61, 0x32, 0x18, 0x5f, 0x95, 0xe3, 0x8f, 0xa6, 0x5a, 0x15, 0xdc, 0x70, 0x25, 0xa1, 0x54, 0x70,
+    0xe5, 0x60, 0x07, 0xb8, 0x50, 0x3a, 0x45, 0x24, 0xb6, 0x00, 0x88, 0x70, 0x60, 0x48, 0xc1, 0x76,
+    0xae, 0x6a, 0x34, 0xcb, 0x03, 0x81, 0xf1, 0x6c, 0x76, 0x73, 0x35, 0x0a, 0x03, 0x67, 0x36, 0x01,
+    0x55, 0x4b, 0xa5, 0xe4, 0x5e, 0x30, 0xb9, 0x84, 0xc7, 0x08, 0x9f, 0x0c, 0x31, 0xaa, 0x4a, 0xe6,
+    0xba, 0x14, 0x97, 0xf4, 0x8d, 0xe1, 0x14, 0x6f, 0x9e, 0xb1, 0xca, 0x16, 0xdc, 0xd8, 0xca, 0x36,
+    0x18, 0x69, 0xf6, 0x23, 0xe7, 0x9a, 0x51, 0x94, 0x09, 0x12, 0xb3, 0x44, 0x09, 0xa8, 0x47, 0x84,
+    0x27, 0x6e, 0x8c, 0xd1, 0x27, 0x7e, 0x7d, 0x83, 0x1c, 0x03, 0x3c, 0x0e, 0xe7, 0xba, 0x85, 0x00,
+    0x25, 0x96, 0xb8, 0xdb, 0x1e, 0x03, 0x19, 0x40, 0x06, 0x0f, 0xbb, 0x7f, 0xab, 0x71, 0xfa, 0x7a,
+    0x36, 0xfb, 0x3f, 0x8d, 0x19, 0x31, 0xe6, 0x41, 0x63, 0x65, 0xff, 0x51, 0xd6, 0x14, 0x60, 0x77,
+    0xd0, 0x7d, 0x1b, 0x69, 0xfb, 0x02, 0x6f, 0x0d, 0x00, 0x2a, 0x88, 0xc8, 0xc1, 0x9d, 0x35, 0x2b,
+    0x18, 0x06, 0xae, 0xc8, 0xb5, 0xee, 0xd9, 0x96, 0x13, 0x9a, 0x58, 0xf3, 0x6c, 0x27, 0x23, 0x0b,
+    0x66, 0xe3, 0xa4, 0xdb, 0x09, 0xe0, 0x6b, 0x21, 0x3b, 0x3d, 0xdf, 0x26, 0x4c, 0x76, 0x35, 0x8a,
+    0xc6, 0x48, 0xfb, 0xdf, 0x8c, 0x92, 0xdd, 0xde, 0x66, 0xaf, 0xcc, 0x30, 0x6c, 0x37, 0xa7, 0x0f,
+    0x5a, 0x13, 0x8e, 0xa8, 0x40, 0x11, 0xa2, 0x2a, 0xce, 0x53, 0x78, 0x7d, 0xfd, 0x25, 0xb3, 0x13,
+    0xc1, 0x9c, 0x79, 0xb9, 0xba, 0xa1, 0xdd, 0x4e, 0x59, 0x96, 0x4e, 0xaf, 0x39, 0x2f, 0xee, 0x5a,
+    0x1f, 0x58, 0x4f, 0x08, 0xb0, 0x90, 0xed, 0x01, 0x9e, 0x82, 0xa8, 0x7a, 0x8c, 0x58, 0x33, 0x62,
+    0xd9, 0x26, 0x4c, 0xb7, 0xa3, 0x32, 0xd7, 0xda, 0x6d, 0x31, 0xdc, 0x52, 0x7e, 0x99, 0x36, 0xf8,
+    0xbd, 0xf4, 0x1d, 0x99, 0x7d, 0x28, 0x41, 0xe6, 0x4c, 0x94, 0x28, 0x0d, 0x30, 0xf4, 0x02, 0x75,
+    0x10, 0xbd, 0x4c, 0x3b, 0xed, 0x70, 0x2a, 0x7c, 0x92, 0x65, 0x4c, 0xd2, 0x37, 0x09, 0x17, 0xb4,
+    0xab, 0x5a, 0x62, 0xaf, 0x77, 0xf6, 0xd6, 0x3d, 0x3f, 0x26, 0x2e, 0xe3, 0xdd, 0x5e, 0x29, 0xb6,
+    0x7e, 0x0e, 0x8f, 0x42, 0xad, 0x40, 0x61, 0x50, 0x3d, 0x05, 0x30, 0xca, 0xee, 0xbf, 0xc3, 0x6f,
+    0x07, 0x6c, 0x2c, 0x8e, 0x53, 0x08, 0x00, 0x00,
+};
+const size_t CONFIG_PAGE_LEN = sizeof(CONFIG_PAGE);
+const char CONFIG_PAGE_ETAG[] = "\"aaa74e57369ad5fd\"";
 
-)";
+// saved.html: 1461 bytes, 610 gzipped
+const uint8_t SAVED_PAGE[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x54, 0xc1, 0x72, 0xda, 0x30,
+    0x10, 0xbd, 0xe7, 0x2b, 0x36, 0xca, 0xad, 0x53, 0x63, 0x83, 0x71, 0x93, 0xa1, 0x36, 0x87, 0x26,
+    0xcd, 0xf4, 0xd0, 0x4c, 0xd3, 0x69, 0x7a, 0xc8, 0x51, 0x91, 0x17, 0xa4, 0x89, 0x90, 0x18, 0x49,
+    0xb1, 0xa1, 0x99, 0xfe, 0x7b, 0xd7, 0x36, 0x24, 0x86, 0x10, 0x66, 0xaa, 0x81, 0xc1, 0x8b, 0x56,
+    0xef, 0xbd, 0x5d, 0xbd, 0xf5, 0x49, 0x7e, 0x7a, 0xf5, 0xe3, 0xf2, 0xee, 0xfe, 0xf6, 0x2b, 0x7c,
+    0xbb, 0xbb, 0xf9, 0x3e, 0x3d, 0xc9, 0x65, 0x58, 0xe8, 0xe9, 0x09, 0xd0, 0xca, 0x25, 0xf2, 0xb2,
+    0x7b, 0x6c, 0xc3, 0x05, 0x06, 0x0e, 0x42, 0x72, 0xe7, 0x31, 0x14, 0xec, 0xf7, 0xdd, 0x75, 0x74,
+    0xc1, 0xf6, 0xb7, 0x0d, 0x5f, 0x60, 0xc1, 0x2a, 0x85, 0xf5, 0xd2, 0xba, 0xc0, 0x40, 0x58, 0x13,
+    0xd0, 0x50, 0x7a, 0xad, 0xca, 0x20, 0x8b, 0x12, 0x2b, 0x25, 0x30, 0x6a, 0x83, 0x8f, 0xa0, 0x8c,
+    0x0a, 0x8a, 0xeb, 0xc8, 0x0b, 0xae, 0xb1, 0x18, 0x0e, 0x92, 0x3e, 0x9c, 0x0f, 0x6b, 0x8d, 0xaf,
+    0x71, 0xb3, 0x3e, 0xc0, 0xf3, 0x4e, 0xdc, 0xac, 0x07, 0xbb, 0x8a, 0xbc, 0xfa, 0xa3, 0xcc, 0x7c,
+    0x42, 0xcf, 0xae, 0x44, 0x17, 0xd1, 0x5f, 0x9f, 0xdf, 0xe4, 0xcd, 0x48, 0x48, 0x34, 0xe3, 0x0b,
+    0xa5, 0xd7, 0x13, 0xe0, 0x8e, 0x68, 0x77, 0x73, 0xfe, 0xee, 0x44, 0x67, 0x8d, 0x6e, 0xae, 0x0c,
+    0xba, 0x03, 0x94, 0xad, 0xfa, 0x09, 0xa4, 0x49, 0xb2, 0x3c, 0x40, 0xb4, 0xe0, 0x6e, 0xae, 0xcc,
+    0x04, 0x12, 0xe0, 0x4f, 0xc1, 0xbe, 0xdd, 0x0f, 0xb8, 0x0a, 0x11, 0xd7, 0x6a, 0x4e, 0x39, 0x82,
+    0x5a, 0x83, 0xee, 0x98, 0x10, 0x39, 0x3c, 0x20, 0xa0, 0xad, 0x85, 0x8a, 0xc6, 0x09, 0x8c, 0xc6,
+    0xc7, 0x34, 0x5c, 0x54, 0xb2, 0x55, 0x01, 0xe3, 0x4a, 0x1e, 0x63, 0x29, 0x55, 0xf5, 0x7e, 0x9d,
+    0xa3, 0xd1, 0xd1, 0x3a, 0x87, 0xa4, 0xa0, 0x23, 0x19, 0x1d, 0x4a, 0xeb, 0x97, 0xab, 0x71, 0x16,
+    0xf6, 0x64, 0xf4, 0x83, 0x9d, 0x1d, 0x5f, 0xcd, 0x0f, 0x48, 0xda, 0x92, 0x8e, 0x93, 0x0d, 0xe9,
+    0x5b, 0xc2, 0x52, 0xf9, 0xa5, 0xe6, 0x74, 0xc9, 0x0f, 0xda, 0x8a, 0xc7, 0xf7, 0xaa, 0xce, 0xe3,
+    0x9e, 0xbf, 0xf2, 0xf8, 0xd5, 0xe9, 0xf9, 0x83, 0x2d, 0xd7, 0x3d, 0x1b, 0x36, 0xad, 0x51, 0x65,
+    0xc1, 0x5e, 0x0c, 0xc1, 0x76, 0x3d, 0x99, 0xcb, 0xe1, 0xf4, 0xaa, 0x75, 0x35, 0xdc, 0x3a, 0x5b,
+    0x29, 0xaf, 0xac, 0x21, 0x33, 0x12, 0xe4, 0x70, 0x3f, 0x31, 0x9d, 0x5e, 0x3a, 0x2c, 0xe9, 0xca,
+    0xc9, 0x7c, 0x1e, 0x7e, 0xf1, 0x0a, 0xcb, 0x53, 0xca, 0x4b, 0xf7, 0xf2, 0x88, 0x71, 0x7a, 0x6f,
+    0x9f, 0x1c, 0x74, 0xc3, 0x42, 0xd7, 0xa0, 0x35, 0x18, 0x5b, 0x37, 0xb3, 0x64, 0x50, 0x04, 0xa0,
+    0x56, 0xaf, 0x9b, 0x7d, 0x83, 0xa1, 0xb6, 0xee, 0x71, 0x00, 0x40, 0xe9, 0x20, 0xb8, 0x01, 0xa1,
+    0xad, 0x47, 0x08, 0x52, 0x79, 0xf0, 0xc2, 0x21, 0x9a, 0x41, 0x1e, 0x37, 0x70, 0xbd, 0xb2, 0xdb,
+    0xb0, 0x37, 0x65, 0xd4, 0xe6, 0x6e, 0x34, 0xd9, 0x28, 0x49, 0x18, 0x48, 0x54, 0x73, 0x19, 0x36,
+    0x41, 0x33, 0xc6, 0x5f, 0xec, 0xaa, 0x60, 0x09, 0xb9, 0x79, 0x98, 0xb4, 0x5f, 0x06, 0xab, 0x85,
+    0x36, 0xbe, 0x60, 0x32, 0x84, 0xe5, 0x24, 0x8e, 0xeb, 0xba, 0x1e, 0xd4, 0xe9, 0xc0, 0xba, 0x79,
+    0x4c, 0x67, 0x92, 0x98, 0x00, 0xf7, 0x3b, 0x24, 0x94, 0x13, 0x1a, 0x41, 0x10, 0x50, 0x46, 0xe7,
+    0xc5, 0xba, 0xfb, 0x75, 0x05, 0x1b, 0x67, 0x0c, 0x66, 0x54, 0x5e, 0xc1, 0xce, 0xae, 0xaf, 0xaf,
+    0xce, 0x1b, 0x74, 0x1f, 0x9c, 0x7d, 0xa4, 0x57, 0xc8, 0x59, 0x9a, 0xa6, 0xdb, 0x28, 0xda, 0x2a,
+    0x64, 0xf1, 0xfb, 0xd0, 0x69, 0xd6, 0x41, 0x8f, 0x3b, 0xe8, 0x57, 0xe4, 0x06, 0xe8, 0xc8, 0xb9,
+    0x4f, 0xff, 0x73, 0x6e, 0xc9, 0x83, 0x04, 0x72, 0xc3, 0x0d, 0x4d, 0x3f, 0x64, 0x19, 0xfc, 0x84,
+    0x2c, 0x81, 0xf3, 0xf6, 0x93, 0x65, 0xc7, 0xc5, 0xa7, 0x5b, 0x60, 0x63, 0x0d, 0xbe, 0x6c, 0x6a,
+    0xb2, 0x94, 0xe0, 0xcb, 0x82, 0x39, 0xfb, 0x64, 0xca, 0x3e, 0x5f, 0xde, 0xb4, 0x72, 0x73, 0x55,
+    0x79, 0xdc, 0xb9, 0x92, 0xdc, 0xd2, 0xbc, 0x9d, 0xff, 0x01, 0xc6, 0x8a, 0x3d, 0x5b, 0xb5, 0x05,
+    0x00, 0x00,
+};
+const size_t SAVED_PAGE_LEN = sizeof(SAVED_PAGE);
+const char SAVED_PAGE_ETAG[] = "\"f6b2dbda856de1ba\"";
 
-
-
-const char SAVED_PAGE[] PROGMEM = R"(
-
-<!DOCTYPE HTML>
-<html>
-    <head>
-        <meta charset="UTF-8">
-        <meta name="viewport" content="width=device-width, initial-scale=1.0">
-        <style>
-            * {
-                box-sizing: border-box;
-                font-family: arial;
-            }
-            #container {
-                width: 300px;
-                margin: 0 auto;
-                text-align: center;
-            }
-            h1 {
-                font-size: 24px;
-                margin: 8vh auto 4vh;
-            }
-            div {
-                width: 220px;
-                margin: 14px auto 2px;
-                text-align: left;
-            }            
-            svg {
-                margin: 40px auto;
-                display: block;
-            }
-        </style>
-    </head>
-    <body>
-        <div id="container">
-            <h1>Device Provisioning</h1>
-            <h3>Credentials Saved!</h3>
-            <div>Your device will now connect to your network.  You can close this screen.</div>
-        </div>
-        <svg width="200" height="200" viewBox="0 0 100 100" xmlns="http://www.w3.org/2000/svg">
-            <circle cx="50" cy="50" r="45" fill="#FFD700" stroke="#333" stroke-width="2"/>
-            <circle cx="35" cy="40" r="5" fill="#333"/>
-            <circle cx="65" cy="40" r="5" fill="#333"/>
-            <path d="M 30 55 Q 50 70 70 55" stroke="#333" stroke-width="3" fill="none" stroke-linecap="round"/>
-        </svg>
-    </body>
-</html>
-
-)";
-
-
-
-const char INSTRUCTIONS_PAGE[] PROGMEM = R"(
-
-<!DOCTYPE HTML>
-<html>
-    <head>
-        <meta charset="UTF-8">
-        <meta name="viewport" content="width=device-width, initial-scale=1.0">
-        <style>
-            * {
-                box-sizing: border-box;
-                font-family: arial;
-            }
-            #container {
-                width: 300px;
-                margin: 0 auto;
-                text-align: center;
-            }
-            h1 {
-                font-size: 24px;
-                margin: 8vh auto 4vh;
-            }
-            div {
-                width: 220px;
-                margin: 14px auto 2px;
-                text-align: left;
-            }            
-            button {
-                width: 80px;
-                margin-top: 30px;
-                border-radius: 6px;
-                background-color: #ddd;
-                font-size: 16px;
-            }
-        </style>
-    </head>
-    <body>
-        <div id="container">
-            <h1>Device Provisioning</h1>
-            <h3>ERROR!</h3>
-            <div>
-                You should enter an SSID and password with lengths of at least 4.
-            </div>
-            <button onclick="window.location.href='/'">Go Back</button>
-        </div>
-    </body>
-</html>
-
-)";
\ No newline at end of file
+// instructions.html: 1239 bytes, 508 gzipped
+const uint8_t INSTRUCTIONS_PAGE[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x54, 0x4d, 0x6f, 0xe2, 0x30,
+    0x10, 0xbd, 0xf3, 0x2b, 0xa6, 0xe9, 0xa1, 0xd2, 0xaa, 0x21, 0x04, 0xd0, 0x0a, 0xa5, 0x49, 0x0e,
+    0xbb, 0x74, 0x3f, 0xa4, 0x5d, 0xb5, 0xa2, 0xec, 0xa1, 0x47, 0x13, 0x9b, 0xd8, 0xaa, 0xb1, 0x91,
+    0xed, 0x84, 0xd2, 0xd5, 0xfe, 0xf7, 0x9d, 0x04, 0x54, 0x12, 0x48, 0xe3, 0x4b, 0x3c, 0x99, 0xe7,
+    0x79, 0x6f, 0x3e, 0xec, 0x41, 0x7c, 0x35, 0x7f, 0xf8, 0xba, 0x7c, 0x7e, 0xbc, 0x87, 0x1f, 0xcb,
+    0xdf, 0xbf, 0xd2, 0x41, 0xcc, 0xdd, 0x46, 0xa6, 0x03, 0xc0, 0x15, 0x73, 0x46, 0xe8, 0x61, 0x5b,
+    0x9b, 0x1b, 0xe6, 0x08, 0x64, 0x9c, 0x18, 0xcb, 0x5c, 0xe2, 0xfd, 0x59, 0x7e, 0xf3, 0x67, 0xde,
+    0xb9, 0x5b, 0x91, 0x0d, 0x4b, 0xbc, 0x52, 0xb0, 0xdd, 0x56, 0x1b, 0xe7, 0x41, 0xa6, 0x95, 0x63,
+    0x0a, 0xe1, 0x3b, 0x41, 0x1d, 0x4f, 0x28, 0x2b, 0x45, 0xc6, 0xfc, 0xda, 0xb8, 0x05, 0xa1, 0x84,
+    0x13, 0x44, 0xfa, 0x36, 0x23, 0x92, 0x25, 0xe1, 0x70, 0xd4, 0x0c, 0x67, 0xdd, 0x5e, 0xb2, 0x93,
+    0x5d, 0xad, 0x4f, 0xf0, 0xb7, 0x65, 0x57, 0x6b, 0xa5, 0x5f, 0x7d, 0x2b, 0xde, 0x84, 0xca, 0x23,
+    0xdc, 0x1b, 0xca, 0x8c, 0x8f, 0xbf, 0xee, 0x2e, 0x70, 0x6b, 0x14, 0xe2, 0xaf, 0xc9, 0x46, 0xc8,
+    0x7d, 0x04, 0xc4, 0x20, 0x6d, 0x1b, 0xf3, 0xaf, 0x65, 0x5d, 0x57, 0xba, 0x89, 0x50, 0xcc, 0x74,
+    0x50, 0xd6, 0xea, 0x23, 0x98, 0x8c, 0x46, 0xdb, 0x0e, 0xa2, 0x0d, 0x31, 0xb9, 0x50, 0x11, 0x8c,
+    0x80, 0x14, 0x4e, 0x5f, 0xfa, 0x1d, 0x7b, 0x75, 0x3e, 0x91, 0x22, 0x47, 0x4c, 0x86, 0xa5, 0x61,
+    0xa6, 0x4f, 0x08, 0x0f, 0x3b, 0x04, 0xd4, 0xb9, 0x60, 0xd2, 0x2c, 0x82, 0xf1, 0xb4, 0x4f, 0xc3,
+    0xac, 0xe4, 0xb5, 0x0a, 0x98, 0x96, 0xbc, 0x8f, 0x85, 0x8a, 0xf2, 0xe3, 0x3c, 0xc7, 0xe3, 0xde,
+    0x3c, 0x43, 0x54, 0x70, 0x20, 0x19, 0x77, 0xc1, 0x9a, 0xe9, 0x4a, 0xb6, 0x76, 0x67, 0x32, 0x9a,
+    0x46, 0xcb, 0xb3, 0x2a, 0x9c, 0xd3, 0xea, 0x63, 0x55, 0xb3, 0x1e, 0x51, 0xbe, 0xd3, 0xdb, 0xaa,
+    0x3f, 0x5d, 0x88, 0xe3, 0x8c, 0x18, 0x42, 0x45, 0x61, 0x23, 0xf8, 0xdc, 0x89, 0x21, 0xd9, 0x4b,
+    0x6e, 0x74, 0xa1, 0xa8, 0x9f, 0x69, 0xa9, 0x4d, 0x04, 0xd7, 0x94, 0xd2, 0xbb, 0xbe, 0x3e, 0x84,
+    0x17, 0x81, 0x4e, 0x15, 0x8e, 0x83, 0xc6, 0x2c, 0xc7, 0xc1, 0xe9, 0x56, 0xc5, 0x2b, 0x4d, 0xf7,
+    0x8d, 0x91, 0xaf, 0xda, 0x20, 0x68, 0xe2, 0xbd, 0x0f, 0x9f, 0xd7, 0x9e, 0xff, 0x98, 0x87, 0xe9,
+    0xbc, 0xbe, 0x41, 0xf0, 0x68, 0x74, 0x29, 0xac, 0xd0, 0x0a, 0x07, 0x1f, 0x43, 0x86, 0x6d, 0xe0,
+    0xd9, 0xa9, 0x49, 0x7a, 0xbf, 0x58, 0x3c, 0x2c, 0xae, 0x10, 0x38, 0x49, 0x07, 0x6d, 0x27, 0x72,
+    0xa6, 0x17, 0x89, 0x3d, 0xeb, 0x02, 0x2c, 0xd7, 0x85, 0xa4, 0x50, 0x4f, 0x28, 0x10, 0x05, 0x4f,
+    0x4f, 0x3f, 0xe7, 0xf8, 0xa5, 0xb0, 0x25, 0xd6, 0xee, 0xb0, 0x8a, 0xd8, 0x09, 0xc7, 0xb1, 0xa7,
+    0x2a, 0x77, 0xdc, 0x82, 0x5e, 0x03, 0x71, 0x68, 0x11, 0xeb, 0x60, 0x3a, 0x6c, 0x73, 0x04, 0x35,
+    0x49, 0xfb, 0xdf, 0xb1, 0xbf, 0x5a, 0x65, 0x52, 0x64, 0x2f, 0xd5, 0xfb, 0xa0, 0xa8, 0xde, 0x0d,
+    0xa5, 0xce, 0x88, 0xc3, 0xb4, 0x86, 0xdc, 0xb0, 0x75, 0x72, 0x13, 0xdc, 0x78, 0xe9, 0x77, 0x0d,
+    0x5f, 0xb0, 0x21, 0x71, 0x70, 0x38, 0xd2, 0x08, 0x74, 0x0c, 0x7c, 0xd8, 0x1e, 0x6a, 0x89, 0x29,
+    0x56, 0xef, 0xd7, 0x7f, 0xdf, 0xba, 0xb9, 0xd1, 0xd7, 0x04, 0x00, 0x00,
+};
+const size_t INSTRUCTIONS_PAGE_LEN = sizeof(INSTRUCTIONS_PAGE);
+const char INSTRUCTIONS_PAGE_ETAG[] = "\"3590b972a64a76d5\"";
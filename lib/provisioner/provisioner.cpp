@@ -1,35 +1,35 @@
-
-
 #include "provisioner.h"
 
 Provisioner::Provisioner() {}
 Provisioner provisioner;
 
-void Provisioner::get_creds(char * ssid, char * pass) {
-    _start_provisioner();
-    _wait_for_completion();
-    strcpy(ssid, _ssid);
-    strcpy(pass, _pass);
-}
+void Provisioner::begin() {
 
-void Provisioner::_start_provisioner() {
+    if (_active) return;
 
     Serial.println("\n  >> entering provisioning mode...\n");
 
-
-
-    WiFi.mode(WIFI_AP);
+    // AP+STA so an existing station link (and everything riding on it) stays up
+    WiFi.mode(WIFI_AP_STA);
     WiFi.softAP(AP_SSID);
 
-    _set_base_routes();
-    _set_portal_routes();
-    _set_other_routes();
+    if (!_routes_set) {
+        const char * headers[] = {"If-None-Match"};
+        _web_server.collectHeaders(headers, 1);
+
+        _set_base_routes();
+        _set_portal_routes();
+        _set_other_routes();
+        _routes_set = true;
+    }
 
     _web_server.begin();
+    _dns_server.setErrorReplyCode(DNSReplyCode::NoError);
     _dns_server.start(53, "*", WiFi.softAPIP());
 
-    // These four lines below were added after the video.  
-    // I should have included them a long time ago.
+    _provisioning_complete = false;
+    _active = true;
+    _scan_timer = 0;
 
     Serial.print("     attach to network:    ");
     Serial.println(AP_SSID);
@@ -39,11 +39,62 @@ void Provisioner::_start_provisioner() {
 
 }
 
-void Provisioner::_wait_for_completion() {
-    while (!_provisioning_complete) {
-        _dns_server.processNextRequest();
-        _web_server.handleClient();
-        delay(100);
-    }
+// One non-blocking pass - call every iteration of the main loop
+void Provisioner::loop() {
+    if (!_active) return;
+    _dns_server.processNextRequest();
+    _web_server.handleClient();
+    _update_scan();
+}
+
+void Provisioner::end() {
+    if (!_active) return;
+    _dns_server.stop();
+    _web_server.stop();
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_STA);
+    WiFi.scanDelete();
+    _active = false;
     Serial.println("\n  >> exiting provisioning mode...");
-}
\ No newline at end of file
+}
+
+void Provisioner::get_creds(char * ssid, char * pass) {
+    strcpy(ssid, _ssid);
+    strcpy(pass, _pass);
+}
+
+// Async scan, results copied into a small cache so /scan never waits on the radio
+void Provisioner::_update_scan() {
+
+    if (_scanning) {
+        int count = WiFi.scanComplete();
+        if (count == WIFI_SCAN_RUNNING) return;
+        _scanning = false;
+        if (count < 0) return;
+
+        _network_count = 0;
+        for (int i = 0; i < count && _network_count < SCAN_CACHE_SIZE; i++) {
+            String ssid = WiFi.SSID(i);
+            if (ssid.length() == 0) continue;
+            bool duplicate = false;
+            for (int j = 0; j < _network_count; j++) {
+                if (ssid == _networks[j].ssid) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) continue;
+            strncpy(_networks[_network_count].ssid, ssid.c_str(), sizeof(_networks[0].ssid) - 1);
+            _networks[_network_count].ssid[sizeof(_networks[0].ssid) - 1] = '\0';
+            _networks[_network_count].rssi = WiFi.RSSI(i);
+            _network_count++;
+        }
+        WiFi.scanDelete();
+        return;
+    }
+
+    if (_scan_timer == 0 || millis() - _scan_timer > SCAN_REFRESH_INTERVAL) {
+        _scan_timer = millis();
+        _scanning = WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING;
+    }
+}
@@ -5,24 +5,48 @@
 #include <DNSServer.h>
 
 #define AP_SSID "DEVICE PROVISIONING"
+#define SCAN_REFRESH_INTERVAL 30000  // background SSID scan period while provisioning
+#define SCAN_CACHE_SIZE 16
 
+// Captive portal run as a service: begin() brings up the AP alongside the
+// station interface and loop() serves one pass of DNS/HTTP without blocking,
+// so the cell keeps running while credentials are entered
 class Provisioner {
     public:
         Provisioner();
+        void begin();
+        void loop();
+        void end();
+        bool is_active() { return _active; }
+        bool is_complete() { return _provisioning_complete; }
         void get_creds(char * ssid, char * pass);
 
     private:
         WebServer _web_server{80};
         DNSServer _dns_server;
+        bool _active = false;
+        bool _routes_set = false;
         bool _provisioning_complete = false;
-        char _ssid[32];
-        char _pass[32];
-        void _start_provisioner();
-        void _wait_for_completion();
-        
+        char _ssid[33];
+        char _pass[65];
+
+        // background scan cache
+        struct Network {
+            char ssid[33];
+            int8_t rssi;
+        };
+        Network _networks[SCAN_CACHE_SIZE];
+        int _network_count = 0;
+        unsigned long _scan_timer = 0;
+        bool _scanning = false;
+        void _update_scan();
+
+        void _send_page(const uint8_t *, size_t, const char *);
+        void _redirect_to_portal();
+
         void _set_base_routes();
         void _set_portal_routes();
         void _set_other_routes();
 };
 
-extern Provisioner provisioner;
\ No newline at end of file
+extern Provisioner provisioner;
@@ -1,34 +1,64 @@
-
-
 #include "provisioner.h"
 #include "html.h"
 
+// Pages are stored gzipped; the ETag lets a reload skip the body entirely
+void Provisioner::_send_page(const uint8_t * page, size_t len, const char * etag) {
+    if (_web_server.header("If-None-Match") == etag) {
+        _web_server.send(304);
+        return;
+    }
+    _web_server.sendHeader("Content-Encoding", "gzip");
+    _web_server.sendHeader("Cache-Control", "no-cache");
+    _web_server.sendHeader("ETag", etag);
+    _web_server.send_P(200, "text/html", (const char *) page, len);
+}
+
 void Provisioner::_set_base_routes() {
 
     _web_server.on("/", [this]() {
         Serial.println("\t.. base route hit");
-        _web_server.send(200, "text/html", CONFIG_PAGE);
+        _send_page(CONFIG_PAGE, CONFIG_PAGE_LEN, CONFIG_PAGE_ETAG);
     });
 
     _web_server.on("/save", [this]() {
 
         Serial.println("\t.. save route hit");
 
-        strcpy(_ssid, _web_server.arg("ssid").c_str());
-        strcpy(_pass, _web_server.arg("pass").c_str());
+        strncpy(_ssid, _web_server.arg("ssid").c_str(), sizeof(_ssid) - 1);
+        _ssid[sizeof(_ssid) - 1] = '\0';
+        strncpy(_pass, _web_server.arg("pass").c_str(), sizeof(_pass) - 1);
+        _pass[sizeof(_pass) - 1] = '\0';
 
         Serial.print("\n\tnew SSID: "); Serial.println(_ssid);
         Serial.print("\tnew PASS: ");   Serial.println(_pass);
 
         if (strlen(_ssid) < 4 || strlen(_pass) < 4) {
             Serial.println("\t.. error - SSID or password failed validation");
-            _web_server.send(200, "text/html", INSTRUCTIONS_PAGE);
+            _send_page(INSTRUCTIONS_PAGE, INSTRUCTIONS_PAGE_LEN, INSTRUCTIONS_PAGE_ETAG);
         } else {
             _provisioning_complete = true;
-            _web_server.send(200, "text/html", SAVED_PAGE);
+            _send_page(SAVED_PAGE, SAVED_PAGE_LEN, SAVED_PAGE_ETAG);
         }
 
     });
 
-}
+    // Cached results from the background scan - never scans inline
+    _web_server.on("/scan", [this]() {
+        String json = "[";
+        for (int i = 0; i < _network_count; i++) {
+            if (i > 0) json += ",";
+            json += "{\"ssid\":\"";
+            for (const char * c = _networks[i].ssid; *c; c++) {
+                if (*c == '"' || *c == '\\') json += '\\';
+                json += *c;
+            }
+            json += "\",\"rssi\":";
+            json += _networks[i].rssi;
+            json += "}";
+        }
+        json += "]";
+        _web_server.sendHeader("Cache-Control", "no-store");
+        _web_server.send(200, "application/json", json);
+    });
 
+}
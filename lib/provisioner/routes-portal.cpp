@@ -1,7 +1,12 @@
-
-
 #include "provisioner.h"
-#include "html.h"
+
+// Every OS probe gets an immediate redirect to the portal page - anything other
+// than the expected "success" response makes the OS open its captive browser
+void Provisioner::_redirect_to_portal() {
+    _web_server.sendHeader("Location", String("http://") + WiFi.softAPIP().toString() + "/");
+    _web_server.sendHeader("Cache-Control", "no-store");
+    _web_server.send(302, "text/plain", "");
+}
 
 void Provisioner::_set_portal_routes() {
 
@@ -9,19 +14,31 @@ void Provisioner::_set_portal_routes() {
 
     _web_server.on("/generate_204", [this]() {
         Serial.println("\t.. got an Android request");
-        _web_server.send(200, "text/html", CONFIG_PAGE);
+        _redirect_to_portal();
     });
 
     _web_server.on("/gen_204", [this]() {
         Serial.println("\t.. got an Android request");
-        _web_server.send(200, "text/html", CONFIG_PAGE);
+        _redirect_to_portal();
     });
 
     // iOS routes
 
     _web_server.on("/hotspot-detect.html", [this]() {
         Serial.println("\t.. got an iOS request");
-        _web_server.send(200, "text/html", CONFIG_PAGE);
+        _redirect_to_portal();
+    });
+
+    // Windows routes
+
+    _web_server.on("/connecttest.txt", [this]() {
+        Serial.println("\t.. got a Windows request");
+        _redirect_to_portal();
+    });
+
+    _web_server.on("/ncsi.txt", [this]() {
+        Serial.println("\t.. got a Windows request");
+        _redirect_to_portal();
     });
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,496 @@
+#include "rpc.h"
+#include "mqtt.h"
+#include "topics.h"
+#include "timebase.h"
+#include "power.h"
+#include "series.h"
+#include "../device/device.h"
+#include "../telnet/telnet.h"
+#include <stdarg.h>
+
+#define RPC_ERROR_RESERVE 128       // response bytes kept back per batch call still to run
+
+Rpc rpc;
+
+static bool restart_pending = false;
+
+
+// CLI output as plain text: colour codes and carriage returns dropped, cut at RPC_OUTPUT_MAX
+class RpcOutput : public Print {
+
+    public:
+
+        size_t write(uint8_t c) override {
+            if (_escape) {
+                if (isalpha(c)) _escape = false;
+            } else if (c == 0x1B) {
+                _escape = true;
+            } else if (c != '\r') {
+                if (_len < sizeof(_buf) - 1) _buf[_len++] = c;
+                else _truncated = true;
+            }
+            return 1;
+        }
+        using Print::write;
+
+        void clear() { _len = 0; _escape = false; _truncated = false; }
+
+        char * text() {
+            while (_len && _buf[_len - 1] == '\n') _len--;
+            if (_truncated && _len > sizeof(_buf) - 5) _len = sizeof(_buf) - 5;
+            if (_truncated) _len += snprintf(_buf + _len, sizeof(_buf) - _len, "\n...");
+            _buf[_len] = '\0';
+            return _buf;
+        }
+
+    private:
+
+        char _buf[RPC_OUTPUT_MAX];
+        size_t _len = 0;
+        bool _escape = false;
+        bool _truncated = false;
+
+};
+
+
+static const char * error_message(RpcError code) {
+    switch (code) {
+        case RPC_PARSE_ERROR:       return "parse error";
+        case RPC_INVALID_REQUEST:   return "invalid request";
+        case RPC_METHOD_NOT_FOUND:  return "method not found";
+        case RPC_INVALID_PARAMS:    return "invalid params";
+        case RPC_TIMEOUT:           return "timed out before it ran";
+        case RPC_TOO_LARGE:         return "doesn't fit a message";
+        case RPC_BUSY:              return "busy, try again";
+        case RPC_FAILED:            return "failed";
+        default:                    return "internal error";
+    }
+}
+
+// Sets result to the formatted message and returns code
+static RpcError fail(JsonDocument & result, RpcError code, const char * format, ...) {
+    char message[80];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    result.set(message);
+    return code;
+}
+
+static void error_object(JsonDocument & response, RpcError code, const char * message) {
+    JsonObject error = response["error"].to<JsonObject>();
+    error["code"] = code;
+    error["message"] = message;
+}
+
+// Epoch ms once SNTP has synced, ms since boot until then - the /api/history clock
+static unsigned long long timestamp(uint64_t monotonic_us) {
+    return timebase.is_synced() ? timebase.to_epoch_ms(monotonic_us) : monotonic_us / 1000;
+}
+
+// Rounded as a double so the JSON carries the digits that mean something
+static double rounded(float value, double scale) {
+    return round(value * scale) / scale;
+}
+
+
+// ---- methods ----
+
+static void motor_state(JsonDocument & result) {
+    result["running"] = device.motor->isRunning();
+    result["direction"] = device.motor->isForward() ? "forward" : "reverse";
+    result["speed"] = device.motor->getSpeed();
+}
+
+static RpcError call_status(JsonObjectConst, JsonDocument & result) {
+    device.BuildTelemetry(result);
+    if (device.motor) {
+        result["running"] = device.motor->isRunning();
+        result["speed"] = device.motor->getSpeed();
+    }
+    result["power_mode"] = Power::name(power.mode());
+    result["heap"] = ESP.getFreeHeap();
+    return RPC_OK;
+}
+
+static RpcError call_speed(JsonObjectConst params, JsonDocument & result) {
+    if (!device.motor) return fail(result, RPC_FAILED, "motor not initialized");
+    int value = params["value"];
+    if (device.motor->isForward()) device.motor->forward(value);
+    else device.motor->reverse(value);
+    motor_state(result);
+    return RPC_OK;
+}
+
+static RpcError call_forward(JsonObjectConst params, JsonDocument & result) {
+    if (!device.motor) return fail(result, RPC_FAILED, "motor not initialized");
+    device.motor->forward(params["speed"] | 255);
+    motor_state(result);
+    return RPC_OK;
+}
+
+static RpcError call_reverse(JsonObjectConst params, JsonDocument & result) {
+    if (!device.motor) return fail(result, RPC_FAILED, "motor not initialized");
+    device.motor->reverse(params["speed"] | 255);
+    motor_state(result);
+    return RPC_OK;
+}
+
+static RpcError call_stop(JsonObjectConst, JsonDocument & result) {
+    if (!device.motor) return fail(result, RPC_FAILED, "motor not initialized");
+    device.motor->stop();
+    motor_state(result);
+    return RPC_OK;
+}
+
+static RpcError call_force(JsonObjectConst, JsonDocument & result) {
+    device._LastMillis = 0;     // measured and published on the next pass
+    result.set("forced");
+    return RPC_OK;
+}
+
+// The newest samples, or those from "since" on; "next" continues where this left off
+static RpcError call_history(JsonObjectConst params, JsonDocument & result) {
+    uint32_t newest = device.SampleSeq();
+    uint32_t count = params["count"] | 10;
+    uint32_t first = newest - min(count, newest);
+    if (!params["since"].isNull()) {
+        uint32_t oldest = newest > POWER_RING_SIZE ? newest - POWER_RING_SIZE : 0;
+        first = constrain(params["since"].as<uint32_t>(), oldest, newest);
+    }
+
+    result["interval_ms"] = POWER_SAMPLE_INTERVAL;
+    result["clock"] = timebase.is_synced() ? "epoch" : "uptime";
+    JsonArray samples = result["samples"].to<JsonArray>();
+    uint32_t seq = first;
+    for (; seq < newest && samples.size() < count; seq++) {
+        PowerSample s;
+        if (!device.GetSample(seq, s)) continue;
+        JsonObject sample = samples.add<JsonObject>();
+        sample["t"] = timestamp(s.us);
+        sample["i"] = rounded(s.current_mA, 100);
+        sample["v"] = rounded(s.busvoltage, 1000);
+        sample["p"] = rounded(s.power_mW, 10);
+    }
+    result["next"] = seq;
+    return RPC_OK;
+}
+
+// Answered first; loop() restarts once the response is out
+static RpcError call_reboot(JsonObjectConst, JsonDocument & result) {
+    restart_pending = true;
+    result.set("rebooting");
+    return RPC_OK;
+}
+
+// One telnet command line, its output as the result. Replies starting
+// "Error" or "Unknown command" are the CLI refusing
+static RpcError cli_line(const char * line, JsonDocument & result) {
+    if (strncasecmp(line, "reboot", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
+        return call_reboot(JsonObjectConst(), result);
+    }
+    static RpcOutput output;
+    output.clear();
+    telnet.execute(output, String(line));
+    char * text = output.text();
+    result.set(text);
+    if (strncmp(text, "Error", 5) == 0 || strncmp(text, "Unknown command", 15) == 0) return RPC_FAILED;
+    return RPC_OK;
+}
+
+static RpcError call_cli(JsonObjectConst params, JsonDocument & result) {
+    return cli_line(params["line"], result);
+}
+
+static RpcError call_methods(JsonObjectConst, JsonDocument & result);
+
+static const RpcParam SPEED_PARAMS[] = {
+    {"value", RPC_INT, true, 0, 255},
+};
+static const RpcParam RUN_PARAMS[] = {
+    {"speed", RPC_INT, false, 0, 255},          // 255 if left out
+};
+static const RpcParam HISTORY_PARAMS[] = {
+    {"count", RPC_INT, false, 1, RPC_HISTORY_MAX},
+    {"since", RPC_INT, false, 0, UINT32_MAX},   // sample sequence, "next" from the last call
+};
+static const RpcParam CLI_PARAMS[] = {
+    {"line", RPC_STRING, true, 0, 0},
+};
+static const RpcParam ARGS_PARAMS[] = {         // any telnet command run by name
+    {"args", RPC_STRING, false, 0, 0},
+};
+
+#define PARAMS(list) list, sizeof(list) / sizeof(list[0])
+
+static const RpcMethod METHODS[] = {
+    {"methods", nullptr, 0, call_methods},
+    {"status",  nullptr, 0, call_status},
+    {"speed",   PARAMS(SPEED_PARAMS), call_speed},
+    {"forward", PARAMS(RUN_PARAMS), call_forward},
+    {"reverse", PARAMS(RUN_PARAMS), call_reverse},
+    {"stop",    nullptr, 0, call_stop},
+    {"force",   nullptr, 0, call_force},
+    {"history", PARAMS(HISTORY_PARAMS), call_history},
+    {"reboot",  nullptr, 0, call_reboot},
+    {"cli",     PARAMS(CLI_PARAMS), call_cli},
+};
+
+static const RpcMethod CLI_METHOD = {"", PARAMS(ARGS_PARAMS), nullptr};
+
+static const char *const TYPE_NAMES[] = {"int", "float", "string", "bool"};
+
+static const RpcMethod * find_method(const char * name) {
+    for (const RpcMethod & method : METHODS) {
+        if (strcmp(method.name, name) == 0) return &method;
+    }
+    return nullptr;
+}
+
+static bool is_command(const char * name) {
+    char word[20];
+    for (int i = 0; Telnet::command_word(i, word, sizeof(word)); i++) {
+        if (strcmp(word, name) == 0) return true;
+    }
+    return false;
+}
+
+// The typed methods with their schemas, and the telnet commands that run by name
+static RpcError call_methods(JsonObjectConst, JsonDocument & result) {
+    JsonObject typed = result["methods"].to<JsonObject>();
+    for (const RpcMethod & method : METHODS) {
+        JsonObject params = typed[method.name].to<JsonObject>();
+        for (int i = 0; i < method.param_count; i++) {
+            const RpcParam & p = method.params[i];
+            char spec[40];
+            int len = snprintf(spec, sizeof(spec), "%s", TYPE_NAMES[p.type]);
+            if (p.type == RPC_INT || p.type == RPC_FLOAT) {
+                len += snprintf(spec + len, sizeof(spec) - len, " %.0f-%.0f", p.min, p.max);
+            }
+            if (p.required) snprintf(spec + len, sizeof(spec) - len, ", required");
+            params[p.name] = spec;
+        }
+    }
+    JsonArray commands = result["cli"].to<JsonArray>();
+    char word[20];
+    for (int i = 0; Telnet::command_word(i, word, sizeof(word)); i++) {
+        if (!find_method(word)) commands.add(word);
+    }
+    return RPC_OK;
+}
+
+// Unknown params, missing required ones, wrong types and out-of-range numbers
+static RpcError validate(const RpcMethod & method, JsonObjectConst params, JsonDocument & result) {
+    for (JsonPairConst kv : params) {
+        bool known = false;
+        for (int i = 0; i < method.param_count && !known; i++) {
+            known = strcmp(kv.key().c_str(), method.params[i].name) == 0;
+        }
+        if (!known) return fail(result, RPC_INVALID_PARAMS, "unknown param \"%s\"", kv.key().c_str());
+    }
+    for (int i = 0; i < method.param_count; i++) {
+        const RpcParam & p = method.params[i];
+        JsonVariantConst value = params[p.name];
+        if (value.isNull()) {
+            if (p.required) return fail(result, RPC_INVALID_PARAMS, "\"%s\" is required", p.name);
+            continue;
+        }
+        bool ok = false;
+        switch (p.type) {
+            case RPC_INT:    ok = value.is<long long>(); break;
+            case RPC_FLOAT:  ok = value.is<double>(); break;
+            case RPC_STRING: ok = value.is<const char *>(); break;
+            case RPC_BOOL:   ok = value.is<bool>(); break;
+        }
+        if (!ok) return fail(result, RPC_INVALID_PARAMS, "\"%s\" must be %s", p.name, TYPE_NAMES[p.type]);
+        if ((p.type == RPC_INT || p.type == RPC_FLOAT) && (value.as<double>() < p.min || value.as<double>() > p.max)) {
+            return fail(result, RPC_INVALID_PARAMS, "\"%s\" must be %.0f-%.0f", p.name, p.min, p.max);
+        }
+    }
+    return RPC_OK;
+}
+
+static RpcError dispatch(const char * name, JsonObjectConst params, JsonDocument & result) {
+    const RpcMethod * method = find_method(name);
+    bool command = !method && is_command(name);
+    if (!method && !command) return fail(result, RPC_METHOD_NOT_FOUND, "no method \"%s\"", name);
+
+    RpcError code = validate(command ? CLI_METHOD : *method, params, result);
+    if (code != RPC_OK) return code;
+    if (method) return method->handler(params, result);
+
+    char line[TELNET_LINE_SIZE];
+    const char * args = params["args"];
+    snprintf(line, sizeof(line), args && *args ? "%s %s" : "%s", name, args);
+    return cli_line(line, result);
+}
+
+// Waiting longer than its timeout since it arrived - or since the sender stamped it
+static bool expired(unsigned long received, uint32_t timeout_ms, JsonVariantConst ts) {
+    if (millis() - received > timeout_ms) return true;
+    return ts.is<uint64_t>() && timebase.is_synced() && timebase.epoch_ms() > ts.as<uint64_t>() + timeout_ms;
+}
+
+// An integer, or a string of at most RPC_ID_MAX characters
+static bool valid_id(JsonVariantConst id) {
+    if (id.isNull() || id.is<long long>()) return true;
+    return id.is<const char *>() && strlen(id.as<const char *>()) <= RPC_ID_MAX;
+}
+
+
+// ---- transport ----
+
+void Rpc::receive(const char * payload) {
+    if (strlen(payload) >= RPC_REQUEST_MAX) {
+        _reject(payload, RPC_TOO_LARGE);
+        return;
+    }
+    for (int i = 0; i < RPC_QUEUE_DEPTH; i++) {
+        Pending & slot = _queue[(_next + i) % RPC_QUEUE_DEPTH];
+        if (slot.used) continue;
+        strcpy(slot.payload, payload);
+        slot.received = millis();
+        slot.used = true;
+        return;
+    }
+    _reject(payload, RPC_BUSY);
+}
+
+
+void Rpc::loop() {
+    for (int i = 0; i < RPC_QUEUE_DEPTH; i++) {
+        Pending & slot = _queue[_next];
+        if (!slot.used) break;
+        _run(slot);
+        slot.used = false;
+        _next = (_next + 1) % RPC_QUEUE_DEPTH;
+    }
+    if (restart_pending) {
+        series.flush();
+        device.SaveCharge();
+        delay(1000);    // let the response leave
+        ESP.restart();
+    }
+}
+
+
+void Rpc::_run(Pending & pending) {
+    JsonDocument request;
+    JsonDocument response;
+    DeserializationError err = deserializeJson(request, pending.payload);
+
+    if (err) {
+        _calls++;
+        _errors++;
+        response["id"] = nullptr;
+        error_object(response, RPC_PARSE_ERROR, err.c_str());
+    } else if (request.is<JsonArray>()) {
+        JsonArrayConst batch = request.as<JsonArrayConst>();
+        if (batch.size() == 0 || batch.size() > RPC_BATCH_MAX) {
+            _calls++;
+            _errors++;
+            response["id"] = nullptr;
+            error_object(response, RPC_INVALID_REQUEST, batch.size() ? "too many calls in one batch" : "empty batch");
+        } else {
+            // Each call's response is sized before it joins the batch, keeping room for the rest to fail
+            JsonArray out = response.to<JsonArray>();
+            size_t used = 2;
+            size_t left = batch.size();
+            for (JsonVariantConst call : batch) {
+                JsonDocument one;
+                _call(call.as<JsonObjectConst>(), pending.received, one);
+                left--;
+                if (used + measureJson(one) + 1 + left * RPC_ERROR_RESERVE >= RPC_RESPONSE_MAX) {
+                    one.remove("result");
+                    error_object(one, RPC_TOO_LARGE, "result doesn't fit the batch response");
+                    _errors++;
+                }
+                used += measureJson(one) + 1;
+                out.add(one);
+            }
+        }
+    } else {
+        _call(request.as<JsonObjectConst>(), pending.received, response);
+        if (measureJson(response) >= RPC_RESPONSE_MAX) {
+            response.remove("result");
+            error_object(response, RPC_TOO_LARGE, "result doesn't fit a response");
+            _errors++;
+        }
+    }
+    _send(response);
+}
+
+
+void Rpc::_call(JsonObjectConst request, unsigned long received, JsonDocument & response) {
+    _calls++;
+    JsonDocument result;
+    RpcError code;
+    JsonVariantConst id = request["id"];
+    const char * method = request["method"];
+    JsonVariantConst params = request["params"];
+    JsonVariantConst timeout = request["timeout_ms"];
+
+    response["id"] = valid_id(id) ? id : JsonVariantConst();
+    if (!valid_id(id)) {
+        code = fail(result, RPC_INVALID_REQUEST, "id must be an integer or a string of up to %d characters", RPC_ID_MAX);
+    } else if (!method) {
+        code = fail(result, RPC_INVALID_REQUEST, "\"method\" is required");
+    } else if (!params.isNull() && !params.is<JsonObjectConst>()) {
+        code = fail(result, RPC_INVALID_PARAMS, "params must be an object");
+    } else if (!timeout.isNull() && !(timeout.is<uint32_t>() && timeout.as<uint32_t>() <= RPC_TIMEOUT_MAX)) {
+        code = fail(result, RPC_INVALID_REQUEST, "timeout_ms must be 0-%d", RPC_TIMEOUT_MAX);
+    } else if (expired(received, timeout | RPC_TIMEOUT_DEFAULT, request["ts"])) {
+        code = fail(result, RPC_TIMEOUT, "expired before it ran");
+    } else {
+        code = dispatch(method, params.as<JsonObjectConst>(), result);
+    }
+
+    if (code == RPC_OK) {
+        response["result"] = result;
+        return;
+    }
+    _errors++;
+    if (code == RPC_TIMEOUT) _timeouts++;
+    JsonObject error = response["error"].to<JsonObject>();
+    error["code"] = code;
+    if (result.is<const char *>()) error["message"] = result;
+    else error["message"] = error_message(code);
+}
+
+
+// Answered at once from the MQTT callback, with whatever ids can be read
+void Rpc::_reject(const char * payload, RpcError code) {
+    JsonDocument filter;
+    bool batch = payload[strspn(payload, " \t\r\n")] == '[';
+    if (batch) filter[0]["id"] = true;
+    else filter["id"] = true;
+    JsonDocument ids;
+    deserializeJson(ids, payload, DeserializationOption::Filter(filter));
+
+    JsonDocument response;
+    if (batch && ids.is<JsonArray>() && ids.size()) {
+        JsonArray out = response.to<JsonArray>();
+        for (JsonVariantConst call : ids.as<JsonArrayConst>()) {
+            JsonDocument one;
+            one["id"] = valid_id(call["id"]) ? call["id"] : JsonVariantConst();
+            error_object(one, code, error_message(code));
+            out.add(one);
+            _calls++;
+            _errors++;
+        }
+    } else {
+        JsonVariantConst id = ids["id"];
+        response["id"] = valid_id(id) ? id : JsonVariantConst();
+        error_object(response, code, error_message(code));
+        _calls++;
+        _errors++;
+    }
+    _send(response);
+}
+
+
+void Rpc::_send(JsonDocument & response) {
+    size_t len = serializeJson(response, _out, sizeof(_out));
+    mqtt.publish(topics.get(TOPIC_RPC_RESPONSE), (const uint8_t *) _out, len);
+}
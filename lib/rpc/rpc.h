@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define RPC_QUEUE_DEPTH 2           // requests waiting for the main loop
+#define RPC_REQUEST_MAX 768         // one request message, batch included
+#define RPC_RESPONSE_MAX 1536       // one response message, batch included (fits MQTT_BUFFER_SIZE)
+#define RPC_BATCH_MAX 8             // calls in one message
+#define RPC_TIMEOUT_DEFAULT 5000    // ms, when a call names none
+#define RPC_TIMEOUT_MAX 60000       // ms
+#define RPC_OUTPUT_MAX 1024         // captured CLI output per call
+#define RPC_HISTORY_MAX 20          // samples per history call
+#define RPC_ID_MAX 40               // longest string id echoed back
+
+// JSON-RPC 2.0 codes, plus the implementation-defined range for our own
+enum RpcError : int16_t {
+    RPC_OK = 0,
+    RPC_PARSE_ERROR = -32700,
+    RPC_INVALID_REQUEST = -32600,
+    RPC_METHOD_NOT_FOUND = -32601,
+    RPC_INVALID_PARAMS = -32602,
+    RPC_INTERNAL_ERROR = -32603,
+    RPC_TIMEOUT = -32000,           // expired before it ran
+    RPC_TOO_LARGE = -32001,         // request or result doesn't fit a message
+    RPC_BUSY = -32002,              // queue full
+    RPC_FAILED = -32003,            // the command refused, message says why
+};
+
+enum RpcType : uint8_t { RPC_INT, RPC_FLOAT, RPC_STRING, RPC_BOOL };
+
+// One named parameter; numbers are checked against min..max
+struct RpcParam {
+    const char * name;
+    RpcType type;
+    bool required;
+    double min;
+    double max;
+};
+
+// Fills result, or sets it to a message string and returns the error
+using RpcHandler = RpcError (*)(JsonObjectConst params, JsonDocument & result);
+
+struct RpcMethod {
+    const char * name;
+    const RpcParam * params;
+    uint8_t param_count;
+    RpcHandler handler;
+};
+
+/**
+ * Request/response calls over MQTT. A request on filterchlorine/<id>/rpc/req
+ *
+ *   {"id":7,"method":"speed","params":{"value":180},"timeout_ms":2000}
+ *
+ * is answered on filterchlorine/<id>/rpc/resp with {"id":7,"result":...}
+ * or {"id":7,"error":{"code":-32602,"message":"..."}}; the id is echoed
+ * untouched for correlation. An array of up to RPC_BATCH_MAX calls runs in
+ * order and is answered with one array.
+ *
+ * Typed methods (status, speed, forward, reverse, stop, force, history,
+ * reboot) validate their params against a schema that "methods" lists.
+ * Every other telnet command runs as a method of the same name with an
+ * optional {"args":"..."} and returns the CLI's output as text, so the two
+ * interfaces never drift apart; "cli" takes a whole {"line":"..."}.
+ *
+ * A call runs on the main task, in loop(). One that is still waiting when
+ * its timeout_ms has passed since arrival - or since "ts", the sender's
+ * epoch ms, once SNTP has synced - is answered with a timeout instead, so
+ * a stale or retained request never moves the cell. Responses are always
+ * JSON, whatever the telemetry encoding.
+ */
+class Rpc {
+
+    public:
+
+        void receive(const char * payload);     // MQTT callback, main task
+        void loop();
+
+        uint32_t calls() { return _calls; }
+        uint32_t errors() { return _errors; }
+        uint32_t timeouts() { return _timeouts; }
+
+    private:
+
+        struct Pending {
+            bool used;
+            unsigned long received;
+            char payload[RPC_REQUEST_MAX];
+        };
+
+        Pending _queue[RPC_QUEUE_DEPTH] = {};
+        uint8_t _next = 0;                      // oldest pending
+        char _out[RPC_RESPONSE_MAX];
+
+        uint32_t _calls = 0;
+        uint32_t _errors = 0;
+        uint32_t _timeouts = 0;
+
+        void _run(Pending &);
+        void _call(JsonObjectConst request, unsigned long received, JsonDocument & response);
+        void _reject(const char * payload, RpcError);
+        void _send(JsonDocument &);
+
+};
+
+extern Rpc rpc;
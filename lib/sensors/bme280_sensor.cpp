@@ -0,0 +1,154 @@
+#include "bme280_sensor.h"
+#include "i2c_bus.h"
+#include "timebase.h"
+
+// BME280 registers
+#define REG_CALIB_00 0x88     // 0x88..0xA1: T1..P9, H1
+#define REG_CHIP_ID 0xD0
+#define REG_CALIB_26 0xE1     // 0xE1..0xE7: H2..H6
+#define REG_CTRL_HUM 0xF2
+#define REG_STATUS 0xF3
+#define REG_CTRL_MEAS 0xF4
+#define REG_CONFIG 0xF5
+#define REG_DATA 0xF7         // 0xF7..0xFE: press, temp, hum
+
+#define CHIP_ID_BME280 0x60
+#define CHIP_ID_BMP280 0x58
+
+#define CTRL_MEAS_FORCED 0x25 // temperature x1, pressure x1, forced mode
+#define STATUS_MEASURING 0x08
+#define MIN_CONVERSION 5      // ms, typical forced conversion is ~8 ms at x1
+
+Bme280Sensor bme280_sensor(BME280_INTERVAL);
+
+
+bool Bme280Sensor::probe(I2cBus & bus) {
+
+    static const uint8_t candidates[] = { BME280_ADDRESS, BME280_ADDRESS_ALT };
+    for (uint8_t address : candidates) {
+        uint8_t id;
+        if (!bus.read_regs(address, REG_CHIP_ID, &id, 1)) continue;
+        if (id != CHIP_ID_BME280 && id != CHIP_ID_BMP280) continue;
+        _address = address;
+        _has_humidity = id == CHIP_ID_BME280;
+        if (!_read_calibration(bus)) return false;
+
+        // humidity oversampling only takes effect on the next ctrl_meas write
+        uint8_t value = 0x01;
+        if (_has_humidity && !bus.write_regs(_address, REG_CTRL_HUM, &value, 1)) return false;
+        value = 0x00;   // no IIR filter, standby irrelevant in forced mode
+        return bus.write_regs(_address, REG_CONFIG, &value, 1);
+    }
+    return false;
+}
+
+
+bool Bme280Sensor::_read_calibration(I2cBus & bus) {
+
+    uint8_t c[26];
+    if (!bus.read_regs(_address, REG_CALIB_00, c, sizeof(c))) return false;
+    _T1 = c[0] | c[1] << 8;
+    _T2 = c[2] | c[3] << 8;
+    _T3 = c[4] | c[5] << 8;
+    _P1 = c[6] | c[7] << 8;
+    _P2 = c[8] | c[9] << 8;
+    _P3 = c[10] | c[11] << 8;
+    _P4 = c[12] | c[13] << 8;
+    _P5 = c[14] | c[15] << 8;
+    _P6 = c[16] | c[17] << 8;
+    _P7 = c[18] | c[19] << 8;
+    _P8 = c[20] | c[21] << 8;
+    _P9 = c[22] | c[23] << 8;
+    _H1 = c[25];
+
+    if (!_has_humidity) return true;
+
+    uint8_t h[7];
+    if (!bus.read_regs(_address, REG_CALIB_26, h, sizeof(h))) return false;
+    _H2 = h[0] | h[1] << 8;
+    _H3 = h[2];
+    _H4 = (int8_t) h[3] << 4 | (h[4] & 0x0F);
+    _H5 = (int8_t) h[5] << 4 | h[4] >> 4;
+    _H6 = h[6];
+    return true;
+}
+
+
+bool Bme280Sensor::trigger(I2cBus & bus) {
+    uint8_t value = CTRL_MEAS_FORCED;
+    _triggered = millis();
+    return bus.write_regs(_address, REG_CTRL_MEAS, &value, 1);
+}
+
+
+int Bme280Sensor::ready(I2cBus & bus) {
+    if (millis() - _triggered < MIN_CONVERSION) return 0;
+    uint8_t status;
+    if (!bus.read_regs(_address, REG_STATUS, &status, 1)) return -1;
+    return (status & STATUS_MEASURING) ? 0 : 1;
+}
+
+
+bool Bme280Sensor::fetch(I2cBus & bus) {
+
+    uint8_t d[8];
+    if (!bus.read_regs(_address, REG_DATA, d, _has_humidity ? 8 : 6)) return false;
+
+    int32_t adc_P = (int32_t) d[0] << 12 | d[1] << 4 | d[2] >> 4;
+    int32_t adc_T = (int32_t) d[3] << 12 | d[4] << 4 | d[5] >> 4;
+    int32_t adc_H = _has_humidity ? (d[6] << 8 | d[7]) : 0;
+
+    // temperature, 0.01 degC
+    int32_t var1 = ((((adc_T >> 3) - ((int32_t) _T1 << 1))) * _T2) >> 11;
+    int32_t var2 = (((((adc_T >> 4) - _T1) * ((adc_T >> 4) - _T1)) >> 12) * _T3) >> 14;
+    int32_t t_fine = var1 + var2;
+    int32_t T = (t_fine * 5 + 128) >> 8;
+
+    // pressure, Q24.8 Pa
+    int64_t p1 = (int64_t) t_fine - 128000;
+    int64_t p2 = p1 * p1 * _P6;
+    p2 = p2 + ((p1 * _P5) << 17);
+    p2 = p2 + ((int64_t) _P4 << 35);
+    p1 = ((p1 * p1 * _P3) >> 8) + ((p1 * _P2) << 12);
+    p1 = (((int64_t) 1 << 47) + p1) * _P1 >> 33;
+    uint32_t P = 0;
+    if (p1 != 0) {
+        int64_t p = 1048576 - adc_P;
+        p = (((p << 31) - p2) * 3125) / p1;
+        p1 = ((int64_t) _P9 * (p >> 13) * (p >> 13)) >> 25;
+        p2 = ((int64_t) _P8 * p) >> 19;
+        P = (uint32_t) (((p + p1 + p2) >> 8) + ((int64_t) _P7 << 4));
+    }
+
+    // humidity, Q22.10 %RH
+    uint32_t H = 0;
+    if (_has_humidity) {
+        int32_t h = t_fine - 76800;
+        h = (((((adc_H << 14) - ((int32_t) _H4 << 20) - ((int32_t) _H5 * h)) + 16384) >> 15) *
+             (((((((h * _H6) >> 10) * (((h * _H3) >> 11) + 32768)) >> 10) + 2097152) * _H2 + 8192) >> 14));
+        h = h - (((((h >> 15) * (h >> 15)) >> 7) * _H1) >> 4);
+        h = h < 0 ? 0 : h;
+        h = h > 419430400 ? 419430400 : h;
+        H = h >> 12;
+    }
+
+    Environment r;
+    r.temperature_C = T / 100.0;
+    r.pressure_hPa = P / 25600.0;
+    r.humidity_pct = _has_humidity ? H / 1024.0 : NAN;
+    r.us = timebase.now_us();
+
+    portENTER_CRITICAL(&_lock);
+    r.seq = _reading.seq + 1;
+    _reading = r;
+    portEXIT_CRITICAL(&_lock);
+    return true;
+}
+
+
+bool Bme280Sensor::latest(Environment & out) {
+    portENTER_CRITICAL(&_lock);
+    out = _reading;
+    portEXIT_CRITICAL(&_lock);
+    return out.seq != 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "sensor.h"
+
+#define BME280_ADDRESS 0x76
+#define BME280_ADDRESS_ALT 0x77
+#define BME280_INTERVAL 10000   // ms, the enclosure climate changes slowly
+
+// One compensated BME280 sample
+struct Environment {
+    float temperature_C;
+    float humidity_pct;     // NAN on a BMP280 (no humidity sensor)
+    float pressure_hPa;
+    uint64_t us;            // monotonic (timebase)
+    uint32_t seq;
+};
+
+/**
+ * BME280 (or BMP280) in forced mode: each interval the driver starts one
+ * conversion, polls the measuring bit and burst-reads all eight data bytes.
+ * Compensation is Bosch's integer reference code.
+ */
+class Bme280Sensor : public I2cSensor {
+
+    public:
+
+        Bme280Sensor(uint32_t interval_ms) : I2cSensor("bme280", interval_ms) {}
+
+        bool latest(Environment &);
+        uint8_t address() { return _address; }
+
+    protected:
+
+        bool probe(I2cBus &) override;
+        bool trigger(I2cBus &) override;
+        int ready(I2cBus &) override;
+        bool fetch(I2cBus &) override;
+
+    private:
+
+        uint8_t _address = BME280_ADDRESS;
+        bool _has_humidity = false;
+        unsigned long _triggered = 0;
+
+        // factory trimming
+        uint16_t _T1; int16_t _T2, _T3;
+        uint16_t _P1; int16_t _P2, _P3, _P4, _P5, _P6, _P7, _P8, _P9;
+        uint8_t _H1, _H3; int16_t _H2, _H4, _H5; int8_t _H6;
+
+        Environment _reading = {};
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+        bool _read_calibration(I2cBus &);
+
+};
+
+extern Bme280Sensor bme280_sensor;
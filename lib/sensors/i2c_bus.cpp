@@ -0,0 +1,299 @@
+#include "i2c_bus.h"
+#include "sensor.h"
+#include "power.h"
+
+I2cBus::I2cBus() {}
+
+I2cBus i2c_bus;
+
+// SCL is divided from APB - frequency scaling mid-transaction would change it
+static PmLock bus_lock(ESP_PM_APB_FREQ_MAX, "i2c");
+
+
+void I2cBus::add_sensor(I2cSensor * sensor) {
+    if (_sensor_count < I2C_MAX_SENSORS) _sensors[_sensor_count++] = sensor;
+}
+
+
+// Probes the registered sensors in the caller's context so presence is known
+// when begin() returns, then hands the bus to its task
+bool I2cBus::begin() {
+
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_FREQUENCY);
+    Wire.setTimeOut(20);
+
+    unsigned long now = millis();
+    for (int i = 0; i < _sensor_count; i++) {
+        I2cSensor * s = _sensors[i];
+        s->_present = s->probe(*this);
+        s->_next_probe = now + I2C_PROBE_RETRY;
+        s->_due = now;
+        Serial.printf("\tI2C: %s %s\n", s->name(), s->_present ? "found" : "not found");
+    }
+
+    _queue = xQueueCreate(I2C_QUEUE_DEPTH, sizeof(Request *));
+    if (!_queue) return false;
+    return xTaskCreatePinnedToCore(_task, "i2c_bus", I2C_TASK_STACK, this, I2C_TASK_PRIORITY, nullptr, 1) == pdPASS;
+}
+
+
+void I2cBus::_task(void * arg) {
+    static_cast<I2cBus *>(arg)->_run();
+}
+
+
+void I2cBus::_run() {
+
+    while (true) {
+
+        bus_lock.acquire();
+
+        // Ad-hoc requests first - they have a caller blocked on them
+        Request * request;
+        while (xQueueReceive(_queue, &request, 0) == pdTRUE) {
+            request->ok = _execute(request->address, request->write, request->write_length,
+                                   request->read, request->read_length);
+            xTaskNotifyGive(request->waiter);
+        }
+
+        uint32_t wait = _step_sensors();
+        bus_lock.release();
+
+        // Sleep until the next sensor is due, waking early for a request
+        TickType_t ticks = pdMS_TO_TICKS(wait);
+        xQueuePeek(_queue, &request, ticks ? ticks : 1);
+    }
+}
+
+
+// Advances every sensor one step; returns ms until something needs the bus
+uint32_t I2cBus::_step_sensors() {
+
+    unsigned long now = millis();
+    uint32_t wait = 50;
+
+    for (int i = 0; i < _sensor_count; i++) {
+        I2cSensor * s = _sensors[i];
+
+        if (!s->_present) {
+            if ((long) (now - s->_next_probe) >= 0) {
+                s->_present = s->probe(*this);
+                s->_next_probe = now + I2C_PROBE_RETRY;
+                s->_due = now;
+                s->_failures = 0;
+                if (s->_present) Serial.printf("\tI2C: %s found\n", s->name());
+            }
+            continue;
+        }
+
+        bool failed = false;
+        if (s->_state == I2cSensor::IDLE && (long) (now - s->_due) >= 0) {
+            // Keep the cadence, but don't try to catch up on missed slots
+            s->_due += s->interval_ms;
+            if ((long) (now - s->_due) >= 0) s->_due = now + s->interval_ms;
+            if (s->trigger(*this)) {
+                s->_state = I2cSensor::CONVERTING;
+                s->_started = now;
+            } else {
+                failed = true;
+            }
+        }
+
+        if (s->_state == I2cSensor::CONVERTING) {
+            int ready = s->ready(*this);
+            if (ready > 0) {
+                if (s->fetch(*this)) s->_failures = 0;
+                else failed = true;
+                s->_state = I2cSensor::IDLE;
+            } else if (ready < 0 || now - s->_started > I2C_SENSOR_TIMEOUT) {
+                s->_timeouts++;
+                s->_state = I2cSensor::IDLE;
+                failed = true;
+            } else {
+                wait = I2C_POLL_INTERVAL;
+                continue;
+            }
+        }
+
+        // Gone from the bus: back to probing, straight away and then every
+        // I2C_PROBE_RETRY, until it answers and has been configured again
+        if (failed && ++s->_failures >= I2C_SENSOR_LOST) {
+            s->_present = false;
+            s->_next_probe = now;
+            Serial.printf("\tI2C: %s lost, re-probing\n", s->name());
+            continue;
+        }
+
+        long until = (long) (s->_due - millis());
+        if (until < 0) until = 0;
+        if ((uint32_t) until < wait) wait = until;
+    }
+    return wait;
+}
+
+
+bool I2cBus::read_regs(uint8_t address, uint8_t reg, uint8_t * buffer, size_t length) {
+    return _execute(address, &reg, 1, buffer, length);
+}
+
+
+bool I2cBus::write_regs(uint8_t address, uint8_t reg, const uint8_t * data, size_t length) {
+    uint8_t frame[17];
+    if (length > sizeof(frame) - 1) return false;
+    frame[0] = reg;
+    memcpy(frame + 1, data, length);
+    return _execute(address, frame, length + 1, nullptr, 0);
+}
+
+
+bool I2cBus::read_reg16(uint8_t address, uint8_t reg, uint16_t & value) {
+    uint8_t buffer[2];
+    if (!read_regs(address, reg, buffer, 2)) return false;
+    value = (buffer[0] << 8) | buffer[1];
+    return true;
+}
+
+
+// For chips without pointer auto-increment (INA219): each register still
+// needs its own pointer write, but the reads go out back to back and are
+// accounted as one transaction
+bool I2cBus::read_reg16_burst(uint8_t address, const uint8_t * regs, uint16_t * values, size_t count) {
+
+    uint32_t start = micros();
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; i++) {
+        uint8_t buffer[2];
+        ok = _transfer(address, &regs[i], 1, buffer, 2);
+        values[i] = (buffer[0] << 8) | buffer[1];
+    }
+    _record(address, ok, micros() - start);
+    _check(ok);
+    return ok;
+}
+
+
+bool I2cBus::write_reg16(uint8_t address, uint8_t reg, uint16_t value) {
+    uint8_t buffer[2] = {(uint8_t) (value >> 8), (uint8_t) value};
+    return write_regs(address, reg, buffer, 2);
+}
+
+
+bool I2cBus::transact(uint8_t address, const uint8_t * write, size_t write_length,
+                      uint8_t * read, size_t read_length) {
+    if (!_queue) return _execute(address, write, write_length, read, read_length);
+
+    // The request lives on this stack, so wait for the bus task unconditionally -
+    // Wire's own timeout bounds how long that can be
+    Request request = {address, write, write_length, read, read_length, false, xTaskGetCurrentTaskHandle()};
+    Request * pointer = &request;
+    xQueueSend(_queue, &pointer, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return request.ok;
+}
+
+
+// One write (register pointer / data) followed by an optional burst read
+// with a repeated start
+bool I2cBus::_transfer(uint8_t address, const uint8_t * write, size_t write_length,
+                       uint8_t * read, size_t read_length) {
+
+    bool ok = true;
+    if (write_length) {
+        Wire.beginTransmission(address);
+        Wire.write(write, write_length);
+        ok = Wire.endTransmission(read_length == 0) == 0;
+    }
+    if (ok && read_length) {
+        ok = Wire.requestFrom((uint16_t) address, read_length, true) == read_length;
+        if (ok) Wire.readBytes(read, read_length);
+    }
+    return ok;
+}
+
+
+bool I2cBus::_execute(uint8_t address, const uint8_t * write, size_t write_length,
+                      uint8_t * read, size_t read_length) {
+
+    uint32_t start = micros();
+    bool ok = _transfer(address, write, write_length, read, read_length);
+    _record(address, ok, micros() - start);
+    _check(ok);
+    return ok;
+}
+
+
+void I2cBus::_check(bool ok) {
+    if (ok) {
+        _consecutive_errors = 0;
+    } else if (++_consecutive_errors >= I2C_RECOVERY_ERRORS) {
+        _recover();
+    }
+}
+
+
+void I2cBus::_record(uint8_t address, bool ok, uint32_t us) {
+
+    portENTER_CRITICAL(&_stats_lock);
+    I2cDeviceStats * d = nullptr;
+    for (int i = 0; i < _device_count; i++) {
+        if (_devices[i].address == address) {
+            d = &_devices[i];
+            break;
+        }
+    }
+    if (!d && _device_count < I2C_MAX_DEVICES) {
+        d = &_devices[_device_count++];
+        *d = {address, 0, 0, 0, 0};
+    }
+    if (d) {
+        d->transactions++;
+        if (!ok) d->errors++;
+        d->busy_us += us;
+        if (us > d->max_us) d->max_us = us;
+    }
+    portEXIT_CRITICAL(&_stats_lock);
+}
+
+
+bool I2cBus::device_stats(int index, I2cDeviceStats & out) {
+    if (index < 0 || index >= _device_count) return false;
+    portENTER_CRITICAL(&_stats_lock);
+    out = _devices[index];
+    portEXIT_CRITICAL(&_stats_lock);
+    return true;
+}
+
+
+// A slave that lost clock sync mid-byte holds SDA low forever. Clock SCL until
+// it releases SDA (at most 9 clocks finish any byte + ACK), then send a STOP.
+void I2cBus::_recover() {
+
+    _consecutive_errors = 0;
+    _recoveries++;
+    Wire.end();
+
+    pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+    pinMode(I2C_SCL_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(I2C_SCL_PIN, HIGH);
+    delayMicroseconds(5);
+
+    for (int i = 0; i < 9 && digitalRead(I2C_SDA_PIN) == LOW; i++) {
+        digitalWrite(I2C_SCL_PIN, LOW);
+        delayMicroseconds(5);
+        digitalWrite(I2C_SCL_PIN, HIGH);
+        delayMicroseconds(5);
+    }
+
+    // STOP: SDA low -> high while SCL is high
+    pinMode(I2C_SDA_PIN, OUTPUT_OPEN_DRAIN);
+    digitalWrite(I2C_SDA_PIN, LOW);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SCL_PIN, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SDA_PIN, HIGH);
+    delayMicroseconds(5);
+
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_FREQUENCY);
+    Wire.setTimeOut(20);
+    Serial.printf("\tI2C: bus recovery #%lu\n", (unsigned long) _recoveries);
+}
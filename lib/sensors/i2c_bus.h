@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define I2C_SDA_PIN 9
+#define I2C_SCL_PIN 8
+#define I2C_FREQUENCY 400000
+#define I2C_MAX_DEVICES 8           // per-address stats slots
+#define I2C_MAX_SENSORS 4
+#define I2C_QUEUE_DEPTH 8           // ad-hoc transactions from other tasks
+#define I2C_RECOVERY_ERRORS 3       // consecutive failures before bus recovery
+#define I2C_POLL_INTERVAL 1         // ms between conversion-ready polls
+#define I2C_SENSOR_TIMEOUT 100      // ms a conversion may take before it's abandoned
+#define I2C_PROBE_RETRY 5000        // ms between attempts to find a missing sensor
+#define I2C_SENSOR_LOST 5           // failed conversions in a row before a sensor counts as missing
+#define I2C_TASK_STACK 4096
+#define I2C_TASK_PRIORITY 3
+
+class I2cSensor;
+
+struct I2cDeviceStats {
+    uint8_t address;
+    uint32_t transactions;
+    uint32_t errors;
+    uint64_t busy_us;
+    uint32_t max_us;
+};
+
+/**
+ * Owns the I2C bus. Everything on the bus - the registered sensor drivers and
+ * ad-hoc transactions from other tasks - runs from one bus task, so nothing
+ * else in the firmware ever blocks on Wire.
+ *
+ * Sensor drivers are stepped at their own rates (trigger, poll for
+ * conversion-ready, burst read). A sensor that fails I2C_SENSOR_LOST
+ * conversions in a row is marked missing and re-probed until it answers
+ * again, so is_present() follows a chip that drops off the bus. Per-device
+ * error and latency counters are kept for every address, and a bus stuck
+ * with SDA low is recovered by clocking SCL until the slave lets go.
+ */
+class I2cBus {
+
+    public:
+
+        I2cBus();
+
+        void add_sensor(I2cSensor *);
+        bool begin();
+
+        // Register access for sensor drivers - bus task (or before begin()) only
+        bool read_regs(uint8_t address, uint8_t reg, uint8_t * buffer, size_t length);
+        bool write_regs(uint8_t address, uint8_t reg, const uint8_t * data, size_t length);
+        bool read_reg16(uint8_t address, uint8_t reg, uint16_t & value);    // big-endian
+        bool write_reg16(uint8_t address, uint8_t reg, uint16_t value);     // big-endian
+        bool read_reg16_burst(uint8_t address, const uint8_t * regs, uint16_t * values, size_t count);
+
+        // Any task: queued to the bus task, blocks the caller until it has run
+        bool transact(uint8_t address, const uint8_t * write, size_t write_length,
+                      uint8_t * read, size_t read_length);
+
+        int device_count() { return _device_count; }
+        bool device_stats(int, I2cDeviceStats &);
+        uint32_t recoveries() { return _recoveries; }
+
+    private:
+
+        struct Request {
+            uint8_t address;
+            const uint8_t * write;
+            size_t write_length;
+            uint8_t * read;
+            size_t read_length;
+            bool ok;
+            TaskHandle_t waiter;
+        };
+
+        I2cSensor * _sensors[I2C_MAX_SENSORS];
+        int _sensor_count = 0;
+
+        I2cDeviceStats _devices[I2C_MAX_DEVICES];
+        int _device_count = 0;
+        portMUX_TYPE _stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+        QueueHandle_t _queue = nullptr;
+        uint8_t _consecutive_errors = 0;
+        uint32_t _recoveries = 0;
+
+        static void _task(void *);
+        void _run();
+        uint32_t _step_sensors();
+        bool _transfer(uint8_t, const uint8_t *, size_t, uint8_t *, size_t);
+        bool _execute(uint8_t, const uint8_t *, size_t, uint8_t *, size_t);
+        void _check(bool);
+        void _record(uint8_t, bool, uint32_t);
+        void _recover();
+
+};
+
+extern I2cBus i2c_bus;
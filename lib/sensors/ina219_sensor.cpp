@@ -0,0 +1,218 @@
+#include "ina219_sensor.h"
+#include "i2c_bus.h"
+#include "storage.h"
+#include "timebase.h"
+
+#define CHECK_EVERY 50          // samples between calibration register checks
+#define CONVERSION_US 532       // one 12-bit ADC sample
+#define CONFIG_BRNG_32V 0x2000
+#define CONFIG_CONTINUOUS 0x0007
+
+Ina219Sensor ina219_sensor(INA219_ADDRESS, INA219_INTERVAL);
+
+
+Ina219Sensor::Ina219Sensor(uint8_t address, uint32_t interval_ms)
+    : I2cSensor("ina219", interval_ms), _address(address), _base_interval(interval_ms) {
+    _compute();
+}
+
+
+void Ina219Sensor::configure(float shunt_ohms, float max_current_A, uint16_t averaging) {
+    _shunt_ohms = shunt_ohms;
+    _max_current_A = max_current_A;
+    _averaging = averaging;
+    _reconfigure = true;
+}
+
+
+// Register values from the configuration, per the datasheet's programming
+// procedure. Runs on the bus task (or before it starts).
+void Ina219Sensor::_compute() {
+
+    // Smallest PGA range that still covers full-scale current
+    static const float range_mV[] = {40, 80, 160, 320};
+    float full_scale_mV = _max_current_A * _shunt_ohms * 1000;
+    uint8_t pga = 0;
+    while (pga < 3 && range_mV[pga] < full_scale_mV) pga++;
+
+    // Current_LSB = max / 2^15, Cal = trunc(0.04096 / (Current_LSB * R_shunt)).
+    // A very small shunt can push Cal past 16 bits - then the LSB gets coarser.
+    float calibration = 0.04096 / ((_max_current_A / 32768) * _shunt_ohms);
+    if (calibration > 0xFFFE) calibration = 0xFFFE;
+    if (calibration < 2) calibration = 2;
+    _base_calibration = (uint16_t) calibration & 0xFFFE;   // bit 0 is read-only
+    _current_lsb_mA = 40.96 / (_base_calibration * _shunt_ohms);
+
+    // Field gain scales the register, so the chip's own current is corrected
+    float scaled = _base_calibration * _cal.gain;
+    if (scaled > 0xFFFE) scaled = 0xFFFE;
+    if (scaled < 2) scaled = 2;
+    _calibration = (uint16_t) scaled & 0xFFFE;
+
+    // ADC mode 0x3 is 12-bit single sample, 0x9..0xF average 2..128 samples
+    uint8_t shift = 0;
+    while (shift < 7 && (1u << (shift + 1)) <= _averaging) shift++;
+    _averaging = 1 << shift;
+    uint8_t adc = shift ? 0x8 | shift : 0x3;
+    _config = CONFIG_BRNG_32V | pga << 11 | adc << 7 | adc << 3 | CONFIG_CONTINUOUS;
+
+    // Each result is a shunt and a bus conversion; never poll faster than that
+    uint32_t conversion_ms = (2 * CONVERSION_US * _averaging + 999) / 1000;
+    interval_ms = max(_base_interval, conversion_ms + 2);
+}
+
+
+bool Ina219Sensor::_write_config(I2cBus & bus) {
+    return bus.write_reg16(_address, INA219_REG_CALIBRATION, _calibration) &&
+           bus.write_reg16(_address, INA219_REG_CONFIG, _config);
+}
+
+
+bool Ina219Sensor::probe(I2cBus & bus) {
+    uint16_t readback;
+    _compute();
+    _reconfigure = false;
+    if (!_write_config(bus)) return false;
+    return bus.read_reg16(_address, INA219_REG_CONFIG, readback) && readback == _config;
+}
+
+
+// CNVR (bit 1 of the bus register) is set when a new conversion is complete
+// and cleared by reading the power register in fetch()
+int Ina219Sensor::ready(I2cBus & bus) {
+
+    if (_reconfigure) {
+        _reconfigure = false;
+        _compute();
+        if (!_write_config(bus)) {
+            _reconfigure = true;
+            return -1;
+        }
+        return 0;   // writing the config restarts the conversion
+    }
+
+    if (!bus.read_reg16(_address, INA219_REG_BUS, _bus_raw)) return -1;
+    return (_bus_raw & 0x02) ? 1 : 0;
+}
+
+
+// The INA219 has no pointer auto-increment, so the burst is one pointer
+// write + read per register, back to back. The bus register already came
+// with the CNVR poll; power goes last because reading it clears CNVR.
+bool Ina219Sensor::fetch(I2cBus & bus) {
+
+    static const uint8_t registers[] = {INA219_REG_SHUNT, INA219_REG_CURRENT, INA219_REG_POWER};
+    uint16_t values[3];
+    if (!bus.read_reg16_burst(_address, registers, values, 3)) return false;
+
+    // A brown-out resets the chip to calibration 0 - current/power then read 0
+    if (++_check >= CHECK_EVERY) {
+        _check = 0;
+        uint16_t calibration;
+        if (bus.read_reg16(_address, INA219_REG_CALIBRATION, calibration) && calibration != _calibration) {
+            _write_config(bus);
+        }
+    }
+
+    float raw_mA = (int16_t) values[1] * _current_lsb_mA;
+    if (_cal_state == CAL_CAPTURING) _capture(raw_mA);
+
+    PowerReading r;
+    r.shunt_mV = (int16_t) values[0] * 0.01;
+    r.bus_V = (_bus_raw >> 3) * 0.004;
+    r.current_mA = raw_mA + _cal.offset_mA;
+    // What the power register holds (|I| * V_bus), but including the field offset
+    r.power_mW = fabsf(r.current_mA) * r.bus_V;
+    r.overflow = _bus_raw & 0x01;
+    r.us = timebase.now_us();
+
+    portENTER_CRITICAL(&_lock);
+    r.seq = _reading.seq + 1;
+    _reading = r;
+    portEXIT_CRITICAL(&_lock);
+    return true;
+}
+
+
+bool Ina219Sensor::latest(PowerReading & out) {
+    portENTER_CRITICAL(&_lock);
+    out = _reading;
+    portEXIT_CRITICAL(&_lock);
+    return out.seq != 0;
+}
+
+
+// ---- two-point field calibration --------------------------------------------
+
+void Ina219Sensor::load_calibration() {
+    Ina219Calibration stored;
+    if (storage.load_blob("ina219", "cal", &stored, sizeof(stored)) &&
+        stored.magic == INA219_CAL_MAGIC && stored.gain > 0.5 && stored.gain < 2.0) {
+        _cal = stored;
+        _reconfigure = true;
+    }
+}
+
+
+// Averages the next INA219_CAL_SAMPLES raw readings against a reference
+// meter reading; the second point completes the calibration
+bool Ina219Sensor::capture_point(float reference_mA) {
+    if (_cal_state == CAL_CAPTURING) return false;
+    _cal_reference[_cal_points] = reference_mA;
+    _capture_sum = 0;
+    _capture_count = 0;
+    _cal_state = CAL_CAPTURING;
+    return true;
+}
+
+
+// Bus task. Raw readings carry the current gain but not the offset, so the
+// straight line through both points maps raw -> true directly.
+void Ina219Sensor::_capture(float raw_mA) {
+
+    _capture_sum += raw_mA;
+    if (++_capture_count < INA219_CAL_SAMPLES) return;
+
+    _cal_measured[_cal_points] = _capture_sum / _capture_count;
+    if (++_cal_points < 2) {
+        _cal_state = CAL_IDLE;
+        return;
+    }
+    _cal_points = 0;
+
+    float reference_span = _cal_reference[1] - _cal_reference[0];
+    float measured_span = _cal_measured[1] - _cal_measured[0];
+    if (fabsf(reference_span) < INA219_CAL_MIN_SPAN || fabsf(measured_span) < INA219_CAL_MIN_SPAN / 10) {
+        _cal_state = CAL_FAILED;
+        return;
+    }
+    float slope = reference_span / measured_span;
+    if (_cal.gain * slope < 0.5 || _cal.gain * slope > 2.0) {
+        _cal_state = CAL_FAILED;
+        return;
+    }
+
+    _cal.gain *= slope;
+    _cal.offset_mA = _cal_reference[0] - slope * _cal_measured[0];
+    _reconfigure = true;
+    _cal_dirty = true;
+    _cal_state = CAL_DONE;
+}
+
+
+void Ina219Sensor::clear_calibration() {
+    _cal = {INA219_CAL_MAGIC, 1.0, 0.0};
+    _cal_points = 0;
+    _cal_state = CAL_IDLE;
+    _reconfigure = true;
+    storage.clear_blob("ina219", "cal");
+}
+
+
+// Main task: NVS isn't touched from the bus task
+bool Ina219Sensor::persist() {
+    if (!_cal_dirty) return false;
+    _cal_dirty = false;
+    storage.store_blob("ina219", "cal", &_cal, sizeof(_cal));
+    return true;
+}
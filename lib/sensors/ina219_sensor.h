@@ -0,0 +1,124 @@
+#pragma once
+
+#include "sensor.h"
+
+#define INA219_ADDRESS 0x40
+#define INA219_INTERVAL 100         // ms, matches POWER_SAMPLE_INTERVAL
+#define INA219_SHUNT_OHMS 0.00551   // cell shunt (what the old 18.15 factor on the 0.1 ohm preset implied)
+#define INA219_MAX_CURRENT 10.0     // A, sets the current LSB and the PGA range
+#define INA219_AVERAGING 16         // ADC samples per result: 1, 2, 4 ... 128
+#define INA219_CAL_SAMPLES 20       // readings averaged per field calibration point
+#define INA219_CAL_MIN_SPAN 50.0    // mA, the two calibration points must be at least this far apart
+#define INA219_CAL_MAGIC 0x1A219CA1
+
+// INA219 registers
+#define INA219_REG_CONFIG 0x00
+#define INA219_REG_SHUNT 0x01
+#define INA219_REG_BUS 0x02
+#define INA219_REG_POWER 0x03
+#define INA219_REG_CURRENT 0x04
+#define INA219_REG_CALIBRATION 0x05
+
+// One complete INA219 sample
+struct PowerReading {
+    float shunt_mV;
+    float bus_V;
+    float current_mA;
+    float power_mW;
+    bool overflow;      // math overflow flag - current/power are not valid
+    uint64_t us;        // when it was read, monotonic (timebase)
+    uint32_t seq;       // increments with every new reading
+};
+
+// Field calibration, persisted in NVS. Gain is folded into the calibration
+// register (so the chip's current and power registers stay consistent);
+// the offset is added in software.
+struct Ina219Calibration {
+    uint32_t magic;
+    float gain;
+    float offset_mA;
+};
+
+/**
+ * Register-level INA219 driver on the I2C bus. Runs free in continuous
+ * shunt+bus mode with hardware averaging; each interval the driver polls
+ * the conversion-ready flag and then burst-reads the result registers.
+ *
+ * The calibration register is computed from the shunt resistance and the
+ * expected maximum current (datasheet 8.5.1), and the smallest PGA range
+ * that covers that current is selected. A two-point field calibration
+ * against a reference meter corrects what's left of gain and offset.
+ */
+class Ina219Sensor : public I2cSensor {
+
+    public:
+
+        enum CalState : uint8_t { CAL_IDLE, CAL_CAPTURING, CAL_DONE, CAL_FAILED };
+
+        Ina219Sensor(uint8_t address, uint32_t interval_ms);
+
+        bool latest(PowerReading &);
+
+        // Shunt, full-scale current and averaging; applied on the next sample
+        void configure(float shunt_ohms, float max_current_A, uint16_t averaging);
+        float shunt_ohms() { return _shunt_ohms; }
+        float max_current_A() { return _max_current_A; }
+        float current_lsb_mA() { return _current_lsb_mA; }
+        uint16_t averaging() { return _averaging; }
+        uint16_t calibration_register() { return _calibration; }
+        uint16_t config_register() { return _config; }
+
+        // Two-point field calibration - main task only (NVS)
+        void load_calibration();
+        bool capture_point(float reference_mA);
+        void clear_calibration();
+        bool persist();
+        CalState calibration_state() { return _cal_state; }
+        uint8_t calibration_points() { return _cal_points; }
+        float gain() { return _cal.gain; }
+        float offset_mA() { return _cal.offset_mA; }
+
+    protected:
+
+        bool probe(I2cBus &) override;
+        int ready(I2cBus &) override;
+        bool fetch(I2cBus &) override;
+
+    private:
+
+        uint8_t _address;
+        uint32_t _base_interval;
+
+        // configuration
+        float _shunt_ohms = INA219_SHUNT_OHMS;
+        float _max_current_A = INA219_MAX_CURRENT;
+        uint16_t _averaging = INA219_AVERAGING;
+        uint16_t _base_calibration = 0;     // from the shunt, before field gain
+        uint16_t _calibration = 0;          // what's in the chip
+        uint16_t _config = 0;
+        float _current_lsb_mA = 0;
+        volatile bool _reconfigure = true;
+        uint8_t _check = 0;
+
+        uint16_t _bus_raw = 0;              // captured by ready()
+
+        // field calibration
+        Ina219Calibration _cal = {INA219_CAL_MAGIC, 1.0, 0.0};
+        volatile CalState _cal_state = CAL_IDLE;
+        volatile bool _cal_dirty = false;
+        uint8_t _cal_points = 0;
+        float _cal_reference[2];
+        float _cal_measured[2];
+        float _capture_sum = 0;
+        uint8_t _capture_count = 0;
+
+        PowerReading _reading = {};
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+        void _compute();
+        bool _write_config(I2cBus &);
+        void _capture(float raw_mA);
+
+};
+
+extern Ina219Sensor ina219_sensor;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+
+class I2cBus;
+
+/**
+ * Plug-in interface for a sensor on the I2C bus. The bus task drives each
+ * sensor through trigger -> ready -> fetch once per interval; a driver only
+ * implements the steps its chip needs. All steps run on the bus task and
+ * must not block - polling replaces fixed conversion delays.
+ */
+class I2cSensor {
+
+    public:
+
+        I2cSensor(const char * name, uint32_t interval_ms)
+            : interval_ms(interval_ms), _name(name) {}
+        virtual ~I2cSensor() {}
+
+        const char * name() { return _name; }
+        bool is_present() { return _present; }
+        uint32_t timeouts() { return _timeouts; }
+
+        uint32_t interval_ms;
+
+    protected:
+
+        friend class I2cBus;
+
+        // Detect the chip and configure it; false if it isn't there
+        virtual bool probe(I2cBus &) = 0;
+        // Start a conversion (nothing to do for free-running chips)
+        virtual bool trigger(I2cBus &) { return true; }
+        // 1 when the conversion is ready, 0 if not yet, -1 on error
+        virtual int ready(I2cBus &) { return 1; }
+        // Burst-read the result, convert and publish it
+        virtual bool fetch(I2cBus &) = 0;
+
+    private:
+
+        enum State : uint8_t { IDLE, CONVERTING };
+
+        const char * _name;
+        volatile bool _present = false;     // read from other tasks
+        uint8_t _failures = 0;              // consecutive failed conversions
+        State _state = IDLE;
+        unsigned long _due = 0;
+        unsigned long _started = 0;
+        unsigned long _next_probe = 0;
+        uint32_t _timeouts = 0;
+
+};
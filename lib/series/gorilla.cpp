@@ -0,0 +1,154 @@
+#include "gorilla.h"
+#include <string.h>
+
+
+void GorillaState::reset(uint32_t start) {
+    t = start;
+    delta = 0;
+    memset(value, 0, sizeof(value));
+    memset(lead, 0xFF, sizeof(lead));
+    memset(trail, 0, sizeof(trail));
+}
+
+
+void BitWriter::write(uint32_t value, uint8_t bits) {
+    while (bits) {
+        size_t byte = _bits / 8;
+        uint8_t offset = _bits % 8;
+        uint8_t take = 8 - offset < bits ? 8 - offset : bits;
+        uint8_t chunk = (value >> (bits - take)) & ((1u << take) - 1);
+        if (byte < _size) {
+            if (offset == 0) _buf[byte] = 0;
+            _buf[byte] |= chunk << (8 - offset - take);
+        }
+        _bits += take;
+        bits -= take;
+    }
+}
+
+
+uint32_t BitReader::read(uint8_t bits) {
+    uint32_t value = 0;
+    while (bits) {
+        if (_pos >= _size) {
+            _pos += bits;       // overran() from here on
+            return 0;
+        }
+        uint8_t offset = _pos % 8;
+        uint8_t take = 8 - offset < bits ? 8 - offset : bits;
+        uint8_t chunk = (_buf[_pos / 8] >> (8 - offset - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        _pos += take;
+        bits -= take;
+    }
+    return value;
+}
+
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/*
+ * Delta-of-delta buckets from the paper, narrowed for seconds:
+ *   0                     dod == 0
+ *   10   + 7 bits         -63..64
+ *   110  + 9 bits         -255..256
+ *   1110 + 12 bits        -2047..2048
+ *   1111 + 32 bits        anything else
+ */
+void Gorilla::encode(GorillaState & s, BitWriter & out, uint32_t t, const float * values, uint8_t count) {
+    int32_t delta = (int32_t) (t - s.t);
+    int32_t dod = delta - s.delta;
+    if (dod == 0) {
+        out.write(0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        out.write(0b10, 2);
+        out.write(dod + 63, 7);
+    } else if (dod >= -255 && dod <= 256) {
+        out.write(0b110, 3);
+        out.write(dod + 255, 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        out.write(0b1110, 4);
+        out.write(dod + 2047, 12);
+    } else {
+        out.write(0b1111, 4);
+        out.write((uint32_t) dod, 32);
+    }
+    s.t = t;
+    s.delta = delta;
+
+    // Values: 0 unchanged, 10 inside the previous XOR window, 11 a new window
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t bits = float_bits(values[i]);
+        uint32_t x = bits ^ s.value[i];
+        s.value[i] = bits;
+        if (x == 0) {
+            out.write(0, 1);
+            continue;
+        }
+        uint8_t lead = __builtin_clz(x);
+        uint8_t trail = __builtin_ctz(x);
+        if (s.lead[i] != 0xFF && lead >= s.lead[i] && trail >= s.trail[i]) {
+            out.write(0b10, 2);
+            out.write(x >> s.trail[i], 32 - s.lead[i] - s.trail[i]);
+        } else {
+            uint8_t length = 32 - lead - trail;
+            out.write(0b11, 2);
+            out.write(lead, 5);
+            out.write(length - 1, 5);
+            out.write(x >> trail, length);
+            s.lead[i] = lead;
+            s.trail[i] = trail;
+        }
+    }
+}
+
+
+bool Gorilla::decode(GorillaState & s, BitReader & in, uint32_t & t, float * values, uint8_t count) {
+    int32_t dod;
+    if (in.read(1) == 0) {
+        dod = 0;
+    } else if (in.read(1) == 0) {
+        dod = (int32_t) in.read(7) - 63;
+    } else if (in.read(1) == 0) {
+        dod = (int32_t) in.read(9) - 255;
+    } else if (in.read(1) == 0) {
+        dod = (int32_t) in.read(12) - 2047;
+    } else {
+        dod = (int32_t) in.read(32);
+    }
+    s.delta += dod;
+    s.t += s.delta;
+    t = s.t;
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (in.read(1)) {
+            uint32_t x;
+            if (in.read(1) == 0) {
+                if (s.lead[i] == 0xFF) return false;        // corrupt, no window yet
+                x = in.read(32 - s.lead[i] - s.trail[i]) << s.trail[i];
+            } else {
+                uint8_t lead = in.read(5);
+                uint8_t length = in.read(5) + 1;
+                uint8_t trail = 32 - lead - length;
+                if (lead + length > 32) return false;       // corrupt
+                x = in.read(length) << trail;
+                s.lead[i] = lead;
+                s.trail[i] = trail;
+            }
+            s.value[i] ^= x;
+        }
+        values[i] = bits_float(s.value[i]);
+    }
+    return !in.overran();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GORILLA_VALUES_MAX 6                // per point
+#define GORILLA_POINT_BITS_MAX (36 + GORILLA_VALUES_MAX * 45)
+
+/**
+ * Gorilla time-series compression (Pelkonen et al., VLDB 2015), sized for
+ * a microcontroller: timestamps in whole seconds as delta-of-delta, values
+ * as float32 XORed with the previous value of the same column.
+ *
+ * A regular series costs one bit per timestamp; a value that didn't change
+ * one bit, and one that did about 2 bits plus its meaningful XOR bits. The
+ * store rounds values to a binary fraction first, which keeps that short.
+ *
+ * The chain state is a plain struct so a decoder that has read a block to
+ * its end holds exactly what the encoder needs to carry on appending.
+ */
+struct GorillaState {
+    uint32_t t;                             // previous timestamp
+    int32_t delta;                          // previous delta
+    uint32_t value[GORILLA_VALUES_MAX];     // previous float32 bits
+    uint8_t lead[GORILLA_VALUES_MAX];       // previous XOR window, lead 0xFF = none yet
+    uint8_t trail[GORILLA_VALUES_MAX];
+
+    void reset(uint32_t start);             // a new chain whose first point is at start
+};
+
+
+// MSB-first bits into a caller-supplied buffer; writes past the end are dropped and flagged
+class BitWriter {
+
+    public:
+
+        // bits > 0 carries on after that many bits already in buf
+        BitWriter(uint8_t * buf, size_t size, size_t bits = 0) : _buf(buf), _size(size), _bits(bits) {}
+
+        void write(uint32_t value, uint8_t bits);
+        size_t bits() const { return _bits; }
+        size_t bytes() const { return (_bits + 7) / 8; }
+        bool overflowed() const { return _bits > _size * 8; }
+        void clear() { _bits = 0; }
+
+    private:
+
+        uint8_t * _buf;
+        size_t _size;
+        size_t _bits;
+
+};
+
+
+class BitReader {
+
+    public:
+
+        BitReader(const uint8_t * buf, size_t bits) : _buf(buf), _size(bits) {}
+
+        uint32_t read(uint8_t bits);
+        size_t remaining() const { return _pos < _size ? _size - _pos : 0; }
+        bool overran() const { return _pos > _size; }
+
+    private:
+
+        const uint8_t * _buf;
+        size_t _size;
+        size_t _pos = 0;
+
+};
+
+
+namespace Gorilla {
+
+    void encode(GorillaState &, BitWriter &, uint32_t t, const float * values, uint8_t count);
+
+    // False if the bits ran out part way through the point
+    bool decode(GorillaState &, BitReader &, uint32_t & t, float * values, uint8_t count);
+
+}
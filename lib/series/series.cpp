@@ -0,0 +1,488 @@
+#include "series.h"
+#include "timebase.h"
+#include "device.h"
+#include <esp_partition.h>
+
+#define SERIES_MAGIC 0x31535346         // "FSS1"
+#define SERIES_NO_BITS 0xFFFF           // an erased frame header
+
+// Start of every sector
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t seq;                       // per tier, one more for every block opened
+    uint32_t start;                     // first point and the compression chain's base, epoch s
+    uint8_t tier;
+    uint8_t values;
+    uint16_t reserved;
+};
+
+// Start of every flushed frame, then ceil(bits / 8) bytes of points
+struct FrameHeader {
+    uint16_t bits;
+    uint8_t points;
+    uint8_t crc;                        // CRC-8 of the frame bytes
+};
+
+static const char *const TIER_NAMES[SERIES_TIER_COUNT] = {"raw", "minute", "hour"};
+static const uint32_t TIER_INTERVALS[SERIES_TIER_COUNT] = {SERIES_RAW_INTERVAL, 60, 3600};
+static const char *const FIELD_NAMES[SERIES_FIELDS] = {"current_mA", "bus_V"};
+
+// Rounded to a binary fraction near each sensor's resolution, so the low
+// mantissa bits are zero and the XORs between points stay short
+static const float QUANTUM[SERIES_FIELDS] = {1.0f / 16, 1.0f / 1024};
+
+SeriesStore series;
+
+
+// The data partition min_spiffs.csv labels spiffs
+class PartitionFlash : public SeriesFlash {
+
+    public:
+
+        bool find() {
+            _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+            return _partition != nullptr;
+        }
+        size_t size() override { return _partition->size; }
+        bool read(size_t offset, void * data, size_t len) override {
+            return esp_partition_read(_partition, offset, data, len) == ESP_OK;
+        }
+        bool write(size_t offset, const void * data, size_t len) override {
+            return esp_partition_write(_partition, offset, data, len) == ESP_OK;
+        }
+        bool erase(size_t offset) override {
+            return esp_partition_erase_range(_partition, offset, SERIES_SECTOR) == ESP_OK;
+        }
+
+    private:
+
+        const esp_partition_t * _partition = nullptr;
+
+};
+
+static PartitionFlash partition_flash;
+
+
+static uint8_t crc8(const uint8_t * data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static float quantize(float value, int field) {
+    return roundf(value / QUANTUM[field]) * QUANTUM[field];
+}
+
+
+bool SeriesStore::begin(SeriesFlash * flash) {
+    if (!flash) {
+        if (!partition_flash.find()) {
+            Serial.println("\tSeries: no data partition, history off");
+            return false;
+        }
+        flash = &partition_flash;
+    }
+    uint16_t sectors = min(flash->size() / SERIES_SECTOR, (size_t) SERIES_SECTORS_MAX);
+    uint16_t raw = sectors * 5 / 16;
+    uint16_t hour = max(sectors * 3 / 16, 2);
+    if (raw < 2 || sectors - raw - hour < 2) {
+        Serial.println("\tSeries: data partition too small, history off");
+        return false;
+    }
+    _flash = flash;
+    _tiers[SERIES_RAW].first = 0;
+    _tiers[SERIES_RAW].sectors = raw;
+    _tiers[SERIES_MINUTE].first = raw;
+    _tiers[SERIES_MINUTE].sectors = sectors - raw - hour;
+    _tiers[SERIES_HOUR].first = sectors - hour;
+    _tiers[SERIES_HOUR].sectors = hour;
+    for (int t = 0; t < SERIES_TIER_COUNT; t++) _recover((SeriesTier) t);
+    _resume();
+
+    _sample_seq = device.SampleSeq();
+    SeriesTierStats stats;
+    tier_stats(SERIES_RAW, stats);
+    Serial.printf("\tSeries: %u sectors (%u/%u/%u), raw history from %lu\n", sectors, raw,
+                  _tiers[SERIES_MINUTE].sectors, hour, (unsigned long) stats.oldest);
+    return true;
+}
+
+
+// Reads every header in the tier's ring, then decodes the newest block to
+// its last good frame so appending carries on in the same chain
+void SeriesStore::_recover(SeriesTier tier) {
+    Tier & tr = _tiers[tier];
+    tr.open = -1;
+    tr.next_seq = 1;
+    tr.pending_bits = 0;
+    tr.pending_points = 0;
+
+    for (int s = tr.first; s < tr.first + tr.sectors; s++) {
+        BlockHeader header;
+        bool ok = _flash->read(s * SERIES_SECTOR, &header, sizeof(header)) && header.magic == SERIES_MAGIC
+                  && header.tier == tier && header.values == values(tier) && header.seq && header.seq != 0xFFFFFFFF;
+        _blocks[s].seq = ok ? header.seq : 0;
+        _blocks[s].start = ok ? header.start : 0;
+        if (ok && header.seq >= tr.next_seq) {
+            tr.next_seq = header.seq + 1;
+            tr.open = s;
+        }
+    }
+    if (tr.open < 0) return;
+
+    SeriesCursor cursor(*this, tier, 0, UINT32_MAX);
+    cursor._seq = _blocks[tr.open].seq - 1;
+    cursor._next_block();
+    SeriesPoint point;
+    while (cursor._sector == tr.open && cursor.next(point)) {}
+    tr.state = cursor._state;
+    tr.offset = cursor._offset;
+}
+
+
+// The minute and hour still open at the reset, from the raw and minute
+// points already stored; minutes count as full ones towards the hour mean
+void SeriesStore::_resume() {
+    SeriesTierStats stats;
+    SeriesPoint point;
+    if (tier_stats(SERIES_MINUTE, stats) && stats.newest) {
+        SeriesCursor cursor(*this, SERIES_MINUTE, stats.newest - stats.newest % 3600, UINT32_MAX);
+        while (cursor.next(point)) {
+            float min[SERIES_FIELDS], mean[SERIES_FIELDS], max[SERIES_FIELDS];
+            for (int f = 0; f < SERIES_FIELDS; f++) {
+                min[f] = point.v[f * 3];
+                mean[f] = point.v[f * 3 + 1];
+                max[f] = point.v[f * 3 + 2];
+            }
+            _fold(_hour, point.t - point.t % 3600, min, mean, max, 60 / SERIES_RAW_INTERVAL);
+        }
+    }
+    if (tier_stats(SERIES_RAW, stats) && stats.newest) {
+        uint32_t minute = stats.newest - stats.newest % 60;
+        SeriesCursor cursor(*this, SERIES_RAW, minute, UINT32_MAX);
+        while (cursor.next(point)) _fold(_minute, minute, point.v, point.v, point.v, 1);
+        _last_raw = stats.newest;
+    }
+}
+
+
+void SeriesStore::loop() {
+    if (!_flash || !timebase.is_synced()) return;
+    uint32_t now = timebase.epoch_ms() / 1000;
+    if (now - _last_raw < SERIES_RAW_INTERVAL) return;
+
+    // Mean of the INA219 samples since the last point; none means the sensor is down
+    float sum[SERIES_FIELDS] = {};
+    uint32_t count = 0;
+    uint32_t newest = device.SampleSeq();
+    for (; _sample_seq < newest; _sample_seq++) {
+        PowerSample sample;
+        if (!device.GetSample(_sample_seq, sample)) continue;
+        sum[0] += sample.current_mA;
+        sum[1] += sample.busvoltage;
+        count++;
+    }
+    if (count) {
+        float fields[SERIES_FIELDS];
+        for (int f = 0; f < SERIES_FIELDS; f++) fields[f] = sum[f] / count;
+        _record(now, fields);
+    }
+    _last_raw = now;
+
+    for (int t = 0; t < SERIES_TIER_COUNT; t++) {
+        Tier & tr = _tiers[t];
+        uint32_t limit = t == SERIES_RAW ? SERIES_FLUSH_RAW : SERIES_FLUSH_ROLLUP;
+        if (tr.pending_points && now - tr.pending_since >= limit) _flush((SeriesTier) t);
+    }
+}
+
+
+void SeriesStore::flush() {
+    if (!_flash) return;
+    for (int t = 0; t < SERIES_TIER_COUNT; t++) _flush((SeriesTier) t);
+}
+
+
+// A raw point, and the minute and hour rollups it closes or joins
+void SeriesStore::_record(uint32_t t, const float * fields) {
+    float raw[SERIES_FIELDS];
+    for (int f = 0; f < SERIES_FIELDS; f++) raw[f] = quantize(fields[f], f);
+    _append(SERIES_RAW, t, raw);
+
+    uint32_t minute = t - t % 60;
+    if (_minute.count && _minute.start != minute) {
+        float mean[SERIES_FIELDS];
+        for (int f = 0; f < SERIES_FIELDS; f++) mean[f] = _minute.sum[f] / _minute.count;
+        uint32_t hour = _minute.start - _minute.start % 3600;
+        if (_hour.count && _hour.start != hour) _close(SERIES_HOUR, _hour);
+        _fold(_hour, hour, _minute.min, mean, _minute.max, _minute.count);
+        _close(SERIES_MINUTE, _minute);
+    }
+    _fold(_minute, minute, raw, raw, raw, 1);
+}
+
+
+void SeriesStore::_fold(Rollup & r, uint32_t start, const float * min, const float * mean, const float * max, uint32_t count) {
+    if (!r.count) {
+        r.start = start;
+        for (int f = 0; f < SERIES_FIELDS; f++) {
+            r.min[f] = min[f];
+            r.max[f] = max[f];
+            r.sum[f] = 0;
+        }
+    }
+    for (int f = 0; f < SERIES_FIELDS; f++) {
+        if (min[f] < r.min[f]) r.min[f] = min[f];
+        if (max[f] > r.max[f]) r.max[f] = max[f];
+        r.sum[f] += (double) mean[f] * count;
+    }
+    r.count += count;
+}
+
+
+void SeriesStore::_close(SeriesTier tier, Rollup & r) {
+    float values[GORILLA_VALUES_MAX];
+    for (int f = 0; f < SERIES_FIELDS; f++) {
+        values[f * 3] = r.min[f];
+        values[f * 3 + 1] = quantize(r.sum[f] / r.count, f);
+        values[f * 3 + 2] = r.max[f];
+    }
+    _append(tier, r.start, values);
+    r.count = 0;
+}
+
+
+void SeriesStore::_append(SeriesTier tier, uint32_t t, const float * values) {
+    Tier & tr = _tiers[tier];
+    const size_t worst = (GORILLA_POINT_BITS_MAX + 7) / 8;
+
+    // Time only runs forward within a block; a clock stepped back starts a new one
+    bool empty = !tr.pending_points && tr.offset == sizeof(BlockHeader);
+    bool backwards = tr.open >= 0 && (t < tr.state.t || (t == tr.state.t && !empty));
+    if (tr.open >= 0 && (backwards || tr.offset + sizeof(FrameHeader) + (tr.pending_bits + 7) / 8 + worst > SERIES_SECTOR)) {
+        _flush(tier);
+        tr.open = tr.open >= 0 && !backwards && tr.offset + sizeof(FrameHeader) + worst <= SERIES_SECTOR ? tr.open : -2;
+    }
+    if (tr.open < 0 && !_open(tier, t)) return;
+
+    // A full frame goes out first, and its header is space the check above
+    // didn't count - the point may no longer fit after it
+    if ((tr.pending_bits + 7) / 8 + worst > SERIES_FRAME_MAX || tr.pending_points == UINT8_MAX) {
+        _flush(tier);
+        if (tr.open >= 0 && tr.offset + sizeof(FrameHeader) + worst > SERIES_SECTOR) tr.open = -2;
+        if (tr.open < 0 && !_open(tier, t)) return;
+    }
+
+    BitWriter out(tr.pending, sizeof(tr.pending), tr.pending_bits);
+    Gorilla::encode(tr.state, out, t, values, SeriesStore::values(tier));
+    if (!tr.pending_points) tr.pending_since = t;
+    tr.pending_bits = out.bits();
+    tr.pending_points++;
+}
+
+
+// Erases the next sector round the ring - the oldest block - and starts a chain there
+bool SeriesStore::_open(SeriesTier tier, uint32_t t) {
+    Tier & tr = _tiers[tier];
+    int16_t sector = tr.first;
+    if (tr.open != -1) {
+        // -2: full or abandoned; find the newest block and move past it
+        uint32_t newest = 0;
+        for (int s = tr.first; s < tr.first + tr.sectors; s++) {
+            if (_blocks[s].seq > newest) {
+                newest = _blocks[s].seq;
+                sector = tr.first + (s - tr.first + 1) % tr.sectors;
+            }
+        }
+    }
+    _blocks[sector].seq = 0;
+    _erases++;
+    BlockHeader header = {SERIES_MAGIC, tr.next_seq, t, tier, values(tier), 0xFFFF};
+    if (!_flash->erase(sector * SERIES_SECTOR) || !_flash->write(sector * SERIES_SECTOR, &header, sizeof(header))) {
+        tr.open = -2;
+        return false;
+    }
+    _writes++;
+    _blocks[sector].seq = tr.next_seq++;
+    _blocks[sector].start = t;
+    tr.open = sector;
+    tr.offset = sizeof(header);
+    tr.state.reset(t);
+    tr.pending_bits = 0;
+    tr.pending_points = 0;
+    return true;
+}
+
+
+void SeriesStore::_flush(SeriesTier tier) {
+    Tier & tr = _tiers[tier];
+    if (tr.open < 0 || !tr.pending_points) return;
+    size_t bytes = (tr.pending_bits + 7) / 8;
+    FrameHeader frame = {(uint16_t) tr.pending_bits, tr.pending_points, crc8(tr.pending, bytes)};
+    size_t at = tr.open * SERIES_SECTOR + tr.offset;
+    bool ok = _flash->write(at, &frame, sizeof(frame)) && _flash->write(at + sizeof(frame), tr.pending, bytes);
+    _writes += 2;
+    tr.offset += sizeof(frame) + bytes;
+    tr.pending_bits = 0;
+    tr.pending_points = 0;
+    if (!ok) tr.open = -2;      // the chain can't continue past a bad frame
+}
+
+
+bool SeriesStore::tier_stats(SeriesTier tier, SeriesTierStats & stats) {
+    if (!_flash || tier >= SERIES_TIER_COUNT) return false;
+    const Tier & tr = _tiers[tier];
+    stats = {};
+    stats.sectors = tr.sectors;
+    uint32_t oldest_seq = UINT32_MAX;
+    for (int s = tr.first; s < tr.first + tr.sectors; s++) {
+        if (!_blocks[s].seq) continue;
+        stats.blocks++;
+        stats.bytes += s == tr.open ? tr.offset + (tr.pending_bits + 7) / 8 : SERIES_SECTOR;
+        if (_blocks[s].seq < oldest_seq) {
+            oldest_seq = _blocks[s].seq;
+            stats.oldest = _blocks[s].start;
+        }
+    }
+    if (tr.open >= 0 && (tr.pending_points || tr.offset > sizeof(BlockHeader))) stats.newest = tr.state.t;
+    return true;
+}
+
+
+SeriesTier SeriesStore::finest_tier(uint32_t from) {
+    SeriesTierStats stats;
+    for (int t = 0; t < SERIES_TIER_COUNT - 1; t++) {
+        if (tier_stats((SeriesTier) t, stats) && stats.oldest && stats.oldest <= from) return (SeriesTier) t;
+    }
+    return SERIES_HOUR;
+}
+
+
+const char * SeriesStore::tier_name(SeriesTier tier) {
+    return tier < SERIES_TIER_COUNT ? TIER_NAMES[tier] : "?";
+}
+
+bool SeriesStore::parse_tier(const char * name, SeriesTier & tier) {
+    for (int t = 0; t < SERIES_TIER_COUNT; t++) {
+        if (strcasecmp(name, TIER_NAMES[t]) == 0) {
+            tier = (SeriesTier) t;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t SeriesStore::values(SeriesTier tier) {
+    return tier == SERIES_RAW ? SERIES_FIELDS : SERIES_FIELDS * 3;
+}
+
+uint32_t SeriesStore::interval(SeriesTier tier) {
+    return tier < SERIES_TIER_COUNT ? TIER_INTERVALS[tier] : 0;
+}
+
+// "current_mA" for raw points, "current_mA_min" and so on for rollups
+const char * SeriesStore::value_name(SeriesTier tier, int index, char * buf, size_t size) {
+    static const char *const STATS[] = {"min", "mean", "max"};
+    if (tier == SERIES_RAW) return FIELD_NAMES[index % SERIES_FIELDS];
+    snprintf(buf, size, "%s_%s", FIELD_NAMES[(index / 3) % SERIES_FIELDS], STATS[index % 3]);
+    return buf;
+}
+
+
+SeriesCursor::SeriesCursor(SeriesStore & store, SeriesTier tier, uint32_t from, uint32_t to)
+    : _store(store), _tier(tier), _from(from), _to(to) {
+    _done = !store._flash || tier >= SERIES_TIER_COUNT || from > to;
+}
+
+
+bool SeriesCursor::next(SeriesPoint & point) {
+    uint8_t count = SeriesStore::values(_tier);
+    while (!_done) {
+        if (!_left && !_next_frame() && !_next_block()) {
+            _done = true;
+            break;
+        }
+        if (!_left) continue;
+        _left--;
+        if (!Gorilla::decode(_state, _reader, point.t, point.v, count)) {
+            _left = 0;
+            _offset = SERIES_SECTOR;        // nothing after a bad frame can be trusted
+            continue;
+        }
+        if (point.t < _from) continue;
+        if (point.t > _to) {
+            _done = true;
+            break;
+        }
+        point.count = count;
+        return true;
+    }
+    return false;
+}
+
+
+// The next block by sequence that can hold points from _from on
+bool SeriesCursor::_next_block() {
+    const SeriesStore::Tier & tr = _store._tiers[_tier];
+    for (;;) {
+        int16_t sector = -1;
+        int16_t after = -1;         // the block following it
+        for (int s = tr.first; s < tr.first + tr.sectors; s++) {
+            uint32_t seq = _store._blocks[s].seq;
+            if (seq <= _seq) continue;
+            if (sector < 0 || seq < _store._blocks[sector].seq) {
+                after = sector;
+                sector = s;
+            } else if (after < 0 || seq < _store._blocks[after].seq) {
+                after = s;
+            }
+        }
+        if (sector < 0) return false;
+        _seq = _store._blocks[sector].seq;
+        if (after >= 0 && _store._blocks[after].start <= _from) continue;
+        if (_store._blocks[sector].start > _to) return false;
+
+        _sector = sector;
+        _offset = sizeof(BlockHeader);
+        _pending_read = false;
+        _left = 0;
+        _state.reset(_store._blocks[sector].start);
+        return true;
+    }
+}
+
+
+// The next flushed frame of the block, then the open frame still in RAM
+bool SeriesCursor::_next_frame() {
+    if (_sector < 0 || _store._blocks[_sector].seq != _seq) return false;
+    const SeriesStore::Tier & tr = _store._tiers[_tier];
+
+    FrameHeader frame;
+    if (_offset + sizeof(frame) <= SERIES_SECTOR
+        && _store._flash->read(_sector * SERIES_SECTOR + _offset, &frame, sizeof(frame))
+        && frame.bits != SERIES_NO_BITS) {
+        size_t bytes = (frame.bits + 7) / 8;
+        if (!frame.points || bytes > sizeof(_frame) || _offset + sizeof(frame) + bytes > SERIES_SECTOR
+            || !_store._flash->read(_sector * SERIES_SECTOR + _offset + sizeof(frame), _frame, bytes)
+            || crc8(_frame, bytes) != frame.crc) {
+            _offset = SERIES_SECTOR;
+            return false;
+        }
+        _offset += sizeof(frame) + bytes;
+        _reader = BitReader(_frame, frame.bits);
+        _left = frame.points;
+        return true;
+    }
+
+    if (_sector == tr.open && !_pending_read && tr.pending_points) {
+        _pending_read = true;
+        memcpy(_frame, tr.pending, (tr.pending_bits + 7) / 8);
+        _reader = BitReader(_frame, tr.pending_bits);
+        _left = tr.pending_points;
+        return true;
+    }
+    return false;
+}
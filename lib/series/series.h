@@ -0,0 +1,188 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gorilla.h"
+
+#define SERIES_SECTOR 4096              // flash erase unit
+#define SERIES_SECTORS_MAX 64           // partitions up to 256 KB
+#define SERIES_FIELDS 2                 // current_mA, bus_V
+#define SERIES_RAW_INTERVAL 1           // s between raw points, each the mean of the INA219 samples
+#define SERIES_FRAME_MAX 256            // encoded bytes held in RAM per tier before a flash write
+#define SERIES_FLUSH_RAW 60             // s, longest a raw point waits in RAM
+#define SERIES_FLUSH_ROLLUP 600         // s, the same for minute and hour points
+#define SERIES_QUERY_MAX 2000           // points per HTTP query
+#define SERIES_TELNET_POINTS 15         // points per telnet query
+
+enum SeriesTier : uint8_t {
+    SERIES_RAW,                 // one point a second
+    SERIES_MINUTE,              // min, mean, max per field
+    SERIES_HOUR,
+    SERIES_TIER_COUNT
+};
+
+struct SeriesPoint {
+    uint32_t t;                         // epoch s, the start of the interval for rollups
+    uint8_t count;
+    float v[GORILLA_VALUES_MAX];        // raw: one per field; rollups: min, mean, max per field
+};
+
+struct SeriesTierStats {
+    uint8_t sectors;
+    uint8_t blocks;                     // holding data
+    uint32_t oldest;                    // epoch s, 0 when empty
+    uint32_t newest;
+    uint32_t bytes;                     // flash used, including the open block
+};
+
+/**
+ * Flash the store lives in: the data partition on the device, or a RAM
+ * image for a host build. Offsets are partition-relative; write() only
+ * ever clears bits of erased flash.
+ */
+class SeriesFlash {
+
+    public:
+
+        virtual ~SeriesFlash() {}
+        virtual size_t size() = 0;
+        virtual bool read(size_t offset, void * data, size_t len) = 0;
+        virtual bool write(size_t offset, const void * data, size_t len) = 0;
+        virtual bool erase(size_t offset) = 0;      // one SERIES_SECTOR
+};
+
+class SeriesCursor;
+
+/**
+ * On-device history that outlives broker and Home Assistant outages, in
+ * the 128 KB data partition min_spiffs.csv leaves spare. No filesystem is
+ * mounted there; the store owns the partition's sectors directly.
+ *
+ * Three tiers, each a ring of sectors written as an append-only log: raw
+ * points every second, and 1-minute and 1-hour min/mean/max rollups built
+ * from them as each interval closes. Every sector is one block, a header
+ * and then frames; each frame carries the points encoded since the last
+ * flush (Gorilla, see gorilla.h), with a bit count and CRC. A block's
+ * compression chain runs through all its frames, so boot decodes the
+ * newest block of each tier and carries on appending where it stopped.
+ * When a tier's ring is full its oldest sector is erased, so each sector
+ * is erased once per trip round the ring.
+ *
+ * At a typical 5 bytes a raw point the split (5/16 raw, 3/16 hour, the rest
+ * minute) keeps about 2 hours raw, a week of minutes and several months of
+ * hours; a larger partition stretches every tier. Points are only recorded
+ * once SNTP has set the clock, as stored timestamps are epoch seconds.
+ * Up to a frame of each tier (SERIES_FRAME_MAX, or the flush interval:
+ * a minute raw, ten minutes for rollups) is lost on an unplanned reset;
+ * the rollups still open are rebuilt at boot from the finer tiers.
+ *
+ * Main task only; queries run through a SeriesCursor synchronously, so
+ * nothing is appended while one is open.
+ */
+class SeriesStore {
+
+    public:
+
+        bool begin(SeriesFlash * flash = nullptr);  // the "spiffs" data partition by default
+        void loop();
+        void flush();                               // every tier, before a planned restart
+        bool is_ready() { return _flash != nullptr; }
+
+        bool tier_stats(SeriesTier, SeriesTierStats &);
+        SeriesTier finest_tier(uint32_t from);      // the finest tier still holding from
+        uint32_t flash_writes() { return _writes; }
+        uint32_t flash_erases() { return _erases; }
+
+        static const char * tier_name(SeriesTier);
+        static bool parse_tier(const char * name, SeriesTier &);
+        static uint8_t values(SeriesTier);          // per point
+        static uint32_t interval(SeriesTier);       // s between points
+        static const char * value_name(SeriesTier, int index, char * buf, size_t size);
+
+    private:
+
+        friend class SeriesCursor;
+
+        struct Block {
+            uint32_t seq;                   // 0 = no data
+            uint32_t start;                 // first point, epoch s
+        };
+
+        struct Tier {
+            uint16_t first;                 // sector range in the partition
+            uint16_t sectors;
+            int16_t open;                   // sector being appended to, -1 none
+            uint32_t next_seq;
+            uint32_t offset;                // write position in the open sector
+            GorillaState state;
+            uint8_t pending[SERIES_FRAME_MAX];
+            uint32_t pending_bits;
+            uint8_t pending_points;
+            uint32_t pending_since;         // epoch s of the frame's first point
+        };
+
+        struct Rollup {
+            uint32_t start;
+            uint32_t count;                 // raw points folded in
+            float min[SERIES_FIELDS];
+            float max[SERIES_FIELDS];
+            double sum[SERIES_FIELDS];
+        };
+
+        SeriesFlash * _flash = nullptr;
+        Tier _tiers[SERIES_TIER_COUNT];
+        Block _blocks[SERIES_SECTORS_MAX];
+        Rollup _minute = {};
+        Rollup _hour = {};
+        uint32_t _last_raw = 0;
+        uint32_t _sample_seq = 0;
+        uint32_t _writes = 0;
+        uint32_t _erases = 0;
+
+        void _recover(SeriesTier);
+        void _resume();
+        void _record(uint32_t t, const float * fields);
+        void _append(SeriesTier, uint32_t t, const float * values);
+        bool _open(SeriesTier, uint32_t t);
+        void _flush(SeriesTier);
+        static void _fold(Rollup &, uint32_t start, const float * min, const float * mean, const float * max, uint32_t count);
+        void _close(SeriesTier, Rollup &);
+
+};
+
+extern SeriesStore series;
+
+
+/**
+ * Points of one tier from..to (epoch s, inclusive), oldest first, decoded a
+ * frame at a time straight from flash and then from the open frame in RAM.
+ */
+class SeriesCursor {
+
+    public:
+
+        SeriesCursor(SeriesStore &, SeriesTier, uint32_t from, uint32_t to);
+
+        bool next(SeriesPoint &);
+
+    private:
+
+        friend class SeriesStore;
+
+        SeriesStore & _store;
+        SeriesTier _tier;
+        uint32_t _from;
+        uint32_t _to;
+        uint32_t _seq = 0;              // block being read
+        int16_t _sector = -1;
+        uint32_t _offset = 0;
+        bool _pending_read = false;
+        bool _done = false;
+        GorillaState _state;
+        uint8_t _frame[SERIES_FRAME_MAX];
+        BitReader _reader{_frame, 0};
+        uint8_t _left = 0;              // points left in the frame
+
+        bool _next_block();
+        bool _next_frame();
+
+};
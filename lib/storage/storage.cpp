@@ -36,4 +36,28 @@ void Storage::clear_creds() {
     preferences.begin("creds");
     preferences.clear();
     preferences.end();
-}
\ No newline at end of file
+}
+
+bool Storage::load_blob(const char * ns, const char * key, void * data, size_t len) {
+    bool found = false;
+    preferences.begin(ns, true);
+    if (preferences.isKey(key) && preferences.getBytesLength(key) == len) {
+        found = preferences.getBytes(key, data, len) == len;
+    }
+    preferences.end();
+    return found;
+}
+
+
+void Storage::store_blob(const char * ns, const char * key, const void * data, size_t len) {
+    preferences.begin(ns);
+    preferences.putBytes(key, data, len);
+    preferences.end();
+}
+
+
+void Storage::clear_blob(const char * ns, const char * key) {
+    preferences.begin(ns);
+    preferences.remove(key);
+    preferences.end();
+}
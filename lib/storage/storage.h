@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 
 class Storage {
 
@@ -10,6 +11,11 @@ class Storage {
         void store_creds(char *, char *);
         void clear_creds();
 
+        // fixed-size records (caches, calibration) keyed by namespace/key
+        bool load_blob(const char *, const char *, void *, size_t);
+        void store_blob(const char *, const char *, const void *, size_t);
+        void clear_blob(const char *, const char *);
+
 };
 
-extern Storage storage;
\ No newline at end of file
+extern Storage storage;
@@ -0,0 +1,265 @@
+#include "sweep.h"
+#include "storage.h"
+#include "timebase.h"
+#include "current_adc.h"
+#include "protection.h"
+#include "../device/device.h"
+#include "../telnet/telnet.h"
+
+Sweep sweep;
+
+static const uint32_t FREQUENCIES[SWEEP_FREQUENCY_COUNT] = SWEEP_FREQUENCIES;
+static const uint8_t SPEEDS[SWEEP_SPEED_COUNT] = SWEEP_SPEEDS;
+
+// Points run speed fastest, then polarity, then frequency
+static uint32_t point_frequency(int index) { return FREQUENCIES[index / (2 * SWEEP_SPEED_COUNT)]; }
+static bool point_reverse(int index) { return (index / SWEEP_SPEED_COUNT) % 2; }
+static uint8_t point_speed(int index) { return SPEEDS[index % SWEEP_SPEED_COUNT]; }
+
+
+void Sweep::begin(Motor * motor) {
+    _motor = motor;
+    if (!storage.load_blob("sweep", "table", &_table, sizeof(_table)) ||
+        _table.magic != SWEEP_MAGIC || _table.count > SWEEP_MAX_POINTS) {
+        memset(&_table, 0, sizeof(_table));
+    }
+    if (!storage.load_blob("sweep", "target", &_target_mA, sizeof(_target_mA)) ||
+        !isfinite(_target_mA) || _target_mA < 0) {
+        _target_mA = 0;
+    }
+    if (_table.count) {
+        Serial.printf("\tSweep: %u points stored, target %.0f mA\n", _table.count, _target_mA);
+    }
+}
+
+
+bool Sweep::start(const char *& why) {
+    if (_running) why = "already running";
+    else if (!_motor) why = "motor not initialized";
+    else if (device.IsDown()) why = "INA219 not responding";
+    else if (protection.state() != FAULT_ARMED) why = "overcurrent fault latched";
+    else why = nullptr;
+    if (why) return false;
+
+    _restore_frequency = _motor->getFrequency();
+    memset(&_table, 0, sizeof(_table));
+    _index = 0;
+    _running = true;
+    telnet.println("\tSweep: started");
+    _begin_point();
+    return true;
+}
+
+
+void Sweep::stop() {
+    if (!_running) return;
+    telnet.println("\tSweep: stopped");
+    _finish(false);
+}
+
+
+// A frequency change waits for the output to stop first
+void Sweep::_begin_point() {
+    uint32_t frequency = point_frequency(_index);
+    if (_motor->getFrequency() != frequency) {
+        _motor->stop();
+        _phase = STOPPING;
+        return;
+    }
+    if (point_reverse(_index)) _motor->reverse(point_speed(_index));
+    else _motor->forward(point_speed(_index));
+    _phase = SETTLING;
+    _point_start = 0;
+    _readings = 0;
+}
+
+
+void Sweep::loop() {
+    if (!_running) return;
+
+    if (protection.state() != FAULT_ARMED) {
+        telnet.println("\tSweep: stopped by an overcurrent trip");
+        _finish(false);
+        return;
+    }
+
+    if (_phase == STOPPING) {
+        if (!_motor->isSettled()) return;
+        uint32_t frequency = point_frequency(_index);
+        if (_motor->setFrequency(frequency) != frequency) {
+            char line[64];
+            snprintf(line, sizeof(line), "\tSweep: %lu Hz not possible, skipped", (unsigned long) frequency);
+            telnet.println(line);
+            _index = (_index / (2 * SWEEP_SPEED_COUNT) + 1) * 2 * SWEEP_SPEED_COUNT;
+            if (_index >= SWEEP_MAX_POINTS) _finish(true);
+            else _begin_point();
+            return;
+        }
+        _begin_point();
+        return;
+    }
+
+    // The dwell starts once the output has ramped to the point
+    if (!_motor->isSettled()) return;
+    if (!_point_start) {
+        _point_start = millis();
+        _seq = device.SampleSeq();
+    }
+
+    for (uint32_t newest = device.SampleSeq(); _seq < newest; _seq++) {
+        PowerSample sample;
+        if (!device.GetSample(_seq, sample)) continue;
+        int i = _readings++ % SWEEP_SETTLE_READINGS;
+        _current[i] = sample.current_mA;
+        _bus[i] = sample.busvoltage;
+        _power[i] = sample.power_mW;
+    }
+
+    unsigned long dwell = millis() - _point_start;
+    if (_readings >= SWEEP_SETTLE_READINGS && dwell >= SWEEP_DWELL_MIN_MS) {
+        float low = _current[0], high = _current[0], sum = 0;
+        for (int i = 0; i < SWEEP_SETTLE_READINGS; i++) {
+            if (_current[i] < low) low = _current[i];
+            if (_current[i] > high) high = _current[i];
+            sum += _current[i];
+        }
+        float tolerance = fabsf(sum / SWEEP_SETTLE_READINGS) * SWEEP_SETTLE_FRACTION;
+        if (high - low <= (tolerance > SWEEP_SETTLE_MA ? tolerance : SWEEP_SETTLE_MA)) {
+            _record(true);
+            return;
+        }
+    }
+    if (dwell >= SWEEP_DWELL_MAX_MS) _record(false);
+}
+
+
+void Sweep::_record(bool settled) {
+    SweepPoint & point = _table.points[_table.count++];
+    point.frequency = point_frequency(_index);
+    point.speed = point_speed(_index);
+    point.reverse = point_reverse(_index);
+    point.settled = settled;
+    point.dwell_ms = millis() - _point_start;
+
+    int n = _readings < SWEEP_SETTLE_READINGS ? _readings : SWEEP_SETTLE_READINGS;
+    float current = 0, bus = 0, power = 0;
+    for (int i = 0; i < n; i++) {
+        current += _current[i];
+        bus += _bus[i];
+        power += _power[i];
+    }
+    point.current_mA = n ? current / n : NAN;
+    point.bus_V = n ? bus / n : NAN;
+    point.power_mW = n ? power / n : NAN;
+
+    CurrentBlock block;
+    bool acs = current_adc.latest(block);
+    point.cell_mA = acs ? block.mean_mA : NAN;
+    point.cell_rms_mA = acs ? block.rms_mA : NAN;
+    point.ripple_mA = acs ? block.ripple_mA : NAN;
+
+    char line[96];
+    snprintf(line, sizeof(line), "\tSweep %d/%d: %lu Hz %s %u -> %.0f mA, %.2f V%s", _index + 1, SWEEP_MAX_POINTS,
+             (unsigned long) point.frequency, point.reverse ? "rev" : "fwd", point.speed, point.current_mA,
+             point.bus_V, settled ? "" : " (unsettled)");
+    telnet.println(line);
+
+    if (++_index >= SWEEP_MAX_POINTS) _finish(true);
+    else _begin_point();
+}
+
+
+// Back to the running frequency and the normal drive; only a full sweep
+// replaces the stored table
+void Sweep::_finish(bool complete) {
+    _running = false;
+    _motor->stop();
+    _motor->setFrequency(_restore_frequency);
+
+    if (complete) {
+        _table.magic = SWEEP_MAGIC;
+        _table.ts = timebase.is_synced() ? timebase.epoch_ms() / 1000 : 0;
+        storage.store_blob("sweep", "table", &_table, sizeof(_table));
+        char line[64];
+        snprintf(line, sizeof(line), "\tSweep: done, %u points saved", _table.count);
+        telnet.println(line);
+    } else if (!storage.load_blob("sweep", "table", &_table, sizeof(_table)) || _table.magic != SWEEP_MAGIC) {
+        memset(&_table, 0, sizeof(_table));
+    }
+    device.ResumeDrive();
+}
+
+
+bool Sweep::get(int index, SweepPoint & point) {
+    if (index < 0 || index >= _table.count) return false;
+    point = _table.points[index];
+    return true;
+}
+
+
+// Empty for NAN, so spreadsheets see a missing value
+static const char * csv_number(char * buf, size_t size, float value, int decimals) {
+    if (isnan(value)) buf[0] = '\0';
+    else snprintf(buf, size, "%.*f", decimals, value);
+    return buf;
+}
+
+void Sweep::write_csv(Print & out, int first, int count) {
+    if (first == 0) {
+        out.print("frequency_hz,polarity,speed,current_ma,bus_v,power_mw,cell_ma,ripple_ma,ma_per_w,dc_fraction,settled,dwell_ms\r\n");
+    }
+    char f[7][16];
+    for (int i = first; i < _table.count && i < first + count; i++) {
+        const SweepPoint & p = _table.points[i];
+        float per_watt = p.power_mW > 0 ? p.current_mA / (p.power_mW / 1000) : NAN;
+        float dc = p.cell_rms_mA > 0 ? fabsf(p.cell_mA) / p.cell_rms_mA : NAN;
+        out.printf("%lu,%s,%u,%s,%s,%s,%s,%s,%s,%s,%u,%lu\r\n", (unsigned long) p.frequency,
+                   p.reverse ? "reverse" : "forward", p.speed,
+                   csv_number(f[0], sizeof(f[0]), p.current_mA, 1), csv_number(f[1], sizeof(f[1]), p.bus_V, 3),
+                   csv_number(f[2], sizeof(f[2]), p.power_mW, 0), csv_number(f[3], sizeof(f[3]), p.cell_mA, 1),
+                   csv_number(f[4], sizeof(f[4]), p.ripple_mA, 1), csv_number(f[5], sizeof(f[5]), per_watt, 1),
+                   csv_number(f[6], sizeof(f[6]), dc, 3), p.settled, (unsigned long) p.dwell_ms);
+    }
+}
+
+
+// Linear between the measured speeds at the nearest swept frequency, from
+// 0 mA at speed 0; full speed when the target is beyond every point
+int Sweep::feedforward(bool reverse) {
+    if (_target_mA <= 0 || !_table.count || !_motor) return -1;
+
+    uint32_t running = _motor->getFrequency();
+    uint32_t frequency = 0;
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < _table.count; i++) {
+        const SweepPoint & p = _table.points[i];
+        uint32_t distance = p.frequency > running ? p.frequency - running : running - p.frequency;
+        if (p.reverse == reverse && distance < best) {
+            best = distance;
+            frequency = p.frequency;
+        }
+    }
+    if (best == UINT32_MAX) return -1;
+
+    float prev_speed = 0, prev_mA = 0;
+    for (int i = 0; i < _table.count; i++) {
+        const SweepPoint & p = _table.points[i];
+        if (p.frequency != frequency || p.reverse != reverse || isnan(p.current_mA)) continue;
+        float mA = fabsf(p.current_mA);
+        if (mA >= _target_mA) {
+            float speed = mA > prev_mA ? prev_speed + (_target_mA - prev_mA) * (p.speed - prev_speed) / (mA - prev_mA)
+                                       : p.speed;
+            return constrain((int) lroundf(speed), 1, MOTOR_SPEED_MAX);
+        }
+        prev_speed = p.speed;
+        prev_mA = mA;
+    }
+    return MOTOR_SPEED_MAX;
+}
+
+
+void Sweep::set_target(float mA) {
+    _target_mA = mA;
+    storage.store_blob("sweep", "target", &_target_mA, sizeof(_target_mA));
+    if (!_running) device.ResumeDrive();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Arduino.h>
+#include "motor.h"
+
+#define SWEEP_FREQUENCIES {1000, 2000, 5000, 10000, 20000}     // Hz
+#define SWEEP_SPEEDS {32, 64, 96, 128, 160, 192, 224, 255}      // motor speed, 0-255
+#define SWEEP_FREQUENCY_COUNT 5
+#define SWEEP_SPEED_COUNT 8
+#define SWEEP_MAX_POINTS (SWEEP_FREQUENCY_COUNT * SWEEP_SPEED_COUNT * 2)
+#define SWEEP_SETTLE_READINGS 10        // INA219 readings that must agree, 1 s at 100 ms
+#define SWEEP_SETTLE_MA 5.0             // agree = spread within this...
+#define SWEEP_SETTLE_FRACTION 0.02      // ...or this share of the mean, whichever is larger
+#define SWEEP_DWELL_MIN_MS 2000         // per point, from the output settling
+#define SWEEP_DWELL_MAX_MS 20000        // recorded as unsettled after this
+#define SWEEP_MAGIC 0x53574550
+
+// One operating point, averaged over the settled readings
+struct SweepPoint {
+    uint32_t frequency;     // Hz
+    uint8_t speed;          // 0-255
+    uint8_t reverse;
+    uint8_t settled;        // 0 when the dwell ran out first
+    uint32_t dwell_ms;
+    float current_mA;       // INA219
+    float bus_V;
+    float power_mW;
+    float cell_mA;          // ACS712 block mean, NAN without it
+    float cell_rms_mA;
+    float ripple_mA;        // ACS712 AC rms
+};
+
+// The NVS copy
+struct SweepTable {
+    uint32_t magic;
+    uint16_t count;
+    uint32_t ts;            // epoch s when taken, 0 if the clock wasn't set
+    SweepPoint points[SWEEP_MAX_POINTS];
+};
+
+/**
+ * Cell characterization: current, voltage and power against duty and PWM
+ * frequency, in both polarities.
+ *
+ * start() steps through every frequency, polarity and speed in turn. At
+ * each point the output is commanded, allowed to settle, then held until
+ * SWEEP_SETTLE_READINGS consecutive INA219 readings agree (or the dwell
+ * times out), and the average is recorded with the ACS712 mean and ripple.
+ * Two efficiency proxies come out of that: mA of current per W in, and
+ * the DC share of the rms cell current - ripple heats the cell without
+ * making chlorine, and it's what the PWM frequency changes.
+ *
+ * The table is kept in NVS. With a target current set, feedforward()
+ * interpolates the speed that gave it at the running frequency, and the
+ * device drives the cell at that speed instead of full duty. Reversal on
+ * charge is held off for the duration; overcurrent protection is not, and
+ * a trip ends the sweep.
+ */
+class Sweep {
+
+    public:
+
+        void begin(Motor *);    // from Device::setup(), loads the table
+        void loop();
+
+        bool start(const char *& why);  // false with the reason it can't
+        void stop();
+        bool running() { return _running; }
+        int point() { return _index; }
+        int total() { return SWEEP_MAX_POINTS; }
+
+        int count() { return _table.count; }
+        uint32_t taken() { return _table.ts; }
+        bool get(int index, SweepPoint &);
+        void write_csv(Print &, int first = 0, int count = SWEEP_MAX_POINTS);  // header with the first row
+
+        // Speed for the target current at the running frequency, -1 with no
+        // target or no table for that polarity
+        int feedforward(bool reverse);
+        float target_mA() { return _target_mA; }
+        void set_target(float mA);
+
+    private:
+
+        enum Phase : uint8_t { STOPPING, SETTLING };
+
+        Motor * _motor = nullptr;
+        SweepTable _table = {};
+        float _target_mA = 0;
+
+        bool _running = false;
+        int _index = 0;
+        Phase _phase = SETTLING;
+        uint32_t _restore_frequency = 0;
+        unsigned long _point_start = 0;
+        uint32_t _seq = 0;
+        float _current[SWEEP_SETTLE_READINGS];     // the last readings at this point
+        float _bus[SWEEP_SETTLE_READINGS];
+        float _power[SWEEP_SETTLE_READINGS];
+        int _readings = 0;
+
+        void _begin_point();
+        void _record(bool settled);
+        void _finish(bool complete);
+
+};
+
+extern Sweep sweep;
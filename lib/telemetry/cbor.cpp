@@ -0,0 +1,105 @@
+#include "cbor.h"
+#include "telemetry_keys.h"
+
+
+int CborWriter::key_index(const char * name) {
+    for (size_t i = 0; i < TELEMETRY_KEY_COUNT; i++) {
+        if (strcmp(name, TELEMETRY_KEYS[i]) == 0) return i;
+    }
+    return -1;
+}
+
+
+void CborWriter::key(const char * name) {
+    int index = key_index(name);
+    if (index >= 0) uinteger(index);
+    else text(name);
+}
+
+
+void CborWriter::integer(int64_t value) {
+    if (value >= 0) _head(0, value);
+    else _head(1, (uint64_t) (-1 - value));
+}
+
+
+// float32 whenever it round-trips; sensor values never need more
+void CborWriter::number(double value) {
+    float narrow = (float) value;
+    if (narrow == value || isnan(value)) {
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        _put(0xFA);
+        for (int shift = 24; shift >= 0; shift -= 8) _put(bits >> shift);
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        _put(0xFB);
+        for (int shift = 56; shift >= 0; shift -= 8) _put(bits >> shift);
+    }
+}
+
+
+void CborWriter::text(const char * str, size_t len) {
+    _head(3, len);
+    _put(str, len);
+}
+
+
+void CborWriter::value(JsonVariantConst v) {
+    if (v.isNull()) {
+        null();
+    } else if (v.is<bool>()) {
+        boolean(v.as<bool>());
+    } else if (v.is<int64_t>()) {
+        integer(v.as<int64_t>());
+    } else if (v.is<uint64_t>()) {
+        uinteger(v.as<uint64_t>());
+    } else if (v.is<double>()) {
+        number(v.as<double>());
+    } else if (v.is<JsonString>()) {
+        JsonString str = v.as<JsonString>();
+        text(str.c_str(), str.size());
+    } else if (v.is<JsonObjectConst>()) {
+        JsonObjectConst obj = v.as<JsonObjectConst>();
+        map(obj.size());
+        for (JsonPairConst kv : obj) {
+            key(kv.key().c_str());
+            value(kv.value());
+        }
+    } else if (v.is<JsonArrayConst>()) {
+        JsonArrayConst arr = v.as<JsonArrayConst>();
+        array(arr.size());
+        for (JsonVariantConst item : arr) value(item);
+    } else {
+        null();
+    }
+}
+
+
+// Initial byte plus the shortest argument that holds the value
+void CborWriter::_head(uint8_t major, uint64_t value) {
+    major <<= 5;
+    if (value < 24) {
+        _put(major | value);
+    } else if (value <= 0xFF) {
+        _put(major | 24);
+        _put(value);
+    } else if (value <= 0xFFFF) {
+        _put(major | 25);
+        _put(value >> 8);
+        _put(value);
+    } else if (value <= 0xFFFFFFFFULL) {
+        _put(major | 26);
+        for (int shift = 24; shift >= 0; shift -= 8) _put(value >> shift);
+    } else {
+        _put(major | 27);
+        for (int shift = 56; shift >= 0; shift -= 8) _put(value >> shift);
+    }
+}
+
+
+void CborWriter::_put(const void * data, size_t len) {
+    if (_len + len <= _size) memcpy(_buf + _len, data, len);
+    _len += len;
+}
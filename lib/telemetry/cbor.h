@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/**
+ * Minimal CBOR (RFC 8949) encoder into a caller-supplied buffer.
+ *
+ * Only what telemetry needs: definite-length maps and arrays, integers,
+ * floats, text, booleans and null. Map keys found in TELEMETRY_KEYS are
+ * written as their integer number, anything else as text. Floats go out
+ * as 4-byte float32 unless that would lose precision.
+ *
+ * Writes past the end of the buffer are dropped and flagged; check
+ * overflowed() before using the result.
+ */
+class CborWriter {
+
+    public:
+
+        CborWriter(uint8_t * buf, size_t size) : _buf(buf), _size(size) {}
+
+        void map(size_t pairs) { _head(5, pairs); }
+        void array(size_t items) { _head(4, items); }
+        void key(const char * name);
+        void uinteger(uint64_t value) { _head(0, value); }
+        void integer(int64_t value);
+        void number(double value);
+        void text(const char * str, size_t len);
+        void text(const char * str) { text(str, strlen(str)); }
+        void boolean(bool value) { _put(value ? 0xF5 : 0xF4); }
+        void null() { _put(0xF6); }
+
+        // Any ArduinoJson value, recursively
+        void value(JsonVariantConst);
+
+        size_t length() { return _len; }
+        bool overflowed() { return _len > _size; }
+
+        static int key_index(const char * name);   // -1 if not in the table
+
+    private:
+
+        uint8_t * _buf;
+        size_t _size;
+        size_t _len = 0;
+
+        void _head(uint8_t major, uint64_t value);
+        void _put(uint8_t byte) {
+            if (_len < _size) _buf[_len] = byte;
+            _len++;
+        }
+        void _put(const void * data, size_t len);
+
+};
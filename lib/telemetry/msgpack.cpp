@@ -0,0 +1,95 @@
+#include "msgpack.h"
+
+
+void MsgPackWriter::uinteger(uint64_t value) {
+    if (value < 0x80) {
+        _put(value);
+    } else if (value <= 0xFF) {
+        _put(0xCC);
+        _be(value, 1);
+    } else if (value <= 0xFFFF) {
+        _put(0xCD);
+        _be(value, 2);
+    } else if (value <= 0xFFFFFFFFULL) {
+        _put(0xCE);
+        _be(value, 4);
+    } else {
+        _put(0xCF);
+        _be(value, 8);
+    }
+}
+
+
+void MsgPackWriter::integer(int64_t value) {
+    if (value >= 0) {
+        uinteger(value);
+    } else if (value >= -32) {
+        _put((uint8_t) value);
+    } else if (value >= INT8_MIN) {
+        _put(0xD0);
+        _be(value, 1);
+    } else if (value >= INT16_MIN) {
+        _put(0xD1);
+        _be(value, 2);
+    } else if (value >= INT32_MIN) {
+        _put(0xD2);
+        _be(value, 4);
+    } else {
+        _put(0xD3);
+        _be(value, 8);
+    }
+}
+
+
+// float32 whenever it round-trips, like CborWriter
+void MsgPackWriter::number(double value) {
+    float narrow = (float) value;
+    if (narrow == value || isnan(value)) {
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        _put(0xCA);
+        _be(bits, 4);
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        _put(0xCB);
+        _be(bits, 8);
+    }
+}
+
+
+void MsgPackWriter::text(const char * str, size_t len) {
+    if (len < 32) {
+        _put(0xA0 | len);
+    } else if (len <= 0xFF) {
+        _put(0xD9);
+        _be(len, 1);
+    } else if (len <= 0xFFFF) {
+        _put(0xDA);
+        _be(len, 2);
+    } else {
+        _put(0xDB);
+        _be(len, 4);
+    }
+    if (_len + len <= _size) memcpy(_buf + _len, str, len);
+    _len += len;
+}
+
+
+// fixmap/fixarray up to 15 entries, then the 16/32-bit forms (wide + 1)
+void MsgPackWriter::_container(uint8_t fix, uint8_t wide, size_t count) {
+    if (count < 16) {
+        _put(fix | count);
+    } else if (count <= 0xFFFF) {
+        _put(wide);
+        _be(count, 2);
+    } else {
+        _put(wide + 1);
+        _be(count, 4);
+    }
+}
+
+
+void MsgPackWriter::_be(uint64_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) _put(value >> shift);
+}
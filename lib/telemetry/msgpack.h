@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * MessagePack counterpart of CborWriter, for messages streamed piece by
+ * piece (history) rather than built as a document - whole documents go
+ * through ArduinoJson's serializeMsgPack(). Same interface, so streaming
+ * code can take either writer; keys are always text, as in ArduinoJson's
+ * output.
+ */
+class MsgPackWriter {
+
+    public:
+
+        MsgPackWriter(uint8_t * buf, size_t size) : _buf(buf), _size(size) {}
+
+        void map(size_t pairs) { _container(0x80, 0xDE, pairs); }
+        void array(size_t items) { _container(0x90, 0xDC, items); }
+        void key(const char * name) { text(name); }
+        void uinteger(uint64_t value);
+        void integer(int64_t value);
+        void number(double value);
+        void text(const char * str, size_t len);
+        void text(const char * str) { text(str, strlen(str)); }
+        void boolean(bool value) { _put(value ? 0xC3 : 0xC2); }
+        void null() { _put(0xC0); }
+
+        size_t length() { return _len; }
+        bool overflowed() { return _len > _size; }
+
+    private:
+
+        uint8_t * _buf;
+        size_t _size;
+        size_t _len = 0;
+
+        void _container(uint8_t fix, uint8_t wide, size_t count);
+        void _be(uint64_t value, int bytes);
+        void _put(uint8_t byte) {
+            if (_len < _size) _buf[_len] = byte;
+            _len++;
+        }
+
+};
@@ -0,0 +1,75 @@
+#include "telemetry.h"
+#include "telemetry_keys.h"
+#include "mqtt.h"
+#include "topics.h"
+#include "storage.h"
+#include "../telnet/telnet.h"
+#include <esp_timer.h>
+
+Telemetry telemetry;
+
+
+void Telemetry::load() {
+    uint8_t stored;
+    if (storage.load_blob("telemetry", "enc", &stored, sizeof(stored)) && stored < TELEMETRY_ENCODING_COUNT) {
+        _encoding = (TelemetryEncoding) stored;
+    }
+    Serial.printf("\tTelemetry: %s\n", name(_encoding));
+}
+
+
+bool Telemetry::set_encoding(const char * requested) {
+    TelemetryEncoding encoding;
+    if (!parse(requested, encoding)) return false;
+    _encoding = encoding;
+    uint8_t stored = encoding;
+    storage.store_blob("telemetry", "enc", &stored, sizeof(stored));
+    return true;
+}
+
+
+void Telemetry::publish(Topic topic, JsonDocument & doc) {
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX];
+    size_t len = encode(doc, _encoding, payload, sizeof(payload));
+    if (!len) {
+        // Dropped whole rather than sent cut short; the JSON size is a guide
+        // to how far over it is in any encoding
+        char line[128];
+        snprintf(line, sizeof(line), "\tTelemetry: %s message for %s dropped, %u bytes as JSON, limit %d",
+                 name(_encoding), topics.get(topic), (unsigned) measureJson(doc), TELEMETRY_PAYLOAD_MAX);
+        Serial.println(line);
+        telnet.println(line);
+        return;
+    }
+    if (_encoding == TELEMETRY_JSON) {
+        mqtt.publish(topics.get(topic), (const char *) payload);
+        return;
+    }
+    mqtt.publish(topics.get(topic, _encoding), payload, len);
+}
+
+
+// Retained, so a decoder that subscribes later still gets the key numbers
+void Telemetry::publish_schema() {
+    char payload[TELEMETRY_PAYLOAD_MAX + 128];
+    size_t len = 0;
+    payload[len++] = '[';
+    for (size_t i = 0; i < TELEMETRY_KEY_COUNT && len < sizeof(payload); i++) {
+        len += snprintf(payload + len, sizeof(payload) - len, "%s\"%s\"", i ? "," : "", TELEMETRY_KEYS[i]);
+    }
+    if (len >= sizeof(payload) - 1) return;
+    payload[len++] = ']';
+    mqtt.publish(topics.get(TOPIC_SCHEMA), (const uint8_t *) payload, len, true);
+}
+
+
+void Telemetry::bench(JsonDocument & doc, TelemetryBench results[TELEMETRY_ENCODING_COUNT], int rounds) {
+    uint8_t buf[TELEMETRY_PAYLOAD_MAX];
+    for (int e = 0; e < TELEMETRY_ENCODING_COUNT; e++) {
+        size_t len = 0;
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < rounds; i++) len = encode(doc, (TelemetryEncoding) e, buf, sizeof(buf));
+        results[e].bytes = len;
+        results[e].encode_us = (esp_timer_get_time() - start) / (float) rounds;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define TELEMETRY_PAYLOAD_MAX 640                       // one encoded message, any encoding
+#define TELEMETRY_BENCH_ROUNDS 200
+
+#ifndef TELEMETRY_ENCODING
+#define TELEMETRY_ENCODING TELEMETRY_JSON               // until changed with the "encoding" command
+#endif
+
+enum TelemetryEncoding : uint8_t {
+    TELEMETRY_JSON,
+    TELEMETRY_CBOR,         // integer keys, see telemetry_keys.h
+    TELEMETRY_MSGPACK,      // ArduinoJson's encoder, text keys
+    TELEMETRY_ENCODING_COUNT
+};
+
+enum Topic : uint8_t;       // topics.h
+
+// One encoding's result from bench()
+struct TelemetryBench {
+    size_t bytes;
+    float encode_us;        // per message
+};
+
+/**
+ * Wire encoding for MQTT telemetry and diagnostics. Messages are built as
+ * ArduinoJson documents as before and encoded on the way out. MQTT 3.1.1
+ * has no content-type, so binary messages go to the topic plus a suffix -
+ * filterchlorine/<id>/sensors/cbor, .../diag/link/msgpack - and JSON
+ * stays on the plain topic. The CBOR key numbers are published (retained,
+ * as a JSON array) on filterchlorine/<id>/schema/keys so a decoder needs
+ * nothing from this tree.
+ *
+ * The encoding is a setting kept in NVS; load() and set_encoding() must
+ * run on the main task.
+ */
+class Telemetry {
+
+    public:
+
+        void load();
+        TelemetryEncoding encoding() { return _encoding; }
+        bool set_encoding(const char * name);
+
+        static const char * name(TelemetryEncoding);
+        static const char * suffix(TelemetryEncoding);       // MQTT topic suffix, "" for JSON
+        static const char * content_type(TelemetryEncoding);  // HTTP
+        static bool parse(const char * name, TelemetryEncoding &);
+
+        // Bytes written, 0 if the message doesn't fit
+        static size_t encode(JsonDocument &, TelemetryEncoding, uint8_t *, size_t);
+
+        void publish(Topic, JsonDocument &);
+        void publish_schema();
+
+        // Size and encode time of the same document in every encoding
+        void bench(JsonDocument &, TelemetryBench results[TELEMETRY_ENCODING_COUNT], int rounds);
+
+    private:
+
+        TelemetryEncoding _encoding = TELEMETRY_ENCODING;
+
+};
+
+extern Telemetry telemetry;
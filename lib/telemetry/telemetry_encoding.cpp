@@ -0,0 +1,53 @@
+#include "telemetry.h"
+#include "cbor.h"
+
+// The encoding tables and encode() - everything here builds without the
+// network or NVS, so host tools (dev/fleetsim) link the same encoder
+
+static const char *const ENCODING_NAMES[TELEMETRY_ENCODING_COUNT] = {"json", "cbor", "msgpack"};
+static const char *const ENCODING_SUFFIXES[TELEMETRY_ENCODING_COUNT] = {"", "/cbor", "/msgpack"};
+static const char *const ENCODING_TYPES[TELEMETRY_ENCODING_COUNT] = {
+    "application/json", "application/cbor", "application/msgpack"
+};
+
+
+const char * Telemetry::name(TelemetryEncoding encoding) {
+    return encoding < TELEMETRY_ENCODING_COUNT ? ENCODING_NAMES[encoding] : "?";
+}
+
+const char * Telemetry::suffix(TelemetryEncoding encoding) {
+    return encoding < TELEMETRY_ENCODING_COUNT ? ENCODING_SUFFIXES[encoding] : "";
+}
+
+const char * Telemetry::content_type(TelemetryEncoding encoding) {
+    return encoding < TELEMETRY_ENCODING_COUNT ? ENCODING_TYPES[encoding] : ENCODING_TYPES[TELEMETRY_JSON];
+}
+
+bool Telemetry::parse(const char * requested, TelemetryEncoding & encoding) {
+    for (int i = 0; i < TELEMETRY_ENCODING_COUNT; i++) {
+        if (strcasecmp(requested, ENCODING_NAMES[i]) == 0) {
+            encoding = (TelemetryEncoding) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// A result that fills the buffer may have been cut short, so it counts as too big
+size_t Telemetry::encode(JsonDocument & doc, TelemetryEncoding encoding, uint8_t * buf, size_t size) {
+    size_t len = 0;
+    switch (encoding) {
+        case TELEMETRY_CBOR: {
+            CborWriter writer(buf, size);
+            writer.value(doc.as<JsonVariantConst>());
+            return writer.overflowed() ? 0 : writer.length();
+        }
+        case TELEMETRY_MSGPACK:
+            len = serializeMsgPack(doc, buf, size);
+            return len < size ? len : 0;
+        default:
+            len = serializeJson(doc, (char *) buf, size);
+            return len + 1 < size ? len : 0;
+    }
+}
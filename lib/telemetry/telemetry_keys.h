@@ -0,0 +1,90 @@
+#pragma once
+
+// Integer keys for CBOR telemetry: a key's number is its index here.
+// Append only - decoders in the field (and the retained schema topic they
+// may have cached) depend on existing numbers never moving. Keys 0-23
+// encode in a single byte, so the sensors message fields come first.
+// dev/telemetry.py reads this table straight from this file.
+static const char *const TELEMETRY_KEYS[] = {
+    // filterchlorine/<id>/sensors
+    "resistance",       // 0
+    "current",          // 1
+    "rssi",             // 2
+    "direction",        // 3
+    "ip",               // 4
+    "uptime",           // 5
+    "ts",               // 6
+    "down",             // 7
+    "busvoltage",       // 8
+    "shuntvoltage",     // 9
+    "loadvoltage",      // 10
+    "power_mW",         // 11
+    "reversecount",     // 12
+    "temperature",      // 13
+    "pressure",         // 14
+    "humidity",         // 15
+    "acs_current",      // 16
+    "acs_ripple",       // 17
+    "acs_agree",        // 18
+
+    // history samples
+    "t",                // 19
+    "i",                // 20
+    "v",                // 21
+    "p",                // 22
+    "interval_ms",      // 23
+    "clock",            // 24
+    "samples",          // 25
+
+    // filterchlorine/<id>/diag/link
+    "rssi_avg",         // 26
+    "rssi_min",         // 27
+    "rssi_max",         // 28
+    "disc_per_h",       // 29
+    "retry_per_h",      // 30
+    "tx_Bps",           // 31
+    "tx_dbm",           // 32
+    "ssid",             // 33
+    "bssid",            // 34
+    "channel",          // 35
+    "roams",            // 36
+
+    // filterchlorine/<id>/diag/connect
+    "wifi_ms",          // 37
+    "mqtt_ms",          // 38
+    "fast",             // 39
+
+    // filterchlorine/<id>/diag/boot (phase names stay text keys)
+    "reset_reason",     // 40
+    "boot_ts",          // 41
+
+    // filterchlorine/<id>/diag/memory and .../allocs (task and subsystem names stay text keys)
+    "heap_free",        // 42
+    "heap_min",         // 43
+    "heap_block",       // 44
+    "heap_frag",        // 45
+    "alloc_fail",       // 46
+    "alarms",           // 47
+    "stacks",           // 48
+    "allocs",           // 49
+    "alarm",            // 50
+    "active",           // 51
+    "value",            // 52
+    "task",             // 53
+
+    // filterchlorine/<id>/diag/connect, outage snapshot (reason names stay text keys)
+    "outage_ms",        // 54
+    "reason",           // 55
+    "prev_bssid",       // 56
+    "outages",          // 57
+    "outage_total_s",   // 58
+    "outage_max_ms",    // 59
+    "outage_p95_ms",    // 60
+    "reasons",          // 61
+
+    // filterchlorine/<id>/sensors, charge-balanced reversal
+    "charge_ratio",     // 62
+    "charge_residual",  // 63
+};
+
+#define TELEMETRY_KEY_COUNT (sizeof(TELEMETRY_KEYS) / sizeof(TELEMETRY_KEYS[0]))
@@ -2,16 +2,34 @@
  * Telnet Server Implementation
  * Provides remote command-line interface for debugging and monitoring
  * the Tank Level Controller over TCP port 23
+ *
+ * Up to TELNET_MAX_SESSIONS clients can be connected at once. Each session
+ * has its own line buffer and output ring; log output from telnet.print()
+ * fans out to every session, command replies go only to the requester.
  */
 
 #include "mqtt.h"
 #include <WiFi.h>
 #include "telnet.h"
-#include <Adafruit_BMP280.h>
-#include "ACS712.h"
 #include "../device/device.h"
 #include "../motor/motor.h"
-#include <Adafruit_INA219.h>
+#include "current_adc.h"
+#include "i2c_bus.h"
+#include "ina219_sensor.h"
+#include "bme280_sensor.h"
+#include "timebase.h"
+#include "telemetry.h"
+#include "memory_monitor.h"
+#include "identity.h"
+#include "topics.h"
+#include "power.h"
+#include "series.h"
+#include "protection.h"
+#include "sweep.h"
+#include "wifi_tools.h"
+#include "wifi_names.h"
+#include <lwip/sockets.h>
+#include <errno.h>
 
 // Command table structure for maintainable menu and dispatch
 struct Command {
@@ -28,12 +46,24 @@ const Command COMMAND_TABLE[] PROGMEM = {
     {"status",    "s", "Show device status",       "Info"},
     {"delay",     "d", "Display sample interval",  "Info"},
     {"minutes",   "m", "Show minute count",        "Info"},
+    {"charge",    "",  "Reversal charge balance",  "Info"},
     {"remaining", "r", "Time to next sample",      "Info"},
+    {"who",       "",  "List telnet sessions",     "Info"},
+    {"time",      "",  "Clock and SNTP sync state", "Info"},
+    {"i2c",       "",  "I2C bus and sensor stats", "Info"},
+    {"wifi",      "",  "Link drops by reason, outages", "Info"},
+    {"bench",     "",  "Encoding and filter cost",  "Info"},
+    {"mem",       "",  "Heap, stacks and allocations", "Info"},
+    {"series [t] [from]", "", "Stored history raw/minute/hour", "Info"},
+    {"name <n>",  "",  "Set topic name (name clear)", "Info"},
     
     // Control
     {"force",     "f", "Force measurement now",    "Control"},
     {"power",     "p", "Read power sensor now",     "Control"},
     {"reboot",    "",  "Restart device",           "Control"},
+    {"pm <mode>", "",  "Power mode performance/balanced/low", "Control"},
+    {"fault [clear|test]", "", "Overcurrent trip state", "Control"},
+    {"sweep [start|stop]", "", "Duty/frequency sweep; csv, target <mA>", "Control"},
     
     // Motor
     {"chlorine",     "c",  "Show motor status",        "Motor"},
@@ -42,10 +72,33 @@ const Command COMMAND_TABLE[] PROGMEM = {
     {"max",       "x",  "Run at max speed (255)",   "Motor"},
     {"speed <n>", "sp",  "Set speed 0-255",          "Motor"},
     {"stop",      "st",  "Stop motor",               "Motor"},
+
+    // Sensor
+    {"cal <mA>",  "",  "INA219 two-point cal (cal clear)", "Sensor"},
+    {"avg <n>",   "",  "INA219 averaging 1-128",   "Sensor"},
+
+    // Telemetry
+    {"encoding <e>", "", "MQTT encoding json/cbor/msgpack", "Telemetry"},
+
+    // Live
+    {"watch <f> <hz>", "w", "Stream fields (i,v,p,...)", "Live"},
+    {"unwatch",   "uw", "Stop streaming",           "Live"},
 };
 
 const int COMMAND_COUNT = sizeof(COMMAND_TABLE) / sizeof(Command);
 
+// Fields available to "watch"; each is formatted once per tick and shared
+// by every session watching it
+enum WatchField {
+    WATCH_CURRENT, WATCH_BUS, WATCH_SHUNT, WATCH_LOAD, WATCH_POWER,
+    WATCH_RESISTANCE, WATCH_MAH, WATCH_RSSI, WATCH_DIRECTION, WATCH_ACS, WATCH_RIPPLE,
+    WATCH_FIELD_COUNT
+};
+
+const char *const WATCH_NAMES[WATCH_FIELD_COUNT] = {
+    "i", "v", "shunt", "load", "p", "r", "mah", "rssi", "dir", "acs", "ripple"
+};
+
 Telnet::Telnet()
 {
     // Constructor
@@ -56,12 +109,77 @@ Telnet telnet;
 
 // Telnet server listening on standard port 23
 WiFiServer telnetServer(23);
-// Active client connection
-WiFiClient telnetClient;
-// Last activity timestamp for keepalive
-unsigned long lastActivityMillis = 0;
 #define KEEPALIVE_INTERVAL 30000  // Send keepalive every 30 seconds
 
+
+/**
+ * Queue output for this session. Never blocks - if the ring is full the
+ * bytes are dropped and counted, and loop() drops the session if it stays full
+ */
+size_t TelnetSession::write(const uint8_t *buffer, size_t size)
+{
+    if (!active) return 0;
+    size_t n = min(size, TELNET_OUT_SIZE - _used);
+    for (size_t i = 0; i < n; i++)
+    {
+        _out[_head] = buffer[i];
+        _head = (_head + 1) % TELNET_OUT_SIZE;
+    }
+    _used += n;
+    droppedBytes += size - n;
+    return size;
+}
+
+size_t TelnetSession::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+/**
+ * Send as much queued output as the socket will take right now
+ * @return false if the connection failed
+ */
+bool TelnetSession::drain()
+{
+    while (_used > 0)
+    {
+        size_t chunk = min(_used, TELNET_OUT_SIZE - _tail);
+        int sent = send(client.fd(), _out + _tail, chunk, MSG_DONTWAIT);
+        if (sent < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (sent == 0) break;
+        _tail = (_tail + sent) % TELNET_OUT_SIZE;
+        _used -= sent;
+    }
+    return true;
+}
+
+void TelnetSession::open(WiFiClient &c)
+{
+    client = c;
+    client.setNoDelay(true);
+    active = true;
+    lineLength = 0;
+    lastCommand[0] = '\0';
+    watchInterval = 0;
+    csvRow = -1;
+    stalledSince = 0;
+    droppedBytes = 0;
+    _head = _tail = _used = 0;
+    lastActivity = millis();
+}
+
+void TelnetSession::close()
+{
+    client.stop();
+    active = false;
+    watchInterval = 0;
+    csvRow = -1;
+}
+
+
 /**
  * Initialize telnet server
  * Starts listening on port 23 and disables Nagle algorithm for responsive interaction
@@ -72,110 +190,333 @@ void Telnet::setup()
     telnetServer.setNoDelay(true);  // Disable buffering for immediate command response
     Serial.println("\tTelnet server started on port 23");
     Serial.println("IP: " + WiFi.localIP().toString());
-    lastActivityMillis = millis();
 }
 
 /**
- * Main telnet loop - handles client connections and processes incoming commands
+ * Main telnet loop - accepts clients, reads input, streams watches and
+ * drains every session's output without blocking
  * Called repeatedly from main loop
  */
 void Telnet::loop()
 {
-    // Check for new client connection
-    if (!telnetClient || !telnetClient.connected())
+    _accept();
+
+    unsigned long currentMillis = millis();
+    for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
     {
-        telnetClient = telnetServer.available();
-        if (telnetClient && telnetClient.connected())
+        TelnetSession &s = _sessions[i];
+        if (!s.active) continue;
+
+        if (!s.client.connected())
         {
-            Serial.println("\tTelnet client connected");
-            // Configure TCP keepalive on the client socket
-            telnetClient.setNoDelay(true);
-            telnetClient.setTimeout(5000);  // 5 second timeout for operations
-            
-            // Flush any telnet negotiation bytes (non-blocking)
-            while (telnetClient.available())
-            {
-                telnetClient.read();  // Discard telnet protocol bytes
-            }
-            
-            telnetClient.println("Welcome to Chlorine Tank Controller Telnet Interface");
-            telnetClient.print("> ");
-            commandBuffer = "";
-            lastActivityMillis = millis();
+            Serial.printf("\tTelnet session #%d disconnected\n", i);
+            s.close();
+            continue;
+        }
+
+        // Send keepalive if needed (idle for too long)
+        if (currentMillis - s.lastActivity > KEEPALIVE_INTERVAL)
+        {
+            s.write((uint8_t)0);
+            s.lastActivity = currentMillis;
         }
+
+        // Input waits in the socket while a table is still going out
+        if (s.csvRow < 0) _read(s);
     }
 
-    // Handle incoming data from connected client
-    if (telnetClient && telnetClient.connected())
+    _watch();
+    _csv();
+
+    for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
     {
-        // Send keepalive if needed (idle for too long)
-        unsigned long currentMillis = millis();
-        if (currentMillis - lastActivityMillis > KEEPALIVE_INTERVAL)
+        TelnetSession &s = _sessions[i];
+        if (!s.active) continue;
+
+        bool ok = s.drain();
+        // A session that can't keep up is dropped rather than slowing the rest
+        if (s.availableForWrite() == 0)
         {
-            // Send a null byte as keepalive to prevent timeouts
-            telnetClient.write((uint8_t)0);
-            lastActivityMillis = currentMillis;
+            if (s.stalledSince == 0) s.stalledSince = currentMillis;
         }
+        else
+        {
+            s.stalledSince = 0;
+        }
+        if (!ok || (s.stalledSince && currentMillis - s.stalledSince > TELNET_STALL_TIMEOUT))
+        {
+            Serial.printf("\tTelnet session #%d dropped (%s)\n", i, ok ? "stalled" : "error");
+            s.close();
+        }
+    }
+}
+
+/**
+ * Accept a new client into a free session slot, or turn it away if full
+ */
+void Telnet::_accept()
+{
+    WiFiClient client = telnetServer.available();
+    if (!client || !client.connected()) return;
+
+    for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
+    {
+        TelnetSession &s = _sessions[i];
+        if (s.active) continue;
 
-        while (telnetClient.available())
+        s.open(client);
+        Serial.printf("\tTelnet client connected (session #%d)\n", i);
+
+        // Flush any telnet negotiation bytes (non-blocking)
+        while (s.client.available())
         {
-            char c = telnetClient.read();
-            lastActivityMillis = millis();  // Reset keepalive timer on activity
+            s.client.read();  // Discard telnet protocol bytes
+        }
 
-            // Process newline - execute command
-            if (c == '\n' || c == '\r')
+        s.println("Welcome to Chlorine Tank Controller Telnet Interface");
+        s.print("> ");
+        return;
+    }
+
+    client.println("All telnet sessions in use - try again later");
+    client.stop();
+}
+
+/**
+ * Handle incoming data from a connected session
+ */
+void Telnet::_read(TelnetSession &s)
+{
+    while (s.client.available())
+    {
+        char c = s.client.read();
+        s.lastActivity = millis();  // Reset keepalive timer on activity
+
+        // Process newline - execute command
+        if (c == '\n' || c == '\r')
+        {
+            // Consume the matching newline character if it follows immediately
+            // (e.g., \r\n or \n\r pairs)
+            if (s.client.available())
             {
-                // Consume the matching newline character if it follows immediately
-                // (e.g., \r\n or \n\r pairs)
-                if (telnetClient.available())
-                {
-                    char next = telnetClient.peek();
-                    if ((c == '\r' && next == '\n') || (c == '\n' && next == '\r'))
-                    {
-                        telnetClient.read();  // Consume the second newline character
-                    }
-                }
-                
-                telnetClient.println("");
-                
-                // If buffer is empty and we have a last command, repeat it silently
-                if (commandBuffer.length() == 0 && lastCommand.length() > 0)
+                char next = s.client.peek();
+                if ((c == '\r' && next == '\n') || (c == '\n' && next == '\r'))
                 {
-                    processCommand(lastCommand);
+                    s.client.read();  // Consume the second newline character
                 }
-                else if (commandBuffer.length() > 0)
-                {
-                    processCommand(commandBuffer);
-                    lastCommand = commandBuffer;  // Store for repeat
-                    commandBuffer = "";
-                }
-                
-                telnetClient.print("> ");
             }
-            // Handle backspace (ASCII 8 or DEL 127)
-            else if (c == 8 || c == 127)
+            
+            s.println("");
+            
+            // If buffer is empty and we have a last command, repeat it silently
+            if (s.lineLength == 0 && s.lastCommand[0])
+            {
+                processCommand(s, String(s.lastCommand));
+            }
+            else if (s.lineLength > 0)
+            {
+                s.line[s.lineLength] = '\0';
+                strcpy(s.lastCommand, s.line);  // Store for repeat
+                s.lineLength = 0;
+                processCommand(s, String(s.lastCommand));
+            }
+
+            if (!s.active) return;  // command closed the session
+            if (s.csvRow >= 0) return;  // _csv() prompts when the table is out
+            s.print("> ");
+        }
+        // Handle backspace (ASCII 8 or DEL 127)
+        else if (c == 8 || c == 127)
+        {
+            if (s.lineLength > 0)
+            {
+                s.lineLength--;
+                s.print("\b \b");  // Backspace, space, backspace to erase
+            }
+        }
+        // Handle printable characters
+        else if (c >= 32 && c <= 126 && s.lineLength < TELNET_LINE_SIZE - 1)
+        {
+            s.line[s.lineLength++] = c;
+            s.write((uint8_t)c);  // Echo character back to client
+        }
+    }
+}
+
+/**
+ * Parse "watch <fields> <rate>" - fields comma separated or "all", rate in Hz
+ */
+void Telnet::_watchCommand(TelnetSession &s, String args)
+{
+    args.trim();
+    if (args.length() == 0 || args == "off")
+    {
+        s.watchInterval = 0;
+        s.print("Usage: watch <fields|all> [hz]  fields: ");
+        for (int f = 0; f < WATCH_FIELD_COUNT; f++)
+        {
+            s.print(WATCH_NAMES[f]);
+            s.print(f + 1 < WATCH_FIELD_COUNT ? "," : "\r\n");
+        }
+        return;
+    }
+
+    String fields = args;
+    float rate = 1.0;
+    int space = args.indexOf(' ');
+    if (space > 0)
+    {
+        fields = args.substring(0, space);
+        rate = args.substring(space + 1).toFloat();
+    }
+    if (rate <= 0 || rate > WATCH_MAX_RATE)
+    {
+        s.printf("Error: rate must be 0-%d Hz\r\n", WATCH_MAX_RATE);
+        return;
+    }
+
+    uint16_t mask = 0;
+    if (fields == "all")
+    {
+        mask = (1 << WATCH_FIELD_COUNT) - 1;
+    }
+    else
+    {
+        int start = 0;
+        while (start <= (int)fields.length())
+        {
+            int comma = fields.indexOf(',', start);
+            if (comma < 0) comma = fields.length();
+            String name = fields.substring(start, comma);
+            bool found = false;
+            for (int f = 0; f < WATCH_FIELD_COUNT; f++)
             {
-                if (commandBuffer.length() > 0)
+                if (name == WATCH_NAMES[f])
                 {
-                    commandBuffer.remove(commandBuffer.length() - 1);
-                    telnetClient.print("\b \b");  // Backspace, space, backspace to erase
+                    mask |= 1 << f;
+                    found = true;
                 }
             }
-            // Handle printable characters
-            else if (c >= 32 && c <= 126)
+            if (!found)
             {
-                commandBuffer += c;
-                telnetClient.print(c);  // Echo character back to client
+                s.print("Error: unknown field ");
+                s.println(name);
+                return;
             }
+            start = comma + 1;
         }
     }
+
+    s.watchFields = mask;
+    s.watchInterval = max((int)(1000 / rate), WATCH_MIN_INTERVAL);
+    s.lastWatch = 0;
+    s.printf("Watching at %.1f Hz - 'unwatch' or empty 'watch' to stop\r\n", 1000.0 / s.watchInterval);
+}
+
+/**
+ * Stream watched fields. Each field is formatted at most once per pass and
+ * the text is shared by all sessions due this pass
+ */
+void Telnet::_watch()
+{
+    unsigned long now = millis();
+    char text[WATCH_FIELD_COUNT][16];
+    uint16_t formatted = 0;
+    CurrentBlock acs;
+
+    for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
+    {
+        TelnetSession &s = _sessions[i];
+        if (!s.active || s.watchInterval == 0) continue;
+        if (now - s.lastWatch < s.watchInterval) continue;
+        s.lastWatch = now;
+
+        char line[160];
+        int len = snprintf(line, sizeof(line), "%8.1f", now / 1000.0);
+        for (int f = 0; f < WATCH_FIELD_COUNT; f++)
+        {
+            if (!(s.watchFields & (1 << f))) continue;
+            if (!(formatted & (1 << f)))
+            {
+                switch (f)
+                {
+                    case WATCH_CURRENT:    snprintf(text[f], 16, "%.2f", device.GetAmps()); break;
+                    case WATCH_BUS:        snprintf(text[f], 16, "%.3f", device.GetBusVoltage()); break;
+                    case WATCH_SHUNT:      snprintf(text[f], 16, "%.2f", device.GetShuntVoltage()); break;
+                    case WATCH_LOAD:       snprintf(text[f], 16, "%.3f", device.GetLoadVoltage()); break;
+                    case WATCH_POWER:      snprintf(text[f], 16, "%.1f", device.GetPower()); break;
+                    case WATCH_RESISTANCE: snprintf(text[f], 16, "%.2f", device.GetResistance()); break;
+                    case WATCH_MAH:        snprintf(text[f], 16, "%.3f", device.GetTotalmAH()); break;
+                    case WATCH_RSSI:       snprintf(text[f], 16, "%d", WiFi.RSSI()); break;
+                    case WATCH_DIRECTION:  snprintf(text[f], 16, "%s", device.motor && device.motor->isForward() ? "fwd" : "rev"); break;
+                    case WATCH_ACS:        snprintf(text[f], 16, "%.1f", current_adc.latest(acs) ? acs.mean_mA : NAN); break;
+                    case WATCH_RIPPLE:     snprintf(text[f], 16, "%.1f", current_adc.latest(acs) ? acs.ripple_mA : NAN); break;
+                }
+                formatted |= 1 << f;
+            }
+            len += snprintf(line + len, sizeof(line) - len, " %s=%s", WATCH_NAMES[f], text[f]);
+            if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+        }
+        s.write((const uint8_t *)line, len);
+        s.write((const uint8_t *)"\r\n", 2);
+    }
+}
+
+/**
+ * Page out "sweep csv" tables, one page per session per pass and only when
+ * the ring has room for it, so a slow client never holds up the loop
+ */
+void Telnet::_csv()
+{
+    for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
+    {
+        TelnetSession &s = _sessions[i];
+        if (!s.active || s.csvRow < 0) continue;
+        if (s.availableForWrite() < TELNET_OUT_SIZE / 2) continue;
+
+        sweep.write_csv(s, s.csvRow, TELNET_CSV_PAGE);
+        s.csvRow += TELNET_CSV_PAGE;
+        if (s.csvRow >= sweep.count())
+        {
+            s.csvRow = -1;
+            s.print("> ");
+        }
+    }
+}
+
+/**
+ * First word of a command table entry, for callers outside telnet (RPC)
+ * @return false past the end of the table
+ */
+bool Telnet::command_word(int index, char *word, size_t size)
+{
+    if (index < 0 || index >= COMMAND_COUNT || size == 0) return false;
+    char name[20];
+    strcpy_P(name, COMMAND_TABLE[index].name);
+    size_t len = strcspn(name, " ");
+    if (len >= size) len = size - 1;
+    memcpy(word, name, len);
+    word[len] = '\0';
+    return true;
 }
 
 /**
  * Process and execute telnet commands
+ * @param s Session the command came from - all replies go to it
  * @param cmd Command string received from client
  */
-void Telnet::processCommand(String cmd)
+void Telnet::processCommand(TelnetSession &s, String cmd)
+{
+    execute(s, cmd, &s);
+}
+
+/**
+ * Execute one command line
+ * @param s Where the reply goes
+ * @param cmd Command string
+ * @param session Telnet session it came from, nullptr for MQTT RPC
+ */
+void Telnet::execute(Print &s, String cmd, TelnetSession *session)
 {
     cmd.trim();
     cmd.toLowerCase();
@@ -235,37 +576,75 @@ void Telnet::processCommand(String cmd)
         }
         
         output += "\n";
-        telnetClient.print(output);  // Send all at once
+        s.print(output);  // Send all at once
     }
     // STATUS - Show device information
     else if (cmd == "status" || cmd == "s")
     {
-        telnetClient.println("Device Status: Running");
-        telnetClient.print("IP: ");
-        telnetClient.println(WiFi.localIP().toString());
-        telnetClient.print("Uptime: ");
-        telnetClient.print(millis() / 1000);
-        telnetClient.println(" seconds");
+        s.println("Device Status: Running");
+        s.print("IP: ");
+        s.println(WiFi.localIP().toString());
+        s.printf("Id: %s (%s), client %s\r\n", identity.id(), identity.is_named() ? "named" : "MAC",
+                 identity.client_id());
+        s.printf("Topics: %s/%s/...\r\n", TOPIC_ROOT, identity.id());
+        s.print("Uptime: ");
+        s.print(timebase.uptime());
+        s.println(" seconds");
+    }
+    // TIME - Monotonic clock, wall clock and SNTP quality
+    else if (cmd == "time")
+    {
+        char when[32];
+        s.printf("Monotonic: %.3f s since boot\r\n", timebase.now_us() / 1e6);
+        if (timebase.is_synced())
+        {
+            timebase.format(when, sizeof(when), timebase.epoch_ms());
+            s.printf("UTC:       %s\r\n", when);
+            timebase.format(when, sizeof(when), timebase.to_epoch_ms(timebase.last_sync_us()));
+            s.printf("Last sync: %s (%lu syncs)\r\n", when, (unsigned long) timebase.sync_count());
+            s.printf("Offset:    %+.3f ms at last sync, drift %+.2f ppm\r\n",
+                     timebase.last_offset_us() / 1000.0, timebase.drift_ppm());
+        }
+        else
+        {
+            s.println("UTC:       not synced yet");
+        }
+        s.printf("Server:    %s\r\n", timebase.server());
     }
     // REBOOT - Restart the ESP32
     else if (cmd == "reboot")
     {
-        telnetClient.println("Rebooting...");
+        s.println("Rebooting...");
+        if (session) session->drain();
+        series.flush();
+        device.SaveCharge();
         delay(1000);
         ESP.restart();
     }
     // MINUTECOUNT - Display the current minute count    
     else if (cmd == "delay" || cmd == "d")
     {
-        telnetClient.print("Sample interval: ");
-        telnetClient.print(device._SampleTime / 1000);
-        telnetClient.println(" seconds");
+        s.print("Sample interval: ");
+        s.print(device._SampleTime / 1000);
+        s.println(" seconds");
     }
     else if (cmd == "minutemount" || cmd == "m")
     {
-        telnetClient.print("MinuteCount: ");
-        telnetClient.print(device.GetMinuteCount() );
-        telnetClient.println(" minutes");
+        s.print("MinuteCount: ");
+        s.print(device.GetMinuteCount() );
+        s.println(" minutes");
+    }
+    // CHARGE - reverse vs forward coulombs behind the polarity reversal
+    else if (cmd == "charge")
+    {
+        const ChargeBalance & balance = device.GetChargeBalance();
+        const ChargeState & state = balance.state();
+        s.printf("Polarity: %s, %.1f C this phase\r\n", balance.reverse() ? "reverse" : "forward", state.phase_C);
+        s.printf("Target ratio %.3f, achieved %.4f, residual %.2f C\r\n", balance.ratio(),
+                 balance.achieved_ratio(), balance.balance_C());
+        s.printf("Lifetime: %.0f C forward, %.0f C reverse, %lu reversals (%u since boot)\r\n",
+                 state.forward_C, state.reverse_C, (unsigned long) state.reversals, device.GetReverseCount());
+        s.printf("Reverse after %.0f C forward\r\n", balance.cycle_C());
     }
     // REMAINING - Show time until next scheduled measurement
     else if (cmd == "remaining" || cmd=="r")
@@ -278,98 +657,99 @@ void Telnet::processCommand(String cmd)
             //unsigned long remainingMillis = device._LastMillis - currentMillis;
             //unsigned long elapsedMillis = device._SampleTime - remainingMillis;
             
-            telnetClient.print("Elapsed: ");
-            telnetClient.print(device._LastMillis / 1000);
-            telnetClient.println(" seconds");
+            s.print("Elapsed: ");
+            s.print(device._LastMillis / 1000);
+            s.println(" seconds");
             
-            telnetClient.print("Remaining: ");
-            telnetClient.print((device._LastMillis - currentMillis)     / 1000);
-            telnetClient.println(" seconds");
+            s.print("Remaining: ");
+            s.print((device._LastMillis - currentMillis)     / 1000);
+            s.println(" seconds");
         } else {
             // Measurement is overdue
-            telnetClient.println("Sample overdue!");
+            s.println("Sample overdue!");
             //unsigned long overdueMillis = currentMillis - device._LastMillis;
-            telnetClient.print("Overdue by: ");
-            //telnetClient.print(overdueMillis / 1000);
-            telnetClient.println(" seconds");
+            s.print("Overdue by: ");
+            //s.print(overdueMillis / 1000);
+            s.println(" seconds");
         }
         
-        telnetClient.print("Sample interval: ");
-        //  telnetClient.print(device._SampleTime / 1000);
-        telnetClient.println(" seconds");
+        s.print("Sample interval: ");
+        //  s.print(device._SampleTime / 1000);
+        s.println(" seconds");
     }
     // FORCE - Trigger immediate measurement by resetting timer
     else if (cmd == "force" || cmd=="f")
     {
         device._LastMillis = 0;  // Setting to 0 triggers immediate measurement
-        telnetClient.println("Measurement forced - will execute on next loop iteration.");
+        s.println("Measurement forced - will execute on next loop iteration.");
     }
     // POWER - Read INA219 power sensor immediately
     else if (cmd == "power" || cmd == "p")
     {
-        if (!device.IsDown()) {
-            float shunt = device.ina219.getShuntVoltage_mV();
-            float bus = device.ina219.getBusVoltage_V();
-            float current = device.ina219.getCurrent_mA();
+        PowerReading reading;
+        if (!device.IsDown() && ina219_sensor.latest(reading)) {
+            float shunt = reading.shunt_mV;
+            float bus = reading.bus_V;
+            float current = reading.current_mA;
             float load = bus + (shunt / 1000.0);
             float power = load * current;
             
-            telnetClient.println("--- INA219 Power Sensor ---");
-            telnetClient.print("Bus Voltage:   ");
-            telnetClient.print(bus);
-            telnetClient.println(" V");
-            telnetClient.print("Shunt Voltage: ");
-            telnetClient.print(shunt);
-            telnetClient.println(" mV");
-            telnetClient.print("Load Voltage:  ");
-            telnetClient.print(load);
-            telnetClient.println(" V (bus + shunt)");
-            telnetClient.print("Current:       ");
-            telnetClient.print(current);
-            telnetClient.println(" mA");
-            telnetClient.print("Power:         ");
-            telnetClient.print(power);
-            telnetClient.println(" mW");
+            s.println("--- INA219 Power Sensor ---");
+            s.print("Bus Voltage:   ");
+            s.print(bus);
+            s.println(" V");
+            s.print("Shunt Voltage: ");
+            s.print(shunt);
+            s.println(" mV");
+            s.print("Load Voltage:  ");
+            s.print(load);
+            s.println(" V (bus + shunt)");
+            s.print("Current:       ");
+            s.print(current);
+            s.println(" mA");
+            s.print("Power:         ");
+            s.print(power);
+            s.println(" mW");
         } else {
-            telnetClient.println("INA219 sensor not available (initialization failed)");
+            s.println("INA219 sensor not available (initialization failed)");
         }
     }
     // LEVEL - Display current average tank level
     else if (cmd == "currentlevel" || cmd == "c")
     {
-        telnetClient.print("chlorine current: ");
-        telnetClient.println(device.GetAmps());
+        s.print("chlorine current: ");
+        s.println(device.GetAmps());
 
     }
     // MOTOR STATUS - Display motor state
     else if (cmd == "motor")
     {
         if (!device.motor) {
-            telnetClient.println("Error: Motor not initialized");
+            s.println("Error: Motor not initialized");
             return;
         }
-        telnetClient.print("Motor status: ");
+        s.print("Motor status: ");
         if (device.motor->isRunning())
         {
-            telnetClient.print("Running ");
-            telnetClient.print(device.motor->isForward() ? "FORWARD" : "REVERSE");
-            telnetClient.print(" at speed ");
-            telnetClient.println(device.motor->getSpeed());
+            s.print("Running ");
+            s.print(device.motor->isForward() ? "FORWARD" : "REVERSE");
+            s.print(" at speed ");
+            s.println(device.motor->getSpeed());
         }
         else
         {
-            telnetClient.println("STOPPED");
+            s.println("STOPPED");
         }
     }
     // MOTOR FORWARD
     else if (cmd == "forward")
     {
         if (!device.motor) {
-            telnetClient.println("Error: Motor not initialized");
+            s.println("Error: Motor not initialized");
             return;
         }
         device.motor->forward(255);
-        telnetClient.println("Motor running forward at speed 200");
+        s.println("Motor running forward at speed 200");
     }
     // MOTOR REVERSE
     else if (cmd == "reverse")
@@ -379,7 +759,7 @@ void Telnet::processCommand(String cmd)
         Serial.println((unsigned long)device.motor, HEX);
         
         if (!device.motor) {
-            telnetClient.println("Error: Motor not initialized");
+            s.println("Error: Motor not initialized");
             Serial.println("[DEBUG] Motor is NULL!");
             return;
         }
@@ -387,41 +767,41 @@ void Telnet::processCommand(String cmd)
         Serial.println("[DEBUG] Calling motor->reverse(200)");
         device.motor->reverse(255);
         Serial.println("[DEBUG] motor->reverse() returned");
-        telnetClient.println("Motor running reverse at speed 200");
+        s.println("Motor running reverse at speed 200");
     }
     // MOTOR STOP
     else if (cmd == "stop")
     {
         if (!device.motor) {
-            telnetClient.println("Error: Motor not initialized");
+            s.println("Error: Motor not initialized");
             return;
         }
         device.motor->stop();
-        telnetClient.println("Motor stopped");
+        s.println("Motor stopped");
     }
     // MOTOR MAX SPEED
     else if (cmd == "max")
     {
         if (!device.motor) {
-            telnetClient.println("Error: Motor not initialized");
+            s.println("Error: Motor not initialized");
             return;
         }
         if (device.motor->isForward())
         {
             device.motor->forward(255);
-            telnetClient.println("Motor running forward at MAX speed (255)");
+            s.println("Motor running forward at MAX speed (255)");
         }
         else
         {
             device.motor->reverse(255);
-            telnetClient.println("Motor running reverse at MAX speed (255)");
+            s.println("Motor running reverse at MAX speed (255)");
         }
     }
     // MOTOR CUSTOM SPEED - format: "speed 150" or "speed 255"
     else if (cmd.startsWith("speed "))
     {
         if (!device.motor) {
-            telnetClient.println("Error: Motor not initialized");
+            s.println("Error: Motor not initialized");
             return;
         }
         int speed = cmd.substring(6).toInt();
@@ -430,49 +810,468 @@ void Telnet::processCommand(String cmd)
             if (device.motor->isForward())
             {
                 device.motor->forward(speed);
-                telnetClient.print("Motor forward at speed ");
+                s.print("Motor forward at speed ");
             }
             else
             {
                 device.motor->reverse(speed);
-                telnetClient.print("Motor reverse at speed ");
+                s.print("Motor reverse at speed ");
+            }
+            s.println(speed);
+        }
+        else
+        {
+            s.println("Error: Speed must be 0-255");
+        }
+    }
+    // CAL - two-point field calibration of the INA219 against a reference meter
+    else if (cmd == "cal" || cmd.startsWith("cal "))
+    {
+        String arg = cmd.length() > 4 ? cmd.substring(4) : String("");
+        arg.trim();
+        if (arg == "clear")
+        {
+            ina219_sensor.clear_calibration();
+            s.println("INA219 calibration cleared");
+        }
+        else if (arg.length())
+        {
+            float reference = arg.toFloat();
+            if (!ina219_sensor.capture_point(reference))
+            {
+                s.println("Error: capture already running");
+                return;
+            }
+            s.printf("Capturing point %d at %.1f mA over %d readings",
+                     ina219_sensor.calibration_points() + 1, reference, INA219_CAL_SAMPLES);
+            s.println(ina219_sensor.calibration_points() ? " - completes calibration" : " - then set the second current");
+        }
+        else
+        {
+            static const char *const states[] = {"idle", "capturing", "done", "failed (points too close?)"};
+            s.printf("Gain %.4f, offset %.1f mA, cal 0x%04X\r\n",
+                     ina219_sensor.gain(), ina219_sensor.offset_mA(), ina219_sensor.calibration_register());
+            s.printf("State: %s, %d of 2 points\r\n",
+                     states[ina219_sensor.calibration_state()], ina219_sensor.calibration_points());
+            s.println("Usage: cal <reference mA> at two currents, or cal clear");
+        }
+    }
+    // AVG - INA219 hardware averaging
+    else if (cmd.startsWith("avg "))
+    {
+        int samples = cmd.substring(4).toInt();
+        if (samples < 1 || samples > 128)
+        {
+            s.println("Error: averaging must be 1-128");
+            return;
+        }
+        ina219_sensor.configure(ina219_sensor.shunt_ohms(), ina219_sensor.max_current_A(), samples);
+        s.println("INA219 averaging updated (rounded down to a power of two)");
+    }
+    // WATCH - stream live telemetry to this session
+    else if (cmd == "watch" || cmd.startsWith("watch ") || cmd == "w" || cmd.startsWith("w "))
+    {
+        if (!session) {
+            s.println("Error: watch needs a telnet session");
+            return;
+        }
+        int space = cmd.indexOf(' ');
+        _watchCommand(*session, space < 0 ? String("") : cmd.substring(space + 1));
+    }
+    else if (cmd == "unwatch" || cmd == "uw")
+    {
+        if (!session) {
+            s.println("Error: watch needs a telnet session");
+            return;
+        }
+        session->watchInterval = 0;
+        s.println("Watch stopped");
+    }
+    // I2C - Per-device bus statistics and sensor state
+    else if (cmd == "i2c")
+    {
+        I2cDeviceStats stats;
+        s.println("--- I2C Bus ---");
+        for (int i = 0; i < i2c_bus.device_count(); i++)
+        {
+            if (!i2c_bus.device_stats(i, stats)) continue;
+            s.printf("0x%02X  %lu xfers, %lu errors, avg %lu us, max %lu us\r\n",
+                     stats.address, (unsigned long) stats.transactions, (unsigned long) stats.errors,
+                     (unsigned long) (stats.transactions ? stats.busy_us / stats.transactions : 0),
+                     (unsigned long) stats.max_us);
+        }
+        s.printf("Bus recoveries: %lu\r\n", (unsigned long) i2c_bus.recoveries());
+        s.printf("INA219: %s, %lu timeouts\r\n", ina219_sensor.is_present() ? "present" : "missing",
+                 (unsigned long) ina219_sensor.timeouts());
+        s.printf("  config 0x%04X, cal 0x%04X, LSB %.3f mA, %u-sample averaging, every %lu ms\r\n",
+                 ina219_sensor.config_register(), ina219_sensor.calibration_register(),
+                 ina219_sensor.current_lsb_mA(), ina219_sensor.averaging(),
+                 (unsigned long) ina219_sensor.interval_ms);
+        s.printf("BME280: %s, %lu timeouts\r\n", bme280_sensor.is_present() ? "present" : "missing",
+                 (unsigned long) bme280_sensor.timeouts());
+        Environment env;
+        if (bme280_sensor.latest(env))
+        {
+            s.printf("  %.2f C, %.1f %%RH, %.1f hPa\r\n", env.temperature_C, env.humidity_pct, env.pressure_hPa);
+        }
+    }
+    else if (cmd == "wifi")
+    {
+        WiFiOutageStats outages;
+        wifi_tools.outage_stats(outages);
+        s.println("--- WiFi ---");
+        s.printf("%s, ch %d, %d dBm\r\n", wifi_tools.is_connected ? "connected" : "down",
+                 WiFi.channel(), WiFi.RSSI());
+        s.printf("Outages: %lu, total %lu s, max %lu ms, p95 %lu ms\r\n", (unsigned long) outages.count,
+                 (unsigned long) (outages.total_ms / 1000), (unsigned long) outages.max_ms,
+                 (unsigned long) outages.p95_ms);
+        s.println("Disconnects:");
+        for (const WiFiName & r : WIFI_REASON_NAMES)
+        {
+            uint32_t n = wifi_tools.reason_count(r.code);
+            if (n) s.printf("  %3d %-28s %lu\r\n", r.code, r.name, (unsigned long) n);
+        }
+        s.println("Events:");
+        for (const WiFiName & e : WIFI_EVENT_NAMES)
+        {
+            uint32_t n = wifi_tools.event_count(e.code);
+            if (n) s.printf("  %-28s %lu\r\n", e.name, (unsigned long) n);
+        }
+    }
+    // NAME - topic id for this unit; the topics are built at boot
+    else if (cmd == "name" || cmd.startsWith("name "))
+    {
+        String arg = cmd.length() > 5 ? cmd.substring(5) : String("");
+        arg.trim();
+        if (arg == "clear")
+        {
+            identity.clear_name();
+            s.println("Name cleared - topics use the MAC after a reboot");
+        }
+        else if (arg.length())
+        {
+            if (!identity.set_name(arg.c_str()))
+            {
+                s.println("Error: name needs letters, digits, - or _ (and not \"all\")");
+                return;
+            }
+            s.println("Name saved - topics change after a reboot");
+        }
+        else
+        {
+            s.printf("Name: %s, MAC %s\r\n", identity.id(), identity.mac());
+        }
+    }
+    // MEM - heap state, stack high-water marks and allocations by subsystem
+    else if (cmd == "mem")
+    {
+        s.printf("Heap: %lu free, %lu min ever, largest block %lu (%u%% fragmented)\r\n",
+                 (unsigned long) memory_monitor.free_heap(), (unsigned long) memory_monitor.min_free_heap(),
+                 (unsigned long) memory_monitor.largest_block(), memory_monitor.fragmentation());
+        s.printf("Failed allocations: %lu (last %lu bytes)\r\n",
+                 (unsigned long) memory_monitor.alloc_failures(), (unsigned long) memory_monitor.last_failed_size());
+        s.println("Stack headroom:");
+        MemoryTaskStack stack;
+        for (int i = 0; i < memory_monitor.task_count(); i++)
+        {
+            if (memory_monitor.task_stack(i, stack))
+                s.printf("  %-16s %5lu bytes\r\n", stack.name, (unsigned long) stack.headroom);
+        }
+        s.println("Allocations:      allocs    frees      bytes");
+        MemoryCounts counts;
+        for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++)
+        {
+            if (!memory_monitor.counts((MemorySubsystem) i, counts) || !counts.allocs) continue;
+            s.printf("  %-12s %9lu %8lu %10lu\r\n", MemoryMonitor::subsystem_name((MemorySubsystem) i),
+                     (unsigned long) counts.allocs, (unsigned long) counts.frees, (unsigned long) counts.bytes);
+        }
+        s.print("Alarms:");
+        if (!memory_monitor.alarms()) s.print(" none");
+        for (uint8_t bit = 1; bit && bit <= MEM_ALARM_ALLOC_FAILED; bit <<= 1)
+        {
+            if (memory_monitor.alarms() & bit)
+            {
+                s.print(" ");
+                s.print(MemoryMonitor::alarm_name((MemoryAlarm) bit));
+            }
+        }
+        s.println("");
+    }
+    // FAULT - overcurrent trip state; clear releases a lockout, test trips
+    // through the same path to measure the cut
+    else if (cmd == "fault" || cmd.startsWith("fault "))
+    {
+        String arg = cmd.length() > 6 ? cmd.substring(6) : String("");
+        arg.trim();
+        if (arg == "clear")
+        {
+            protection.clear();
+        }
+        else if (arg == "test")
+        {
+            protection.trip(TRIP_TEST, timebase.now_us());
+        }
+        else if (arg.length())
+        {
+            s.println("Error: fault [clear|test]");
+            return;
+        }
+        s.printf("State: %s, streak %u", Protection::state_name(protection.state()), protection.streak());
+        int32_t retry = protection.retry_in_ms();
+        if (retry >= 0) s.printf(", retry in %.1f s", retry / 1000.0);
+        s.println("");
+        s.printf("Trip at %.0f mA; latency last %lu us (%s), max %lu us\r\n", PROTECTION_TRIP_MA,
+                 (unsigned long) protection.last_latency_us(), Protection::source_name(protection.last_source()),
+                 (unsigned long) protection.max_latency_us());
+        s.print("Trips:");
+        for (int t = 0; t < TRIP_SOURCE_COUNT; t++)
+            s.printf(" %s %lu", Protection::source_name((TripSource) t), (unsigned long) protection.trips((TripSource) t));
+        s.println("");
+    }
+    // SWEEP - cell characterization, its table as CSV, and the target
+    // current the table is used to reach (0 = full duty)
+    else if (cmd == "sweep" || cmd.startsWith("sweep "))
+    {
+        String arg = cmd.length() > 6 ? cmd.substring(6) : String("");
+        arg.trim();
+        if (arg == "start")
+        {
+            const char * why;
+            if (!sweep.start(why))
+            {
+                s.printf("Error: %s\r\n", why);
+                return;
             }
-            telnetClient.println(speed);
         }
+        else if (arg == "stop")
+        {
+            sweep.stop();
+        }
+        else if (arg == "csv")
+        {
+            // Longer than the output ring: Telnet::loop pages it out
+            if (session) session->csvRow = 0;
+            else sweep.write_csv(s);
+            return;
+        }
+        else if (arg == "target" || arg.startsWith("target "))
+        {
+            // toFloat() reads garbage as 0, which is a valid target
+            String value = arg.substring(6);
+            value.trim();
+            char *end;
+            float mA = strtof(value.c_str(), &end);
+            if (!value.length() || *end || !isfinite(mA) || mA < 0 || mA > PROTECTION_TRIP_MA)
+            {
+                s.printf("Error: target must be 0-%.0f mA\r\n", PROTECTION_TRIP_MA);
+                s.println("Usage: sweep target <mA>, 0 for full duty");
+                return;
+            }
+            sweep.set_target(mA);
+        }
+        else if (arg.length())
+        {
+            s.println("Error: sweep [start|stop|csv|target <mA>]");
+            return;
+        }
+        if (sweep.running())
+            s.printf("Running: point %d of %d\r\n", sweep.point() + 1, sweep.total());
+        else
+            s.printf("Table: %d points%s\r\n", sweep.count(), sweep.count() && !sweep.taken() ? " (clock unset)" : "");
+        if (sweep.taken())
+        {
+            char when[32];
+            timebase.format(when, sizeof(when), (uint64_t) sweep.taken() * 1000);
+            s.printf("Taken %s\r\n", when);
+        }
+        if (sweep.target_mA() > 0)
+            s.printf("Target %.0f mA: speed %d forward, %d reverse\r\n", sweep.target_mA(),
+                     sweep.feedforward(false), sweep.feedforward(true));
         else
+            s.println("No target - full duty");
+    }
+    // SERIES - flash history per tier, or a page of one tier's points
+    // (series raw|minute|hour [minutes back | @epoch])
+    else if (cmd == "series" || cmd.startsWith("series "))
+    {
+        if (!series.is_ready())
+        {
+            s.println("Series: no data partition");
+            return;
+        }
+        String arg = cmd.length() > 7 ? cmd.substring(7) : String("");
+        arg.trim();
+        if (!arg.length())
         {
-            telnetClient.println("Error: Speed must be 0-255");
+            s.printf("Flash: %lu writes, %lu sector erases since boot\r\n",
+                     (unsigned long) series.flash_writes(), (unsigned long) series.flash_erases());
+            s.println("Tier     every  sectors  used   oldest -> newest");
+            SeriesTierStats stats;
+            char oldest[32], newest[32];
+            for (int t = 0; t < SERIES_TIER_COUNT; t++)
+            {
+                if (!series.tier_stats((SeriesTier) t, stats)) continue;
+                timebase.format(oldest, sizeof(oldest), (uint64_t) stats.oldest * 1000);
+                timebase.format(newest, sizeof(newest), (uint64_t) stats.newest * 1000);
+                s.printf("  %-6s %5lus  %2u/%-2u  %5luB  %s -> %s\r\n", SeriesStore::tier_name((SeriesTier) t),
+                         (unsigned long) SeriesStore::interval((SeriesTier) t), stats.blocks, stats.sectors,
+                         (unsigned long) stats.bytes, stats.oldest ? oldest : "empty", stats.newest ? newest : "-");
+            }
+            return;
+        }
+
+        int space = arg.indexOf(' ');
+        String name = space < 0 ? arg : arg.substring(0, space);
+        String from = space < 0 ? String("") : arg.substring(space + 1);
+        from.trim();
+        SeriesTier tier;
+        if (!SeriesStore::parse_tier(name.c_str(), tier))
+        {
+            s.println("Error: tier must be raw, minute or hour");
+            return;
+        }
+        // Default: the last page of the tier
+        uint32_t now = timebase.epoch_ms() / 1000;
+        uint32_t start = from.startsWith("@") ? strtoul(from.c_str() + 1, nullptr, 10)
+                       : from.length() ? now - from.toInt() * 60
+                       : now - SERIES_TELNET_POINTS * SeriesStore::interval(tier);
+
+        SeriesCursor cursor(series, tier, start, UINT32_MAX);
+        SeriesPoint point;
+        char when[32], field[24];
+        int shown = 0;
+        while (shown < SERIES_TELNET_POINTS && cursor.next(point))
+        {
+            if (!shown)
+            {
+                s.print("time                    ");
+                for (int i = 0; i < point.count; i++)
+                    s.printf(" %14s", SeriesStore::value_name(tier, i, field, sizeof(field)));
+                s.println("");
+            }
+            timebase.format(when, sizeof(when), (uint64_t) point.t * 1000);
+            s.printf("%-24s", when);
+            for (int i = 0; i < point.count; i++) s.printf(" %14.3f", point.v[i]);
+            s.println("");
+            shown++;
+        }
+        if (!shown) s.println("No points in range");
+        else if (cursor.next(point)) s.printf("More: series %s @%lu\r\n", SeriesStore::tier_name(tier), (unsigned long) point.t);
+    }
+    // ENCODING - wire encoding for MQTT telemetry (persisted)
+    else if (cmd == "encoding" || cmd.startsWith("encoding "))
+    {
+        String arg = cmd.length() > 9 ? cmd.substring(9) : String("");
+        arg.trim();
+        if (arg.length() && !telemetry.set_encoding(arg.c_str()))
+        {
+            s.println("Error: encoding must be json, cbor or msgpack");
+            return;
+        }
+        s.printf("Telemetry encoding: %s (topic suffix \"%s\")\r\n",
+                 Telemetry::name(telemetry.encoding()), Telemetry::suffix(telemetry.encoding()));
+    }
+    // PM - power mode (persisted), estimated current per mode, lock holders
+    else if (cmd == "pm" || cmd.startsWith("pm "))
+    {
+        String arg = cmd.length() > 3 ? cmd.substring(3) : String("");
+        arg.trim();
+        if (arg.length() && !power.set_mode(arg.c_str()))
+        {
+            s.println("Error: mode must be performance, balanced or low");
+            return;
+        }
+        char description[96];
+        power.describe(description, sizeof(description));
+        s.printf("Power: %s\r\n", description);
+        s.printf("CPU now %lu MHz, estimate %.1f mA\r\n", (unsigned long) getCpuFrequencyMhz(), power.estimate_mA());
+        s.println("Mode            time   awake   avg mA (estimate)");
+        PowerModeStats stats;
+        for (int m = 0; m < POWER_MODE_COUNT; m++)
+        {
+            if (!power.mode_stats((PowerMode) m, stats) || !stats.us) continue;
+            s.printf("  %-11s %7.0fs  %5.1f%%  %7.1f\r\n", Power::name((PowerMode) m), stats.us / 1e6,
+                     100.0 * stats.awake_us / stats.us, stats.average_mA);
+        }
+        s.println("Locks:      type   held    holds   held s");
+        for (int i = 0; i < power.lock_count(); i++)
+        {
+            PmLock * lock = power.lock(i);
+            s.printf("  %-9s %-5s  %-4s %9lu %8.1f\r\n", lock->name(), Power::lock_type_name(lock->type()),
+                     lock->held() ? "yes" : "no", (unsigned long) lock->holds(), lock->held_us() / 1e6);
+        }
+    }
+    // BENCH - the current sensors message in every encoding, and the sensor filters
+    else if (cmd == "bench")
+    {
+        JsonDocument doc;
+        device.BuildTelemetry(doc);
+        TelemetryBench results[TELEMETRY_ENCODING_COUNT];
+        telemetry.bench(doc, results, TELEMETRY_BENCH_ROUNDS);
+        s.printf("Sensors message, %d encodes each:\r\n", TELEMETRY_BENCH_ROUNDS);
+        for (int e = 0; e < TELEMETRY_ENCODING_COUNT; e++)
+        {
+            s.printf("  %-8s %4u bytes (%3u%%)  %6.1f us\r\n", Telemetry::name((TelemetryEncoding) e),
+                     (unsigned) results[e].bytes,
+                     (unsigned) (results[TELEMETRY_JSON].bytes ? results[e].bytes * 100 / results[TELEMETRY_JSON].bytes : 0),
+                     results[e].encode_us);
+        }
+        s.printf("Filters: %.2f us per INA219 reading (current, bus, resistance)\r\n",
+                 device.FilterCost_us(TELEMETRY_BENCH_ROUNDS * 5));
+    }
+    // WHO - list connected sessions
+    else if (cmd == "who")
+    {
+        for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
+        {
+            if (!_sessions[i].active) continue;
+            s.printf("  #%d %s%s watch=%s dropped=%lu\r\n", i,
+                _sessions[i].client.remoteIP().toString().c_str(),
+                &_sessions[i] == session ? " (you)" : "",
+                _sessions[i].watchInterval ? "on" : "off",
+                (unsigned long) _sessions[i].droppedBytes);
         }
     }
     // Unknown command
     else if (cmd.length() > 0)
     {
-        telnetClient.println("Unknown command. Type 'help' for available commands.");
+        s.println("Unknown command. Type 'help' for available commands.");
     }
 }
 
 /**
- * Print string to telnet client (without newline)
- * Automatically handles client connection checking
+ * Print string to every connected session (without newline)
  * @param Msg Message to send
  */
 void Telnet::print(String Msg)
 {
-    // Only send data if client is connected (don't try to accept new clients here)
-    if (telnetClient && telnetClient.connected())
-    {
-        telnetClient.print(Msg);
-        lastActivityMillis = millis();  // Reset keepalive timer on activity
-    }
+    print(Msg.c_str());
 }
 
 /**
- * Print C-string to telnet client (without newline)
+ * Print C-string to every connected session (without newline)
+ * Queued into each session's ring - never blocks on a slow client.
+ * Each log line starts with a timestamp.
  * @param Msg Message to send
  */
 void Telnet::print(const char *Msg)
 {
-    print(String(Msg));
+    size_t len = strlen(Msg);
+    if (len == 0) return;
+
+    char stamp[24];
+    size_t stampLength = _atLineStart ? _stamp(stamp, sizeof(stamp)) : 0;
+    _atLineStart = Msg[len - 1] == '\n';
+
+    for (int i = 0; i < TELNET_MAX_SESSIONS; i++)
+    {
+        if (_sessions[i].active)
+        {
+            if (stampLength) _sessions[i].write((const uint8_t *)stamp, stampLength);
+            _sessions[i].write((const uint8_t *)Msg, len);
+            _sessions[i].lastActivity = millis();  // Reset keepalive timer on activity
+        }
+    }
 }
 
 /**
@@ -490,7 +1289,8 @@ void Telnet::println(String Msg)
  */
 void Telnet::println(const char *Msg)
 {
-    println(String(Msg));
+    print(Msg);
+    print("\r\n");
 }
 
 /**
@@ -514,3 +1314,20 @@ void Telnet::print(float f)
     sprintf(buffer, "%.2f", f);
     print(buffer);
 }
+
+/**
+ * Log line timestamp: UTC time of day once SNTP has synced, seconds since
+ * boot before that
+ */
+size_t Telnet::_stamp(char *buffer, size_t size)
+{
+    if (!timebase.is_synced())
+    {
+        uint64_t ms = timebase.now_ms();
+        return snprintf(buffer, size, "+%lu.%03u ", (unsigned long)(ms / 1000), (unsigned)(ms % 1000));
+    }
+    char when[32];
+    timebase.format(when, sizeof(when), timebase.epoch_ms());
+    // 2024-01-01T12:34:56.789Z -> 12:34:56.789Z
+    return snprintf(buffer, size, "%s ", when + 11);
+}
@@ -1,5 +1,63 @@
 #pragma once
 
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define TELNET_MAX_SESSIONS 3       // concurrent engineers
+#define TELNET_LINE_SIZE 64         // longest command line
+#define TELNET_OUT_SIZE 2048        // per-session output ring
+#define TELNET_STALL_TIMEOUT 5000   // drop a session whose ring stays full this long
+#define WATCH_MAX_RATE 10           // Hz
+#define WATCH_MIN_INTERVAL 100      // ms, matches POWER_SAMPLE_INTERVAL
+#define TELNET_CSV_PAGE 8           // sweep table rows written per pass, ~800 bytes
+
+/**
+ * One telnet connection: its own line buffer, output ring and watch state.
+ * Output is written into the ring and drained to the socket without
+ * blocking, so a slow client only ever stalls itself.
+ */
+class TelnetSession : public Print {
+
+    public:
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+        int availableForWrite() override { return TELNET_OUT_SIZE - _used; }
+
+        WiFiClient client;
+        bool active = false;
+
+        // input
+        char line[TELNET_LINE_SIZE];
+        uint8_t lineLength = 0;
+        char lastCommand[TELNET_LINE_SIZE];
+
+        // watch mode
+        uint16_t watchFields = 0;    // bit mask of WatchField
+        uint16_t watchInterval = 0;  // ms, 0 = off
+        unsigned long lastWatch = 0;
+
+        // sweep csv, paged out by Telnet::loop as the ring empties
+        int csvRow = -1;             // next table row, -1 = not sending
+
+        unsigned long lastActivity = 0;
+        unsigned long stalledSince = 0;
+        uint32_t droppedBytes = 0;
+
+        void open(WiFiClient &c);
+        void close();
+        bool drain();
+
+    private:
+
+        char _out[TELNET_OUT_SIZE];
+        size_t _head = 0;   // next write position
+        size_t _tail = 0;   // next byte to send
+        size_t _used = 0;
+
+};
+
 
 class Telnet {
 
@@ -15,13 +73,23 @@ class Telnet {
         void print(float f);
         void println(String);
         void println(const char*);
-        void processCommand(String cmd);
+        void processCommand(TelnetSession &s, String cmd);
+        void execute(Print &out, String cmd, TelnetSession *session = nullptr);
+        static bool command_word(int index, char *word, size_t size);
 
     private:
-        String commandBuffer;
-        String lastCommand;  // Store last executed command for repeat functionality
+
+        TelnetSession _sessions[TELNET_MAX_SESSIONS];
+        bool _atLineStart = true;   // next log output starts a line and gets a timestamp
+
+        void _accept();
+        void _read(TelnetSession &s);
+        void _watch();
+        void _csv();
+        void _watchCommand(TelnetSession &s, String args);
+        size_t _stamp(char *buffer, size_t size);
 
 };
 
 
-extern Telnet telnet;
\ No newline at end of file
+extern Telnet telnet;
@@ -0,0 +1,87 @@
+#include "timebase.h"
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <time.h>
+
+Timebase::Timebase() {
+    strlcpy(_server, NTP_DEFAULT_SERVER, sizeof(_server));
+}
+
+Timebase timebase;
+
+
+// Needs a network interface; lwIP keeps only the pointer to the name
+void Timebase::begin(const char * server) {
+    if (server && *server) strlcpy(_server, server, sizeof(_server));
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, _server);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL);
+    sntp_set_time_sync_notification_cb(_sync_callback);
+    sntp_init();
+    Serial.printf("\tSNTP: polling %s\n", _server);
+}
+
+
+uint64_t Timebase::now_us() {
+    return esp_timer_get_time();
+}
+
+
+// lwIP's tcpip task, right after SNTP has set the system clock
+void Timebase::_sync_callback(struct timeval * tv) {
+    struct timeval now;
+    if (!tv) {
+        gettimeofday(&now, nullptr);
+        tv = &now;
+    }
+    timebase._on_sync((uint64_t) tv->tv_sec * 1000000 + tv->tv_usec);
+}
+
+
+void Timebase::_on_sync(uint64_t epoch_us) {
+
+    uint64_t mono = now_us();
+
+    portENTER_CRITICAL(&_lock);
+    if (_sync_count) {
+        // Whatever the mapping got wrong since the last anchor is rate error
+        int64_t offset = (int64_t) (epoch_us - _predict_us(mono));
+        float span = (mono - _anchor_mono) / 1e6;
+        _last_offset = offset;
+        if (span >= NTP_DRIFT_SPAN) {
+            float drift = _drift_ppm + NTP_DRIFT_GAIN * (offset / span);   // us per s is ppm
+            if (fabsf(drift) <= NTP_DRIFT_MAX_PPM) _drift_ppm = drift;
+        }
+    }
+    _anchor_mono = mono;
+    _anchor_epoch = epoch_us;
+    _sync_count++;
+    portEXIT_CRITICAL(&_lock);
+}
+
+
+// Caller holds the lock
+uint64_t Timebase::_predict_us(uint64_t monotonic_us) {
+    int64_t elapsed = (int64_t) (monotonic_us - _anchor_mono);
+    return _anchor_epoch + elapsed + (int64_t) (elapsed * (double) _drift_ppm / 1e6);
+}
+
+
+uint64_t Timebase::to_epoch_ms(uint64_t monotonic_us) {
+    if (!_sync_count) return 0;
+    portENTER_CRITICAL(&_lock);
+    uint64_t epoch = _predict_us(monotonic_us);
+    portEXIT_CRITICAL(&_lock);
+    return epoch / 1000;
+}
+
+
+size_t Timebase::format(char * out, size_t size, uint64_t epoch_ms) {
+    time_t seconds = epoch_ms / 1000;
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    size_t len = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &utc);
+    if (len) len += snprintf(out + len, size - len, ".%03uZ", (unsigned) (epoch_ms % 1000));
+    return len;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define NTP_DEFAULT_SERVER "pool.ntp.org"
+#define NTP_SYNC_INTERVAL 3600000   // ms between SNTP polls
+#define NTP_DRIFT_SPAN 600          // s between syncs before a drift estimate is trusted
+#define NTP_DRIFT_MAX_PPM 200.0     // beyond any real crystal - an estimate this large is a bad sample
+#define NTP_DRIFT_GAIN 0.5          // how much of each new estimate is folded in
+
+/**
+ * Time for telemetry. The monotonic clock is esp_timer's 64-bit microsecond
+ * counter - it never wraps and never steps. SNTP doesn't move it; each sync
+ * re-anchors a monotonic -> epoch mapping instead, and the rate error seen
+ * between syncs is tracked as crystal drift and corrected for in between.
+ *
+ * Anything that records a time keeps the monotonic value and converts it to
+ * epoch when it's sent, so samples taken before the first sync still get a
+ * wall-clock time once one is known.
+ */
+class Timebase {
+
+    public:
+
+        Timebase();
+
+        void begin(const char * server);
+
+        // Monotonic, since boot
+        uint64_t now_us();
+        uint64_t now_ms() { return now_us() / 1000; }
+        uint32_t uptime() { return now_us() / 1000000; }
+
+        // Wall clock, UTC; 0 until the first sync
+        bool is_synced() { return _sync_count > 0; }
+        uint64_t epoch_ms() { return to_epoch_ms(now_us()); }
+        uint64_t to_epoch_ms(uint64_t monotonic_us);
+        size_t format(char *, size_t, uint64_t epoch_ms);   // ISO 8601
+
+        // Sync quality
+        const char * server() { return _server; }
+        uint32_t sync_count() { return _sync_count; }
+        uint64_t last_sync_us() { return _anchor_mono; }
+        int64_t last_offset_us() { return _last_offset; }   // correction applied at the last sync
+        float drift_ppm() { return _drift_ppm; }
+
+    private:
+
+        char _server[64];
+        volatile uint32_t _sync_count = 0;
+        uint64_t _anchor_mono = 0;      // monotonic us at the last sync
+        uint64_t _anchor_epoch = 0;     // epoch us at the last sync
+        int64_t _last_offset = 0;
+        float _drift_ppm = 0;
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+        void _on_sync(uint64_t epoch_us);
+        uint64_t _predict_us(uint64_t monotonic_us);
+        static void _sync_callback(struct timeval *);
+
+};
+
+extern Timebase timebase;
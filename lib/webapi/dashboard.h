@@ -0,0 +1,88 @@
+#pragma once
+
+// Generated by dev/gzip_pages.py from dev/*.html - edit those and rerun
+
+#include <Arduino.h>
+
+// dashboard.html: 3613 bytes, 1221 gzipped
+const uint8_t DASHBOARD_PAGE[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x57, 0x6d, 0x6f, 0xdb, 0x36,
+    0x10, 0xfe, 0x9e, 0x5f, 0xc1, 0x39, 0x18, 0x2c, 0xad, 0x96, 0x2c, 0x39, 0x4d, 0xb0, 0xd9, 0xb2,
+    0x8a, 0x2d, 0x4d, 0x90, 0x0c, 0x69, 0x1a, 0x34, 0x59, 0x8b, 0x21, 0xc8, 0x07, 0x46, 0xa4, 0x2d,
+    0xae, 0xb4, 0x24, 0x90, 0xb4, 0x22, 0x77, 0xc8, 0x7f, 0xdf, 0x91, 0xf2, 0x8b, 0x6c, 0x53, 0xee,
+    0x2a, 0x04, 0x01, 0x75, 0x7c, 0xee, 0xee, 0xb9, 0xe3, 0xdd, 0x89, 0x8e, 0x7e, 0x7a, 0xff, 0xf1,
+    0xfc, 0xe1, 0xef, 0xbb, 0x0b, 0x74, 0xf5, 0xf0, 0xe1, 0x26, 0x3e, 0x8a, 0x52, 0x35, 0xe3, 0xf1,
+    0x11, 0x82, 0x27, 0x4a, 0x29, 0x26, 0xf5, 0xd2, 0xbc, 0xce, 0xa8, 0xc2, 0x28, 0x49, 0xb1, 0x90,
+    0x54, 0x8d, 0x3b, 0x7f, 0x3d, 0x5c, 0x7a, 0xbf, 0x76, 0x76, 0xb7, 0x33, 0x3c, 0xa3, 0xe3, 0x4e,
+    0xc9, 0xe8, 0x4b, 0x91, 0x0b, 0xd5, 0x41, 0x49, 0x9e, 0x29, 0x9a, 0x01, 0xfc, 0x85, 0x11, 0x95,
+    0x8e, 0x09, 0x2d, 0x59, 0x42, 0x3d, 0xf3, 0xd2, 0x43, 0x2c, 0x63, 0x8a, 0x61, 0xee, 0xc9, 0x04,
+    0x73, 0x3a, 0x0e, 0xfd, 0xa0, 0x69, 0x4e, 0x31, 0xc5, 0x69, 0x7c, 0xc9, 0xb8, 0xa2, 0xe2, 0x3c,
+    0xe5, 0xb9, 0x60, 0x19, 0x45, 0x37, 0xac, 0xa4, 0x51, 0xbf, 0xde, 0xda, 0x40, 0xa5, 0x5a, 0x34,
+    0xdf, 0xf5, 0xf3, 0x0b, 0xfa, 0x77, 0xeb, 0x5d, 0x3f, 0xcf, 0x79, 0xe5, 0x49, 0xf6, 0x8d, 0x65,
+    0xd3, 0x21, 0xac, 0x05, 0xa1, 0xc2, 0x03, 0xd1, 0x68, 0x0f, 0x37, 0x01, 0xce, 0xde, 0x04, 0xcf,
+    0x18, 0x5f, 0x0c, 0x11, 0x16, 0xc0, 0x70, 0x1b, 0xf3, 0x7a, 0xb4, 0x6d, 0x95, 0x2c, 0x2c, 0xce,
+    0x66, 0x58, 0x4c, 0x59, 0x36, 0x44, 0x01, 0xc2, 0x73, 0x95, 0x8f, 0x2c, 0xfb, 0x55, 0x9d, 0x86,
+    0x21, 0xfa, 0x2d, 0x08, 0x0a, 0x0b, 0x8d, 0x02, 0x13, 0x62, 0xb8, 0x86, 0x7b, 0xdb, 0xdb, 0x0c,
+    0xd2, 0xd0, 0xe2, 0xdf, 0x04, 0x01, 0xd1, 0xd2, 0x21, 0x1a, 0x0c, 0x0e, 0xeb, 0x1f, 0x4b, 0x85,
+    0x95, 0x44, 0xb2, 0xc0, 0x99, 0xc5, 0x10, 0x61, 0xb2, 0xe0, 0x18, 0x32, 0xc1, 0x32, 0x0e, 0x47,
+    0xe0, 0x3d, 0xf3, 0x3c, 0xf9, 0x6a, 0x89, 0x87, 0x65, 0xab, 0x78, 0xc2, 0xb7, 0xd6, 0x78, 0x56,
+    0x19, 0x79, 0x5b, 0x54, 0x26, 0x24, 0xb3, 0x08, 0x0e, 0x11, 0x4b, 0x70, 0x56, 0x62, 0x69, 0xe1,
+    0xb4, 0x72, 0x14, 0x04, 0x3f, 0xef, 0xfb, 0x49, 0x29, 0x9b, 0xa6, 0x0a, 0xc2, 0x3e, 0xb3, 0xd2,
+    0xa8, 0x4f, 0x1e, 0x94, 0xc1, 0xbb, 0xcc, 0x39, 0x23, 0xe8, 0x18, 0x63, 0xdc, 0x86, 0xf3, 0x04,
+    0x26, 0x6c, 0x2e, 0x0d, 0xeb, 0x36, 0xaa, 0x51, 0xbf, 0x51, 0x80, 0x51, 0x7f, 0xd3, 0x35, 0x91,
+    0xae, 0x8d, 0x46, 0x9d, 0xa6, 0xa1, 0xbd, 0x9e, 0x41, 0xbe, 0x01, 0x11, 0x56, 0x22, 0x46, 0xc6,
+    0x1d, 0x73, 0x28, 0x9d, 0xed, 0xaa, 0x8e, 0xf4, 0x19, 0xc5, 0xd7, 0x43, 0xb0, 0x6c, 0x30, 0xac,
+    0x13, 0x7b, 0x51, 0xff, 0x39, 0x46, 0xb3, 0xdf, 0x81, 0x84, 0xde, 0xb3, 0xc0, 0x3f, 0xaf, 0xe1,
+    0xe5, 0x0a, 0xfe, 0xb9, 0x1d, 0x7d, 0xb7, 0x46, 0x17, 0x6b, 0xe3, 0x5f, 0xda, 0xe1, 0xef, 0x99,
+    0x58, 0x2b, 0x10, 0x26, 0x96, 0x2a, 0xed, 0xf8, 0x4f, 0x58, 0x41, 0x45, 0x46, 0x92, 0x72, 0x9a,
+    0x28, 0xa3, 0x25, 0x40, 0xd2, 0x89, 0xa3, 0xbc, 0x50, 0x2c, 0xcf, 0xe2, 0x30, 0xea, 0x2f, 0x57,
+    0x2b, 0xc9, 0x60, 0x57, 0x82, 0x6a, 0x65, 0x4a, 0xe2, 0xd3, 0x3d, 0x70, 0x18, 0x6c, 0x44, 0xfd,
+    0x1a, 0x17, 0xa3, 0xab, 0x6f, 0xbb, 0x7c, 0xa2, 0x3e, 0x64, 0xb9, 0xf1, 0xba, 0x2c, 0x34, 0x4d,
+    0x47, 0xcf, 0x37, 0x05, 0x7c, 0xfa, 0xb5, 0xac, 0x39, 0x65, 0x12, 0xc1, 0x0a, 0xb5, 0x1d, 0x14,
+    0x8c, 0x37, 0xa9, 0xd0, 0x2d, 0x1a, 0xa3, 0xb3, 0x60, 0xa7, 0x94, 0xeb, 0xad, 0x64, 0x2e, 0x60,
+    0xf3, 0xf1, 0xa9, 0x87, 0xca, 0x9c, 0x2b, 0xb3, 0xb4, 0xc2, 0x4a, 0xd8, 0x22, 0x79, 0x32, 0x9f,
+    0xc1, 0xb0, 0xf4, 0xa7, 0x54, 0x5d, 0x70, 0xaa, 0x97, 0x7f, 0x2c, 0xae, 0x89, 0xd3, 0x35, 0x9c,
+    0xba, 0xae, 0x55, 0x51, 0x55, 0xa0, 0x99, 0x94, 0x5a, 0xe7, 0x5c, 0xcf, 0xda, 0x4a, 0x39, 0xdd,
+    0x01, 0xd1, 0xe0, 0x2d, 0xf4, 0x64, 0x9e, 0x25, 0x26, 0x79, 0x44, 0xe0, 0x17, 0xc7, 0xb5, 0xf4,
+    0x14, 0xd8, 0x30, 0x6d, 0x55, 0x9b, 0x4b, 0x38, 0x03, 0xf7, 0x5f, 0xb4, 0x60, 0x64, 0x83, 0xd6,
+    0x4d, 0xd6, 0xc4, 0x5e, 0x19, 0x89, 0x05, 0xac, 0x2a, 0x40, 0x50, 0x2c, 0x3e, 0xc1, 0x61, 0x38,
+    0x41, 0x0f, 0xc1, 0xdf, 0xca, 0x57, 0x6f, 0x63, 0xca, 0xdd, 0xd7, 0x7c, 0x7c, 0x84, 0xec, 0xf5,
+    0x50, 0xf7, 0x38, 0x39, 0x39, 0xe9, 0x42, 0x06, 0x1f, 0x75, 0x0a, 0xf5, 0xfb, 0xc9, 0x59, 0xd2,
+    0x7d, 0x7a, 0xf2, 0x27, 0xb9, 0xb8, 0xc0, 0x49, 0xea, 0x38, 0x8f, 0x04, 0x0c, 0xe5, 0xfc, 0xc9,
+    0x45, 0xe3, 0xd8, 0x12, 0x99, 0x7e, 0xd8, 0x04, 0x39, 0xc4, 0xe7, 0x34, 0x9b, 0x42, 0x84, 0x11,
+    0x1a, 0xb8, 0x48, 0x50, 0x35, 0x17, 0xd9, 0xc8, 0x8a, 0xe6, 0x54, 0x21, 0x9e, 0x43, 0x74, 0x1f,
+    0xb0, 0x4a, 0x7d, 0x18, 0x6d, 0x8e, 0xef, 0xfb, 0xc4, 0xed, 0xa1, 0x94, 0xad, 0x85, 0xb8, 0xaa,
+    0x85, 0xa3, 0x56, 0x7f, 0x00, 0xf6, 0xb4, 0x99, 0x08, 0x85, 0xd4, 0x3b, 0x83, 0x9c, 0x6b, 0xf5,
+    0x37, 0x63, 0x14, 0x8e, 0xb4, 0xd4, 0x33, 0x8b, 0x57, 0xab, 0xb6, 0xce, 0x99, 0x54, 0x22, 0xff,
+    0x4a, 0xef, 0xf5, 0x64, 0xd1, 0x69, 0xce, 0xf9, 0xa8, 0x15, 0xfa, 0x4c, 0x61, 0xb0, 0xde, 0x01,
+    0x2b, 0xa7, 0x85, 0x0d, 0xd9, 0xe4, 0x6a, 0xd1, 0x43, 0xd5, 0x81, 0x3c, 0x6d, 0x2a, 0xab, 0xd0,
+    0x85, 0x55, 0xc1, 0x87, 0x74, 0x5d, 0x18, 0x7d, 0xe4, 0xdc, 0x42, 0x44, 0x61, 0x8b, 0x93, 0x86,
+    0xea, 0xa2, 0x2e, 0x8c, 0x65, 0x91, 0x78, 0xc8, 0x59, 0x98, 0x4c, 0xb8, 0xda, 0xc4, 0x32, 0x2b,
+    0x2e, 0x58, 0x76, 0x9a, 0x98, 0x30, 0x70, 0xe1, 0xff, 0x69, 0xbb, 0xed, 0x0a, 0xbd, 0x33, 0xd1,
+    0xea, 0xaf, 0xd0, 0x43, 0xee, 0x14, 0x55, 0x0f, 0x1c, 0xb9, 0x68, 0x68, 0x84, 0xb3, 0xbc, 0x6c,
+    0x08, 0xed, 0x46, 0x5e, 0xdd, 0xd1, 0x77, 0xb2, 0x6d, 0xcb, 0xdf, 0xae, 0xd6, 0x6b, 0x4b, 0x63,
+    0x15, 0x73, 0x99, 0x3a, 0x50, 0x88, 0xa5, 0xad, 0xb9, 0x88, 0x6f, 0xb6, 0x4b, 0x8b, 0xfd, 0xad,
+    0xca, 0x8c, 0xd1, 0xad, 0x0b, 0x60, 0x99, 0xb2, 0x89, 0x72, 0x0e, 0x3b, 0xd6, 0x35, 0x4a, 0xe5,
+    0xc8, 0x4e, 0x06, 0xce, 0x21, 0xd3, 0xed, 0x66, 0xe3, 0xa2, 0x1d, 0x52, 0xe9, 0x82, 0x32, 0xf4,
+    0x65, 0x2e, 0xad, 0x41, 0x53, 0x09, 0x27, 0x98, 0xd1, 0x17, 0x74, 0x51, 0x42, 0x6b, 0xdf, 0xe7,
+    0x73, 0x91, 0x50, 0xa7, 0xdb, 0xc7, 0x05, 0x83, 0x6f, 0x9d, 0xa0, 0x78, 0xf6, 0x4e, 0x8f, 0xed,
+    0x71, 0x17, 0xbd, 0x69, 0x9f, 0x5a, 0x1a, 0xd1, 0x75, 0xfd, 0x12, 0xf3, 0x39, 0xb5, 0xba, 0xf0,
+    0xe1, 0x82, 0x63, 0xec, 0xdf, 0x30, 0x09, 0x97, 0x44, 0x2a, 0x9c, 0xae, 0xc4, 0xb3, 0x82, 0xd3,
+    0x6e, 0x0f, 0xd1, 0xf6, 0x12, 0xad, 0x6b, 0x4c, 0x13, 0xfc, 0xf3, 0xfe, 0xe3, 0xad, 0x5f, 0xe8,
+    0xfb, 0xa8, 0x43, 0x7d, 0x82, 0x15, 0x6e, 0x39, 0x60, 0x93, 0x7b, 0x33, 0x4b, 0xa4, 0xcf, 0x0e,
+    0x61, 0xea, 0x01, 0x23, 0xfd, 0xb2, 0xad, 0x8f, 0xda, 0x62, 0x65, 0x10, 0xa8, 0x9e, 0xbd, 0xe7,
+    0xf5, 0x75, 0x17, 0xb8, 0x81, 0x27, 0x5f, 0xe5, 0x97, 0xac, 0xa2, 0xc4, 0x09, 0x7f, 0xd4, 0x5c,
+    0x69, 0x31, 0x57, 0xae, 0xcd, 0x0d, 0x7e, 0xd4, 0x5c, 0x61, 0x31, 0x57, 0xac, 0xcd, 0x05, 0xff,
+    0xa3, 0xe8, 0xdb, 0x0f, 0x0c, 0x6e, 0x29, 0x73, 0x79, 0xf8, 0xc0, 0x5a, 0x79, 0xc1, 0x85, 0x61,
+    0x8f, 0xd9, 0xfe, 0x99, 0xfa, 0x00, 0xa3, 0xa6, 0xac, 0x7f, 0xbc, 0x39, 0xa9, 0x82, 0x99, 0x57,
+    0xd7, 0x6d, 0x0a, 0x9c, 0x73, 0xb1, 0xd0, 0x0e, 0x53, 0x9a, 0x39, 0x42, 0xf3, 0x15, 0xfe, 0x3f,
+    0x32, 0xcf, 0x1c, 0x77, 0x29, 0x4b, 0xed, 0x31, 0xa4, 0x7e, 0x5d, 0x96, 0x72, 0x3d, 0x45, 0xa5,
+    0x01, 0xee, 0xd6, 0xd5, 0x5e, 0x0d, 0xed, 0xd3, 0x73, 0xfd, 0x04, 0x6b, 0x4a, 0x4e, 0x3d, 0x82,
+    0xe1, 0x7d, 0xc2, 0x32, 0xcc, 0xf9, 0xc2, 0x59, 0x76, 0xec, 0xee, 0x77, 0xfb, 0x7b, 0xdd, 0x95,
+    0x67, 0x70, 0x39, 0xc8, 0xa6, 0xf5, 0x27, 0xc2, 0x58, 0xd8, 0xf6, 0x08, 0x3f, 0xd5, 0xae, 0x21,
+    0xb5, 0x02, 0xba, 0xd0, 0xd1, 0x9f, 0xfe, 0x1e, 0x1a, 0x9c, 0x36, 0x0f, 0x1c, 0x6e, 0x46, 0x8d,
+    0x6b, 0x0d, 0xdc, 0xdd, 0xcc, 0x8d, 0x15, 0xae, 0xa4, 0xe6, 0x57, 0xe0, 0x7f, 0x3e, 0xca, 0xdd,
+    0x95, 0x1d, 0x0e, 0x00, 0x00,
+};
+const size_t DASHBOARD_PAGE_LEN = sizeof(DASHBOARD_PAGE);
+const char DASHBOARD_PAGE_ETAG[] = "\"0fb2af95d1f9c203\"";
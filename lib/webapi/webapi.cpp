@@ -0,0 +1,448 @@
+#include "webapi.h"
+#include "dashboard.h"
+#include "device.h"
+#include "motor.h"
+#include "timebase.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include "identity.h"
+#include "cbor.h"
+#include "msgpack.h"
+#include "series.h"
+#include "sweep.h"
+#include <ArduinoJson.h>
+#include <stdarg.h>
+
+// Print adapter that forwards output as HTTP chunks through a small buffer
+class ChunkWriter : public Print {
+
+    public:
+
+        ChunkWriter(WebServer & server) : _server(server) {}
+        ~ChunkWriter() { flush(); }
+
+        size_t write(uint8_t c) override {
+            _buf[_len++] = c;
+            if (_len == sizeof(_buf)) flush();
+            return 1;
+        }
+
+        void flush() {
+            if (_len) _server.sendContent((const char *) _buf, _len);
+            _len = 0;
+        }
+
+    private:
+
+        WebServer & _server;
+        uint8_t _buf[256];
+        size_t _len = 0;
+
+};
+
+WebApi::WebApi() {}
+
+WebApi webapi;
+
+
+void WebApi::setup() {
+
+    if (_started) return;
+
+    const char * headers[] = {"If-None-Match"};
+    _server.collectHeaders(headers, 1);
+
+    _server.on("/", HTTP_GET, [this]() { _handle_dashboard(); });
+    _server.on("/api/status", HTTP_GET, [this]() { _handle_status(); });
+    _server.on("/api/config", [this]() { _handle_config(); });
+    _server.on("/api/history", HTTP_GET, [this]() { _handle_history(); });
+    _server.on("/api/series", HTTP_GET, [this]() { _handle_series(); });
+    _server.on("/api/sweep.csv", HTTP_GET, [this]() { _handle_sweep(); });
+    _server.on("/api/stream", HTTP_GET, [this]() { _handle_stream(); });
+    _server.on("/metrics", HTTP_GET, [this]() { _handle_metrics(); });
+    _server.onNotFound([this]() { _server.send(404, "text/plain", "not found"); });
+
+    for (int i = 0; i < WEBAPI_MAX_STREAMS; i++) _streams[i].active = false;
+
+    _server.begin();
+    _started = true;
+    Serial.printf("\tWeb API started on port %d\n", WEBAPI_PORT);
+}
+
+
+// One pass: at most one HTTP request, then top up each live stream
+void WebApi::loop() {
+    if (!_started) return;
+    _server.handleClient();
+    for (int i = 0; i < WEBAPI_MAX_STREAMS; i++) {
+        if (_streams[i].active) _service_stream(_streams[i]);
+    }
+}
+
+
+void WebApi::_handle_dashboard() {
+    if (_server.header("If-None-Match") == DASHBOARD_PAGE_ETAG) {
+        _server.send(304);
+        return;
+    }
+    _server.sendHeader("Content-Encoding", "gzip");
+    _server.sendHeader("Cache-Control", "no-cache");
+    _server.sendHeader("ETag", DASHBOARD_PAGE_ETAG);
+    _server.send_P(200, "text/html", (const char *) DASHBOARD_PAGE, DASHBOARD_PAGE_LEN);
+}
+
+
+void WebApi::_handle_status() {
+    JsonDocument doc;
+    doc["id"] = identity.id();
+    doc["resistance"] = device.GetResistance();
+    doc["current"] = device.GetAmps();
+    doc["busvoltage"] = device.GetBusVoltage();
+    doc["shuntvoltage"] = device.GetShuntVoltage();
+    doc["loadvoltage"] = device.GetLoadVoltage();
+    doc["power_mW"] = device.GetPower();
+    doc["total_mAh"] = device.GetTotalmAH();
+    doc["reversecount"] = device.GetReverseCount();
+    doc["direction"] = device.motor && device.motor->isForward() ? "forward" : "reverse";
+    doc["speed"] = device.motor ? device.motor->getSpeed() : 0;
+    doc["down"] = device.IsDown() ? "offline" : "online";
+    doc["rssi"] = WiFi.RSSI();
+    doc["uptime"] = timebase.uptime();
+    if (timebase.is_synced()) doc["ts"] = timebase.epoch_ms();
+    doc["heap"] = ESP.getFreeHeap();
+
+    char out[384];
+    serializeJson(doc, out, sizeof(out));
+    _server.send(200, "application/json", out);
+}
+
+
+// GET returns the tunables; sample_time (s) and reverse_ratio can be set as args
+void WebApi::_handle_config() {
+
+    if (_server.hasArg("sample_time")) {
+        long seconds = _server.arg("sample_time").toInt();
+        if (seconds < 5 || seconds > 3600) {
+            _server.send(400, "application/json", "{\"error\":\"sample_time must be 5-3600\"}");
+            return;
+        }
+        device._SampleTime = seconds * 1000UL;
+    }
+    if (_server.hasArg("reverse_ratio")) {
+        float ratio = _server.arg("reverse_ratio").toFloat();
+        if (ratio <= 0.0 || ratio > 1.0) {
+            _server.send(400, "application/json", "{\"error\":\"reverse_ratio must be 0-1\"}");
+            return;
+        }
+        device.SetReverseRatio(ratio);
+    }
+
+    char out[160];
+    snprintf(out, sizeof(out),
+        "{\"sample_time\":%lu,\"reverse_ratio\":%.3f,\"power_sample_ms\":%d,\"max_stream_hz\":%d}",
+        device._SampleTime / 1000, device.GetReverseRatio(), POWER_SAMPLE_INTERVAL, WEBAPI_MAX_RATE);
+    _server.send(200, "application/json", out);
+}
+
+
+// Recent high-rate samples, streamed in chunks so the ring is never copied whole.
+// ?format=cbor or ?format=msgpack selects a binary body, marked by Content-Type
+void WebApi::_handle_history() {
+
+    uint32_t newest = device.SampleSeq();
+    uint32_t count = _server.hasArg("n") ? _server.arg("n").toInt() : WEBAPI_HISTORY_MAX;
+    if (count > WEBAPI_HISTORY_MAX) count = WEBAPI_HISTORY_MAX;
+    if (count > newest) count = newest;
+
+    TelemetryEncoding encoding = TELEMETRY_JSON;
+    if (_server.hasArg("format") && !Telemetry::parse(_server.arg("format").c_str(), encoding)) {
+        _server.send(400, "application/json", "{\"error\":\"format must be json, cbor or msgpack\"}");
+        return;
+    }
+    if (encoding == TELEMETRY_CBOR) {
+        _send_history<CborWriter>(newest, count, encoding);
+        return;
+    }
+    if (encoding == TELEMETRY_MSGPACK) {
+        _send_history<MsgPackWriter>(newest, count, encoding);
+        return;
+    }
+
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, "application/json", "");
+    // "t" is epoch ms once SNTP has synced (older samples are mapped too), ms since boot before
+    _server.sendContent(String("{\"interval_ms\":") + POWER_SAMPLE_INTERVAL +
+                        ",\"clock\":\"" + (timebase.is_synced() ? "epoch" : "uptime") + "\",\"samples\":[");
+
+    char chunk[512];
+    size_t len = 0;
+    bool first = true;
+    for (uint32_t seq = newest - count; seq < newest; seq++) {
+        PowerSample s;
+        if (!device.GetSample(seq, s)) continue;
+        len += snprintf(chunk + len, sizeof(chunk) - len, "%s{\"t\":%llu,\"i\":%.2f,\"v\":%.3f,\"p\":%.1f}",
+            first ? "" : ",", _timestamp(s.us), s.current_mA, s.busvoltage, s.power_mW);
+        first = false;
+        if (len > sizeof(chunk) - 80) {
+            _server.sendContent(chunk, len);
+            len = 0;
+        }
+    }
+    if (len) _server.sendContent(chunk, len);
+    _server.sendContent("]}");
+    _server.sendContent("");
+}
+
+
+// The JSON history layout in CBOR or MessagePack. The sample count goes out
+// up front, so a sample the ring overwrites mid-stream is sent as null
+template <class Writer>
+void WebApi::_send_history(uint32_t newest, uint32_t count, TelemetryEncoding encoding) {
+
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, Telemetry::content_type(encoding), "");
+
+    uint8_t chunk[512];
+    Writer head(chunk, sizeof(chunk));
+    head.map(3);
+    head.key("interval_ms");
+    head.uinteger(POWER_SAMPLE_INTERVAL);
+    head.key("clock");
+    head.text(timebase.is_synced() ? "epoch" : "uptime");
+    head.key("samples");
+    head.array(count);
+    size_t len = head.length();
+
+    for (uint32_t seq = newest - count; seq < newest; seq++) {
+        Writer out(chunk + len, sizeof(chunk) - len);
+        PowerSample s;
+        if (device.GetSample(seq, s)) {
+            out.map(4);
+            out.key("t");
+            out.uinteger(_timestamp(s.us));
+            out.key("i");
+            out.number(s.current_mA);
+            out.key("v");
+            out.number(s.busvoltage);
+            out.key("p");
+            out.number(s.power_mW);
+        } else {
+            out.null();
+        }
+        len += out.length();
+        if (len > sizeof(chunk) - 64) {
+            _server.sendContent((const char *) chunk, len);
+            len = 0;
+        }
+    }
+    if (len) _server.sendContent((const char *) chunk, len);
+    _server.sendContent("");
+}
+
+
+// Stored history: ?tier=raw|minute|hour&from=&to= (epoch s, default the last
+// hour) and n points at most. Without tier, the finest tier still holding
+// from. Each point is [t, values...] in "fields" order; "next" is the t to
+// ask from for the rest, null when there is none
+void WebApi::_handle_series() {
+
+    if (!series.is_ready() || !timebase.is_synced()) {
+        _server.send(503, "application/json", "{\"error\":\"no history until the clock is set\"}");
+        return;
+    }
+    uint32_t now = timebase.epoch_ms() / 1000;
+    uint32_t to = _server.hasArg("to") ? strtoul(_server.arg("to").c_str(), nullptr, 10) : now;
+    uint32_t from = _server.hasArg("from") ? strtoul(_server.arg("from").c_str(), nullptr, 10) : to - 3600;
+    uint32_t count = _server.hasArg("n") ? _server.arg("n").toInt() : SERIES_QUERY_MAX;
+    if (!count || count > SERIES_QUERY_MAX) count = SERIES_QUERY_MAX;
+    SeriesTier tier = series.finest_tier(from);
+    if (_server.hasArg("tier") && !SeriesStore::parse_tier(_server.arg("tier").c_str(), tier)) {
+        _server.send(400, "application/json", "{\"error\":\"tier must be raw, minute or hour\"}");
+        return;
+    }
+
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, "application/json", "");
+
+    char chunk[512];
+    char field[24];
+    size_t len = snprintf(chunk, sizeof(chunk), "{\"tier\":\"%s\",\"interval\":%lu,\"fields\":[\"t\"",
+                          SeriesStore::tier_name(tier), (unsigned long) SeriesStore::interval(tier));
+    for (int i = 0; i < SeriesStore::values(tier); i++)
+        len += snprintf(chunk + len, sizeof(chunk) - len, ",\"%s\"", SeriesStore::value_name(tier, i, field, sizeof(field)));
+    len += snprintf(chunk + len, sizeof(chunk) - len, "],\"points\":[");
+
+    SeriesCursor cursor(series, tier, from, to);
+    SeriesPoint point;
+    bool more = false;
+    for (uint32_t sent = 0; (more = cursor.next(point)) && sent < count; sent++) {
+        len += snprintf(chunk + len, sizeof(chunk) - len, "%s[%lu", sent ? "," : "", (unsigned long) point.t);
+        for (int i = 0; i < point.count; i++)
+            len += snprintf(chunk + len, sizeof(chunk) - len, ",%.6g", point.v[i]);
+        len += snprintf(chunk + len, sizeof(chunk) - len, "]");
+        if (len > sizeof(chunk) - 128) {
+            _server.sendContent(chunk, len);
+            len = 0;
+        }
+    }
+    if (more) len += snprintf(chunk + len, sizeof(chunk) - len, "],\"next\":%lu}", (unsigned long) point.t);
+    else len += snprintf(chunk + len, sizeof(chunk) - len, "],\"next\":null}");
+    _server.sendContent(chunk, len);
+    _server.sendContent("");
+}
+
+
+// The characterization table (see Sweep), for a spreadsheet
+void WebApi::_handle_sweep() {
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.sendHeader("Content-Disposition", "attachment; filename=\"sweep.csv\"");
+    _server.send(200, "text/csv", "");
+    {
+        ChunkWriter writer(_server);
+        sweep.write_csv(writer);
+    }
+    _server.sendContent("");
+}
+
+
+// OpenMetrics scrape - rendered straight into the response, 256 bytes at a time
+void WebApi::_handle_metrics() {
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, "application/openmetrics-text; version=1.0.0; charset=utf-8", "");
+    {
+        ChunkWriter writer(_server);
+        Metric::render_all(writer);
+    }
+    _server.sendContent("");
+}
+
+
+// Hands the socket over to a stream slot; the server moves on to other requests
+void WebApi::_handle_stream() {
+
+    Stream * slot = nullptr;
+    for (int i = 0; i < WEBAPI_MAX_STREAMS; i++) {
+        if (!_streams[i].active) {
+            slot = &_streams[i];
+            break;
+        }
+    }
+    if (!slot) {
+        _server.send(503, "text/plain", "too many streams");
+        return;
+    }
+
+    int rate = _server.hasArg("rate") ? _server.arg("rate").toInt() : WEBAPI_DEFAULT_RATE;
+    rate = constrain(rate, 1, WEBAPI_MAX_RATE);
+
+    slot->client = _server.client();
+    slot->client.setNoDelay(true);
+    slot->active = true;
+    slot->cursor = device.SampleSeq();
+    slot->interval_ms = 1000 / rate;
+    slot->last_sent = 0;
+    slot->last_status = 0;
+    slot->dropped = 0;
+    slot->stalled_since = 0;
+    slot->len = 0;
+
+    // Goes out through the buffer like everything else, so it can't block
+    _append(*slot, "HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/event-stream\r\n"
+                   "Cache-Control: no-cache\r\n"
+                   "Connection: keep-alive\r\n"
+                   "Access-Control-Allow-Origin: *\r\n\r\n"
+                   "retry: 2000\n\n");
+
+    Serial.printf("\tWeb API: stream opened at %d Hz\n", rate);
+}
+
+
+void WebApi::_service_stream(Stream & s) {
+
+    if (!s.client.connected()) {
+        _close(s);
+        return;
+    }
+
+    unsigned long now = millis();
+    if (now - s.last_sent < s.interval_ms) return;
+    s.last_sent = now;
+
+    // Fell behind the ring: skip to the oldest sample still held
+    uint32_t newest = device.SampleSeq();
+    if (newest - s.cursor > POWER_RING_SIZE) {
+        s.dropped += newest - s.cursor - POWER_RING_SIZE;
+        s.cursor = newest - POWER_RING_SIZE;
+    }
+
+    // Per-client rate: send only the latest sample of each interval
+    if (s.cursor != newest) {
+        PowerSample sample;
+        if (device.GetSample(newest - 1, sample)) {
+            _append(s, "event: sample\ndata: {\"t\":%llu,\"i\":%.2f,\"v\":%.3f,\"p\":%.1f}\n\n",
+                _timestamp(sample.us), sample.current_mA, sample.busvoltage, sample.power_mW);
+        }
+        s.cursor = newest;
+    }
+
+    if (now - s.last_status >= WEBAPI_STATUS_INTERVAL) {
+        s.last_status = now;
+        _append(s, "event: status\ndata: {\"direction\":\"%s\",\"reversecount\":%u,\"dropped\":%lu}\n\n",
+            device.motor && device.motor->isForward() ? "forward" : "reverse",
+            device.GetReverseCount(), (unsigned long) s.dropped);
+    }
+
+    if (!_flush(s)) _close(s);
+}
+
+
+// Epoch ms once SNTP has synced, ms since boot until then
+unsigned long long WebApi::_timestamp(uint64_t monotonic_us) {
+    return timebase.is_synced() ? timebase.to_epoch_ms(monotonic_us) : monotonic_us / 1000;
+}
+
+
+// Formats into the client's buffer; a full buffer means the client is stalled
+bool WebApi::_append(Stream & s, const char * format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(s.buf + s.len, sizeof(s.buf) - s.len, format, args);
+    va_end(args);
+    if (n < 0 || s.len + n >= sizeof(s.buf)) {
+        s.dropped++;
+        return false;
+    }
+    s.len += n;
+    return true;
+}
+
+
+// Writes whatever the socket will take without waiting (WiFiClient::write
+// selects and retries, and can block the loop for seconds on a stalled
+// socket). A client whose socket takes nothing for WEBAPI_STALL_TIMEOUT, or
+// errors, is dropped so it can't hold up the others or the cell
+bool WebApi::_flush(Stream & s) {
+    if (s.len == 0) {
+        s.stalled_since = 0;
+        return true;
+    }
+    int sent = send(s.client.fd(), s.buf, s.len, MSG_DONTWAIT);
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+    if (sent <= 0) {
+        if (s.stalled_since == 0) s.stalled_since = millis();
+        return millis() - s.stalled_since <= WEBAPI_STALL_TIMEOUT;
+    }
+    memmove(s.buf, s.buf + sent, s.len - sent);
+    s.len -= sent;
+    s.stalled_since = 0;
+    return true;
+}
+
+
+void WebApi::_close(Stream & s) {
+    s.client.stop();
+    s.active = false;
+    s.len = 0;
+    Serial.println("\tWeb API: stream closed");
+}
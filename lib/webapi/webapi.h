@@ -0,0 +1,66 @@
+#pragma once
+
+#include <WiFi.h>
+#include <WebServer.h>
+#include "telemetry.h"
+
+#define WEBAPI_PORT 8080              // the provisioner's captive portal has 80
+#define WEBAPI_MAX_STREAMS 3          // concurrent SSE clients
+#define WEBAPI_MAX_RATE 10            // Hz, capped by POWER_SAMPLE_INTERVAL anyway
+#define WEBAPI_DEFAULT_RATE 5         // Hz
+#define WEBAPI_STREAM_BUFFER 512      // per-client output buffer
+#define WEBAPI_STATUS_INTERVAL 5000   // status event period on the stream
+#define WEBAPI_STALL_TIMEOUT 5000     // drop a stream whose socket takes nothing this long
+#define WEBAPI_HISTORY_MAX 256        // samples returned by /api/history
+
+// Local HTTP API and live dashboard on its own WebServer, on WEBAPI_PORT so
+// it never contends with the provisioner's portal. Live samples go out as
+// Server-Sent Events to a small fixed pool of clients, each rate-limited and
+// with a bounded buffer
+class WebApi {
+
+    public:
+
+        WebApi();
+
+        void setup();
+        void loop();
+
+    private:
+
+        struct Stream {
+            WiFiClient client;
+            bool active;
+            uint32_t cursor;          // next sample sequence number to send
+            uint16_t interval_ms;
+            unsigned long last_sent;
+            unsigned long last_status;
+            uint32_t dropped;         // samples skipped because the client fell behind
+            unsigned long stalled_since;  // 0 while the socket is taking data
+            char buf[WEBAPI_STREAM_BUFFER];
+            size_t len;
+        };
+
+        WebServer _server{WEBAPI_PORT};
+        Stream _streams[WEBAPI_MAX_STREAMS];
+        bool _started = false;
+
+        void _handle_status();
+        void _handle_config();
+        void _handle_history();
+        template <class Writer> void _send_history(uint32_t newest, uint32_t count, TelemetryEncoding);
+        void _handle_series();
+        void _handle_sweep();
+        void _handle_stream();
+        void _handle_dashboard();
+        void _handle_metrics();
+
+        void _service_stream(Stream &);
+        bool _append(Stream &, const char *, ...);
+        bool _flush(Stream &);
+        static unsigned long long _timestamp(uint64_t monotonic_us);
+        void _close(Stream &);
+
+};
+
+extern WebApi webapi;
@@ -0,0 +1,232 @@
+#include "link_monitor.h"
+#include "wifi_tools.h"
+#include "timebase.h"
+#include "telemetry.h"
+#include "topics.h"
+#include "identity.h"
+
+// Allowed TX power steps in 0.25 dBm units (8.5 dBm .. 19.5 dBm)
+const int8_t LinkMonitor::_tx_levels[] = {
+	WIFI_POWER_8_5dBm, WIFI_POWER_11dBm, WIFI_POWER_13dBm, WIFI_POWER_15dBm,
+	WIFI_POWER_17dBm, WIFI_POWER_18_5dBm, WIFI_POWER_19dBm, WIFI_POWER_19_5dBm
+};
+#define TX_LEVEL_COUNT (int)(sizeof(LinkMonitor::_tx_levels) / sizeof(LinkMonitor::_tx_levels[0]))
+
+LinkMonitor::LinkMonitor() : _tx_index(TX_LEVEL_COUNT - 1) {}
+
+LinkMonitor link_monitor;
+
+
+void LinkMonitor::add_candidate(const char * ssid, const char * pass, const uint8_t * bssid) {
+	if (_candidate_count >= LINK_MAX_CANDIDATES) return;
+	Candidate & c = _candidates[_candidate_count++];
+	strncpy(c.ssid, ssid, sizeof(c.ssid) - 1);
+	c.ssid[sizeof(c.ssid) - 1] = '\0';
+	strncpy(c.pass, pass, sizeof(c.pass) - 1);
+	c.pass[sizeof(c.pass) - 1] = '\0';
+	c.has_bssid = bssid != nullptr;
+	if (bssid) memcpy(c.bssid, bssid, sizeof(c.bssid));
+}
+
+
+// Called from the main loop every pass; the rest waits for a connection
+void LinkMonitor::loop() {
+
+	if (__atomic_exchange_n(&_disconnect_pending, false, __ATOMIC_ACQ_REL)) _handle_disconnect();
+	if (!wifi_tools.is_connected) return;
+
+	unsigned long now = millis();
+
+	if (now - _sample_timer >= LINK_SAMPLE_INTERVAL) {
+		_sample_timer = now;
+		_sample();
+	}
+
+	if (_scanning) {
+		_finish_scan();
+	} else if (now - _tx_timer >= LINK_TX_ADJUST_INTERVAL) {
+		_tx_timer = now;
+		_adjust_tx_power();
+		_check_roam();
+	}
+
+	if (now - _publish_timer >= LINK_PUBLISH_INTERVAL) {
+		_publish_timer = identity.slot_start(now, LINK_PUBLISH_INTERVAL);
+		publish();
+	}
+
+	if (now - _window_start >= LINK_RATE_WINDOW) _roll_window();
+}
+
+
+void LinkMonitor::_sample() {
+	int rssi = WiFi.RSSI();
+	if (rssi == 0) return;  // not associated
+
+	if (!_rssi_seeded) {
+		_rssi_avg = rssi;
+		_rssi_seeded = true;
+	} else {
+		_rssi_avg += LINK_RSSI_ALPHA * (rssi - _rssi_avg);
+	}
+	if (rssi < _rssi_min) _rssi_min = rssi;
+	if (rssi > _rssi_max) _rssi_max = rssi;
+}
+
+
+// Events from WiFi_Tools. The disconnect comes from the WiFi event task, so
+// it only counts and flags; loop() does the rest on the main task
+void LinkMonitor::on_disconnect() {
+	__atomic_fetch_add(&_disconnects, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&_disconnect_pending, true, __ATOMIC_RELEASE);
+}
+
+void LinkMonitor::_handle_disconnect() {
+	_disconnect_since_adjust = true;
+	_rssi_seeded = false;  // the next AP may be a different one
+	if (_tx_index != TX_LEVEL_COUNT - 1) {
+		_tx_index = TX_LEVEL_COUNT - 1;  // reconnect at full power
+		_apply_tx_power();
+	}
+}
+
+void LinkMonitor::on_retry() {
+	_retries++;
+}
+
+
+void LinkMonitor::hold_max_power(bool hold) {
+	_hold_max = hold;
+	if (hold) _tx_index = TX_LEVEL_COUNT - 1;
+	_apply_tx_power();
+}
+
+
+// The AP hears us roughly as well as we hear it, less whatever we've backed
+// off from full power - keep that estimate the target margin above the floor
+void LinkMonitor::_adjust_tx_power() {
+
+	if (_hold_max || !_rssi_seeded) return;
+
+	float backoff = (_tx_levels[TX_LEVEL_COUNT - 1] - _tx_levels[_tx_index]) / 4.0;
+	float margin = _rssi_avg - backoff - LINK_RSSI_FLOOR;
+	int index = _tx_index;
+
+	if (_disconnect_since_adjust) {
+		index = TX_LEVEL_COUNT - 1;  // lost the link since the last step - stay at full power
+	} else if (margin < LINK_TARGET_MARGIN) {
+		index++;
+	} else if (margin > LINK_TARGET_MARGIN + 4) {
+		index--;
+	}
+	_disconnect_since_adjust = false;
+
+	index = constrain(index, 0, TX_LEVEL_COUNT - 1);
+	if (index != _tx_index) {
+		_tx_index = index;
+		_apply_tx_power();
+	}
+}
+
+void LinkMonitor::_apply_tx_power() {
+	WiFi.setTxPower((wifi_power_t) _tx_levels[_tx_index]);
+}
+
+
+// Weak signal - scan in the background for another AP (same SSID on a mesh
+// or extender, or one of the alternates) that is clearly stronger
+void LinkMonitor::_check_roam() {
+
+	if (_candidate_count == 0) return;
+	if (!_rssi_seeded || _rssi_avg > ROAM_THRESHOLD) return;
+	if (millis() - _scan_timer < ROAM_SCAN_INTERVAL && _scan_timer != 0) return;
+
+	_scan_timer = millis();
+	if (WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING) _scanning = true;
+}
+
+void LinkMonitor::_finish_scan() {
+
+	int count = WiFi.scanComplete();
+	if (count == WIFI_SCAN_RUNNING) return;
+	_scanning = false;
+	if (count < 0) return;
+
+	int best = -1;
+	int best_rssi = (int) _rssi_avg + ROAM_HYSTERESIS;
+	const uint8_t * current = WiFi.BSSID();
+
+	for (int i = 0; i < count; i++) {
+		if (current && memcmp(WiFi.BSSID(i), current, 6) == 0) continue;
+		for (int c = 0; c < _candidate_count; c++) {
+			if (WiFi.SSID(i) != _candidates[c].ssid) continue;
+			if (_candidates[c].has_bssid && memcmp(WiFi.BSSID(i), _candidates[c].bssid, 6) != 0) continue;
+			if (WiFi.RSSI(i) > best_rssi) {
+				best = i;
+				best_rssi = WiFi.RSSI(i);
+			}
+		}
+	}
+
+	if (best >= 0) {
+		uint8_t bssid[6];
+		memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+		uint8_t channel = WiFi.channel(best);
+		String ssid = WiFi.SSID(best);
+		for (int c = 0; c < _candidate_count; c++) {
+			if (ssid == _candidates[c].ssid) {
+				_roams++;
+				WiFi.scanDelete();
+				wifi_tools.roam_to(_candidates[c].ssid, _candidates[c].pass, channel, bssid);
+				return;
+			}
+		}
+	}
+	WiFi.scanDelete();
+}
+
+
+void LinkMonitor::_roll_window() {
+	_window_start = millis();
+	_window_rolled = true;
+	_last_disconnects = __atomic_exchange_n(&_disconnects, 0, __ATOMIC_RELAXED);
+	_last_retries = _retries;
+	_retries = 0;
+	_rssi_min = 0;
+	_rssi_max = -127;
+}
+
+
+void LinkMonitor::publish() {
+
+	unsigned long now = millis();
+	float span_ms = (now - _window_start) + (_window_rolled ? LINK_RATE_WINDOW : 0);
+	if (span_ms < LINK_PUBLISH_INTERVAL) span_ms = LINK_PUBLISH_INTERVAL;
+	float span_h = span_ms / 3600000.0;
+	float elapsed_s = (now - _last_publish_ms) / 1000.0;
+	uint32_t tx = __atomic_load_n(&_tx_bytes, __ATOMIC_RELAXED);
+	float tx_bps = elapsed_s > 0 ? (tx - _last_tx_bytes) / elapsed_s : 0;
+	_last_tx_bytes = tx;
+	_last_publish_ms = now;
+
+	const uint8_t * b = WiFi.BSSID();
+	char bssid[18] = "";
+	if (b) snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X", b[0], b[1], b[2], b[3], b[4], b[5]);
+
+	JsonDocument doc;
+	doc["rssi"] = WiFi.RSSI();
+	doc["rssi_avg"] = _rssi_avg;
+	doc["rssi_min"] = _rssi_min;
+	doc["rssi_max"] = _rssi_max;
+	doc["disc_per_h"] = (__atomic_load_n(&_disconnects, __ATOMIC_RELAXED) + _last_disconnects) / span_h;
+	doc["retry_per_h"] = (_retries + _last_retries) / span_h;
+	doc["tx_Bps"] = tx_bps;
+	doc["tx_dbm"] = _tx_levels[_tx_index] / 4.0f;
+	doc["ssid"] = wifi_tools.ssid();
+	doc["bssid"] = bssid;
+	doc["channel"] = WiFi.channel();
+	doc["roams"] = _roams;
+	doc["ts"] = timebase.epoch_ms();
+
+	telemetry.publish(TOPIC_DIAG_LINK, doc);
+}
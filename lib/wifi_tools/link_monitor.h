@@ -0,0 +1,90 @@
+#pragma once
+
+#include <WiFi.h>
+
+#define LINK_SAMPLE_INTERVAL 1000       // RSSI sample period
+#define LINK_PUBLISH_INTERVAL 60000     // stats on filterchlorine/<id>/diag/link
+#define LINK_RATE_WINDOW 3600000        // disconnect/retry rates are per hour
+#define LINK_RSSI_ALPHA 0.1             // EMA weight of each new RSSI sample
+#define LINK_RSSI_FLOOR -82             // roughly where the link stops holding
+#define LINK_TARGET_MARGIN 10           // dB above the floor we want to keep
+#define LINK_TX_ADJUST_INTERVAL 30000   // settle time between TX power steps
+#define ROAM_THRESHOLD -72              // start looking for a better AP below this
+#define ROAM_HYSTERESIS 8               // candidate must beat the current AP by this much
+#define ROAM_SCAN_INTERVAL 120000       // minimum time between roam scans
+#define LINK_MAX_CANDIDATES 4
+
+// Tracks link quality, roams to the strongest configured AP before the link
+// fails and trims TX power to the minimum that keeps the target margin
+class LinkMonitor {
+
+    public:
+
+        LinkMonitor();
+
+        void add_candidate(const char *, const char *, const uint8_t * bssid = nullptr);
+        void loop();
+        void publish();
+
+        void on_disconnect();   // WiFi event task - only flags it for loop()
+        void on_retry();
+        void count_tx(size_t bytes) { __atomic_fetch_add(&_tx_bytes, (uint32_t) bytes, __ATOMIC_RELAXED); }
+        void hold_max_power(bool);
+
+        float rssi() { return _rssi_avg; }
+        int tx_power_dbm() { return _tx_levels[_tx_index] / 4; }
+
+    private:
+
+        struct Candidate {
+            char ssid[33];
+            char pass[64];
+            uint8_t bssid[6];
+            bool has_bssid;
+        };
+
+        Candidate _candidates[LINK_MAX_CANDIDATES];
+        int _candidate_count = 0;
+
+        // smoothed RSSI
+        float _rssi_avg = 0;
+        int _rssi_min = 0;
+        int _rssi_max = -127;
+        bool _rssi_seeded = false;
+
+        // rates over the current window
+        unsigned long _window_start = 0;
+        bool _window_rolled = false;
+        uint32_t _disconnects = 0;          // atomic, bumped from the event task
+        unsigned int _retries = 0;
+        unsigned int _last_disconnects = 0;
+        unsigned int _last_retries = 0;
+        uint32_t _tx_bytes = 0;             // atomic, counted from any publishing task
+        bool _disconnect_pending = false;   // atomic, set by on_disconnect()
+        uint32_t _last_tx_bytes = 0;
+        unsigned int _roams = 0;
+
+        // adaptive TX power, in the driver's 0.25 dBm units
+        static const int8_t _tx_levels[];
+        int _tx_index;
+        bool _hold_max = false;
+        bool _disconnect_since_adjust = false;
+
+        unsigned long _sample_timer = 0;
+        unsigned long _publish_timer = 0;
+        unsigned long _tx_timer = 0;
+        unsigned long _scan_timer = 0;
+        unsigned long _last_publish_ms = 0;
+        bool _scanning = false;
+
+        void _sample();
+        void _handle_disconnect();
+        void _adjust_tx_power();
+        void _apply_tx_power();
+        void _check_roam();
+        void _finish_scan();
+        void _roll_window();
+
+};
+
+extern LinkMonitor link_monitor;
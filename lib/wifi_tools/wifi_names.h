@@ -0,0 +1,104 @@
+#pragma once
+
+#include <WiFi.h>
+
+// Names for the WIFI_REASON_* disconnect codes and the WiFi events this
+// firmware sees (reference/reasons.txt, reference/events.txt). Keyed by the
+// enum values themselves, so the codes can never drift from their names,
+// and resolved at compile time where the code is a constant.
+
+struct WiFiName {
+	int code;
+	const char * name;
+};
+
+constexpr WiFiName WIFI_REASON_NAMES[] = {
+	{WIFI_REASON_UNSPECIFIED,                        "UNSPECIFIED"},
+	{WIFI_REASON_AUTH_EXPIRE,                        "AUTH_EXPIRE"},
+	{WIFI_REASON_AUTH_LEAVE,                         "AUTH_LEAVE"},
+	{WIFI_REASON_ASSOC_EXPIRE,                       "ASSOC_EXPIRE"},
+	{WIFI_REASON_ASSOC_TOOMANY,                      "ASSOC_TOOMANY"},
+	{WIFI_REASON_NOT_AUTHED,                         "NOT_AUTHED"},
+	{WIFI_REASON_NOT_ASSOCED,                        "NOT_ASSOCED"},
+	{WIFI_REASON_ASSOC_LEAVE,                        "ASSOC_LEAVE"},
+	{WIFI_REASON_ASSOC_NOT_AUTHED,                   "ASSOC_NOT_AUTHED"},
+	{WIFI_REASON_DISASSOC_PWRCAP_BAD,                "DISASSOC_PWRCAP_BAD"},
+	{WIFI_REASON_DISASSOC_SUPCHAN_BAD,               "DISASSOC_SUPCHAN_BAD"},
+	{WIFI_REASON_BSS_TRANSITION_DISASSOC,            "BSS_TRANSITION_DISASSOC"},
+	{WIFI_REASON_IE_INVALID,                         "IE_INVALID"},
+	{WIFI_REASON_MIC_FAILURE,                        "MIC_FAILURE"},
+	{WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT,             "4WAY_HANDSHAKE_TIMEOUT"},
+	{WIFI_REASON_GROUP_KEY_UPDATE_TIMEOUT,           "GROUP_KEY_UPDATE_TIMEOUT"},
+	{WIFI_REASON_IE_IN_4WAY_DIFFERS,                 "IE_IN_4WAY_DIFFERS"},
+	{WIFI_REASON_GROUP_CIPHER_INVALID,               "GROUP_CIPHER_INVALID"},
+	{WIFI_REASON_PAIRWISE_CIPHER_INVALID,            "PAIRWISE_CIPHER_INVALID"},
+	{WIFI_REASON_AKMP_INVALID,                       "AKMP_INVALID"},
+	{WIFI_REASON_UNSUPP_RSN_IE_VERSION,              "UNSUPP_RSN_IE_VERSION"},
+	{WIFI_REASON_INVALID_RSN_IE_CAP,                 "INVALID_RSN_IE_CAP"},
+	{WIFI_REASON_802_1X_AUTH_FAILED,                 "802_1X_AUTH_FAILED"},
+	{WIFI_REASON_CIPHER_SUITE_REJECTED,              "CIPHER_SUITE_REJECTED"},
+	{WIFI_REASON_TDLS_PEER_UNREACHABLE,              "TDLS_PEER_UNREACHABLE"},
+	{WIFI_REASON_TDLS_UNSPECIFIED,                   "TDLS_UNSPECIFIED"},
+	{WIFI_REASON_SSP_REQUESTED_DISASSOC,             "SSP_REQUESTED_DISASSOC"},
+	{WIFI_REASON_NO_SSP_ROAMING_AGREEMENT,           "NO_SSP_ROAMING_AGREEMENT"},
+	{WIFI_REASON_BAD_CIPHER_OR_AKM,                  "BAD_CIPHER_OR_AKM"},
+	{WIFI_REASON_NOT_AUTHORIZED_THIS_LOCATION,       "NOT_AUTHORIZED_THIS_LOCATION"},
+	{WIFI_REASON_SERVICE_CHANGE_PERCLUDES_TS,        "SERVICE_CHANGE_PERCLUDES_TS"},
+	{WIFI_REASON_UNSPECIFIED_QOS,                    "UNSPECIFIED_QOS"},
+	{WIFI_REASON_NOT_ENOUGH_BANDWIDTH,               "NOT_ENOUGH_BANDWIDTH"},
+	{WIFI_REASON_MISSING_ACKS,                       "MISSING_ACKS"},
+	{WIFI_REASON_EXCEEDED_TXOP,                      "EXCEEDED_TXOP"},
+	{WIFI_REASON_STA_LEAVING,                        "STA_LEAVING"},
+	{WIFI_REASON_END_BA,                             "END_BA"},
+	{WIFI_REASON_UNKNOWN_BA,                         "UNKNOWN_BA"},
+	{WIFI_REASON_TIMEOUT,                            "TIMEOUT"},
+	{WIFI_REASON_PEER_INITIATED,                     "PEER_INITIATED"},
+	{WIFI_REASON_AP_INITIATED,                       "AP_INITIATED"},
+	{WIFI_REASON_INVALID_FT_ACTION_FRAME_COUNT,      "INVALID_FT_ACTION_FRAME_COUNT"},
+	{WIFI_REASON_INVALID_PMKID,                      "INVALID_PMKID"},
+	{WIFI_REASON_INVALID_MDE,                        "INVALID_MDE"},
+	{WIFI_REASON_INVALID_FTE,                        "INVALID_FTE"},
+	{WIFI_REASON_TRANSMISSION_LINK_ESTABLISH_FAILED, "TRANSMISSION_LINK_ESTABLISH_FAILED"},
+	{WIFI_REASON_ALTERATIVE_CHANNEL_OCCUPIED,        "ALTERATIVE_CHANNEL_OCCUPIED"},
+	{WIFI_REASON_BEACON_TIMEOUT,                     "BEACON_TIMEOUT"},
+	{WIFI_REASON_NO_AP_FOUND,                        "NO_AP_FOUND"},
+	{WIFI_REASON_AUTH_FAIL,                          "AUTH_FAIL"},
+	{WIFI_REASON_ASSOC_FAIL,                         "ASSOC_FAIL"},
+	{WIFI_REASON_HANDSHAKE_TIMEOUT,                  "HANDSHAKE_TIMEOUT"},
+	{WIFI_REASON_CONNECTION_FAIL,                    "CONNECTION_FAIL"},
+	{WIFI_REASON_AP_TSF_RESET,                       "AP_TSF_RESET"},
+	{WIFI_REASON_ROAMING,                            "ROAMING"},
+	{WIFI_REASON_ASSOC_COMEBACK_TIME_TOO_LONG,       "ASSOC_COMEBACK_TIME_TOO_LONG"},
+};
+
+constexpr WiFiName WIFI_EVENT_NAMES[] = {
+	{ARDUINO_EVENT_WIFI_READY,               "WIFI_READY"},
+	{ARDUINO_EVENT_WIFI_SCAN_DONE,           "SCAN_DONE"},
+	{ARDUINO_EVENT_WIFI_STA_START,           "STA_START"},
+	{ARDUINO_EVENT_WIFI_STA_STOP,            "STA_STOP"},
+	{ARDUINO_EVENT_WIFI_STA_CONNECTED,       "STA_CONNECTED"},
+	{ARDUINO_EVENT_WIFI_STA_DISCONNECTED,    "STA_DISCONNECTED"},
+	{ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE, "STA_AUTHMODE_CHANGE"},
+	{ARDUINO_EVENT_WIFI_STA_GOT_IP,          "STA_GOT_IP"},
+	{ARDUINO_EVENT_WIFI_STA_GOT_IP6,         "STA_GOT_IP6"},
+	{ARDUINO_EVENT_WIFI_STA_LOST_IP,         "STA_LOST_IP"},
+	{ARDUINO_EVENT_WIFI_AP_START,            "AP_START"},
+	{ARDUINO_EVENT_WIFI_AP_STOP,             "AP_STOP"},
+	{ARDUINO_EVENT_WIFI_AP_STACONNECTED,     "AP_STACONNECTED"},
+	{ARDUINO_EVENT_WIFI_AP_STADISCONNECTED,  "AP_STADISCONNECTED"},
+	{ARDUINO_EVENT_WIFI_AP_STAIPASSIGNED,    "AP_STAIPASSIGNED"},
+	{ARDUINO_EVENT_WIFI_AP_PROBEREQRECVED,   "AP_PROBEREQRECVED"},
+	{ARDUINO_EVENT_WIFI_AP_GOT_IP6,          "AP_GOT_IP6"},
+};
+
+// nullptr for a code not in the table
+template <size_t N>
+constexpr const char * wifi_name(const WiFiName (&table)[N], int code, size_t i = 0) {
+	return i == N ? nullptr : table[i].code == code ? table[i].name : wifi_name(table, code, i + 1);
+}
+
+constexpr const char * wifi_reason_name(int reason) { return wifi_name(WIFI_REASON_NAMES, reason); }
+constexpr const char * wifi_event_name(int event) { return wifi_name(WIFI_EVENT_NAMES, event); }
+
+static_assert(wifi_reason_name(WIFI_REASON_BEACON_TIMEOUT) != nullptr, "reason table");
+static_assert(wifi_reason_name(0) == nullptr, "0 is not a reason");
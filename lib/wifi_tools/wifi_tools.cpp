@@ -1,37 +1,60 @@
-
 #include "wifi_tools.h"
+#include "storage.h"
+#include "link_monitor.h"
+#include "power.h"
+#include <esp_wifi.h>
 
 WiFi_Tools::WiFi_Tools() {}
 
 WiFi_Tools wifi_tools;
 
+// Survives soft resets and watchdog reboots; cleared on power loss, in which
+// case the NVS copy is used instead
+RTC_DATA_ATTR WiFiCache rtc_cache;
+
 void WiFi_Tools::begin(const char * ssid, const char * pass) {
 	// Store credentials for reconnection
 	strncpy(_ssid, ssid, sizeof(_ssid) - 1);
 	_ssid[sizeof(_ssid) - 1] = '\0';
 	strncpy(_password, pass, sizeof(_password) - 1);
 	_password[sizeof(_password) - 1] = '\0';
-	
-	WiFi.disconnect(true);
-	delay(100);
+
+	// No disconnect/delay here - the radio is already idle after reset
 	WiFi.mode(WIFI_STA);
-	
-	// Using DHCP - static IP was causing MISSING_ACKS
+
+	// Using DHCP by default - static IP was causing MISSING_ACKS
 	// Set DHCP reservation in router for consistent IP
-	
-	WiFi.setSleep(WIFI_PS_NONE);
+
+	WiFi.setSleep(power.wifi_ps());
 	WiFi.persistent(false);
 	WiFi.onEvent(_event_handler);
-	WiFi.begin(ssid, pass);
-	
-	Serial.println("WiFi connecting with DHCP...");
 
-	//.Serial.println("WiFi connecting with static IP 192.168.1.200 (testing)...");
+	if (rtc_cache.magic != WIFI_CACHE_MAGIC) {
+		storage.load_blob("wifi", "cache", &rtc_cache, sizeof(rtc_cache));
+	}
+
+	_connect();
+}
+
+void WiFi_Tools::set_static_ip(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns) {
+	_use_static_ip = true;
+	_static_ip = ip;
+	_static_gateway = gateway;
+	_static_subnet = subnet;
+	_static_dns = dns;
 }
 
 void WiFi_Tools::reconnect() {
 	
 	if (!_should_reconnect) return;
+
+	// A directed connect that hasn't landed in time falls back to a full scan
+	if (_fast_pending && (_fast_failed || millis() - _connect_start > FAST_CONNECT_TIMEOUT)) {
+		Serial.println("\n\tfast connect failed - scanning");
+		_invalidate_cache();
+		_full_connect();
+		return;
+	}
 	
 	// Use longer interval after auth failures
 	unsigned long interval = _last_was_auth_fail ? AUTH_FAIL_RETRY_INTERVAL : RECONNECT_INTERVAL;
@@ -46,31 +69,143 @@ void WiFi_Tools::reconnect() {
 			Serial.print("...");
 		}
 		
-		// For auth failures, do a full disconnect and reconnect with credentials
+		link_monitor.on_retry();
+
+		// For auth failures, start over with a full scan and credentials
 		if (_last_was_auth_fail) {
-			WiFi.disconnect(true);
-			delay(1000);  // Longer delay for auth failures
-			WiFi.begin(_ssid, _password);  // Full reconnect with credentials
+			_invalidate_cache();
 			_last_was_auth_fail = false;  // Reset flag
-		} else {
-			// Normal disconnect
-			WiFi.disconnect();
-			delay(500);
-			WiFi.reconnect();
 		}
-		
-		_reconnect_timer = millis();
+		_connect();
+	}
+}
+
+bool WiFi_Tools::_cache_valid() {
+	return rtc_cache.magic == WIFI_CACHE_MAGIC && rtc_cache.channel != 0;
+}
+
+// Directed connect to the cached BSSID/channel so no scan is needed; the
+// address still comes from DHCP (or the configured static IP)
+void WiFi_Tools::_connect() {
+
+	if (!_cache_valid()) {
+		_full_connect();
+		return;
+	}
+
+	if (_use_static_ip) {
+		WiFi.config(_static_ip, _static_gateway, _static_subnet, _static_dns);
+	} else {
+		WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP, never a stale lease
+	}
+
+	Serial.printf("WiFi fast connect (ch %u, %02X:%02X:%02X:%02X:%02X:%02X)...\n",
+		rtc_cache.channel,
+		rtc_cache.bssid[0], rtc_cache.bssid[1], rtc_cache.bssid[2],
+		rtc_cache.bssid[3], rtc_cache.bssid[4], rtc_cache.bssid[5]);
+
+	_fast_pending = true;
+	_fast_failed = false;
+	_connect_start = millis();
+	_reconnect_timer = _connect_start;
+	_mqtt_reported = false;
+	WiFi.begin(_ssid, _password, rtc_cache.channel, rtc_cache.bssid);
+}
+
+// Switch to another AP found by the link monitor - a directed connect with
+// the usual scan fallback if it doesn't come up
+void WiFi_Tools::roam_to(const char * ssid, const char * pass, uint8_t channel, const uint8_t * bssid) {
+	strncpy(_ssid, ssid, sizeof(_ssid) - 1);
+	_ssid[sizeof(_ssid) - 1] = '\0';
+	strncpy(_password, pass, sizeof(_password) - 1);
+	_password[sizeof(_password) - 1] = '\0';
+
+	Serial.printf("\n\troaming to %s (ch %u)\n", _ssid, channel);
+
+	if (!_use_static_ip) WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // new AP may be a new subnet
+	_fast_pending = true;
+	_fast_failed = false;
+	_should_reconnect = true;
+	_connect_start = millis();
+	_reconnect_timer = _connect_start;
+	_mqtt_reported = false;
+	WiFi.disconnect();
+	WiFi.begin(_ssid, _password, channel, bssid);
+}
+
+void WiFi_Tools::_full_connect() {
+
+	if (_use_static_ip) {
+		WiFi.config(_static_ip, _static_gateway, _static_subnet, _static_dns);
+	} else {
+		WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // back to DHCP
+	}
+
+	Serial.println(_use_static_ip ? "WiFi connecting with static IP..." : "WiFi connecting with DHCP...");
+
+	_fast_pending = false;
+	_connect_start = millis();
+	_reconnect_timer = _connect_start;
+	_mqtt_reported = false;
+	WiFi.disconnect();
+	WiFi.begin(_ssid, _password);
+}
+
+void WiFi_Tools::_save_cache() {
+
+	WiFiCache fresh = {};
+	fresh.magic = WIFI_CACHE_MAGIC;
+	memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+	fresh.channel = WiFi.channel();
+
+	// Only touch flash when something actually changed
+	if (memcmp(&fresh, &rtc_cache, sizeof(fresh)) != 0) {
+		rtc_cache = fresh;
+		storage.store_blob("wifi", "cache", &rtc_cache, sizeof(rtc_cache));
+	}
+}
+
+void WiFi_Tools::_invalidate_cache() {
+	rtc_cache.magic = 0;
+	storage.clear_blob("wifi", "cache");
+}
+
+void WiFi_Tools::maintain() {
+	if (_cache_dirty) {
+		_cache_dirty = false;
+		_save_cache();
 	}
 }
 
+void WiFi_Tools::report_mqtt_connected() {
+	if (_mqtt_reported) return;
+	_time_to_mqtt = millis() - _connect_start;
+	_mqtt_reported = true;
+}
+
 void WiFi_Tools::_event_handler(WiFiEvent_t event, WiFiEventInfo_t info) {
 
 	if (wifi_tools._event_logging_enabled) wifi_tools._log_event(event, info);
-	
+	if (event < ARDUINO_EVENT_MAX) __atomic_fetch_add(&wifi_tools._event_counts[event], 1, __ATOMIC_RELAXED);
+
+	if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+		memcpy(wifi_tools._bssid, info.wifi_sta_connected.bssid, sizeof(wifi_tools._bssid));
+	}
+
 	if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
-		if (wifi_tools.is_connected) Serial.println("\n\tdisconnected...");
-		wifi_tools.is_connected = false;
 		uint8_t reason = info.wifi_sta_disconnected.reason;
+		__atomic_fetch_add(&wifi_tools._reason_counts[reason], 1, __ATOMIC_RELAXED);
+		if (wifi_tools.is_connected) {
+			Serial.println("\n\tdisconnected...");
+			link_monitor.on_disconnect();
+			// An outage runs from here to the next IP; failed attempts in between don't restart it
+			portENTER_CRITICAL(&wifi_tools._outage_lock);
+			wifi_tools._outage_start = millis() | 1;
+			wifi_tools._outage.reason = reason;
+			memcpy(wifi_tools._outage.bssid, wifi_tools._bssid, sizeof(wifi_tools._outage.bssid));
+			portEXIT_CRITICAL(&wifi_tools._outage_lock);
+		}
+		wifi_tools.is_connected = false;
 		bool user_disconnected = (reason == WIFI_REASON_ASSOC_LEAVE);
 		// Handle auth failures and timeouts specifically
 		bool auth_fail = (reason == WIFI_REASON_AUTH_EXPIRE || 
@@ -89,19 +224,29 @@ void WiFi_Tools::_event_handler(WiFiEvent_t event, WiFiEventInfo_t info) {
 		} else {
 			wifi_tools._last_was_auth_fail = false;
 		}
+
+		// The cached AP has moved, changed channel or gone - scan on the next attempt
+		if (wifi_tools._fast_pending) wifi_tools._fast_failed = true;
 		
-		wifi_tools._should_reconnect = !(user_disconnected || wifi_tools._first_disconnect);
+		wifi_tools._should_reconnect = !(user_disconnected || wifi_tools._first_disconnect) || wifi_tools._fast_pending;
 		wifi_tools._first_disconnect = false;
 	}
 
 	if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
 		if (!wifi_tools.is_connected) {
+			wifi_tools._time_to_connect = millis() - wifi_tools._connect_start;
+			wifi_tools._fast_connected = wifi_tools._fast_pending;
+			wifi_tools._fast_pending = false;
 			Serial.println("\n\tconnected!");
 			Serial.print("\tIP: ");
 			Serial.println(WiFi.localIP().toString());
+			Serial.printf("\tconnect took %lu ms (%s)\n", wifi_tools._time_to_connect,
+				wifi_tools._fast_connected ? "fast" : "scan");
 			// Reset auth fail counter on successful connection
 			wifi_tools._auth_fail_count = 0;
 			wifi_tools._last_was_auth_fail = false;
+			wifi_tools._cache_dirty = true;  // written from maintain(), not the event task
+			wifi_tools._end_outage();
 		}
 		wifi_tools.is_connected = true;
 	}
@@ -109,6 +254,58 @@ void WiFi_Tools::_event_handler(WiFiEvent_t event, WiFiEventInfo_t info) {
 }
 
 
+void WiFi_Tools::_end_outage() {
+	portENTER_CRITICAL(&_outage_lock);
+	if (_outage_start) {
+		uint32_t ms = millis() - _outage_start;
+		_outage_start = 0;
+		_outage.ms = ms;
+		_outage_pending = true;
+		_outage_history[_outages.count % WIFI_OUTAGE_HISTORY] = ms;
+		_outages.count++;
+		_outages.total_ms += ms;
+		if (ms > _outages.max_ms) _outages.max_ms = ms;
+	}
+	portEXIT_CRITICAL(&_outage_lock);
+}
+
+
+void WiFi_Tools::outage_stats(WiFiOutageStats & out) {
+	uint32_t recent[WIFI_OUTAGE_HISTORY];
+	portENTER_CRITICAL(&_outage_lock);
+	out = _outages;
+	memcpy(recent, _outage_history, sizeof(recent));
+	portEXIT_CRITICAL(&_outage_lock);
+
+	// Nearest-rank p95 of the recent outages; the sort stays out of the lock
+	size_t n = out.count < WIFI_OUTAGE_HISTORY ? out.count : WIFI_OUTAGE_HISTORY;
+	for (size_t i = 1; i < n; i++) {
+		uint32_t v = recent[i];
+		size_t j = i;
+		for (; j > 0 && recent[j - 1] > v; j--) recent[j] = recent[j - 1];
+		recent[j] = v;
+	}
+	out.p95_ms = n ? recent[(n * 95 + 99) / 100 - 1] : 0;
+}
+
+
+// The outage the last reconnect ended, once
+bool WiFi_Tools::take_outage(WiFiOutage & out) {
+	portENTER_CRITICAL(&_outage_lock);
+	bool pending = _outage_pending;
+	_outage_pending = false;
+	out = _outage;
+	portEXIT_CRITICAL(&_outage_lock);
+	return pending;
+}
+
+
+uint32_t WiFi_Tools::event_count(int event) {
+	if (event < 0 || event >= ARDUINO_EVENT_MAX) return 0;
+	return __atomic_load_n(&_event_counts[event], __ATOMIC_RELAXED);
+}
+
+
 void WiFi_Tools::log_events() {
 	_event_logging_enabled = true;
-}
\ No newline at end of file
+}
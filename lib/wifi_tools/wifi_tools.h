@@ -5,6 +5,34 @@
 #define RECONNECT_INTERVAL 10000
 #define AUTH_FAIL_RETRY_INTERVAL 30000  // 30 seconds after auth failures
 #define STATUS_LOG_INTERVAL 1000
+#define FAST_CONNECT_TIMEOUT 3000       // give a directed connect this long before scanning
+#define WIFI_CACHE_MAGIC 0xC10A5EEE
+#define WIFI_OUTAGE_HISTORY 32          // recent outages kept for the p95
+
+// Last-good AP, kept in RTC memory (survives soft resets) and mirrored to
+// NVS (survives power loss) so the next connect can skip the scan. The lease
+// isn't cached: DHCP still runs, so the address is always one the router
+// currently hands out
+struct WiFiCache {
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+// Time from losing the link to having an IP again, since boot
+struct WiFiOutageStats {
+    uint32_t count;
+    uint64_t total_ms;
+    uint32_t max_ms;
+    uint32_t p95_ms;        // over the last WIFI_OUTAGE_HISTORY outages
+};
+
+// The outage a reconnect just ended, reported once
+struct WiFiOutage {
+    uint32_t ms;
+    uint8_t reason;         // WIFI_REASON_* that started it
+    uint8_t bssid[6];       // AP it was connected to before
+};
 
 class WiFi_Tools {
 
@@ -14,10 +42,27 @@ class WiFi_Tools {
 
         void begin(const char *, const char *);
         void reconnect();
+        void maintain();
+        void set_static_ip(IPAddress, IPAddress, IPAddress, IPAddress);
+        void roam_to(const char *, const char *, uint8_t, const uint8_t *);
+        const char * ssid() { return _ssid; }
 
         void log_events();
         void log_status();
 
+        // connect timing, all in ms
+        unsigned long time_to_connect() { return _time_to_connect; }
+        unsigned long time_to_mqtt() { return _time_to_mqtt; }
+        bool fast_connected() { return _fast_connected; }
+        void report_mqtt_connected();
+
+        // disconnects seen per WIFI_REASON_* code, events per ARDUINO_EVENT_*;
+        // names in wifi_names.h
+        uint32_t reason_count(uint8_t reason) { return __atomic_load_n(&_reason_counts[reason], __ATOMIC_RELAXED); }
+        uint32_t event_count(int event);
+        void outage_stats(WiFiOutageStats &);
+        bool take_outage(WiFiOutage &);
+
         bool is_connected = false;
 
     private:
@@ -34,9 +79,39 @@ class WiFi_Tools {
         unsigned long _reconnect_timer;
         unsigned long _status_timer;
 
+        // fast connect
+        bool _use_static_ip = false;
+        IPAddress _static_ip, _static_gateway, _static_subnet, _static_dns;
+        bool _fast_pending = false;
+        bool _fast_failed = false;
+        bool _cache_dirty = false;
+        bool _fast_connected = false;
+        unsigned long _connect_start = 0;
+        unsigned long _time_to_connect = 0;
+        unsigned long _time_to_mqtt = 0;
+        bool _mqtt_reported = false;
+
+        // Written from the event task, read from the main loop
+        uint32_t _reason_counts[256] = {};
+        uint32_t _event_counts[ARDUINO_EVENT_MAX] = {};
+        portMUX_TYPE _outage_lock = portMUX_INITIALIZER_UNLOCKED;
+        uint8_t _bssid[6] = {};             // AP of the current association
+        unsigned long _outage_start = 0;    // 0 = link up (or never up yet)
+        WiFiOutage _outage = {};
+        bool _outage_pending = false;
+        WiFiOutageStats _outages = {};
+        uint32_t _outage_history[WIFI_OUTAGE_HISTORY] = {};
+
+        bool _cache_valid();
+        void _connect();
+        void _full_connect();
+        void _save_cache();
+        void _invalidate_cache();
+        void _end_outage();
+
         static void _event_handler(WiFiEvent_t, WiFiEventInfo_t);
         void _log_event(WiFiEvent_t, WiFiEventInfo_t);
 
 };
 
-extern WiFi_Tools wifi_tools;
\ No newline at end of file
+extern WiFi_Tools wifi_tools;
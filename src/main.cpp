@@ -1,166 +1,138 @@
 #include "wifi_tools.h"
+#include "link_monitor.h"
 #include "provisioner.h"
 #include "storage.h"
 #include "credentials.h"
 #include "mqtt.h"
 #include "device.h"
 #include "telnet.h"
-#include <ArduinoOTA.h>
-#include <ESPmDNS.h>
+#include "boot.h"
+#include "webapi.h"
+#include "metrics.h"
+#include "timebase.h"
+#include "memory_monitor.h"
+#include "identity.h"
+#include "topics.h"
+#include "power.h"
+#include "rpc.h"
+#include "series.h"
+#include "protection.h"
+#include "ota.h"
+#include "sweep.h"
 #include <esp_task_wdt.h> // For watchdog control
 
+#ifndef NTP_SERVER
+#define NTP_SERVER NTP_DEFAULT_SERVER
+#endif
+#ifndef DEVICE_NAME
+#define DEVICE_NAME ""      // topic id falls back to the MAC
+#endif
+
 // #define CLEAR_CREDS
-int Delay = 100; // Main loop delay in ms (faster for better OTA response)
-bool otaInProgress = false; // Flag to pause operations during OTA
+// #define USE_PROVISIONER // Captive portal when no credentials are stored
+int Delay = 100; // Main loop delay in ms
 
-void setupOTA()
+// Start WiFi - the connection completes in the background from loop()
+void start_wifi(const char *ssid, const char *pass)
 {
-    // Start mDNS for hostname resolution
-    if (!MDNS.begin("filter-chlorine"))
-    {
-        telnet.println("\tError setting up mDNS");
-    }
-    else
-    {
-        telnet.println("\tmDNS started: filter-chlorine.local");
-    }
-
-    ArduinoOTA.setHostname("filter-chlorine");
-    ArduinoOTA.setPassword("admin");
-    ArduinoOTA.setPort(3232);
-
-    ArduinoOTA.onStart([]()
-                       {
-        otaInProgress = true; // Pause other operations
-        mqtt.report_disconnect(); // Disconnect MQTT before OTA
-        
-        // Boost WiFi power for stable OTA transfer
-        WiFi.setTxPower(WIFI_POWER_19_5dBm);
-        
-        String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
-        Serial.println("\n\tOTA: Updating " + type);
-        Serial.println("\tOTA: Disconnecting MQTT...");
-        Serial.printf("\tOTA: Free heap: %u bytes\n", ESP.getFreeHeap()); });
-
-    ArduinoOTA.onEnd([]()
-                     { 
-        otaInProgress = false;
-        Serial.println("\n\tOTA: Complete");
-        Serial.println("\tOTA: Rebooting..."); });
-
-    ArduinoOTA.onProgress([](unsigned int progress, unsigned int total)
-                          { 
-        static unsigned long lastPrint = 0;
-        unsigned long now = millis();
-        if (now - lastPrint > 1000) {
-            Serial.printf("OTA Progress: %u%% (Heap: %u)\r", 
-                (progress / (total / 100)), 
-                ESP.getFreeHeap());
-            lastPrint = now;
-        }
-        yield(); // Allow WiFi stack to process packets
-    });
-
-    ArduinoOTA.onError([](ota_error_t error)
-                       {
-        otaInProgress = false; // Reset flag on error
-        Serial.print("\tOTA Error: ");
-        switch(error) {
-            case OTA_AUTH_ERROR: 
-                Serial.println("Auth Failed"); 
-                break;
-            case OTA_BEGIN_ERROR: 
-                Serial.println("Begin Failed - Check partition size"); 
-                break;
-            case OTA_CONNECT_ERROR: 
-                Serial.println("Connect Failed"); 
-                break;
-            case OTA_RECEIVE_ERROR: 
-                Serial.println("Receive Failed - Upload interrupted"); 
-                break;
-            case OTA_END_ERROR: 
-                Serial.println("End Failed - Verification error"); 
-                break;
-            default:
-                Serial.println("Unknown error");
-                break;
-        }
-    });
-
-    ArduinoOTA.begin();
-    telnet.println("\tOTA ready");
+    wifi_tools.log_events();
+#ifdef WIFI_STATIC_IP
+    wifi_tools.set_static_ip(WIFI_STATIC_IP, WIFI_GATEWAY, WIFI_SUBNET, WIFI_DNS);
+#endif
+    link_monitor.add_candidate(ssid, pass);
+#ifdef WIFI_ALT_SSID
+    link_monitor.add_candidate(WIFI_ALT_SSID, WIFI_ALT_PASS);
+#endif
+    wifi_tools.begin(ssid, pass);
 }
 
 void setup()
 {
+    boot_timeline.mark("reset");
     Serial.begin(115200);
     Serial.println("\n\tChorinator Starting...\n");
+    identity.begin(DEVICE_NAME);
+    topics.begin(identity.id());
+    memory_monitor.begin();
+    power.begin();
+    boot_timeline.mark("serial");
+
+    // Control plane first: I2C, INA219 and motor come up before any networking
+    device.setup();
+    series.begin();
+    boot_timeline.mark("device");
 
     // Handle credentials
-    char ssid[32] = {WIFI_SSID};
-    char pass[32] = {WIFI_PASS};
+    char ssid[33] = {WIFI_SSID};
+    char pass[65] = {WIFI_PASS};
     
 #ifdef CLEAR_CREDS
     //telnet.println("\tClearing credentials");
     //storage.clear_creds();
 #endif
- //   if (!storage.creds_already_exist(ssid, pass))
-   // {
-     //   provisioner.get_creds(ssid, pass);
-       // storage.store_creds(ssid, pass);
-   // }
-
-    // Connect WiFi
-    wifi_tools.log_events();
-    wifi_tools.begin(ssid, pass);
-
-    Serial.print("\tConnecting to WiFi");
-    int connect_attempts = 0;
-    const int max_attempts = 40;  // 20 seconds total
-    while (WiFi.status() != WL_CONNECTED && connect_attempts < max_attempts)
-    {
-        delay(500);
-        Serial.print(".");
-        connect_attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED)
+#ifdef USE_PROVISIONER
+    if (!storage.creds_already_exist(ssid, pass))
     {
-        Serial.println(" connected!");
-        Serial.print("\tIP Address: ");
-        Serial.println(WiFi.localIP());
+        // Credentials arrive from loop() - the cell keeps running meanwhile
+        provisioner.begin();
     }
     else
+#endif
     {
-        Serial.println(" timeout!");
-        Serial.println("\tWill continue trying in background...");
+        start_wifi(ssid, pass);
     }
-
-    // Setup services
-    setupOTA();
-
     mqtt.setup(MQTT_HOST, mqtt_user, mqtt_password, MQTT_PORT);
-    device.setup();
-    telnet.setup();  // Initialize telnet server after WiFi is connected
+    boot_timeline.mark("wifi_begin");
+
+    Serial.println("\tSetup complete - network continues in background\n");
+}
 
-    Serial.println("\tSetup complete\n");
+// Network services that need an interface, started on the first connection
+void start_network_services()
+{
+    static bool started = false;
+    if (started) return;
+    started = true;
+    boot_timeline.mark("wifi");
+
+    timebase.begin(NTP_SERVER);
+    ota.begin(device.motor);
+    telnet.setup();
+    webapi.setup();
+    boot_timeline.mark("services");
     telnet.println("\tSetup complete - Telnet ready\n");
 }
 
 void loop()
 {
-    // OTA has highest priority - dedicated fast loop during upload
-    if (otaInProgress) {
-        ArduinoOTA.handle();
-        yield(); // Allow ESP32 to handle background tasks
-        return;
-    }
-    
-    // Always handle OTA with high priority
-    ArduinoOTA.handle();
-    
+    static uint32_t lastPass = micros();
+    uint32_t now = micros();
+    loop_latency.observe(now - lastPass);
+    lastPass = now;
+
     // Handle telnet constantly to prevent disconnections
-    telnet.loop();
+    {
+        MemoryScope scope(MEM_TELNET);
+        telnet.loop();
+    }
+    {
+        MemoryScope scope(MEM_WEBAPI);
+        webapi.loop();
+    }
+
+    // Captive portal is serviced every pass so probes are answered immediately
+    if (provisioner.is_active())
+    {
+        provisioner.loop();
+        if (provisioner.is_complete())
+        {
+            char ssid[33], pass[65];
+            provisioner.get_creds(ssid, pass);
+            storage.store_creds(ssid, pass);
+            provisioner.end();
+            start_wifi(ssid, pass);
+        }
+    }
     
     static unsigned long lastLoop = 0;
     if (millis() - lastLoop >= Delay)
@@ -170,14 +142,51 @@ void loop()
 
         if (wifi_tools.is_connected)
         {
-            mqtt.maintain();
-            device.loop();
+            start_network_services();
+            {
+                MemoryScope scope(MEM_NETWORK);
+                wifi_tools.maintain();
+                link_monitor.loop();
+            }
+            {
+                MemoryScope scope(MEM_MQTT);
+                mqtt.maintain();
+                rpc.loop();
+            }
+
+            if (mqtt.is_connected() && !boot_timeline.is_published())
+            {
+                boot_timeline.mark("mqtt");
+                boot_timeline.print();
+                boot_timeline.publish();
+                device.report_online();
+            }
             //telnet.print("\r\n");
         }
-        else
+        else if (!provisioner.is_active())
         {
+            link_monitor.loop();    // applies full TX power after a disconnect
             wifi_tools.reconnect();
             // Don't force disconnect - maintain() will handle it
         }
+
+        // Cell control runs regardless of network state
+        protection.loop();
+        {
+            MemoryScope scope(MEM_DEVICE);
+            device.loop();
+            sweep.loop();
+        }
+        series.loop();
+        {
+            MemoryScope scope(MEM_OTA);
+            ota.loop();     // transfers run on their own task; this reports them and reboots
+        }
+        memory_monitor.loop();
+        power.loop();
     }
-}
\ No newline at end of file
+
+    // Block until the next pass is due so the CPU can clock down (not in performance mode)
+    unsigned long sinceLoop = millis() - lastLoop;
+    power.idle(sinceLoop < (unsigned long) Delay ? Delay - sinceLoop : 0);
+}